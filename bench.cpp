@@ -0,0 +1,355 @@
+#include "meshview/meshview.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <Eigen/Geometry>
+
+using namespace meshview;
+
+// Camera fly-through benchmark on a generated scene:
+// a grid of spheres with vertex colors, a textured cube and a point cloud,
+// all generated from fixed seeds so that runs are comparable across versions
+// (with --obj, OBJ loading throughput instead; with --codec, compressed
+// mesh size and decode speed; with --export, mesh saving throughput)
+namespace {
+void usage(const char* prog) {
+    std::cerr
+        << "Usage: " << prog << " [options]\n"
+        << "  --frames N       measured frames (default 500)\n"
+        << "  --warmup N       warmup frames (default 20)\n"
+        << "  --size WxH       window/image size (default 1280x720)\n"
+        << "  --headless       render offscreen instead of in a window\n"
+        << "  --software       use the software rasterizer (with --headless)\n"
+        << "  --grid N         N x N spheres (default 8)\n"
+        << "  --rings N        rings/sectors per sphere (default 64)\n"
+        << "  --points N       point cloud size (default 100000)\n"
+        << "  --csv PATH       write per-frame times to PATH\n"
+        << "  --obj PATH       instead, time loading the OBJ file PATH with\n"
+        << "                   Mesh::load_basic_obj and a std::getline /\n"
+        << "                   std::stringstream reference loader\n"
+        << "  --codec PATH     instead, compare Mesh::save_compressed /\n"
+        << "                   load_compressed with binary PLY on the mesh\n"
+        << "                   PATH (.ply or .obj), or on Mesh::Sphere if\n"
+        << "                   PATH is 'sphere'\n"
+        << "  --export PATH    instead, time saving the mesh PATH (as for\n"
+        << "                   --codec) with Mesh::save_basic_obj, a\n"
+        << "                   std::ofstream reference writer and the other\n"
+        << "                   formats of Mesh::save\n";
+}
+
+// Reference OBJ loader: the line-by-line std::getline/std::stringstream
+// approach Mesh::load_basic_obj used to take (v and triangle f lines only)
+void load_obj_reference(const std::string& path, std::vector<float>& verts,
+                        std::vector<Index>& faces) {
+    std::ifstream ifs(path);
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.size() < 2 || line[1] != ' ') continue;
+        if (line[0] == 'v') {
+            std::stringstream ss(line.substr(2));
+            double tmp;
+            while (ss >> tmp) verts.push_back((float)tmp);
+        } else if (line[0] == 'f') {
+            std::stringstream ss(line.substr(2));
+            std::string corner;
+            while (ss >> corner) {
+                faces.push_back((Index)std::atoll(corner.c_str()) - 1);
+            }
+        }
+    }
+}
+
+// Reference OBJ writer: the per-value std::ofstream insertion and
+// per-vertex homogeneous transform Mesh::save_basic_obj used to take
+void save_obj_reference(const Mesh& mesh, const std::string& path) {
+    std::ofstream ofs(path);
+    for (int i = 0; i < mesh.data.rows(); ++i) {
+        ofs << "v";
+        Vector4f v = mesh.transform *
+                     mesh.data.block<1, 3>(i, 0).transpose().homogeneous();
+        for (int j = 0; j < 3; ++j) ofs << " " << v(j);
+        if (mesh.shading_type == Mesh::ShadingType::vertex) {
+            for (int j = 3; j < 6; ++j) ofs << " " << mesh.data(i, j);
+        }
+        ofs << "\n";
+    }
+    for (int i = 0; i < mesh.faces.rows(); ++i) {
+        ofs << "f";
+        for (int j = 0; j < 3; ++j) ofs << " " << mesh.faces(i, j) + 1;
+        ofs << "\n";
+    }
+}
+
+double seconds_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(
+               std::chrono::high_resolution_clock::now() - start)
+        .count();
+}
+
+// Time both loaders on path (best of runs) and print the speedup
+int bench_obj(const std::string& path, int runs) {
+    using clock = std::chrono::high_resolution_clock;
+    double ref_s = 0.0, load_s = 0.0;
+    size_t ref_floats = 0, ref_indices = 0, n_verts = 0, n_faces = 0;
+    for (int i = 0; i < runs; ++i) {
+        auto start = clock::now();
+        std::vector<float> verts;
+        std::vector<Index> faces;
+        load_obj_reference(path, verts, faces);
+        const double t = seconds_since(start);
+        ref_s = i ? std::min(ref_s, t) : t;
+        ref_floats = verts.size();
+        ref_indices = faces.size();
+
+        start = clock::now();
+        Mesh mesh;
+        mesh.load_basic_obj(path);
+        const double u = seconds_since(start);
+        load_s = i ? std::min(load_s, u) : u;
+        n_verts = mesh.data.rows();
+        n_faces = mesh.faces.rows();
+    }
+    std::cout << "meshview OBJ load benchmark: " << path << "\n"
+              << "  " << n_verts << " vertices, " << n_faces << " triangles"
+              << " (reference: " << ref_floats << " floats, " << ref_indices
+              << " indices)\n"
+              << "  reference       " << ref_s * 1e3 << " ms\n"
+              << "  load_basic_obj  " << load_s * 1e3 << " ms\n"
+              << "  speedup         " << ref_s / std::max(load_s, 1e-9)
+              << "x\n";
+    return 0;
+}
+size_t file_size(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary | std::ios::ate);
+    return ifs ? (size_t)ifs.tellg() : 0;
+}
+
+// Load the mesh of --codec/--export: a .ply or .obj file, or a
+// 1024 x 1024 Mesh::Sphere for 'sphere'
+bool load_bench_mesh(const std::string& path, Mesh& mesh) {
+    if (path == "sphere") {
+        mesh = Mesh::Sphere(1024, 1024);
+        // Keep its exact normals
+        mesh.verts_norm();
+    } else if (path.size() > 4 &&
+               path.compare(path.size() - 4, 4, ".ply") == 0) {
+        return mesh.load_ply(path);
+    } else {
+        mesh.load_basic_obj(path);
+    }
+    return true;
+}
+
+// Compressed size and load time against binary PLY (both read from the
+// page cache, best of runs)
+int bench_codec(const std::string& path, int runs) {
+    using clock = std::chrono::high_resolution_clock;
+    Mesh mesh;
+    if (!load_bench_mesh(path, mesh)) return 1;
+    const std::string ply_path = "meshview-codec-bench.ply";
+    const std::string mvz_path = "meshview-codec-bench.mvz";
+    if (!mesh.save_ply(ply_path)) return 1;
+    auto start = clock::now();
+    if (!mesh.save_compressed(mvz_path)) return 1;
+    const double encode_s = seconds_since(start);
+    double ply_s = 0.0, mvz_s = 0.0;
+    for (int i = 0; i < runs; ++i) {
+        Mesh loaded;
+        start = clock::now();
+        loaded.load_ply(ply_path);
+        const double t = seconds_since(start);
+        ply_s = i ? std::min(ply_s, t) : t;
+        start = clock::now();
+        loaded.load_compressed(mvz_path);
+        const double u = seconds_since(start);
+        mvz_s = i ? std::min(mvz_s, u) : u;
+    }
+    const size_t ply_bytes = file_size(ply_path);
+    const size_t mvz_bytes = file_size(mvz_path);
+    std::remove(ply_path.c_str());
+    std::remove(mvz_path.c_str());
+    std::cout << "meshview mesh codec benchmark: " << path << "\n"
+              << "  " << mesh.data.rows() << " vertices, " << mesh.faces.rows()
+              << " triangles\n"
+              << "  binary PLY      " << ply_bytes << " bytes, load "
+              << ply_s * 1e3 << " ms\n"
+              << "  compressed      " << mvz_bytes << " bytes ("
+              << (double)ply_bytes / std::max<size_t>(mvz_bytes, 1)
+              << "x smaller), encode " << encode_s * 1e3 << " ms, load "
+              << mvz_s * 1e3 << " ms\n"
+              << "  decode speed    " << ply_bytes / std::max(mvz_s, 1e-9) / 1e9
+              << " GB/s of PLY data\n";
+    return 0;
+}
+
+// Save time of each writer (into the page cache, best of runs) and the
+// file sizes
+int bench_export(const std::string& path, int runs) {
+    using clock = std::chrono::high_resolution_clock;
+    Mesh mesh;
+    if (!load_bench_mesh(path, mesh)) return 1;
+    const std::string base = "meshview-export-bench";
+    struct Writer {
+        const char* name;
+        std::string path;
+        std::function<bool(const std::string&)> save;
+        double seconds = 0.0;
+    } writers[] = {
+        {"reference OBJ ", base + "-ref.obj",
+         [&](const std::string& p) {
+             save_obj_reference(mesh, p);
+             return true;
+         }},
+        {"save_basic_obj", base + ".obj",
+         [&](const std::string& p) { return mesh.save_basic_obj(p); }},
+        {"ASCII PLY     ", base + "-ascii.ply",
+         [&](const std::string& p) { return mesh.save_ply(p, false); }},
+        {"binary PLY    ", base + ".ply",
+         [&](const std::string& p) { return mesh.save(p); }},
+        {"compressed    ", base + ".mvz",
+         [&](const std::string& p) { return mesh.save(p); }},
+        {"scene cache   ", base + ".mvc",
+         [&](const std::string& p) { return mesh.save(p); }},
+    };
+    for (Writer& writer : writers) {
+        for (int i = 0; i < runs; ++i) {
+            const auto start = clock::now();
+            if (!writer.save(writer.path)) return 1;
+            const double t = seconds_since(start);
+            writer.seconds = i ? std::min(writer.seconds, t) : t;
+        }
+    }
+    std::cout << "meshview mesh export benchmark: " << path << "\n"
+              << "  " << mesh.data.rows() << " vertices, " << mesh.faces.rows()
+              << " triangles\n";
+    for (const Writer& writer : writers) {
+        std::cout << "  " << writer.name << "  " << writer.seconds * 1e3
+                  << " ms, " << file_size(writer.path) << " bytes";
+        if (&writer != writers) {
+            std::cout << " (" << writers[0].seconds /
+                                     std::max(writer.seconds, 1e-9)
+                      << "x the reference speed)";
+        }
+        std::cout << "\n";
+        std::remove(writer.path.c_str());
+    }
+    return 0;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    Viewer::BenchmarkOptions options;
+    options.width = 1280;
+    options.height = 720;
+    int grid = 8, rings = 64, n_points = 100000;
+    bool software = false;
+    std::string csv_path, obj_path, codec_path, export_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--frames" && has_value) {
+            options.frames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--warmup" && has_value) {
+            options.warmup_frames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--size" && has_value) {
+            const char* size = argv[++i];
+            const char* x = std::strchr(size, 'x');
+            if (!x) {
+                usage(argv[0]);
+                return 1;
+            }
+            options.width = std::atoi(size);
+            options.height = std::atoi(x + 1);
+        } else if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--software") {
+            software = true;
+        } else if (arg == "--grid" && has_value) {
+            grid = std::atoi(argv[++i]);
+        } else if (arg == "--rings" && has_value) {
+            rings = std::atoi(argv[++i]);
+        } else if (arg == "--points" && has_value) {
+            n_points = std::atoi(argv[++i]);
+        } else if (arg == "--csv" && has_value) {
+            csv_path = argv[++i];
+        } else if (arg == "--obj" && has_value) {
+            obj_path = argv[++i];
+        } else if (arg == "--codec" && has_value) {
+            codec_path = argv[++i];
+        } else if (arg == "--export" && has_value) {
+            export_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+    if (!obj_path.empty()) return bench_obj(obj_path, 3);
+    if (!codec_path.empty()) return bench_codec(codec_path, 5);
+    if (!export_path.empty()) return bench_export(export_path, 3);
+
+    Viewer viewer;
+    viewer.software_rendering = software;
+    viewer.title = "meshview benchmark";
+
+    // * Scene
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unif(0.f, 1.f);
+    const float spacing = 1.2f;
+    const float offset = 0.5f * spacing * (grid - 1);
+    for (int r = 0; r < grid; ++r) {
+        for (int c = 0; c < grid; ++c) {
+            Mesh sphere = Mesh::Sphere(rings, rings);
+            Points colors(sphere.data.rows(), 3);
+            for (int i = 0; i < colors.rows(); ++i) {
+                colors.row(i) << unif(rng), unif(rng), unif(rng);
+            }
+            viewer
+                .add_mesh(sphere.verts_pos() * 0.5f, sphere.faces, colors)
+                .translate(
+                    Vector3f(c * spacing - offset, 0.f, r * spacing - offset));
+        }
+    }
+    Image tex(256, 256 * 3);
+    for (int i = 0; i < 256; ++i) {
+        for (int j = 0; j < 256; ++j) {
+            const float check = ((i / 32 + j / 32) % 2) ? 1.f : 0.2f;
+            tex.block<1, 3>(i, j * 3) << check, i / 255.f, j / 255.f;
+        }
+    }
+    viewer.add_cube(Vector3f(0.f, 1.5f, 0.f), 1.f).add_texture(tex, 3);
+    Points points(n_points, 3);
+    for (int i = 0; i < n_points; ++i) {
+        points.row(i) << (unif(rng) - 0.5f) * 2.f * (offset + 1.f),
+            -0.8f - unif(rng) * 0.2f, (unif(rng) - 0.5f) * 2.f * (offset + 1.f);
+    }
+    viewer.add_point_cloud(points, 0.6f, 0.8f, 1.f).set_point_size(2.f);
+
+    // * Path: orbit, diving in towards the center halfway
+    const float dist = 2.f * (offset + 1.f);
+    for (int i = 0; i <= 8; ++i) {
+        Camera key;
+        key.yaw = -M_PI / 2 + i * M_PI / 4;
+        key.pitch = -0.5f + 0.2f * std::abs(i - 4) / 4.f;
+        key.dist_to_center = dist * (0.5f + 0.5f * std::abs(i - 4) / 4.f);
+        key.fovy = M_PI / 4.f;
+        options.keyframes.push_back(key);
+    }
+
+    const Viewer::BenchmarkResult result = viewer.benchmark(options);
+    if (result.frame_ms.empty()) {
+        std::cerr << "Benchmark did not run\n";
+        return 1;
+    }
+    result.print(std::cout);
+    if (!csv_path.empty() && !result.write_csv(csv_path)) return 1;
+    return 0;
+}
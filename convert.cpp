@@ -0,0 +1,125 @@
+#include "meshview/meshview.hpp"
+#include "meshview/cache.hpp"
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace meshview;
+
+// Converts models to a meshview scene cache (.mvc), which Viewer::add_cache
+// reopens without parsing
+namespace {
+void usage(const char* prog) {
+    std::cerr << "Usage: " << prog
+              << " [--raw-textures] INPUT... OUTPUT.mvc\n"
+              << "  INPUT          .obj (with its materials), .gltf/.glb,\n"
+              << "                 .ply (mesh, or point cloud if it has no\n"
+              << "                 faces) or .mvc\n"
+              << "  --raw-textures store decoded texture pixels instead of\n"
+              << "                 the image files\n";
+}
+
+bool ends_with(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+double ms_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::high_resolution_clock::now() - start)
+        .count();
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    bool raw_textures = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--raw-textures") {
+            raw_textures = true;
+        } else if (arg == "--help" || arg == "-h") {
+            usage(argv[0]);
+            return 0;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    const std::string output = paths.back();
+    paths.pop_back();
+
+    using clock = std::chrono::high_resolution_clock;
+    auto start = clock::now();
+    std::vector<std::unique_ptr<Mesh>> meshes;
+    std::vector<std::unique_ptr<PointCloud>> point_clouds;
+    for (auto& path : paths) {
+        if (ends_with(path, ".obj") || ends_with(path, ".gltf") ||
+            ends_with(path, ".glb")) {
+            auto loaded = ends_with(path, ".obj") ? Mesh::load_obj(path)
+                                                  : Mesh::load_gltf(path);
+            if (loaded.empty()) return 1;
+            for (auto& mesh : loaded) meshes.push_back(std::move(mesh));
+        } else if (ends_with(path, ".ply")) {
+            auto mesh = std::make_unique<Mesh>();
+            if (!mesh->load_ply(path)) return 1;
+            if (mesh->faces.rows()) {
+                meshes.push_back(std::move(mesh));
+            } else {
+                auto pc = std::make_unique<PointCloud>();
+                if (!pc->load_ply(path)) return 1;
+                point_clouds.push_back(std::move(pc));
+            }
+        } else if (ends_with(path, ".mvc")) {
+            SceneCache cache;
+            if (!cache.open(path)) return 1;
+            for (size_t i = 0; i < cache.num_meshes(); ++i) {
+                meshes.push_back(cache.load_mesh(i));
+            }
+            for (size_t i = 0; i < cache.num_point_clouds(); ++i) {
+                point_clouds.push_back(cache.load_point_cloud(i));
+            }
+        } else {
+            std::cerr << "Unknown input format: " << path << "\n";
+            return 1;
+        }
+    }
+    const double load_ms = ms_since(start);
+
+    std::vector<const Mesh*> mesh_ptrs;
+    std::vector<const PointCloud*> point_cloud_ptrs;
+    for (auto& mesh : meshes) mesh_ptrs.push_back(mesh.get());
+    for (auto& pc : point_clouds) point_cloud_ptrs.push_back(pc.get());
+    start = clock::now();
+    if (!SceneCache::write(output, mesh_ptrs, point_cloud_ptrs,
+                           raw_textures)) {
+        return 1;
+    }
+    const double write_ms = ms_since(start);
+
+    // Time reopening, as Viewer::add_cache would
+    start = clock::now();
+    SceneCache cache;
+    if (!cache.open(output)) return 1;
+    size_t n_verts = 0;
+    for (size_t i = 0; i < cache.num_meshes(); ++i) {
+        n_verts += cache.load_mesh(i)->data.rows();
+    }
+    for (size_t i = 0; i < cache.num_point_clouds(); ++i) {
+        n_verts += cache.load_point_cloud(i)->data.rows();
+    }
+    const double reopen_ms = ms_since(start);
+
+    std::cout << output << ": " << meshes.size() << " meshes, "
+              << point_clouds.size() << " point clouds, " << n_verts
+              << " vertices\n"
+              << "  load inputs  " << load_ms << " ms\n"
+              << "  write cache  " << write_ms << " ms\n"
+              << "  reopen cache " << reopen_ms << " ms\n";
+    return 0;
+}
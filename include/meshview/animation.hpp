@@ -0,0 +1,165 @@
+#pragma once
+#ifndef MESHVIEW_ANIMATION_BAD4B2CA_F846_43FD_A966_8DD69A7ED4CC
+#define MESHVIEW_ANIMATION_BAD4B2CA_F846_43FD_A966_8DD69A7ED4CC
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "meshview/common.hpp"
+
+namespace meshview {
+namespace internal {
+class MappedFile;
+}  // namespace internal
+
+class Mesh;
+
+// A sequence of vertex positions (and optionally normals) of a mesh of
+// fixed topology, e.g. simulation output or per-frame body model fits,
+// read from a memory-mapped file so that only the frames shown are paged
+// in. While playing, a background thread reads the next prefetch_frames
+// frames ahead (in playback direction) so the render thread does not wait
+// on the disk.
+//
+// File layout (.mva, host byte order, checked on open): a 64-byte header,
+// then per frame num_verts x 3 float positions followed, if has_normals(),
+// by num_verts x 3 float normals. Files of raw float32 frames without a
+// header can be opened with open_raw. Write .mva files with Writer.
+//
+// Playback is driven by advance(), which Viewer calls each frame for
+// animations added with Viewer::add_animation.
+class MeshAnimation {
+   public:
+    MeshAnimation();
+    ~MeshAnimation();
+    MeshAnimation(const MeshAnimation&) = delete;
+    MeshAnimation& operator=(const MeshAnimation&) = delete;
+
+    // Map a .mva file; prints an error and returns false if it is not one
+    bool open(const std::string& path);
+    // Map a file of raw float32 frames, each num_verts x 3 positions
+    // followed by num_verts x 3 normals if normals (size must be a whole
+    // number of frames)
+    bool open_raw(const std::string& path, size_t num_verts,
+                  bool normals = false, float fps = 30.f);
+    void close();
+    bool is_open() const;
+
+    inline size_t num_frames() const { return _num_frames; }
+    inline size_t num_verts() const { return _num_verts; }
+    inline bool has_normals() const { return _normals; }
+
+    // Views of a frame inside the mapping (valid until close);
+    // normals is empty without normals
+    Eigen::Map<const Points> positions(size_t frame) const;
+    Eigen::Map<const Points> normals(size_t frame) const;
+
+    // Copy frame into the positions (and normals, which disables normal
+    // estimation, see Mesh::verts_norm) of mesh; call mesh.update() (or
+    // Viewer::update) afterwards. False if the frame is out of range or
+    // the vertex count differs.
+    bool apply(size_t frame, Mesh& mesh) const;
+
+    // * Playback
+    // Frames per second at speed 1 (from the file for .mva)
+    float fps = 30.f;
+    // Playback speed multiplier; negative plays backwards
+    float speed = 1.f;
+    // Wrap around at the ends (else pause at the last frame)
+    bool loop = true;
+    // Number of frames read ahead while playing or after seek
+    size_t prefetch_frames = 8;
+    // Mesh shown by Viewer (see Viewer::add_animation)
+    Mesh* mesh = nullptr;
+
+    void play();
+    void pause();
+    inline bool playing() const { return _playing; }
+    // Jump to frame (clamped), prefetching the frames after it
+    void seek(size_t frame);
+    inline size_t current_frame() const { return _frame; }
+
+    // Move the playback position to time (seconds, any monotonic clock;
+    // the first call after play() only starts the clock). Returns true if
+    // the current frame changed since the last call, including by seek().
+    bool advance(double time);
+    // Seconds from time until advance() would reach the next frame
+    // (0 if it is due, infinity if paused)
+    double time_to_next_frame(double time) const;
+
+    // Writes .mva files one frame at a time
+    class Writer {
+       public:
+        Writer();
+        ~Writer();
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        // Create path and write the header; false on failure
+        bool open(const std::string& path, size_t num_verts,
+                  bool normals = false, float fps = 30.f);
+        // Append a frame: num_verts x 3 positions, and normals if the file
+        // has them. False on a size mismatch or write error.
+        bool add_frame(const Eigen::Ref<const Points>& positions,
+                       const Eigen::Ref<const Points>& normals = Points());
+        // Record the frame count in the header and close the file
+        // (done by the destructor too); false on write error
+        bool close();
+
+        inline size_t num_frames() const { return _num_frames; }
+
+       private:
+        // Write rows x 3 floats
+        bool write(const Eigen::Ref<const Points>& values);
+
+        std::unique_ptr<std::ofstream> _ofs;
+        size_t _num_verts = 0, _num_frames = 0;
+        bool _normals = false;
+    };
+
+   private:
+    bool map(const std::string& path);
+    // Start the prefetch thread if needed and read ahead from frame
+    void request_prefetch(size_t frame);
+    void prefetcher();
+    // Read the pages of frame into memory
+    void touch(size_t frame) const;
+    // Stop the prefetch thread
+    void stop_prefetcher();
+
+    std::unique_ptr<internal::MappedFile> _file;
+    size_t _num_frames = 0, _num_verts = 0;
+    bool _normals = false;
+    // Offset of the first frame and bytes per frame in the file
+    size_t _offset = 0, _frame_bytes = 0;
+
+    bool _playing = false;
+    // Playback position in frames; clock time of the last advance (< 0:
+    // not started)
+    double _position = 0.0, _last_time = -1.0;
+    size_t _frame = 0;
+    // Frame changed since the last advance
+    bool _changed = true;
+
+    std::thread _prefetch_thread;
+    std::mutex _prefetch_mtx;
+    std::condition_variable _prefetch_cv;
+    bool _prefetch_stop = false;
+    // Pending read-ahead request (under _prefetch_mtx)
+    bool _prefetch_pending = false;
+    size_t _prefetch_frame = 0, _prefetch_count = 0;
+    int _prefetch_step = 1;
+    bool _prefetch_wrap = true;
+    // Set when a new request supersedes the one being read
+    std::atomic<bool> _prefetch_restart{false};
+};
+
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_ANIMATION_BAD4B2CA_F846_43FD_A966_8DD69A7ED4CC
@@ -0,0 +1,212 @@
+#pragma once
+#ifndef MESHVIEW_BACKEND_0C36E7D4_51B9_4E0A_9C0B_2B3F6C5D8A17
+#define MESHVIEW_BACKEND_0C36E7D4_51B9_4E0A_9C0B_2B3F6C5D8A17
+
+#include <cstddef>
+#include "meshview/common.hpp"
+
+namespace meshview {
+
+// Thin interface over the graphics calls made by meshview's scene pipeline
+// (Mesh, PointCloud, Texture, shaders and Viewer::draw_scene).
+// Enum arguments (targets, formats, primitive modes, ...) take OpenGL values,
+// so the GL backend is a direct pass-through.
+class Backend {
+   public:
+    virtual ~Backend() = default;
+
+    // Whether a rendering context is available; uploads are skipped if not
+    virtual bool has_context() = 0;
+
+    // * Buffers
+    virtual void gen_buffers(int n, Index* ids) = 0;
+    virtual void delete_buffers(int n, const Index* ids) = 0;
+    virtual void bind_buffer(unsigned target, Index id) = 0;
+    virtual void buffer_data(unsigned target, size_t size, const void* data,
+                             unsigned usage) = 0;
+
+    // * Vertex arrays
+    virtual void gen_vertex_arrays(int n, Index* ids) = 0;
+    virtual void delete_vertex_arrays(int n, const Index* ids) = 0;
+    virtual void bind_vertex_array(Index id) = 0;
+    // Enable float vertex attribute index and set its layout in the bound
+    // array buffer
+    virtual void vertex_attrib_pointer(Index index, int size, size_t stride,
+                                       size_t offset) = 0;
+
+    // * Textures
+    virtual void gen_textures(int n, Index* ids) = 0;
+    virtual void delete_textures(int n, const Index* ids) = 0;
+    // unit: texture unit index (0 = GL_TEXTURE0)
+    virtual void active_texture(Index unit) = 0;
+    virtual void bind_texture(unsigned target, Index id) = 0;
+    virtual void tex_parameter(unsigned target, unsigned pname, int value) = 0;
+    virtual void tex_image_2d(unsigned target, int level, int internal_format,
+                              int width, int height, unsigned format,
+                              unsigned type, const void* data) = 0;
+    virtual void generate_mipmap(unsigned target) = 0;
+
+    // * Shader programs
+    // Compile and link a program; geometry may be empty
+    virtual Index create_program(const char* vertex, const char* fragment,
+                                 const char* geometry) = 0;
+    virtual void delete_program(Index id) = 0;
+    virtual void use_program(Index id) = 0;
+    virtual int uniform_location(Index program, const char* name) = 0;
+    virtual void uniform_int(int location, int value) = 0;
+    virtual void uniform_float(int location, float value) = 0;
+    // Set float vector uniform with 2-4 components
+    virtual void uniform_vec(int location, int components,
+                             const float* value) = 0;
+    // Set column-major dim x dim float matrix uniform
+    virtual void uniform_mat(int location, int dim, const float* value) = 0;
+
+    // * State and drawing
+    // Clear color and depth buffers
+    virtual void clear(float r, float g, float b, float a) = 0;
+    // glEnable/glDisable
+    virtual void set_enabled(unsigned cap, bool enabled) = 0;
+    virtual void depth_func(unsigned func) = 0;
+    virtual void polygon_mode(unsigned mode) = 0;
+    virtual void point_size(float size) = 0;
+    virtual void viewport(int x, int y, int width, int height) = 0;
+    // Scissor rectangle (used while GL_SCISSOR_TEST is enabled)
+    virtual void scissor(int x, int y, int width, int height) = 0;
+    // Draw count uint32 indices from the bound element buffer
+    virtual void draw_elements(unsigned mode, size_t count) = 0;
+    virtual void draw_arrays(unsigned mode, size_t first, size_t count) = 0;
+};
+
+// Backend calling OpenGL directly (the default)
+class GLBackend : public Backend {
+   public:
+    bool has_context() override;
+    void gen_buffers(int n, Index* ids) override;
+    void delete_buffers(int n, const Index* ids) override;
+    void bind_buffer(unsigned target, Index id) override;
+    void buffer_data(unsigned target, size_t size, const void* data,
+                     unsigned usage) override;
+    void gen_vertex_arrays(int n, Index* ids) override;
+    void delete_vertex_arrays(int n, const Index* ids) override;
+    void bind_vertex_array(Index id) override;
+    void vertex_attrib_pointer(Index index, int size, size_t stride,
+                               size_t offset) override;
+    void gen_textures(int n, Index* ids) override;
+    void delete_textures(int n, const Index* ids) override;
+    void active_texture(Index unit) override;
+    void bind_texture(unsigned target, Index id) override;
+    void tex_parameter(unsigned target, unsigned pname, int value) override;
+    void tex_image_2d(unsigned target, int level, int internal_format,
+                      int width, int height, unsigned format, unsigned type,
+                      const void* data) override;
+    void generate_mipmap(unsigned target) override;
+    Index create_program(const char* vertex, const char* fragment,
+                         const char* geometry) override;
+    void delete_program(Index id) override;
+    void use_program(Index id) override;
+    int uniform_location(Index program, const char* name) override;
+    void uniform_int(int location, int value) override;
+    void uniform_float(int location, float value) override;
+    void uniform_vec(int location, int components,
+                     const float* value) override;
+    void uniform_mat(int location, int dim, const float* value) override;
+    void clear(float r, float g, float b, float a) override;
+    void set_enabled(unsigned cap, bool enabled) override;
+    void depth_func(unsigned func) override;
+    void polygon_mode(unsigned mode) override;
+    void point_size(float size) override;
+    void viewport(int x, int y, int width, int height) override;
+    void scissor(int x, int y, int width, int height) override;
+    void draw_elements(unsigned mode, size_t count) override;
+    void draw_arrays(unsigned mode, size_t first, size_t count) override;
+};
+
+// Backend which never touches the GPU: it only hands out object ids and
+// records command counts and data sizes. Always reports a context, so the
+// whole update/draw path (Mesh::update, Viewer::draw_scene, ...) can run and
+// be measured on machines without GL, e.g. headless CI.
+// Not thread-safe (do not combine with Viewer::async_upload).
+class NullBackend : public Backend {
+   public:
+    struct Stats {
+        // Total number of backend calls
+        size_t calls = 0;
+        // Draw calls, and vertices (or indices) submitted by them
+        size_t draw_calls = 0, draw_vertices = 0;
+        // Buffer data uploads and total bytes
+        size_t buffer_uploads = 0, buffer_bytes = 0;
+        // Texture image uploads and total bytes
+        size_t texture_uploads = 0, texture_bytes = 0;
+        // Uniform updates
+        size_t uniform_sets = 0;
+        // State changes (binds, enables, modes, ...)
+        size_t state_changes = 0;
+        // Objects (buffers, vertex arrays, textures, programs) created and
+        // deleted
+        size_t objects_created = 0, objects_deleted = 0;
+    };
+
+    bool has_context() override;
+    void gen_buffers(int n, Index* ids) override;
+    void delete_buffers(int n, const Index* ids) override;
+    void bind_buffer(unsigned target, Index id) override;
+    void buffer_data(unsigned target, size_t size, const void* data,
+                     unsigned usage) override;
+    void gen_vertex_arrays(int n, Index* ids) override;
+    void delete_vertex_arrays(int n, const Index* ids) override;
+    void bind_vertex_array(Index id) override;
+    void vertex_attrib_pointer(Index index, int size, size_t stride,
+                               size_t offset) override;
+    void gen_textures(int n, Index* ids) override;
+    void delete_textures(int n, const Index* ids) override;
+    void active_texture(Index unit) override;
+    void bind_texture(unsigned target, Index id) override;
+    void tex_parameter(unsigned target, unsigned pname, int value) override;
+    void tex_image_2d(unsigned target, int level, int internal_format,
+                      int width, int height, unsigned format, unsigned type,
+                      const void* data) override;
+    void generate_mipmap(unsigned target) override;
+    Index create_program(const char* vertex, const char* fragment,
+                         const char* geometry) override;
+    void delete_program(Index id) override;
+    void use_program(Index id) override;
+    int uniform_location(Index program, const char* name) override;
+    void uniform_int(int location, int value) override;
+    void uniform_float(int location, float value) override;
+    void uniform_vec(int location, int components,
+                     const float* value) override;
+    void uniform_mat(int location, int dim, const float* value) override;
+    void clear(float r, float g, float b, float a) override;
+    void set_enabled(unsigned cap, bool enabled) override;
+    void depth_func(unsigned func) override;
+    void polygon_mode(unsigned mode) override;
+    void point_size(float size) override;
+    void viewport(int x, int y, int width, int height) override;
+    void scissor(int x, int y, int width, int height) override;
+    void draw_elements(unsigned mode, size_t count) override;
+    void draw_arrays(unsigned mode, size_t first, size_t count) override;
+
+    // Reset all counters
+    inline void reset_stats() { stats = Stats(); }
+
+    // Recorded counters
+    Stats stats;
+
+   private:
+    // Generate n new object ids
+    void gen(int n, Index* ids);
+    // Count deletion of valid ids
+    void del(int n, const Index* ids);
+    Index _next_id = 1;
+};
+
+// The backend used by meshview (GLBackend by default)
+Backend& backend();
+// Set the backend used by meshview; nullptr restores the GL backend.
+// The backend is not owned and must outlive its use. Objects (meshes, etc)
+// should not be shared between backends.
+void set_backend(Backend* backend);
+
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_BACKEND_0C36E7D4_51B9_4E0A_9C0B_2B3F6C5D8A17
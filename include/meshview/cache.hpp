@@ -0,0 +1,68 @@
+#pragma once
+#ifndef MESHVIEW_CACHE_92A43523_795C_4EFC_8681_2099A8A12FD1
+#define MESHVIEW_CACHE_92A43523_795C_4EFC_8681_2099A8A12FD1
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "meshview/meshview.hpp"
+
+namespace meshview {
+namespace internal {
+class MappedFile;
+}  // namespace internal
+
+// Binary scene cache (.mvc): meshes and point clouds stored in meshview's
+// in-memory layouts, so a scene parsed once from slower formats can be
+// reopened by memory mapping the file.
+//
+// Layout (version 1, host byte order, checked on open): a 64-byte header,
+// then the mesh, point cloud and texture record tables, then the arrays.
+// Every array starts on a 64-byte boundary and holds exactly the rows of
+// the matching type (PointsRGBNormal, Triangles, Points2D, PointsRGB), so
+// it can be used in place through Eigen::Map. Textures are stored either as
+// the original encoded image file (e.g. PNG) or as raw 8-bit/float pixels.
+class SceneCache {
+   public:
+    SceneCache();
+    ~SceneCache();
+    SceneCache(const SceneCache&) = delete;
+    SceneCache& operator=(const SceneCache&) = delete;
+
+    // Write meshes (data, faces, texture coordinates, textures, transform
+    // and shading settings) and point clouds to path.
+    // raw_textures: store decoded 8-bit pixels of image file textures
+    // rather than the files themselves (larger, but nothing to decode when
+    // loading). Prints an error and returns false on failure.
+    static bool write(const std::string& path,
+                      const std::vector<const Mesh*>& meshes,
+                      const std::vector<const PointCloud*>& point_clouds = {},
+                      bool raw_textures = false);
+
+    // Map a cache file and validate its header, tables and face indices;
+    // prints an error and returns false if it is not a readable cache
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const;
+
+    size_t num_meshes() const;
+    size_t num_point_clouds() const;
+
+    // Views of the arrays inside the mapping (valid until close)
+    Eigen::Map<const PointsRGBNormal> mesh_data(size_t i) const;
+    Eigen::Map<const Triangles> mesh_faces(size_t i) const;
+    Eigen::Map<const PointsRGB> point_cloud_data(size_t i) const;
+
+    // Copy out mesh/point cloud i with its settings and textures (encoded
+    // textures are decoded on the thread pool)
+    std::unique_ptr<Mesh> load_mesh(size_t i) const;
+    std::unique_ptr<PointCloud> load_point_cloud(size_t i) const;
+
+   private:
+    std::unique_ptr<internal::MappedFile> _file;
+};
+
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_CACHE_92A43523_795C_4EFC_8681_2099A8A12FD1
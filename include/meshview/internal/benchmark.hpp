@@ -0,0 +1,53 @@
+#pragma once
+#ifndef MESHVIEW_BENCHMARK_EF8D020C_443B_4779_88A5_E9E6A318608B
+#define MESHVIEW_BENCHMARK_EF8D020C_443B_4779_88A5_E9E6A318608B
+
+#include <chrono>
+#include <vector>
+#include "meshview/meshview.hpp"
+
+namespace meshview {
+namespace internal {
+
+// State of a Viewer::benchmark run: moves the camera along the path and
+// times each frame, on the CPU and (if gpu_timing) with GL_TIME_ELAPSED
+// queries, which are read back RING_SIZE - 1 frames later so that timing
+// does not stall the pipeline. Needs the GL context current for all calls
+// if gpu_timing.
+class BenchmarkRun {
+   public:
+    BenchmarkRun(const Viewer::BenchmarkOptions& options, const Camera& start,
+                 bool gpu_timing);
+    BenchmarkRun(const BenchmarkRun&) = delete;
+    BenchmarkRun& operator=(const BenchmarkRun&) = delete;
+
+    // Move camera to the pose of the next frame (keeping its aspect) and
+    // start timing the frame
+    void begin_frame(Camera& camera);
+    // Call once the frame's scene is submitted
+    void end_submit();
+    // Call once the frame is presented; returns true after the last frame
+    bool end_frame();
+    // Wait for outstanding GPU times, free the queries and compute
+    // statistics (with the context current); later calls return the same
+    const Viewer::BenchmarkResult& finish();
+
+   private:
+    static const size_t RING_SIZE = 3;
+
+    // Read the GPU time of frame (waits for it)
+    void read_query(size_t frame);
+
+    Viewer::BenchmarkOptions _options;
+    bool _gpu_timing;
+    std::vector<unsigned> _queries;
+    size_t _frame = 0;
+    bool _finished = false;
+    std::chrono::high_resolution_clock::time_point _frame_start;
+    Viewer::BenchmarkResult _result;
+};
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_BENCHMARK_EF8D020C_443B_4779_88A5_E9E6A318608B
@@ -0,0 +1,252 @@
+#pragma once
+#ifndef MESHVIEW_BINARY_4D2E934C_5488_49ED_8AC3_70E19F3EAF9D
+#define MESHVIEW_BINARY_4D2E934C_5488_49ED_8AC3_70E19F3EAF9D
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace meshview {
+namespace internal {
+
+// Reading typed values from binary files in place (e.g. memory mapped),
+// at any alignment and in either byte order
+
+// Scalar types of binary model formats
+enum class ScalarType {
+    int8,
+    uint8,
+    int16,
+    uint16,
+    int32,
+    uint32,
+    int64,
+    uint64,
+    f32,
+    f64
+};
+
+inline size_t scalar_size(ScalarType type) {
+    switch (type) {
+        case ScalarType::int8:
+        case ScalarType::uint8:
+            return 1;
+        case ScalarType::int16:
+        case ScalarType::uint16:
+            return 2;
+        case ScalarType::int64:
+        case ScalarType::uint64:
+        case ScalarType::f64:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+inline bool host_is_big_endian() {
+    const uint16_t one = 1;
+    uint8_t first;
+    std::memcpy(&first, &one, 1);
+    return first == 0;
+}
+
+// Load a T from unaligned memory, swapping bytes if swap
+template <class T>
+inline T load(const char* p, bool swap = false) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, p, sizeof(T));
+    if (swap) std::reverse(bytes, bytes + sizeof(T));
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+// Value of type at p as a double
+inline double load_value(const char* p, ScalarType type, bool swap = false) {
+    switch (type) {
+        case ScalarType::int8:
+            return load<int8_t>(p, swap);
+        case ScalarType::uint8:
+            return load<uint8_t>(p, swap);
+        case ScalarType::int16:
+            return load<int16_t>(p, swap);
+        case ScalarType::uint16:
+            return load<uint16_t>(p, swap);
+        case ScalarType::int32:
+            return load<int32_t>(p, swap);
+        case ScalarType::uint32:
+            return load<uint32_t>(p, swap);
+        case ScalarType::int64:
+            return (double)load<int64_t>(p, swap);
+        case ScalarType::uint64:
+            return (double)load<uint64_t>(p, swap);
+        case ScalarType::f32:
+            return load<float>(p, swap);
+        default:
+            return load<double>(p, swap);
+    }
+}
+
+// Convert n values of type T, stride bytes apart from src, to Out times
+// scale, dst_stride apart in dst. Kept free of type dispatch so the compiler
+// can unroll/vectorize it for each T (fully for contiguous values).
+template <class T, class Out>
+void convert_strided(const char* src, size_t stride, size_t n, Out* dst,
+                     size_t dst_stride, float scale, bool swap) {
+    if (!swap && stride == sizeof(T) && dst_stride == 1) {
+        if (scale == 1.f) {
+            for (size_t i = 0; i < n; ++i) {
+                T value;
+                std::memcpy(&value, src + i * sizeof(T), sizeof(T));
+                dst[i] = (Out)value;
+            }
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                T value;
+                std::memcpy(&value, src + i * sizeof(T), sizeof(T));
+                dst[i] = (Out)((float)value * scale);
+            }
+        }
+    } else if (swap && scale == 1.f) {
+        // No float step, which would round integers past 2^24
+        for (size_t i = 0; i < n; ++i) {
+            dst[i * dst_stride] = (Out)load<T>(src + i * stride, true);
+        }
+    } else if (swap) {
+        for (size_t i = 0; i < n; ++i) {
+            dst[i * dst_stride] =
+                (Out)((float)load<T>(src + i * stride, true) * scale);
+        }
+    } else if (scale == 1.f) {
+        for (size_t i = 0; i < n; ++i) {
+            T value;
+            std::memcpy(&value, src + i * stride, sizeof(T));
+            dst[i * dst_stride] = (Out)value;
+        }
+    } else {
+        for (size_t i = 0; i < n; ++i) {
+            T value;
+            std::memcpy(&value, src + i * stride, sizeof(T));
+            dst[i * dst_stride] = (Out)((float)value * scale);
+        }
+    }
+}
+
+// convert_strided for a type known at runtime
+template <class Out>
+void convert_strided(ScalarType type, const char* src, size_t stride,
+                     size_t n, Out* dst, size_t dst_stride, float scale = 1.f,
+                     bool swap = false) {
+    switch (type) {
+        case ScalarType::int8:
+            convert_strided<int8_t>(src, stride, n, dst, dst_stride, scale,
+                                    swap);
+            break;
+        case ScalarType::uint8:
+            convert_strided<uint8_t>(src, stride, n, dst, dst_stride, scale,
+                                     swap);
+            break;
+        case ScalarType::int16:
+            convert_strided<int16_t>(src, stride, n, dst, dst_stride, scale,
+                                     swap);
+            break;
+        case ScalarType::uint16:
+            convert_strided<uint16_t>(src, stride, n, dst, dst_stride, scale,
+                                      swap);
+            break;
+        case ScalarType::int32:
+            convert_strided<int32_t>(src, stride, n, dst, dst_stride, scale,
+                                     swap);
+            break;
+        case ScalarType::uint32:
+            convert_strided<uint32_t>(src, stride, n, dst, dst_stride, scale,
+                                      swap);
+            break;
+        case ScalarType::int64:
+            convert_strided<int64_t>(src, stride, n, dst, dst_stride, scale,
+                                     swap);
+            break;
+        case ScalarType::uint64:
+            convert_strided<uint64_t>(src, stride, n, dst, dst_stride, scale,
+                                      swap);
+            break;
+        case ScalarType::f32:
+            convert_strided<float>(src, stride, n, dst, dst_stride, scale,
+                                   swap);
+            break;
+        case ScalarType::f64:
+            convert_strided<double>(src, stride, n, dst, dst_stride, scale,
+                                    swap);
+            break;
+    }
+}
+
+// Whether the n values of type T, stride bytes apart from src, are integers
+// in [0, 2^32), i.e. convert exactly to uint32 (e.g. vertex indices)
+template <class T>
+bool fit_uint32(const char* src, size_t stride, size_t n, bool swap) {
+    for (size_t i = 0; i < n; ++i) {
+        const double value = (double)load<T>(src + i * stride, swap);
+        if (!(value >= 0.0 && value < 4294967296.0) ||
+            value != std::floor(value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// fit_uint32 for a type known at runtime
+inline bool fit_uint32(ScalarType type, const char* src, size_t stride,
+                       size_t n, bool swap = false) {
+    switch (type) {
+        case ScalarType::uint8:
+        case ScalarType::uint16:
+        case ScalarType::uint32:
+            return true;
+        case ScalarType::int8:
+            return fit_uint32<int8_t>(src, stride, n, swap);
+        case ScalarType::int16:
+            return fit_uint32<int16_t>(src, stride, n, swap);
+        case ScalarType::int32:
+            return fit_uint32<int32_t>(src, stride, n, swap);
+        case ScalarType::int64:
+            return fit_uint32<int64_t>(src, stride, n, swap);
+        case ScalarType::uint64:
+            return fit_uint32<uint64_t>(src, stride, n, swap);
+        case ScalarType::f32:
+            return fit_uint32<float>(src, stride, n, swap);
+        default:
+            return fit_uint32<double>(src, stride, n, swap);
+    }
+}
+
+// Scale mapping the range of an integer type to [0, 1] (1 for floats)
+inline float normalize_scale(ScalarType type) {
+    switch (type) {
+        case ScalarType::int8:
+            return 1.f / 127.f;
+        case ScalarType::uint8:
+            return 1.f / 255.f;
+        case ScalarType::int16:
+            return 1.f / 32767.f;
+        case ScalarType::uint16:
+            return 1.f / 65535.f;
+        case ScalarType::int32:
+            return 1.f / 2147483647.f;
+        case ScalarType::uint32:
+            return 1.f / 4294967295.f;
+        case ScalarType::int64:
+            return 1.f / 9223372036854775807.f;
+        case ScalarType::uint64:
+            return 1.f / 18446744073709551615.f;
+        default:
+            return 1.f;
+    }
+}
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_BINARY_4D2E934C_5488_49ED_8AC3_70E19F3EAF9D
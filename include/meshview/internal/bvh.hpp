@@ -0,0 +1,116 @@
+#pragma once
+#ifndef MESHVIEW_BVH_2BA139C9_256E_4ABA_AC00_2C844C9793DC
+#define MESHVIEW_BVH_2BA139C9_256E_4ABA_AC00_2C844C9793DC
+
+#include <cstdint>
+#include <vector>
+#include <Eigen/Geometry>
+#include "meshview/common.hpp"
+
+namespace meshview {
+namespace internal {
+
+// Number of rays traced together
+const int RAY_PACKET_SIZE = 8;
+
+// Packet of rays o + t d, with the closest hit found so far
+struct RayPacket {
+    using Lanes = Eigen::Array<float, RAY_PACKET_SIZE, 1>;
+    using LanesU = Eigen::Array<uint32_t, RAY_PACKET_SIZE, 1>;
+    using Mask = Eigen::Array<bool, RAY_PACKET_SIZE, 1>;
+
+    Lanes o[3], d[3];
+    // Reciprocal directions, set by init()
+    Lanes inv_d[3];
+    // Ray parameter of the closest hit, or the maximum if none
+    Lanes t;
+    // Barycentric coordinates of the hit (weights of the triangle's 2nd and
+    // 3rd vertex), triangle and object; object is ~0u if no hit
+    Lanes u, v;
+    LanesU prim, object;
+    // Rays in use
+    Mask active;
+
+    // Compute inv_d and clear hits (t must be set to the maximum)
+    void init();
+};
+
+// Bounding volume hierarchy over boxes (triangles, or objects), built with
+// the binned surface area heuristic. Nodes are stored depth first; a node
+// with n primitives owns the 2n - 1 node slots after it, which lets
+// subtrees be built in parallel.
+class Bvh {
+   public:
+    struct Node {
+        float min[3], max[3];
+        // Leaf: first primitive in indices(); inner node: right child (the
+        // left child follows the node)
+        uint32_t index;
+        // Number of primitives, 0 for inner nodes
+        uint16_t count;
+        // Split axis of inner nodes
+        uint16_t axis;
+    };
+
+    // Build over the given primitive bounding boxes
+    void build(const std::vector<Eigen::AlignedBox3f>& boxes,
+               size_t max_leaf_size = 4);
+
+    inline bool empty() const { return _nodes.empty(); }
+    // Bounds of all primitives
+    Eigen::AlignedBox3f bounds() const;
+    // Primitives in leaf order: a leaf holds indices()[index, index + count)
+    inline const std::vector<uint32_t>& indices() const { return _indices; }
+
+    // Call leaf(index, count) for each leaf that an active ray of the packet
+    // may hit before its current t, roughly front to back (following the
+    // first ray); leaf may shorten rays.t to prune the rest
+    template <class Leaf>
+    void traverse(const RayPacket& rays, Leaf&& leaf) const {
+        if (_nodes.empty()) return;
+        uint32_t stack[MAX_DEPTH + 34];
+        int size = 0;
+        stack[size++] = 0;
+        while (size > 0) {
+            const uint32_t id = stack[--size];
+            const Node& node = _nodes[id];
+            RayPacket::Lanes t0 = RayPacket::Lanes::Zero(), t1 = rays.t;
+            for (int a = 0; a < 3; ++a) {
+                const RayPacket::Lanes ta = (node.min[a] - rays.o[a]) *
+                                            rays.inv_d[a],
+                                       tb = (node.max[a] - rays.o[a]) *
+                                            rays.inv_d[a];
+                t0 = t0.max(ta.min(tb));
+                t1 = t1.min(ta.max(tb));
+            }
+            if (!(rays.active && (t0 <= t1)).any()) continue;
+            if (node.count > 0) {
+                leaf(node.index, (uint32_t)node.count);
+            } else if (rays.d[node.axis][0] >= 0.f) {
+                stack[size++] = node.index;
+                stack[size++] = id + 1;
+            } else {
+                stack[size++] = id + 1;
+                stack[size++] = node.index;
+            }
+        }
+    }
+
+   private:
+    // Maximum SAH tree depth: deeper nodes become leaves, or are split in the
+    // middle if too large for a leaf (adding at most 32 levels)
+    static const int MAX_DEPTH = 60;
+
+    void build_node(uint32_t id, size_t begin, size_t end, int depth,
+                    const std::vector<Eigen::AlignedBox3f>& boxes,
+                    const std::vector<Vector3f>& centroids,
+                    size_t max_leaf_size);
+
+    std::vector<Node> _nodes;
+    std::vector<uint32_t> _indices;
+};
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_BVH_2BA139C9_256E_4ABA_AC00_2C844C9793DC
@@ -0,0 +1,179 @@
+#pragma once
+#ifndef MESHVIEW_FORMAT_19F08BFB_25D8_4172_9728_432EBC9D4CE0
+#define MESHVIEW_FORMAT_19F08BFB_25D8_4172_9728_432EBC9D4CE0
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+#include "meshview/internal/thread_pool.hpp"
+
+namespace meshview {
+namespace internal {
+
+// Allocation-free formatting of numbers as text, the writing counterpart of
+// parse.hpp. Functions write at out (without a terminating null) and return
+// the end of what they wrote.
+
+// Longest output of format_float, e.g. -0.000123456789
+const size_t MAX_FLOAT_CHARS = 15;
+// Longest output of format_uint
+const size_t MAX_UINT_CHARS = 10;
+
+inline char* format_uint(char* out, uint32_t v) {
+    char tmp[MAX_UINT_CHARS];
+    char* p = tmp + MAX_UINT_CHARS;
+    do {
+        *--p = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    const size_t len = tmp + MAX_UINT_CHARS - p;
+    std::memcpy(out, p, len);
+    return out + len;
+}
+
+// x * 10^k, rounded once while 10^k is exact in a double
+inline double scale_pow10(double x, int k) {
+    static const double POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                   1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                   1e18, 1e19, 1e20, 1e21, 1e22};
+    if (k >= 0) return k <= 22 ? x * POW10[k] : x * std::pow(10.0, k);
+    return k >= -22 ? x / POW10[-k] : x / std::pow(10.0, -k);
+}
+
+// Shortest decimal of 6 to 9 significant digits which reads back as v
+// (9 always do), without trailing zeros. As %g, uses fixed notation for
+// decimal exponents -4 to 8, else d.ddde+XX. Several times faster than
+// printf, which parses its format and takes the locale into account.
+inline char* format_float(char* out, float v) {
+    if (std::isnan(v)) {
+        std::memcpy(out, "nan", 3);
+        return out + 3;
+    }
+    if (std::signbit(v)) {
+        *out++ = '-';
+        v = -v;
+    }
+    if (std::isinf(v)) {
+        std::memcpy(out, "inf", 3);
+        return out + 3;
+    }
+    if (v == 0.f) {
+        *out++ = '0';
+        return out;
+    }
+    static const double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4,
+                                   1e5, 1e6, 1e7, 1e8, 1e9};
+    const double x = v;
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    // Decimal exponent: floor(e2 * log10(2)) for the binary exponent e2,
+    // then corrected so that the rounded mantissa m has exactly digits
+    // digits (also for subnormals, which start at their least exponent)
+    const int e2 = bits >> 23 ? (int)(bits >> 23) - 127 : -149;
+    int e10 = (e2 * 78913) >> 18;
+    int digits = 6;
+    uint32_t m = 0;
+    for (;; ++digits) {
+        double s;
+        for (;;) {
+            s = (double)(uint64_t)(scale_pow10(x, digits - 1 - e10) + 0.5);
+            if (s >= POW10[digits]) {
+                ++e10;
+            } else if (s < POW10[digits - 1]) {
+                --e10;
+            } else {
+                break;
+            }
+        }
+        m = (uint32_t)s;
+        if (digits == 9 ||
+            (float)scale_pow10((double)m, e10 - digits + 1) == v) {
+            break;
+        }
+    }
+    while (digits > 1 && m % 10 == 0) {
+        m /= 10;
+        --digits;
+    }
+    char d[9];
+    for (int i = digits - 1; i >= 0; --i) {
+        d[i] = (char)('0' + m % 10);
+        m /= 10;
+    }
+    if (e10 >= 0 && e10 < 9) {
+        const int int_digits = e10 + 1;
+        for (int i = 0; i < int_digits; ++i) {
+            *out++ = i < digits ? d[i] : '0';
+        }
+        if (digits > int_digits) {
+            *out++ = '.';
+            std::memcpy(out, d + int_digits, digits - int_digits);
+            out += digits - int_digits;
+        }
+    } else if (e10 < 0 && e10 >= -4) {
+        *out++ = '0';
+        *out++ = '.';
+        for (int i = -1; i > e10; --i) *out++ = '0';
+        std::memcpy(out, d, digits);
+        out += digits;
+    } else {
+        *out++ = d[0];
+        if (digits > 1) {
+            *out++ = '.';
+            std::memcpy(out, d + 1, digits - 1);
+            out += digits - 1;
+        }
+        *out++ = 'e';
+        *out++ = e10 < 0 ? '-' : '+';
+        if (std::abs(e10) < 10) *out++ = '0';
+        out = format_uint(out, (uint32_t)std::abs(e10));
+    }
+    return out;
+}
+
+// Write n rows to os, formatted in blocks of block_rows rows in parallel on
+// the thread pool: format(begin, end, out) writes rows [begin, end) at out,
+// at most max_row_bytes bytes per row, and returns the end of what it
+// wrote. Rounds of a few blocks per thread are formatted, then written in
+// order with one write per block, so memory stays bounded.
+// False on write error.
+template <class FormatFn>
+bool write_blocks(std::ostream& os, size_t n, size_t max_row_bytes,
+                  FormatFn format, size_t block_rows = 1 << 14) {
+    auto& pool = ThreadPool::get();
+    const size_t n_blocks = (n + block_rows - 1) / block_rows;
+    const size_t round = pool.size() * 2;
+    std::vector<std::vector<char>> bufs(std::min(round, n_blocks));
+    std::vector<size_t> lens(bufs.size());
+    for (size_t first = 0; first < n_blocks && os; first += round) {
+        const size_t last = std::min(first + round, n_blocks);
+        pool.parallel_for(
+            first, last,
+            [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    const size_t row = i * block_rows;
+                    const size_t stop = std::min(row + block_rows, n);
+                    std::vector<char>& buf = bufs[i - first];
+                    buf.resize((stop - row) * max_row_bytes);
+                    lens[i - first] =
+                        format(row, stop, buf.data()) - buf.data();
+                }
+            },
+            1);
+        for (size_t i = first; i < last; ++i) {
+            os.write(bufs[i - first].data(), lens[i - first]);
+        }
+    }
+    return (bool)os;
+}
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_FORMAT_19F08BFB_25D8_4172_9728_432EBC9D4CE0
@@ -0,0 +1,106 @@
+#pragma once
+#ifndef MESHVIEW_FRAMEBUFFER_A54A396B_C321_49EA_B272_33A4128BA742
+#define MESHVIEW_FRAMEBUFFER_A54A396B_C321_49EA_B272_33A4128BA742
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "meshview/common.hpp"
+
+namespace meshview {
+namespace internal {
+
+// Offscreen render target: RGBA8 color + 24-bit depth renderbuffers, and
+// optionally auxiliary color targets matching the outputs of the scene
+// shaders: 1 = linear depth (R32F), 2 = packed normal (R32UI),
+// 3 = object/primitive ID (RG32UI).
+// GL objects belong to the context current at construction.
+class Framebuffer {
+   public:
+    Framebuffer(int width, int height);
+    ~Framebuffer();
+
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
+
+    // Reallocate attachments if the size changed
+    void resize(int width, int height);
+    // Bind for drawing and set the viewport to cover it
+    void bind();
+    // Bind the default framebuffer again
+    static void unbind();
+
+    // Enable/disable drawing into the auxiliary targets (allocated on first
+    // enable). The framebuffer must be bound.
+    void set_aux(bool enabled);
+    inline bool aux() const { return _aux; }
+    // Clear color to (r, g, b, 1), auxiliary targets to 0 and depth to 1.
+    // The framebuffer must be bound.
+    void clear(float r, float g, float b);
+
+    // Read color into out (width * height * 4 bytes, RGBA8), top row first.
+    // The framebuffer must be bound.
+    void read_rgba(uint8_t* out);
+    // Read color attachment (0-3) with GL format/type (pixel_bytes bytes per
+    // pixel) into out, top row first. The framebuffer must be bound.
+    void read(int attachment, unsigned format, unsigned type,
+              size_t pixel_bytes, void* out);
+
+    int width, height;
+    Index fbo = -1, color_rb = -1, depth_rb = -1;
+    // Auxiliary renderbuffers (attachments 1-3)
+    Index aux_rb[3] = {(Index)-1, (Index)-1, (Index)-1};
+
+   private:
+    void alloc();
+    bool _aux = false;
+};
+
+// Ring of pixel buffer objects for asynchronous readback: push() queues
+// glReadPixels from the bound read framebuffer into the next free PBO and
+// fences it, so the CPU does not stall; pop() later retrieves results in
+// order, once the GPU has written them.
+class AsyncReadback {
+   public:
+    // n_slots: maximum number of readbacks in flight
+    explicit AsyncReadback(size_t n_slots);
+    ~AsyncReadback();
+
+    AsyncReadback(const AsyncReadback&) = delete;
+    AsyncReadback& operator=(const AsyncReadback&) = delete;
+
+    inline bool empty() const { return _count == 0; }
+    inline bool full() const { return _count == _slots.size(); }
+    inline size_t size() const { return _count; }
+
+    // Queue reading width x height pixels (GL format/type, pixel_bytes bytes
+    // each) at (x, y) (GL window coordinates, y up) from the current read
+    // buffer; tag is passed back by pop(). Must not be full.
+    void push(int width, int height, unsigned format, unsigned type,
+              size_t pixel_bytes, size_t tag, int x = 0, int y = 0);
+    // True if the oldest readback has completed (does not block)
+    bool front_ready();
+    // Retrieve the oldest readback: calls fn(tag, data) with the mapped
+    // pixels (rows bottom-up as in GL, tightly packed), then frees its slot.
+    // If wait is false and it is not ready yet, returns false instead.
+    bool pop(const std::function<void(size_t, const uint8_t*)>& fn,
+             bool wait = true);
+
+   private:
+    struct Slot {
+        Index pbo = -1;
+        // GLsync
+        void* fence = nullptr;
+        size_t capacity = 0, bytes = 0, tag = 0;
+    };
+    std::vector<Slot> _slots;
+    size_t _head = 0, _count = 0;
+};
+
+// Flip rows of an image with height rows of row_bytes bytes in place
+void flip_rows(uint8_t* data, size_t height, size_t row_bytes);
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_FRAMEBUFFER_A54A396B_C321_49EA_B272_33A4128BA742
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef MESHVIEW_HEADLESS_A6AF4581_DC81_4EB2_9C10_AAF2CB851CA1
+#define MESHVIEW_HEADLESS_A6AF4581_DC81_4EB2_9C10_AAF2CB851CA1
+
+namespace meshview {
+namespace internal {
+
+// OpenGL 3.3 core context without a window, for offscreen rendering.
+// Uses EGL if meshview was built with it (MESHVIEW_EGL): a GPU device if one
+// is available, else Mesa's surfaceless platform (software llvmpipe works),
+// else the default display; the context is made current without a surface
+// (or with a 1x1 pbuffer if surfaceless contexts are unsupported).
+// Otherwise falls back to a hidden GLFW window, which needs a display.
+class HeadlessContext {
+   public:
+    // Create the context and make it current on the calling thread;
+    // check valid() afterwards
+    HeadlessContext();
+    // Destroys the context and all objects in it
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // Make the context current on the calling thread
+    void make_current();
+
+    // False if no context could be created
+    inline bool valid() const {
+        return _context != nullptr || _window != nullptr;
+    }
+
+   private:
+    bool create_egl();
+    // Initialize an EGLDisplay and create the context on it, made current;
+    // false (with the display terminated) if it cannot
+    bool try_egl_display(void* display);
+    bool create_glfw();
+
+    // EGL display/context/pbuffer surface
+    void *_display = nullptr, *_context = nullptr, *_surface = nullptr;
+    // GLFWwindow, if using the GLFW fallback
+    void* _window = nullptr;
+};
+
+// True if an EGL context is current on the calling thread
+bool egl_context_current();
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_HEADLESS_A6AF4581_DC81_4EB2_9C10_AAF2CB851CA1
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef MESHVIEW_JSON_2D639968_2C9D_4D83_A5F1_6933DF79C5CE
+#define MESHVIEW_JSON_2D639968_2C9D_4D83_A5F1_6933DF79C5CE
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace meshview {
+namespace internal {
+
+// Minimal JSON document (RFC 8259), enough for reading glTF.
+// Lookups of missing members/elements or of the wrong type return a shared
+// null value, so chains like doc["a"][0]["b"].number(1.0) need no checks.
+class Json {
+   public:
+    enum class Type { null, boolean, number, string, array, object };
+
+    // Parse [text, text + size); prints an error (prefixed with what) and
+    // returns false on malformed input
+    bool parse(const char* text, size_t size, const std::string& what);
+
+    Type type() const { return _type; }
+    bool is_null() const { return _type == Type::null; }
+    bool is_number() const { return _type == Type::number; }
+    bool is_string() const { return _type == Type::string; }
+    bool is_array() const { return _type == Type::array; }
+    bool is_object() const { return _type == Type::object; }
+
+    // Value, or fallback if of another type
+    double number(double fallback = 0.0) const {
+        return _type == Type::number ? _number : fallback;
+    }
+    // Value as a non-negative integer (an index, count or byte size), or
+    // fallback if it is not one. The default fallback is out of range of
+    // any array, so a missing or negative index selects nothing (casting a
+    // negative double to size_t would be undefined).
+    size_t integer(size_t fallback = (size_t)-1) const {
+        return _type == Type::number && _number >= 0.0 &&
+                       _number < 9007199254740992.0 &&
+                       _number == (double)(uint64_t)_number
+                   ? (size_t)_number
+                   : fallback;
+    }
+    bool boolean(bool fallback = false) const {
+        return _type == Type::boolean ? _boolean : fallback;
+    }
+    const std::string& string() const { return _string; }
+
+    // Elements of an array / members of an object (0 otherwise)
+    size_t size() const {
+        return _type == Type::object ? _members.size() : _elements.size();
+    }
+    const Json& operator[](size_t index) const;
+    // (Negative indices give null; also keeps literal 0 unambiguous)
+    const Json& operator[](int index) const {
+        return (*this)[index < 0 ? size() : (size_t)index];
+    }
+    const Json& operator[](const char* key) const;
+    bool has(const char* key) const;
+    const std::vector<std::pair<std::string, Json>>& members() const {
+        return _members;
+    }
+
+   private:
+    friend class JsonParser;
+
+    Type _type = Type::null;
+    bool _boolean = false;
+    double _number = 0.0;
+    std::string _string;
+    std::vector<Json> _elements;
+    std::vector<std::pair<std::string, Json>> _members;
+};
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_JSON_2D639968_2C9D_4D83_A5F1_6933DF79C5CE
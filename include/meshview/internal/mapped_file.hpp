@@ -0,0 +1,58 @@
+#pragma once
+#ifndef MESHVIEW_MAPPED_FILE_3C7B9E1B_8F27_4DF1_AD3A_A3AD1999D80C
+#define MESHVIEW_MAPPED_FILE_3C7B9E1B_8F27_4DF1_AD3A_A3AD1999D80C
+
+#include <cstddef>
+#include <string>
+
+namespace meshview {
+namespace internal {
+
+// Read-only memory mapping of a whole file (mmap, or a file mapping on
+// Windows), so that loaders can parse it in place, in parallel, without
+// copying it into memory first
+class MappedFile {
+   public:
+    // How the file will be read: sequential files are read ahead in full
+    // (loaders scan them front to back), random ones only where accessed
+    // or prefetched
+    enum class Access { sequential, random };
+
+    MappedFile() = default;
+    // Map path (see open)
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map path, unmapping any previous file; prints an error and returns
+    // false on failure. Empty files map to valid() with size() 0.
+    bool open(const std::string& path, Access access = Access::sequential);
+    void close();
+
+    inline bool valid() const { return _valid; }
+    inline const char* data() const { return _data; }
+    inline size_t size() const { return _size; }
+
+    // Hint that [offset, offset + size) will be read soon, starting
+    // asynchronous read-ahead where the OS supports it
+    void prefetch(size_t offset, size_t size) const;
+    // Hint that [offset, offset + size) is not needed anymore, dropping its
+    // pages from the process (they are read again if accessed)
+    void evict(size_t offset, size_t size) const;
+
+   private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+    bool _valid = false;
+#ifdef _WIN32
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#endif
+};
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_MAPPED_FILE_3C7B9E1B_8F27_4DF1_AD3A_A3AD1999D80C
@@ -0,0 +1,162 @@
+#pragma once
+#ifndef MESHVIEW_PARSE_EDF68035_F85B_4BAA_ACC7_FFDD22FC345A
+#define MESHVIEW_PARSE_EDF68035_F85B_4BAA_ACC7_FFDD22FC345A
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace meshview {
+namespace internal {
+
+// Allocation-free parsing of text files in place (e.g. memory mapped).
+// Functions take a cursor p into [p, end), never read at or past end and
+// advance p past what they consumed.
+
+// Horizontal whitespace, including the '\r' of CRLF line endings
+inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline void skip_blanks(const char*& p, const char* end) {
+    while (p < end && is_blank(*p)) ++p;
+}
+
+// Skip to the next blank or the end
+inline void skip_token(const char*& p, const char* end) {
+    while (p < end && !is_blank(*p)) ++p;
+}
+
+// End of the line starting at p (its '\n', or end)
+inline const char* find_line_end(const char* p, const char* end) {
+    const char* nl = (const char*)std::memchr(p, '\n', end - p);
+    return nl ? nl : end;
+}
+
+// Split [text, text + size) into n ranges of similar size, each ending
+// after a '\n' (except the last), for parsing lines in parallel
+inline std::vector<std::pair<const char*, const char*>> split_lines(
+    const char* text, size_t size, size_t n) {
+    std::vector<std::pair<const char*, const char*>> ranges(n);
+    const char* end = text + size;
+    for (size_t i = 0; i < n; ++i) {
+        ranges[i].first = i ? ranges[i - 1].second : text;
+        ranges[i].second = end;
+        if (i + 1 == n) break;
+        const char* split =
+            std::max(text + size * (i + 1) / n, ranges[i].first);
+        const char* nl = find_line_end(split, end);
+        ranges[i].second = nl == end ? nl : nl + 1;
+    }
+    return ranges;
+}
+
+// Parse a decimal integer with optional sign; false (p unchanged) if there
+// is no digit
+inline bool parse_int(const char*& p, const char* end, int64_t& out) {
+    const char* s = p;
+    const bool neg = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+')) ++s;
+    if (s == end || (unsigned)(*s - '0') > 9) return false;
+    int64_t value = 0;
+    while (s < end && (unsigned)(*s - '0') <= 9) {
+        value = value * 10 + (*s - '0');
+        ++s;
+    }
+    out = neg ? -value : value;
+    p = s;
+    return true;
+}
+
+// Parse a floating point number: [+-]digits[.digits][(e|E)[+-]digits]
+// directly, anything else strtod accepts (inf, nan, hex) through strtod.
+// False (p unchanged) if there is no number. Results are correctly rounded
+// except, rarely, in the last bit for more than 15 significant digits or
+// large exponents.
+inline bool parse_double(const char*& p, const char* end, double& out) {
+    static const double POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                   1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                   1e18, 1e19, 1e20, 1e21, 1e22};
+    const char* s = p;
+    const bool neg = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+')) ++s;
+    // Up to 19 significant digits fit in the mantissa; the rest only scale
+    uint64_t mantissa = 0;
+    int digits = 0, exp10 = 0;
+    bool any = false;
+    for (; s < end && (unsigned)(*s - '0') <= 9; ++s) {
+        any = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*s - '0');
+            if (mantissa) ++digits;
+        } else {
+            ++exp10;
+        }
+    }
+    if (s < end && *s == '.') {
+        for (++s; s < end && (unsigned)(*s - '0') <= 9; ++s) {
+            any = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa) ++digits;
+                --exp10;
+            }
+        }
+    }
+    if (!any) {
+        // Rare forms: copy the token so that strtod stops at end
+        char buf[64];
+        const char* t = p;
+        size_t len = 0;
+        while (t < end && !is_blank(*t) && *t != '\n' &&
+               len < sizeof(buf) - 1) {
+            buf[len++] = *t++;
+        }
+        buf[len] = 0;
+        char* stop;
+        const double value = std::strtod(buf, &stop);
+        if (stop == buf) return false;
+        out = value;
+        p += stop - buf;
+        return true;
+    }
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        int64_t exponent;
+        if (parse_int(e, end, exponent)) {
+            if (exponent > 100000) exponent = 100000;
+            if (exponent < -100000) exponent = -100000;
+            exp10 += (int)exponent;
+            s = e;
+        }
+    }
+    double value = (double)mantissa;
+    if (mantissa != 0 && exp10 != 0) {
+        // Exact powers of 10 keep a single rounding for short numbers
+        if (exp10 > 0 && exp10 <= 22) {
+            value *= POW10[exp10];
+        } else if (exp10 < 0 && exp10 >= -22) {
+            value /= POW10[-exp10];
+        } else {
+            value *= std::pow(10.0, exp10);
+        }
+    }
+    out = neg ? -value : value;
+    p = s;
+    return true;
+}
+
+inline bool parse_float(const char*& p, const char* end, float& out) {
+    double value;
+    if (!parse_double(p, end, value)) return false;
+    out = (float)value;
+    return true;
+}
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_PARSE_EDF68035_F85B_4BAA_ACC7_FFDD22FC345A
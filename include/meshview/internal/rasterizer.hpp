@@ -0,0 +1,149 @@
+#pragma once
+#ifndef MESHVIEW_RASTERIZER_7E6927E0_5841_4A94_AEA1_4DB582D570FA
+#define MESHVIEW_RASTERIZER_7E6927E0_5841_4A94_AEA1_4DB582D570FA
+
+#include <cstdint>
+#include <vector>
+#include "meshview/common.hpp"
+#include "meshview/internal/shading.hpp"
+
+namespace meshview {
+class Camera;
+namespace internal {
+
+// Tile-based software rasterizer implementing meshview's scene pipeline (the
+// shaders in shader_inline.hpp, depth test GL_LESS, face culling, wireframe)
+// on the CPU, for machines without any usable OpenGL.
+// Primitives are set up and binned into screen tiles in parallel batches;
+// tiles are then rasterized in parallel, each into a visibility buffer
+// (depth + nearest primitive) using fixed-point edge functions evaluated 8
+// pixels at a time, and finally each visible pixel is shaded once.
+// Primitives are processed in submission order within each tile, so the
+// result matches forward rendering with GL_LESS.
+class Rasterizer {
+   public:
+    enum class Primitive { triangles, lines, points };
+    enum class Shading {
+        // Vertex color only (point cloud shader)
+        flat,
+        // Phong with per-vertex color (MESH_FRAGMENT_SHADER_VERT_COLOR)
+        vertex_color,
+        // Phong with diffuse/specular textures (MESH_FRAGMENT_SHADER)
+        texture,
+    };
+
+    using TextureImage = internal::TextureImage;
+    using Light = internal::Light;
+
+    // One draw call, with vertex data in the layout uploaded to the GPU:
+    // n_verts rows of stride floats, position then color (or uv) then, for
+    // meshes (stride 9), normal
+    struct Draw {
+        Primitive primitive = Primitive::triangles;
+        Shading shading = Shading::flat;
+        const float* verts = nullptr;
+        size_t n_verts = 0, stride = 6;
+        // Triangle vertex indices (triangles only); nullptr = 0 1 2, 3 4 5...
+        const Index* indices = nullptr;
+        size_t n_indices = 0;
+        Matrix4f model = Matrix4f::Identity();
+        // Textures (Shading::texture) and specular exponent
+        TextureImage diffuse, specular;
+        float shininess = 10.f;
+        // Points are point_size x point_size pixel squares
+        float point_size = 1.f;
+        // Written to the object ID buffer
+        uint32_t object_id = 0;
+        // Source object and its version, identifying unchanged geometry
+        // across frames (RayTracer caches BVHs by these); key = nullptr
+        // means no caching
+        const void* key = nullptr;
+        size_t version = 0;
+    };
+
+    struct Options {
+        Vector3f background = Vector3f::Zero();
+        bool cull_face = true;
+        bool wireframe = false;
+    };
+
+    // Output buffers, rows top to bottom, width x height pixels each;
+    // any may be nullptr. Contents match Viewer::AuxBuffers
+    struct Target {
+        // RGBA8
+        uint8_t* color = nullptr;
+        // Linear depth (0 = background)
+        float* depth = nullptr;
+        // Packed world-space normals (0 = none)
+        uint32_t* normals = nullptr;
+        // Object ID, primitive ID pairs
+        uint32_t* ids = nullptr;
+    };
+
+    // Render draws in order
+    void render(const std::vector<Draw>& draws, const Camera& camera,
+                const Light& light, const Options& options, int width,
+                int height, const Target& target);
+
+   private:
+    // Vertex shader outputs of a draw
+    struct Vertices {
+        // Clip-space positions
+        Eigen::Matrix<float, Eigen::Dynamic, 4, Eigen::RowMajor> clip;
+        // World-space positions and normals, color/uv
+        Points world, normal, attr;
+    };
+
+    // A set-up (clipped, projected) point, line or triangle
+    struct Prim {
+        // Number of vertices (1-3)
+        int n;
+        // Draw index and primitive ID
+        uint32_t draw, id;
+        // Vertex indices into the draw's vertices
+        Index verts[3];
+        // Barycentric coordinates of each (possibly clipped) vertex within
+        // the original primitive
+        float bary[3][3];
+        // Window coordinates: y up, x/y in 1/256 pixels for triangles
+        int64_t X[3], Y[3];
+        float x[3], y[3], z[3], inv_w[3];
+        // Twice the signed area, in fixed point (triangles)
+        int64_t area;
+        // Bounding pixel rectangle [x0, x1) x [y0, y1)
+        int x0, y0, x1, y1;
+    };
+
+    // A range of primitives of one draw, set up in parallel with others
+    struct Batch {
+        size_t draw, begin, end;
+        std::vector<Prim> prims;
+        // Indices of prims overlapping each tile, in order
+        std::vector<std::vector<uint32_t>> bins;
+    };
+
+    void setup(Batch& batch);
+    void emit(Batch& batch, Prim& prim);
+    void raster_tile(size_t tile, const Target& target);
+    // Depth test triangle prim over pixels [x0, x1) x [y0, y1) of the tile
+    // at (tile_x, tile_y), with edge functions in Int lanes (int32_t when
+    // their values fit, see raster_tile)
+    template <class Int>
+    void raster_triangle(const Prim& prim, int x0, int y0, int x1, int y1,
+                         int tile_x, int tile_y, float* depth,
+                         const Prim** visible) const;
+
+    const std::vector<Draw>* _draws = nullptr;
+    std::vector<Vertices> _vertices;
+    std::vector<Batch> _batches;
+    Light _light;
+    Options _options;
+    Vector3f _view_pos;
+    Matrix4f _view;
+    int _width = 0, _height = 0, _tiles_x = 0, _tiles_y = 0;
+};
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_RASTERIZER_7E6927E0_5841_4A94_AEA1_4DB582D570FA
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef MESHVIEW_RAY_TRACER_333969CC_CEE1_44FD_A356_C6E6EABC52D1
+#define MESHVIEW_RAY_TRACER_333969CC_CEE1_44FD_A356_C6E6EABC52D1
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "meshview/common.hpp"
+#include "meshview/internal/bvh.hpp"
+#include "meshview/internal/rasterizer.hpp"
+
+namespace meshview {
+class Camera;
+namespace internal {
+
+// CPU ray caster producing exact ground-truth renders of the triangle draws
+// of a scene (point and line draws are ignored): one ray per pixel center,
+// traced through a two-level BVH, i.e. an SAH BVH per draw in object space
+// (cached across calls by Draw::key/version) under a BVH over the draws'
+// world-space bounds. Rays are traced in packets of 4x2 pixels, image tiles
+// in parallel. Shading matches Rasterizer; Options::wireframe is
+// ignored.
+class RayTracer {
+   public:
+    using Draw = Rasterizer::Draw;
+    using Options = Rasterizer::Options;
+
+    // Output buffers as in Rasterizer::Target (depth is exact), plus
+    struct Target : Rasterizer::Target {
+        // Barycentric coordinates (u, v) of the hit in its triangle, the
+        // weights of the 2nd and 3rd vertex; 0 for background
+        float* barycentrics = nullptr;
+    };
+
+    // Trace draws from camera; returns rays per second (excluding BVH
+    // builds)
+    double render(const std::vector<Draw>& draws, const Camera& camera,
+                  const Light& light, const Options& options, int width,
+                  int height, const Target& target);
+
+   private:
+    // Triangle, in the BLAS's leaf order
+    struct Triangle {
+        Vector3f v0, e1, e2;
+        // Face index
+        uint32_t id;
+    };
+
+    // Bottom-level acceleration structure of a draw
+    struct Blas {
+        const void* key;
+        size_t version;
+        const float* verts;
+        const Index* indices;
+        size_t n_verts, n_indices;
+        Bvh bvh;
+        std::vector<Triangle> triangles;
+        bool used;
+    };
+
+    // A draw in the top-level BVH
+    struct Instance {
+        const Draw* draw;
+        const Blas* blas;
+        // World to object transform
+        Matrix4f inv_model;
+        Matrix3f normal_matrix;
+        // Front faces have positive determinant in object space (flipped if
+        // the model matrix mirrors)
+        float front_sign;
+    };
+
+    Blas* get_blas(const Draw& draw);
+    void trace_tile(size_t tile, const Target& target);
+    void trace(RayPacket& rays) const;
+
+    std::vector<std::unique_ptr<Blas>> _blas;
+    std::vector<Instance> _instances;
+    Bvh _tlas;
+    Light _light;
+    Options _options;
+    Matrix4f _view;
+    Eigen::Matrix4d _inv_view_proj;
+    Vector3f _view_pos;
+    int _width = 0, _height = 0, _tiles_x = 0;
+};
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_RAY_TRACER_333969CC_CEE1_44FD_A356_C6E6EABC52D1
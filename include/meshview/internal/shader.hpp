@@ -37,6 +37,10 @@ public:
 
     // GL shader id
     Index id;
+
+private:
+    // Uniform location
+    int loc(const std::string &name) const;
 };
 
 }  // namespace internal
@@ -2,8 +2,37 @@
 #ifndef VIEWER_SHADER_INLINE_91D27C05_59C0_4F9F_A6C5_6AA9E2000CDA
 #define VIEWER_SHADER_INLINE_91D27C05_59C0_4F9F_A6C5_6AA9E2000CDA
 
+#include <string>
+
 namespace meshview {
 
+// GLSL shared by the mesh fragment shaders, which are concatenated from it
+// so that they cannot drift apart
+// Color and auxiliary render target outputs
+static const char* MESH_FRAG_OUTPUTS = R"SHADER(
+// Color, and auxiliary outputs (only stored by framebuffers which have them)
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out float FragDepth; // Linear depth
+layout(location = 2) out uint FragNormal; // Packed world-space normal
+layout(location = 3) out uvec2 FragID; // Object ID, primitive ID
+)SHADER";
+// Octahedral normal packing of the normals target
+static const char* PACK_NORMAL_SHADER = R"SHADER(
+// Octahedral-encode a normal into 2x16 bits (0 = no normal)
+uint pack_normal(vec3 n) {
+    float len = abs(n.x) + abs(n.y) + abs(n.z);
+    if (len == 0.0f) return 0u;
+    n /= len;
+    vec2 o = n.xy;
+    if (n.z < 0.0f) {
+        o = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f,
+                                      n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    uvec2 q = uvec2(round(clamp(o, -1.0f, 1.0f) * 32767.0f) + 32768.0f);
+    return q.x | (q.y << 16);
+}
+)SHADER";
+
 // Shading for mesh using texture
 static const char* MESH_VERTEX_SHADER = R"SHADER(
 #version 330 core
@@ -26,9 +55,8 @@ void main() {
     gl_Position = MVP * vec4(aPosition, 1.0f);
 })SHADER";
 
-static const char* MESH_FRAGMENT_SHADER = R"SHADER(
-#version 330 core
-out vec4 FragColor;
+static const std::string MESH_FRAGMENT_SHADER =
+    std::string("#version 330 core\n") + MESH_FRAG_OUTPUTS + R"SHADER(
 struct Material {
     sampler2D diffuse;
     sampler2D specular;
@@ -47,7 +75,9 @@ in vec3 Normal; // Normal vector (world)
 uniform vec3 viewPos; // Camera position (world)
 uniform Material material; // Material info
 uniform Light light; // Light info
-
+uniform mat4 V; // View matrix
+uniform int ObjectID; // Object ID for the ID buffer
+)SHADER" + PACK_NORMAL_SHADER + R"SHADER(
 void main(){
     vec3 objectColor = texture(material.diffuse, TexCoord).rgb;
     vec3 ambient = light.ambient * objectColor;
@@ -63,6 +93,9 @@ void main(){
     vec3 specular = light.specular * spec * texture(material.specular, TexCoord).rgb;
 
     FragColor = vec4(ambient + diffuse + specular, 1.0f);
+    FragDepth = -(V * vec4(FragPos, 1.0f)).z;
+    FragNormal = pack_normal(norm);
+    FragID = uvec2(uint(ObjectID), uint(gl_PrimitiveID));
 })SHADER";
 
 // Shading for mesh, using interpolated per-vertex colors instead of texture
@@ -87,9 +120,8 @@ void main() {
     gl_Position = MVP * vec4(aPosition, 1.0f);
 })SHADER";
 
-static const char* MESH_FRAGMENT_SHADER_VERT_COLOR = R"SHADER(
-#version 330 core
-out vec4 FragColor;
+static const std::string MESH_FRAGMENT_SHADER_VERT_COLOR =
+    std::string("#version 330 core\n") + MESH_FRAG_OUTPUTS + R"SHADER(
 struct Light {
     vec3 position;
     vec3 ambient;
@@ -106,7 +138,9 @@ in vec3 Normal; // Normal vector (world)
 uniform vec3 viewPos; // Camera position (world)
 uniform Light light; // Light info
 uniform Material material; // Limited material info
-
+uniform mat4 V; // View matrix
+uniform int ObjectID; // Object ID for the ID buffer
+)SHADER" + PACK_NORMAL_SHADER + R"SHADER(
 void main() {
     vec3 ambient = light.ambient * VertColor;
 
@@ -121,6 +155,9 @@ void main() {
     vec3 specular = light.specular * spec;
 
     FragColor = vec4(ambient + diffuse + specular, 1.0f);
+    FragDepth = -(V * vec4(FragPos, 1.0f)).z;
+    FragNormal = pack_normal(norm);
+    FragID = uvec2(uint(ObjectID), uint(gl_PrimitiveID));
 })SHADER";
 
 // Very simple shading for point cloud (points and polylines)
@@ -129,10 +166,12 @@ static const char* POINTCLOUD_VERTEX_SHADER = R"SHADER(
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aColor;
 out vec3 Color;
+out vec3 FragPos;
 uniform mat4 M;
 uniform mat4 MVP;
 void main() {
     Color = aColor;
+    FragPos = (M * vec4(aPosition, 1.0f)).xyz;
     gl_Position = MVP * vec4(aPosition, 1.0f);
 }
 )SHADER";
@@ -140,11 +179,20 @@ void main() {
 static const char* POINTCLOUD_FRAGMENT_SHADER = R"SHADER(
 #version 330 core
 
-out vec4 FragColor; // Ouput data
+layout(location = 0) out vec4 FragColor; // Ouput data
+layout(location = 1) out float FragDepth; // Linear depth
+layout(location = 2) out uint FragNormal; // Packed normal (none)
+layout(location = 3) out uvec2 FragID; // Object ID, point/segment ID
 in vec3 Color; // Color
+in vec3 FragPos; // Position (world)
+uniform mat4 V; // View matrix
+uniform int ObjectID; // Object ID for the ID buffer
 void main(){
     // Finish
     FragColor = vec4(Color, 1.0f);
+    FragDepth = -(V * vec4(FragPos, 1.0f)).z;
+    FragNormal = 0u;
+    FragID = uvec2(uint(ObjectID), uint(gl_PrimitiveID));
 }
 )SHADER";
 
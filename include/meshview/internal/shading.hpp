@@ -0,0 +1,46 @@
+#pragma once
+#ifndef MESHVIEW_SHADING_81D068A9_D35D_4109_86FC_EC597364DB42
+#define MESHVIEW_SHADING_81D068A9_D35D_4109_86FC_EC597364DB42
+
+#include <cstdint>
+#include "meshview/common.hpp"
+
+namespace meshview {
+namespace internal {
+
+// CPU versions of the shaders in shader_inline.hpp, shared by the software
+// renderers (Rasterizer, RayTracer)
+
+// Float texture image, rows from t = 0 up as uploaded to GL,
+// cols = width * channels (1, 3 or 4); data = nullptr means the grey blank
+// texture (see Mesh::gen_blank_texture)
+struct TextureImage {
+    const float* data = nullptr;
+    int width = 0, height = 0, channels = 0;
+};
+
+// Point light, position in world space
+struct Light {
+    Vector3f position, ambient, diffuse, specular;
+};
+
+// Bilinear texture lookup with repeat wrapping (GL_LINEAR, GL_REPEAT)
+Vector3f sample_texture(const TextureImage& tex, float u, float v);
+
+// Phong shading of the mesh fragment shaders; norm must be normalized.
+// specular_color is white for vertex-colored meshes
+Vector3f shade_phong(const Light& light, const Vector3f& view_pos,
+                     const Vector3f& frag_pos, const Vector3f& norm,
+                     const Vector3f& object_color,
+                     const Vector3f& specular_color, float shininess);
+
+// Octahedral normal encoding, as pack_normal in the shaders
+uint32_t pack_normal(Vector3f n);
+
+// Write color (clamped to [0, 1]) as RGBA8 with alpha 255
+void write_rgba8(const Vector3f& color, uint8_t* out);
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_SHADING_81D068A9_D35D_4109_86FC_EC597364DB42
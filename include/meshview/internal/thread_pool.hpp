@@ -0,0 +1,114 @@
+#pragma once
+#ifndef MESHVIEW_THREAD_POOL_F5DB8656_8797_4A32_9999_A86845DCF537
+#define MESHVIEW_THREAD_POOL_F5DB8656_8797_4A32_9999_A86845DCF537
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace meshview {
+namespace internal {
+
+// Work-stealing thread pool used by meshview's CPU-side kernels.
+// Each worker owns a task deque; it pops its own tasks LIFO and steals from
+// the other workers FIFO when it runs out. The thread calling parallel_for
+// also processes chunks, so num_threads counts the caller and a pool of size
+// 1 (no workers) runs everything serially on the caller.
+class ThreadPool {
+   public:
+    // The shared pool, sized to the hardware concurrency by default
+    // (configure with util::set_num_threads)
+    static ThreadPool& get();
+
+    // num_threads: total parallelism including the calling thread;
+    // 0 = hardware concurrency, 1 = serial.
+    // pin: pin worker i to core i (Linux only)
+    explicit ThreadPool(size_t num_threads = 0, bool pin = false);
+    // Finishes all queued tasks, then joins
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Change number of threads/pinning. Finishes all queued tasks first.
+    // Refuses (prints an error and returns false) while any parallel_for or
+    // submitted task is in flight, e.g. on a viewer's background thread;
+    // parallel_for calls made during the resize run serially.
+    bool resize(size_t num_threads, bool pin = false);
+
+    // Total parallelism, including the calling thread
+    inline size_t size() const { return _workers.size() + 1; }
+
+    // Call fn(chunk_begin, chunk_end) over chunks of [begin, end) of size at
+    // most grain (0 = automatic), in parallel; blocks until all are done.
+    // Safe to nest (the caller processes chunks itself rather than idling).
+    // If fn throws, chunks not yet started are skipped and the first
+    // exception is rethrown once the running ones have finished.
+    void parallel_for(size_t begin, size_t end,
+                      const std::function<void(size_t, size_t)>& fn,
+                      size_t grain = 0);
+
+    // Run a task asynchronously (inline if the pool is serial).
+    // Note: waiting on the future from inside another task may deadlock if
+    // all workers are busy waiting.
+    template <class Func>
+    auto submit(Func&& func) -> std::future<decltype(func())> {
+        using Result = decltype(func());
+        auto task = std::make_shared<std::packaged_task<Result()>>(
+            std::forward<Func>(func));
+        auto future = task->get_future();
+        if (!acquire()) {
+            (*task)();
+        } else if (_workers.empty()) {
+            (*task)();
+            release();
+        } else {
+            push([this, task]() {
+                (*task)();
+                release();
+            });
+        }
+        return future;
+    }
+
+   private:
+    struct Queue {
+        std::mutex mtx;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void start(size_t num_threads, bool pin);
+    void stop();
+    // Count a parallel_for/submitted task in flight, blocking resize; false
+    // (not counted) if a resize is in progress
+    bool acquire();
+    void release();
+    void push(std::function<void()> task);
+    bool pop(size_t queue_id, std::function<void()>& task);
+    void worker(size_t id, bool pin);
+
+    std::vector<std::thread> _workers;
+    std::vector<std::unique_ptr<Queue>> _queues;
+
+    // Number of queued (not yet started) tasks; guarded by _mtx for waking
+    size_t _queued = 0;
+    bool _stop = false;
+    // parallel_for calls and submitted tasks in flight, resize in progress;
+    // guarded by _mtx
+    size_t _users = 0;
+    bool _resizing = false;
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    std::atomic<size_t> _next_queue{0};
+};
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_THREAD_POOL_F5DB8656_8797_4A32_9999_A86845DCF537
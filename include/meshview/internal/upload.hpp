@@ -0,0 +1,90 @@
+#pragma once
+#ifndef MESHVIEW_UPLOAD_8EE92A8C_103A_440B_91AA_AC017218A449
+#define MESHVIEW_UPLOAD_8EE92A8C_103A_440B_91AA_AC017218A449
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "meshview/common.hpp"
+
+namespace meshview {
+namespace internal {
+
+// GL objects produced by one background upload, handed over to the owning
+// Mesh/PointCloud once the upload has completed on the GPU.
+// Shared between the owner (main thread) and the upload worker.
+struct PendingUpload {
+    // Vertex/element buffer names (shared between contexts)
+    Index VBO = -1, EBO = -1;
+    // Number of indices (mesh) or vertices (point cloud) to draw
+    size_t count = 0;
+    // Newly loaded textures: (texture type, index within type, GL id)
+    std::vector<std::array<Index, 3>> textures;
+
+    // Owner: true if the upload is complete and the objects may be used.
+    // The owner must then take over (or free) all objects above.
+    bool ready();
+    // Owner: drop this upload; frees its objects now if complete, else once
+    // the worker finishes it (or never, if it had not started)
+    void abandon();
+    // Worker: true if the owner no longer wants this upload
+    bool abandoned();
+    // Worker: called after the upload is fenced and complete
+    void complete();
+
+    // Delete all GL objects above (needs a current context)
+    void free_bufs();
+
+   private:
+    std::mutex _mtx;
+    bool _ready = false, _abandoned = false;
+};
+
+// Background GPU upload thread. Owns a hidden GLFW window whose context shares
+// objects (buffers, textures) with the main window; jobs run on the worker
+// thread with that context current. After each job, the worker fences and
+// waits until the GPU has consumed all of the job's commands before calling
+// the job's completion function, so that the main context never sees
+// partially uploaded objects.
+// Note: VAOs are NOT shared between contexts, so jobs should only create
+// buffers/textures and leave VAO setup to the main thread.
+class UploadWorker {
+   public:
+    // Create worker sharing objects with the given GLFWwindow.
+    // Must be called from the main thread (creates a window).
+    explicit UploadWorker(void* share_window);
+    // Joins the worker thread; jobs which have not started are dropped
+    ~UploadWorker();
+
+    UploadWorker(const UploadWorker&) = delete;
+    UploadWorker& operator=(const UploadWorker&) = delete;
+
+    // Queue an upload job; on_complete is called (on the worker thread)
+    // once the GPU has finished executing the job's commands
+    void submit(std::function<void()> job, std::function<void()> on_complete);
+
+    // False if the shared context could not be created
+    inline bool valid() const { return _window != nullptr; }
+
+   private:
+    struct Job {
+        std::function<void()> upload, on_complete;
+    };
+    void run();
+
+    void* _window = nullptr;
+    std::thread _thread;
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    std::deque<Job> _jobs;
+    bool _stop = false;
+};
+
+}  // namespace internal
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_UPLOAD_8EE92A8C_103A_440B_91AA_AC017218A449
@@ -3,15 +3,33 @@
 #define MESHVIEW_B1FE2D07_A12E_4C8B_A673_D9AC48841D24
 
 #include "meshview/common.hpp"
+#include "meshview/recorder.hpp"
+#include "meshview/animation.hpp"
+#include "meshview/point_stream.hpp"
 #include <vector>
 #include <array>
+#include <deque>
 #include <string>
 #include <cstdint>
 #include <cstddef>
 #include <cmath>
+#include <functional>
+#include <iosfwd>
 #include <memory>
+#include <mutex>
 
 namespace meshview {
+namespace internal {
+class UploadWorker;
+struct PendingUpload;
+class Shader;
+class HeadlessContext;
+class Framebuffer;
+class AsyncReadback;
+class Rasterizer;
+class RayTracer;
+class BenchmarkRun;
+}  // namespace internal
 
 // Represents a texture/material
 struct Texture {
@@ -37,6 +55,9 @@ struct Texture {
 
     // Texture from path
     Texture(const std::string& path, bool flip = true);
+    // Texture from an image file (as supported by stb_image) in memory,
+    // decoded immediately as by preload (e.g. images embedded in models)
+    Texture(const void* encoded, size_t size, bool flip = true);
     // Texture from solid color (1x1)
     Texture(float r, float g, float b);
     // Texture from an (rows, cols*3) row-major
@@ -52,15 +73,30 @@ struct Texture {
     // ADVANCED: free buffers, called by destructor
     void free_bufs();
 
+    // ADVANCED: Image data on the CPU, rows from the bottom as uploaded
+    // (cols = width * channels), read from path if needed; a 1x1 RGB image
+    // of the fallback color if unavailable. Used for software rendering
+    const Image& image(int& channels);
+
+    // ADVANCED: Decode the image at path now rather than in load(), e.g. to
+    // decode many textures on several threads (safe for distinct Texture
+    // objects). The 8-bit pixels are shared by copies of this texture.
+    // Returns false if there is no image to read or it failed to load.
+    bool preload();
+
     // GL texture id; -1 if unavailable
     Index id = -1;
 
    private:
+    friend class SceneCache;
+
     // File path (optional)
     std::string path;
 
     // Image data (optional)
     Image im_data;
+    // 8-bit image data decoded by preload, rows from the bottom (optional)
+    std::shared_ptr<const ImageU> im_u8;
     // Channels in above
     int n_channels;
 
@@ -69,6 +105,10 @@ struct Texture {
 
     // Vertical flip on load?
     bool flip;
+
+    // Read the image at path into im_data; returns the 8-bit data (to free
+    // with stbi_image_free) or nullptr on failure
+    uint8_t* read_file(int& width, int& height);
 };
 
 class Camera {
@@ -148,8 +188,13 @@ class Mesh {
 
     // Construct uninitialized mesh with given number of vertices, triangles
     explicit Mesh(size_t num_verts = 0, size_t num_triangles = 0);
-    // Construct from basic OBJ (see load_basic_obj)
+    // Construct from basic OBJ (see load_basic_obj), or a .npz archive
+    // (see load_npz)
     explicit Mesh(const std::string& path);
+    // Construct from .npy files (see load_npy)
+    explicit Mesh(const std::string& verts_path,
+                  const std::string& faces_path,
+                  const std::string& rgb_path = "");
     // Construct with given points, faces, and (optionally) color data
     // faces: triangles. if not specified, assumes they are 0 1 2, 3 4 5 etc
     // rgb: optional per-vertex color (ignored if you call set_tex_coords later)
@@ -219,6 +264,15 @@ class Mesh {
     // textures are reconstructed.
     void update(bool force_init = false);
 
+    // ADVANCED: Like update(), but the data is snapshotted and uploaded
+    // (along with any new textures) on the background upload thread.
+    // The previously uploaded version (or nothing) is drawn until the upload
+    // completes. Calls while an upload is in flight are coalesced: the data
+    // is snapshotted again only once it completes. Automatically estimated
+    // normals are only written to the GPU buffer, not to data. Usually called
+    // through Viewer::update.
+    void update_async(internal::UploadWorker& worker);
+
     // ADVANCED: Free buffers. Used automatically in destructor.
     void free_bufs();
 
@@ -241,12 +295,94 @@ class Mesh {
 
     // * VERY basic OBJ I/O
     // - Only supports v and f types
-    // - Each f row must consist of three integers (triangle indices)
+    // - Each f row lists vertex indices (anything after a '/' is ignored);
+    // polygons are split into triangle fans
     // - Each v row may consist of 3 OR 6 floats (position, or position+rgb
     // color)
-    void save_basic_obj(const std::string& path) const;
+    // Saving writes transformed positions (and rgb if shading_type is
+    // vertex) with the fewest digits that read back exactly, formatted in
+    // blocks on all threads; prints an error and returns false on failure
+    bool save_basic_obj(const std::string& path) const;
+    // The file is memory mapped and parsed in line-aligned chunks on all
+    // threads
     void load_basic_obj(const std::string& path);
 
+    // * OBJ/MTL import
+    // - v (with optional rgb), vt, vn and f rows; faces may use any of the
+    // v, v/vt, v//vn, v/vt/vn corner forms and negative (relative) indices;
+    // polygons are split into triangle fans
+    // - mtllib/usemtl with the Kd, Ks, Ns, map_Kd and map_Ks statements of
+    // the material (paths relative to the file containing them)
+    // Returns one mesh per material, in order of first use (empty on
+    // failure). Corners with the same v but different vt/vn become distinct
+    // vertices; vn are used only if every corner of the mesh has one.
+    // Meshes with a map_Kd and vt are textured, the others are colored by
+    // v rgb or Kd. Parsing is done as in load_basic_obj, texture images are
+    // decoded on all threads while the meshes are built.
+    static std::vector<std::unique_ptr<Mesh>> load_obj(
+        const std::string& path);
+
+    // * glTF 2.0 import (.gltf with external/data: URI buffers, or .glb)
+    // Returns one mesh per triangle primitive of each node in the default
+    // scene (empty on failure), with the node's world matrix as transform.
+    // Reads POSITION, NORMAL, COLOR_0 (times baseColorFactor, vertex
+    // shading) and TEXCOORD of the baseColorTexture (texture shading);
+    // strips/fans are converted to triangles, points/lines skipped. Accessors
+    // are converted straight from the mapped buffers into data/faces;
+    // embedded and external images are decoded on all threads.
+    static std::vector<std::unique_ptr<Mesh>> load_gltf(
+        const std::string& path);
+
+    // * PLY I/O (ASCII and binary)
+    // Reads x/y/z, nx/ny/nz (used if present, else normals are estimated),
+    // red/green/blue (uint8 or float; vertex shading if present) and face
+    // lists (polygons split into triangle fans). Binary files are memory
+    // mapped and converted straight into data/faces. Prints an error and
+    // returns false (leaving the mesh unchanged) if the file can't be read.
+    bool load_ply(const std::string& path);
+    // Writes transformed positions, rgb as uchar if shading_type is vertex,
+    // normals if set explicitly (see verts_norm) and faces.
+    // binary: binary in host byte order, else ASCII
+    bool save_ply(const std::string& path, bool binary = true) const;
+
+    // * Compressed mesh files
+    // Positions are quantized to position_bits (8 to 24) per axis within
+    // the bounding box, rgb (vertex shading) to 8 bits, explicit normals to
+    // 16-bit octahedral coordinates and uv to 16 bits. Triangles are
+    // reordered for the GPU vertex cache and vertices by first use, then
+    // attribute deltas are bit-packed and indices coded against recently
+    // used ones, in independent blocks (about 3-4x smaller than binary PLY
+    // for smooth meshes). Vertex and triangle order are not preserved and
+    // textures are not stored; transform, shininess and enabled are.
+    // Encoding and decoding use all threads.
+    bool save_compressed(const std::string& path,
+                         int position_bits = 16) const;
+    // Prints an error and returns false (leaving the mesh unchanged) if the
+    // file can't be read
+    bool load_compressed(const std::string& path);
+
+    // * NumPy arrays (see NpyArray in npy.hpp)
+    // From a .npz archive (np.savez or np.savez_compressed) with (N, 3)
+    // positions named verts, vertices, v, points, positions or xyz, and
+    // optionally (M, 3) integer faces (faces, triangles or f; else
+    // vertices 0 1 2, 3 4 5, ...), (N, 3) colors (colors, rgb or
+    // vertex_colors; integer types are normalized, e.g. uint8 / 255) and
+    // (N, 3) normals (normals, vn or vertex_normals). Any numeric dtype is
+    // converted. Prints an error and returns false (leaving the mesh
+    // unchanged) if the file can't be read.
+    bool load_npz(const std::string& path);
+    // The same from .npy files (faces and colors optional: empty paths)
+    bool load_npy(const std::string& verts_path,
+                  const std::string& faces_path = "",
+                  const std::string& rgb_path = "");
+
+    // Save in the format given by the extension of path: .obj
+    // (save_basic_obj), .ply (binary, save_ply), .mvz (save_compressed) or
+    // .mvc (a scene cache of this mesh, see SceneCache::write, which
+    // Viewer::add_cache loads without parsing). Prints an error and returns
+    // false on failure or for other extensions.
+    bool save(const std::string& path) const;
+
     // * Example meshes
     // Triangle
     static Mesh Triangle(const Eigen::Ref<const Vector3f>& a,
@@ -290,10 +426,18 @@ class Mesh {
     ShadingType shading_type = ShadingType::vertex;
 
    private:
+    friend class Viewer;
+    friend class SceneCache;
+
     // Generate a white 1x1 texture to blank_tex_id
     // used to fill maps if no texture provided
     void gen_blank_texture();
 
+    // Get the vertex data and triangles in the layout uploaded to the GPU
+    // (texture indexing if textured), estimating normals first if automatic
+    void buffer_data(const PointsRGBNormal*& vert_data,
+                     const Triangles*& face_data);
+
     // Vertex Array Object index
     Index VAO = -1;
 
@@ -312,6 +456,23 @@ class Mesh {
     // Whether to use automatic normal estimation (get normals automatically on
     // update)
     bool _auto_normals = true;
+
+    // Number of indices in the uploaded element buffer
+    size_t _draw_count = 0;
+    // Incremented by each update, invalidating data cached by the viewer
+    // (ray tracing BVHs, picking)
+    size_t _version = 0;
+
+    // In-flight background upload, if any
+    std::shared_ptr<internal::PendingUpload> _pending;
+    // Swap in buffers/textures from a completed background upload
+    void finish_upload();
+    // Set by update_async while an upload is in flight: the data has changed
+    // since, so upload it again on _upload_worker once that one completes
+    bool _upload_stale = false;
+    internal::UploadWorker* _upload_worker = nullptr;
+    // Snapshot the data and queue its upload on _upload_worker
+    void submit_upload();
 };
 
 // Represents a 3D point cloud with vertices (including uv, normals)
@@ -327,6 +488,10 @@ class PointCloud {
     // (can't put Eigen::Vector3f due 'ambiguity' with above)
     explicit PointCloud(const Eigen::Ref<const Points>& pos, float r = 1.f,
                         float g = 1.f, float b = 1.f);
+    // Load a .npz archive (see load_npz), a PLY file (see load_ply), or
+    // else .npy points and optionally colors (see load_npy)
+    explicit PointCloud(const std::string& path,
+                        const std::string& rgb_path = "");
 
     ~PointCloud();
 
@@ -378,9 +543,42 @@ class PointCloud {
     // this
     void update(bool force_init = false);
 
+    // ADVANCED: Like update(), but the data is snapshotted and uploaded on the
+    // background upload thread. The previously uploaded version (or nothing)
+    // is drawn until the upload completes. Calls while an upload is in
+    // flight are coalesced as for Mesh::update_async. Usually called through
+    // Viewer::update.
+    void update_async(internal::UploadWorker& worker);
+
     // ADVANCED: Free buffers. Used automatically in destructor.
     void free_bufs();
 
+    // ADVANCED: Upload points (rows laid out as in data) into an extra GPU
+    // buffer, drawn along with data but not kept in host memory, e.g. for
+    // out-of-core loading (see PointCloudStream). Needs a current context.
+    // Extra buffers are dropped by free_bufs and update(true), and are not
+    // drawn by the software renderer.
+    void append_gpu(const Eigen::Ref<const PointsRGB>& points);
+    // Number of points in extra GPU buffers
+    inline size_t num_gpu_points() const { return _gpu_points; }
+
+    // * PLY I/O (see Mesh::load_ply); colors default to white, normals
+    // and faces are ignored
+    bool load_ply(const std::string& path);
+    // Writes transformed positions and rgb as uchar
+    bool save_ply(const std::string& path, bool binary = true) const;
+
+    // * NumPy arrays (see NpyArray in npy.hpp)
+    // From a .npz archive with (N, 3) points (named points, verts,
+    // vertices, v, positions or xyz) and optionally (N, 3) colors (colors,
+    // rgb or vertex_colors; integer types are normalized), or (N, 6)
+    // points with colors. Uncolored points are white. Prints an error and
+    // returns false (leaving the point cloud unchanged) on failure.
+    bool load_npz(const std::string& path);
+    // The same from .npy files (colors optional: empty path)
+    bool load_npy(const std::string& points_path,
+                  const std::string& rgb_path = "");
+
     // * Example point clouds/lines
     static PointCloud Line(
         const Eigen::Ref<const Vector3f>& a,
@@ -404,13 +602,149 @@ class PointCloud {
     Matrix4f transform;
 
    private:
+    friend class Viewer;
+
     // Buffer indices
     Index VAO = -1, VBO = -1;
+
+    // Number of vertices in the uploaded vertex buffer
+    size_t _draw_count = 0;
+    // Incremented by each update, invalidating data cached by the viewer
+    // (picking)
+    size_t _version = 0;
+
+    // In-flight background upload, if any
+    std::shared_ptr<internal::PendingUpload> _pending;
+    // Swap in buffers from a completed background upload
+    void finish_upload();
+    // Set by update_async while an upload is in flight: the data has changed
+    // since, so upload it again on _upload_worker once that one completes
+    bool _upload_stale = false;
+    internal::UploadWorker* _upload_worker = nullptr;
+    // Snapshot the data and queue its upload on _upload_worker
+    void submit_upload();
+
+    // Extra GPU-only buffers (see append_gpu)
+    struct GpuChunk {
+        Index VAO, VBO;
+        size_t count;
+    };
+    std::vector<GpuChunk> _gpu_chunks;
+    size_t _gpu_points = 0;
 };
 
 // MeshView OpenGL 3D viewer
 class Viewer {
    public:
+    // Input-to-present latency statistics, in seconds
+    struct LatencyStats {
+        // Latency of the most recent frame which handled input
+        double last = 0.0;
+        // Mean/max over all measured frames
+        double mean = 0.0, max = 0.0;
+        // Number of measured frames
+        size_t count = 0;
+    };
+
+    // Summary of per-frame times, in milliseconds
+    struct TimeStats {
+        double min = 0.0, median = 0.0, p99 = 0.0, mean = 0.0, max = 0.0;
+    };
+
+    // Camera fly-through benchmark settings, see benchmark()
+    struct BenchmarkOptions {
+        // Camera path: keyframes spread evenly over the measured frames.
+        // center_of_rot, dist_to_center, yaw, pitch, roll and fovy are
+        // interpolated with Catmull-Rom splines; other parameters come from
+        // the first keyframe. Empty = one orbit around the current camera's
+        // center of rotation
+        std::vector<Camera> keyframes;
+        // Number of measured frames, preceded by warmup_frames unmeasured
+        // frames at the start of the path
+        size_t frames = 500, warmup_frames = 20;
+        // Render offscreen (as render_to_image, or with the software
+        // rasterizer if software_rendering) instead of in a window
+        bool headless = false;
+        // Window/image size; <= 0 means _width/_height
+        int width = 0, height = 0;
+    };
+
+    // Per-frame timings of a benchmark run, in milliseconds
+    struct BenchmarkResult {
+        // Frame time: from the start of a frame until its buffer swap
+        // returns (headless: until the GPU is at most 2 frames behind)
+        std::vector<double> frame_ms;
+        // CPU time to submit the scene's draw calls (to render it, for the
+        // software rasterizer)
+        std::vector<double> cpu_ms;
+        // GPU time of the scene, from timer queries (empty if unavailable)
+        std::vector<double> gpu_ms;
+        TimeStats frame, cpu, gpu;
+        int width = 0, height = 0;
+        bool headless = false;
+
+        // Print a summary table
+        void print(std::ostream& os) const;
+        // Write per-frame times as CSV (frame,frame_ms,cpu_ms,gpu_ms);
+        // returns false on failure
+        bool write_csv(const std::string& path) const;
+    };
+
+    // Buffers produced by render_aux in a single pass; all have rows top to
+    // bottom and one column per pixel unless noted
+    struct AuxBuffers {
+        // RGBA8 color, cols = width * 4
+        ImageU color;
+        // Linear depth: distance along the camera's viewing axis
+        // (0 = background)
+        Image depth;
+        // World-space unit normals, packed (see util::unpack_normal);
+        // 0 = no normal (background, point clouds)
+        ImageU32 normals;
+        // Object IDs: meshes[i] is i + 1, point_clouds[j] is
+        // meshes.size() + j + 1; 0 = background or axes
+        ImageU32 object_ids;
+        // Primitive IDs within the object: triangle (face row) index for
+        // meshes, point or line segment index for point clouds
+        ImageU32 primitive_ids;
+    };
+
+    // Result of GPU picking, see on_pick
+    struct PickResult {
+        // Query position, in window coordinates as in on_mouse_move
+        double x = 0.0, y = 0.0;
+        // Object ID of the picked pixel, as in AuxBuffers::object_ids
+        // (0 = nothing)
+        uint32_t object_id = 0;
+        // Index of the picked object in meshes or point_clouds (-1 if the
+        // object is not of that kind)
+        int mesh = -1, point_cloud = -1;
+        // Primitive ID, as in AuxBuffers::primitive_ids
+        uint32_t primitive = 0;
+        // Index of the viewport containing the query point (-1 if viewports
+        // is empty)
+        int viewport = -1;
+
+        inline bool hit() const { return object_id != 0; }
+    };
+
+    // A view of the scene within the window, see viewports
+    struct Viewport {
+        // Rectangle within the window, as fractions of the window size,
+        // origin at the top left
+        float x = 0.f, y = 0.f, width = 1.f, height = 1.f;
+        // If true, the viewport shows Viewer::camera, so that its camera
+        // control is synchronized with all other linked viewports; otherwise
+        // it shows (and mouse/keys in it control) camera independently.
+        // The aspect ratio always follows the rectangle.
+        bool linked = true;
+        Camera camera;
+        // Draw all meshes/point clouds (which are enabled), or only the
+        // listed indices into Viewer::meshes and Viewer::point_clouds
+        bool all_objects = true;
+        std::vector<size_t> meshes, point_clouds;
+    };
+
     Viewer();
     ~Viewer();
 
@@ -418,11 +752,27 @@ class Viewer {
     // press q/ESC to close window and exit loop
     void show();
 
+    // Close the window, ending show(). Thread-safe.
+    // If show() is starting, the window closes as soon as it opens; if it is
+    // not running, this does nothing.
+    void close();
+
+    // ADVANCED: Mark show() as starting, before calling it on another
+    // thread, so that a close() in between is not lost (show() also calls
+    // this itself). Thread-safe.
+    void begin_show();
+
+    // Run task on the render thread at the start of the next frame (or of
+    // the first frame, if show() is not running yet), waking the render loop
+    // if it is waiting for events. Thread-safe: use this to modify meshes,
+    // point clouds or the camera from other threads while show() runs.
+    void post(std::function<void()> task);
+
     // Add mesh (to Viewer::meshes), arguments are forwarded to Mesh constructor
     template <typename... Args>
     Mesh& add_mesh(Args&&... args) {
         meshes.push_back(std::make_unique<Mesh>(std::forward<Args>(args)...));
-        if (_looping) meshes.back()->update();
+        if (_looping) update(*meshes.back());
         return *meshes.back();
     }
     // Add point_cloud (to Viewer::point_clouds)
@@ -431,7 +781,7 @@ class Viewer {
     PointCloud& add_point_cloud(Args&&... args) {
         point_clouds.push_back(
             std::make_unique<PointCloud>(std::forward<Args>(args)...));
-        if (_looping) point_clouds.back()->update();
+        if (_looping) update(*point_clouds.back());
         return *point_clouds.back();
     }
     // Add a cube centered at cen with given side length.
@@ -443,6 +793,37 @@ class Viewer {
                    const Eigen::Ref<const Vector3f>& color = Vector3f(1.f, 0.5f,
                                                                       0.f));
 
+    // Add the meshes of an OBJ file, one per material (see Mesh::load_obj);
+    // returns them (empty on failure)
+    std::vector<Mesh*> add_obj(const std::string& path);
+    // Add the meshes of a glTF/GLB file (see Mesh::load_gltf); returns them
+    std::vector<Mesh*> add_gltf(const std::string& path);
+
+    // Add the meshes and point clouds of a scene cache written by
+    // save_cache or meshview-convert (see SceneCache); false on failure
+    bool add_cache(const std::string& path);
+    // Write all meshes and point clouds to a scene cache (SceneCache::write)
+    bool save_cache(const std::string& path, bool raw_textures = false) const;
+
+    // Play a mesh animation file (.mva, see MeshAnimation) on mesh, which
+    // must have the same number of vertices: the current frame is copied
+    // into mesh and uploaded whenever playback reaches a new frame, also
+    // while waiting for events. Space toggles playback, ',' and '.' step
+    // frames. Returns the animation (in animations), or nullptr on failure.
+    MeshAnimation* add_animation(const std::string& path, Mesh& mesh,
+                                 bool play = true);
+
+    // Stream a point cloud file too large for memory (XYZ/PCD/LAS, see
+    // PointCloudStream) into a new point cloud in point_clouds, which is
+    // drawn while it loads: each frame, show() appends up to
+    // options.chunks_per_frame decoded chunks to its GPU buffers. Returns
+    // the stream (in point_streams), or nullptr on failure.
+    PointCloudStream* add_point_stream(
+        const std::string& path, const PointCloudStream::Options& options);
+    inline PointCloudStream* add_point_stream(const std::string& path) {
+        return add_point_stream(path, PointCloudStream::Options());
+    }
+
     // Add a square centered at cen with given side length, normal to the
     // +z-axis. Mesh will have identity transform (points are moved physically
     // in the mesh)
@@ -467,10 +848,129 @@ class Viewer {
         const Eigen::Ref<const Vector3f>& b,
         const Eigen::Ref<const Vector3f>& color = Vector3f(1.f, 1.f, 1.f));
 
+    // Upload mesh/point cloud data to the GPU, i.e. Mesh::update.
+    // If async_upload is set and the window is open, the upload runs on the
+    // background upload thread instead (see Mesh::update_async) and does not
+    // block the render loop.
+    void update(Mesh& mesh, bool force_init = false);
+    void update(PointCloud& point_cloud, bool force_init = false);
+
+    // ADVANCED: Draw axes, point clouds and meshes as seen from camera into
+    // the current framebuffer through the current backend (see backend.hpp);
+    // show() calls this each frame. Outside show(), this needs a current GL
+    // context, or the null backend, e.g. to measure the CPU cost of the
+    // draw path without a GPU (call Mesh::update etc. first).
+    void draw_scene(const Camera& camera);
+
+    // * Headless rendering
+    // Render the scene from camera offscreen, without a window or event
+    // loop, and return the color image: rows top to bottom,
+    // cols = width * 4 (RGBA), values in [0, 1].
+    // width/height <= 0 means _width/_height; camera.aspect should match.
+    // The first call creates a headless GL context (EGL if available, see
+    // MESHVIEW_BUILD_EGL), which stays current on the calling thread, so
+    // call from one thread only and not while show() runs. Meshes/point
+    // clouds added later are uploaded automatically; after modifying
+    // existing ones, call their update(). Needs the GL backend.
+    // If no GL context can be created, or software_rendering is set, the
+    // scene is rendered on the CPU instead (also for render_aux and
+    // render_batch).
+    Image render_to_image(const Camera& camera, int width = 0, int height = 0);
+    // Same as render_to_image, writing RGBA8 into out (width * height * 4
+    // bytes, top row first). Returns false if no context is available.
+    bool render_to_buffer(const Camera& camera, uint8_t* out, int width = 0,
+                          int height = 0);
+
+    // Render color, linear depth, normals and object/primitive IDs of the
+    // scene from camera in a single pass (headless, as in render_to_image)
+    // through multiple render targets
+    AuxBuffers render_aux(const Camera& camera, int width = 0, int height = 0);
+    // Caller-provided outputs of render_aux_to_buffer, as in AuxBuffers
+    // (width x height pixels each, rows top to bottom); nullptr = skip
+    struct AuxTargets {
+        // RGB8 (color_channels = 3) or RGBA8 (4)
+        uint8_t* color = nullptr;
+        int color_channels = 4;
+        float* depth = nullptr;
+        uint32_t* normals = nullptr;
+        uint32_t* object_ids = nullptr;
+        uint32_t* primitive_ids = nullptr;
+    };
+    // Same as render_aux, reading each output directly into the caller's
+    // buffer (auxiliary targets are only drawn if requested). Returns false
+    // if no context is available.
+    bool render_aux_to_buffer(const Camera& camera, const AuxTargets& out,
+                              int width = 0, int height = 0);
+
+    // Batch rendering: render the scene from each camera (headless, as in
+    // render_to_image) and return the RGBA8 images stacked vertically,
+    // i.e. an N x height x width x 4 array with N = cameras.size()
+    ImageU render_batch(const std::vector<Camera>& cameras, int width = 0,
+                        int height = 0);
+    // Same as render_batch, writing into out, which must hold
+    // N * height * width * 4 bytes. Readback is pipelined: each view is read
+    // into a pixel buffer object asynchronously and copied out once its fence
+    // signals, with up to in_flight views outstanding, so the GPU keeps
+    // rendering instead of waiting on each glReadPixels.
+    // Returns throughput in views per second (0 on failure).
+    double render_batch_to_buffer(const std::vector<Camera>& cameras,
+                                  uint8_t* out, int width = 0, int height = 0,
+                                  size_t in_flight = 3);
+    // Throughput of the last render_batch call, in views per second
+    inline double batch_views_per_sec() const { return _batch_views_per_sec; }
+
+    // Render headless images with meshview's multithreaded tile-based
+    // software rasterizer, which implements the same shading on the CPU,
+    // instead of OpenGL. Also used (leaving this flag unchanged) when no
+    // headless GL context can be created, e.g. no GPU and no Mesa. Point
+    // sizes are in pixels.
+    bool software_rendering = false;
+
+    // * Ray tracing
+    // Buffers produced by ray_trace: as in AuxBuffers (point clouds do not
+    // appear), plus
+    struct RayTraceBuffers : AuxBuffers {
+        // Barycentric coordinates of the hit within its triangle (weights of
+        // the face's 2nd and 3rd vertex), cols = width * 2; 0 = background
+        Image barycentrics;
+    };
+    // Ray trace the meshes from camera on the CPU, for offline
+    // ground-truth renders: one ray per pixel center, exact depth, same
+    // shading as render_aux. Each mesh gets an SAH BVH in object space,
+    // kept until its next update(), under a BVH over meshes (respecting
+    // transform); rays are traced in packets on all threads.
+    // width/height <= 0 means _width/_height. Needs no GL context.
+    RayTraceBuffers ray_trace(const Camera& camera, int width = 0,
+                              int height = 0);
+    // Throughput of the last ray_trace call (excluding BVH builds), in rays
+    // per second
+    inline double ray_trace_rays_per_sec() const {
+        return _ray_trace_rays_per_sec;
+    }
+
+    // * Recording
+    // Record every frame presented by show() (including the GUI) to PNG
+    // files or an encoder process, see Recorder. Frames are read back
+    // through two pixel buffer objects, so the render loop does not wait
+    // for the GPU, and are encoded/written on writer threads.
+    // Recording stops when the window closes. Call from the render thread
+    // (e.g. in callbacks) or while show() is not running; use post()
+    // otherwise. Returns false if the recorder failed to start.
+    bool start_recording(const Recorder::Options& options);
+    // Write out pending frames and stop recording
+    void stop_recording();
+    inline bool recording() const { return _recorder != nullptr; }
+    // Counters of the current recording, or the last one if stopped
+    Recorder::Stats recording_stats();
+
     // * The meshes
     std::vector<std::unique_ptr<Mesh>> meshes;
     // * The point clouds
     std::vector<std::unique_ptr<PointCloud>> point_clouds;
+    // * The animations, each playing on its mesh (if set)
+    std::vector<std::unique_ptr<MeshAnimation>> animations;
+    // * The point cloud streams, each loading into its point cloud (if set)
+    std::vector<std::unique_ptr<PointCloudStream>> point_streams;
 
     // * Lighting
     // Ambient light color, default 0.2 0.2 0.2
@@ -485,6 +985,24 @@ class Viewer {
     // * Camera
     Camera camera;
 
+    // * Viewports
+    // Split screen: if not empty, show() draws the scene once per viewport,
+    // each with its own camera and object selection, in order (later ones
+    // on top where they overlap). All viewports draw the same GPU buffers
+    // and textures, so memory and upload time do not grow with the number
+    // of views. Dragging/scrolling controls the camera of the viewport
+    // under the mouse. Window only; headless rendering takes a camera.
+    std::vector<Viewport> viewports;
+    // Replace viewports by a rows x cols grid, in row-major order; if not
+    // linked, each viewport starts with a copy of camera
+    void split_viewports(int rows, int cols, bool linked = true);
+    // Index of the viewport containing window coordinates (x, y) (the last
+    // one if several do), or -1 if none or the window is closed
+    int viewport_at(double x, double y) const;
+    // Camera controlling viewport index: camera if it is linked or
+    // index is -1, else its own
+    Camera& viewport_camera(int index);
+
     // * Render params
     // Axes? (a)
     bool draw_axes = true;
@@ -494,8 +1012,55 @@ class Viewer {
     bool cull_face = true;
     // Whether to wait for event on loop
     // true: loops on user input (glfwWaitEvents), saves power and computation
+    // (playing animations and loading point streams still wake the loop)
     // false: loops continuously (glfwPollEvents), useful for e.g. animation
     bool loop_wait_events = true;
+    // Whether to upload mesh/point cloud data and textures on a background
+    // thread with a shared GL context, so that large uploads do not freeze
+    // the render loop (see update()). Set before show().
+    bool async_upload = false;
+
+    // * Latency
+    // Low-latency mode: process input events immediately before drawing
+    // each frame (instead of after presenting it), so that camera changes
+    // from mouse/key callbacks show up in the very next frame
+    bool low_latency = false;
+    // Swap interval passed to glfwSwapInterval: 1 = vsync, 0 = no vsync
+    int swap_interval = 1;
+    // Whether to call glFinish after each buffer swap, so that the CPU never
+    // runs ahead of the GPU and no frames queue up in the driver
+    bool finish_after_swap = false;
+
+    // Measured input-to-present latency: time from handling the first
+    // key/mouse/scroll event of a frame until that frame's buffer swap
+    // returns (after glFinish, if finish_after_swap)
+    inline const LatencyStats& latency_stats() const { return _latency; }
+    // Clear latency statistics
+    void reset_latency_stats();
+
+    // * Picking
+    // GPU picking for on_pick: object and primitive IDs of the scene are
+    // rendered into an integer framebuffer, only when the camera, window
+    // size or scene changed since the last pick, and the pixels around each
+    // query are read back asynchronously through pixel buffer objects, so
+    // that picking never stalls the render loop. Window only (use
+    // render_aux for headless ID buffers).
+    // Request a pick at window coordinates (x, y); mouse moves do this
+    // automatically while on_pick is set. Call from the render thread.
+    void pick(double x, double y);
+    // The hit nearest to the query point within a square of
+    // (2 * pick_radius + 1)^2 pixels is reported, so that thin lines and
+    // small points are easy to pick
+    int pick_radius = 2;
+
+    // * Benchmarking
+    // Replay a deterministic camera fly-through with vsync off and no event
+    // waiting, timing every frame (see BenchmarkOptions/BenchmarkResult).
+    // In a window, this runs show() until the path ends (q/ESC ends it
+    // early); the camera, swap_interval and loop_wait_events are restored
+    // afterwards. Results are empty if no window/context can be created.
+    BenchmarkResult benchmark(const BenchmarkOptions& options);
+    inline BenchmarkResult benchmark() { return benchmark(BenchmarkOptions()); }
 
     // * Aesthetics
     // Window title, updated on show() calls only (i.e. please set before
@@ -534,6 +1099,10 @@ class Viewer {
     // Called on mouse scroll: args(xoffset, yoffset) return false to prevent
     // default
     std::function<bool(double, double)> on_scroll;
+    // Called with what is under the cursor after it moves (or at a pick()
+    // position), usually a frame or two later; setting it enables GPU
+    // picking in show(). Called on the render thread
+    std::function<void(const PickResult&)> on_pick;
 
     // * Dynamic data (advanced, for use in callbacks)
     // Window width/height, as set in system
@@ -547,18 +1116,136 @@ class Viewer {
     // modify)
     int _mouse_button = -1, _mouse_mods;
 
+    // Viewport the mouse button was pressed in, which the drag controls
+    // (don't modify)
+    int _active_viewport = -1;
+
     // Window pos/size prior to full screen
     int _fullscreen_backup[4];
 
     // Is window in fullscreen? (do not modify)
     bool _fullscreen;
 
+    // Time (glfwGetTime) of the first input event not yet presented, or
+    // negative if none (don't modify)
+    double _input_time = -1.0;
+
     // ADNANCED: Pointer to GLFW window object
     void* _window = nullptr;
 
    private:
     // True only during the render loop (show())
     bool _looping = false;
+
+    // Move animations to the current time, copying new frames into their
+    // meshes
+    void update_animations();
+    // Upload chunks decoded by point streams since the last frame
+    void update_point_streams();
+    // Wait for events, until the next frame of a playing animation, or
+    // briefly while point streams load
+    void wait_events();
+
+    // Draw axes, point clouds and meshes without clearing; only the objects
+    // selected by viewport, if given
+    void draw_objects(const Camera& camera,
+                      const Viewport* viewport = nullptr);
+    // Clear the framebuffer of the given size (fbo, if given, else through
+    // the backend) and draw the scene in each of viewports
+    void draw_viewports(int width, int height,
+                        internal::Framebuffer* fbo = nullptr);
+    // Rectangle of viewports[index] in a framebuffer of the given size
+    // (pixels, y up)
+    void viewport_rect(size_t index, int width, int height, int& x, int& y,
+                       int& w, int& h) const;
+
+    // Create shaders and axes used by draw_scene, if not yet created
+    void init_scene_objects();
+    // Free shaders and axes (needs the same context/backend)
+    void free_scene_objects();
+    std::unique_ptr<internal::Shader> _shader_mesh, _shader_mesh_vert_color,
+        _shader_pc;
+    std::unique_ptr<PointCloud> _axes;
+
+    // Make the headless context current (creating it if needed), upload
+    // any meshes/point clouds not in it yet, and bind an offscreen
+    // framebuffer of the given size; false if unavailable
+    bool begin_headless(int& width, int& height);
+    // Free everything in the headless context, then destroy it
+    void destroy_headless();
+    std::unique_ptr<internal::HeadlessContext> _headless;
+    std::unique_ptr<internal::Framebuffer> _headless_fbo;
+    // Set when no headless GL context could be created, so that headless
+    // rendering falls back to the software rasterizer
+    bool _headless_failed = false;
+    // Whether headless rendering uses the software rasterizer
+    inline bool use_software() const {
+        return software_rendering || _headless_failed;
+    }
+    double _batch_views_per_sec = 0.0;
+
+    // Render the scene on the CPU into the given buffers (see
+    // internal::Rasterizer::Target; any may be nullptr), or ray trace it
+    // (internal::RayTracer::Target) if ray_trace
+    void render_software(const Camera& camera, int width, int height,
+                         uint8_t* color, float* depth = nullptr,
+                         uint32_t* normals = nullptr, uint32_t* ids = nullptr,
+                         bool ray_trace = false,
+                         float* barycentrics = nullptr);
+    std::unique_ptr<internal::Rasterizer> _rasterizer;
+    std::unique_ptr<internal::RayTracer> _ray_tracer;
+    double _ray_trace_rays_per_sec = 0.0;
+
+    // Queue a readback of the presented frame for the recorder, handing
+    // over finished earlier ones
+    void capture_frame();
+    // Hand the oldest readback to the recorder (waits for it)
+    void pop_recorded_frame();
+    std::unique_ptr<Recorder> _recorder;
+    std::unique_ptr<internal::AsyncReadback> _record_readback;
+    // Sizes of frames in _record_readback, oldest first
+    std::deque<std::pair<int, int>> _record_sizes;
+    Recorder::Stats _record_stats;
+
+    // Background upload thread, if async_upload (only during show())
+    std::unique_ptr<internal::UploadWorker> _upload_worker;
+
+    // Input-to-present latency statistics
+    LatencyStats _latency;
+    // Benchmark driving show(), if any
+    internal::BenchmarkRun* _benchmark = nullptr;
+
+    // Render the ID buffer if stale and queue the requested pick, and hand
+    // finished picks to on_pick
+    void update_picking();
+    // Hash of everything the ID buffer (of the given size) depends on
+    size_t pick_signature(int width, int height) const;
+    // True while a pick is requested or being read back
+    inline bool picking() const {
+        return _pick_requested || !_pick_queries.empty();
+    }
+    // A pick being read back: query point and the read rectangle
+    // (framebuffer pixels, y up)
+    struct PickQuery {
+        double x, y;
+        int x0, y0, width, height, center_x, center_y;
+    };
+    std::unique_ptr<internal::Framebuffer> _pick_fbo;
+    std::unique_ptr<internal::AsyncReadback> _pick_readback;
+    std::deque<PickQuery> _pick_queries;
+    bool _pick_requested = false, _pick_fbo_valid = false;
+    double _pick_x = 0.0, _pick_y = 0.0;
+    size_t _pick_signature = 0;
+
+    // Tasks posted from other threads; also guards _window and the flags
+    // below
+    std::mutex _post_mtx;
+    std::vector<std::function<void()>> _posted;
+    // show() is starting but the window is not open yet (see begin_show);
+    // close() was called meanwhile
+    bool _starting = false, _close_requested = false;
+    // Run (and clear) posted tasks
+    void run_posted();
 };
 
 }  // namespace meshview
@@ -0,0 +1,135 @@
+#pragma once
+#ifndef MESHVIEW_NPY_03CA106D_8202_4954_8CDA_FD97C35CE014
+#define MESHVIEW_NPY_03CA106D_8202_4954_8CDA_FD97C35CE014
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "meshview/common.hpp"
+
+namespace meshview {
+namespace internal {
+class MappedFile;
+enum class ScalarType;
+}  // namespace internal
+
+// An array of a NumPy .npy file, read without Python: the file is memory
+// mapped and the data used in place. Arrays of bool, (u)int8-64 and
+// float32/64 in either byte order and C or Fortran order (up to 2
+// dimensions) are supported.
+//
+// Data in meshview's layout (C order float32, or int32/uint32 for faces,
+// in host byte order) can be viewed without a copy (points_view etc.);
+// anything else is converted by read/to_* with a vectorized pass on the
+// thread pool.
+class NpyArray {
+   public:
+    NpyArray();
+    ~NpyArray();
+
+    // Map a .npy file and parse its header; prints an error and returns
+    // false if it is not a supported array
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const;
+
+    // NumPy dtype string, e.g. "<f4"
+    inline const std::string& dtype() const { return _dtype; }
+    inline const std::vector<size_t>& shape() const { return _shape; }
+    inline bool fortran_order() const { return _fortran; }
+    // shape[0] (1 for a scalar) and the product of the other dimensions
+    // (1 for a vector): the array as a matrix
+    size_t rows() const;
+    size_t cols() const;
+    // The array data and its size in bytes (valid until close)
+    inline const char* data() const { return _data; }
+    inline size_t size_bytes() const { return _size; }
+
+    // Views of the data in place if it is rows() x 3 (rows() x cols() for
+    // matrix_view) C order float32, or int32/uint32 for triangles_view, in
+    // host byte order and aligned; else empty (0 rows)
+    Eigen::Map<const Points> points_view() const;
+    Eigen::Map<const Triangles> triangles_view() const;
+    Eigen::Map<const Matrix> matrix_view() const;
+
+    // Convert the array (as rows() x cols()) into dst, whose rows are
+    // row_stride elements apart. normalize: scale integer types to [0, 1]
+    // (e.g. uint8 colors). Reading as Index prints an error and returns
+    // false (writing nothing) unless all values are integers in [0, 2^32).
+    void read(float* dst, size_t row_stride, bool normalize = false) const;
+    bool read(Index* dst, size_t row_stride) const;
+
+    // Copies (see read) into out, resized; print an error and return false
+    // if the shape does not fit: (N, 3) for points and triangles, (H, W) or
+    // (H, W, C) with C of 1, 3 or 4 for images, stored as Texture expects
+    // (H x W*C, rows as in the array) with integer types normalized
+    bool to_points(Points& out) const;
+    bool to_triangles(Triangles& out) const;
+    bool to_matrix(Matrix& out) const;
+    bool to_image(Image& out, int& channels) const;
+    // Print an error and return false unless the array is (N, cols)
+    bool check_cols(size_t cols) const;
+
+   private:
+    friend class NpzFile;
+    // Parse the .npy file [data, data + size), naming it name in errors
+    bool parse(const char* data, size_t size, const std::string& name);
+    template <class Out>
+    void convert(Out* dst, size_t row_stride, float scale) const;
+
+    // Keep the mapping (or inflated .npz member) alive while in use
+    std::shared_ptr<const internal::MappedFile> _file;
+    std::shared_ptr<const std::vector<char>> _buffer;
+    std::string _name, _dtype;
+    std::vector<size_t> _shape;
+    bool _fortran = false, _swap = false;
+    internal::ScalarType _type;
+    const char* _data = nullptr;
+    size_t _size = 0;
+};
+
+// A NumPy .npz archive (np.savez / np.savez_compressed), memory mapped.
+// Arrays stored uncompressed are used in place inside the mapping;
+// compressed ones are inflated into memory on get (which needs meshview
+// built with zlib, see MESHVIEW_USE_ZLIB).
+class NpzFile {
+   public:
+    NpzFile();
+    ~NpzFile();
+    NpzFile(const NpzFile&) = delete;
+    NpzFile& operator=(const NpzFile&) = delete;
+
+    // Map an .npz file and read its directory; prints an error and returns
+    // false if it is not a readable zip archive
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const;
+
+    // Names of the arrays, as passed to np.savez (without .npy)
+    std::vector<std::string> names() const;
+    bool contains(const std::string& name) const;
+    // Open array name into out (valid after close, which it keeps mapped);
+    // prints an error and returns false if it is missing or unreadable
+    bool get(const std::string& name, NpyArray& out) const;
+
+   private:
+    // A member of the archive, from its central directory
+    struct Entry {
+        std::string name;
+        // Offset of its local header, sizes of its (compressed) data
+        size_t header_offset, compressed_size, size;
+        // Zip compression method: 0 stored, 8 deflated
+        int method;
+    };
+    const Entry* find(const std::string& name) const;
+
+    std::shared_ptr<const internal::MappedFile> _file;
+    std::string _path;
+    std::vector<Entry> _entries;
+};
+
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_NPY_03CA106D_8202_4954_8CDA_FD97C35CE014
@@ -0,0 +1,154 @@
+#pragma once
+#ifndef MESHVIEW_POINT_STREAM_9E6C02CE_2CD4_4C68_AD70_AAB257F2A935
+#define MESHVIEW_POINT_STREAM_9E6C02CE_2CD4_4C68_AD70_AAB257F2A935
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "meshview/common.hpp"
+
+namespace meshview {
+namespace internal {
+class MappedFile;
+}  // namespace internal
+
+class PointCloud;
+
+// Out-of-core loading of point clouds too large for host memory.
+// The file is memory mapped and split into chunks of about
+// Options::chunk_points points, which parser threads decode independently
+// (in any order) into PointsRGB blocks. Decoded chunks wait in a bounded
+// queue until taken by upload() (appending them to GPU buffers of a
+// PointCloud, see PointCloud::append_gpu) or next_chunk(), so host memory
+// stays bounded however large the file is, and the cloud can be drawn
+// while it loads.
+//
+// Formats (by extension, or the LAS signature):
+// - XYZ text (.xyz, .txt, .pts, .csv): lines of x y z [r g b] or, with 7+
+//   columns, x y z intensity r g b, separated by blanks or commas; colors
+//   in 0-255 or 0-1. Other lines (headers, comments) are skipped.
+// - PCD (.pcd) with DATA ascii or binary (not binary_compressed), fields
+//   x y z and optionally rgb/rgba (packed) or r g b.
+// - LAS 1.0-1.4 (.las), point formats 0-10 (not LAZ), with RGB if the
+//   format has it (8- or 16-bit values).
+class PointCloudStream {
+   public:
+    struct Options {
+        // Points per chunk (approximate for text files)
+        size_t chunk_points = 1 << 20;
+        // Parser threads; 0 = hardware concurrency - 1 (at least 1)
+        size_t num_threads = 0;
+        // Most decoded chunks waiting to be taken: host memory stays below
+        // about (max_queued_chunks + num_threads) * chunk_points * 24 bytes
+        size_t max_queued_chunks = 4;
+        // Chunks uploaded per frame by Viewer (see Viewer::add_point_stream)
+        size_t chunks_per_frame = 2;
+        // Keep every stride-th point
+        size_t stride = 1;
+        // If > 0, raise stride so that about max_points points are kept
+        // (estimated from the file size for text files), and stop after
+        // max_points
+        size_t max_points = 0;
+        // Subtract origin() from positions, so that georeferenced
+        // coordinates (e.g. UTM) keep their precision as floats
+        bool recenter = true;
+        // Color of points in files without colors
+        Vector3f color = Vector3f(1.f, 1.f, 1.f);
+    };
+
+    struct Progress {
+        // Bytes of point data decoded so far, and in total
+        size_t bytes_parsed = 0, total_bytes = 0;
+        // Points taken (uploaded) so far, and the expected total (after
+        // stride; estimated for text files)
+        size_t points_loaded = 0, total_points = 0;
+        size_t chunks_loaded = 0, total_chunks = 0;
+        // Text lines which were not points
+        size_t skipped_lines = 0;
+        // All chunks (or max_points) taken
+        bool done = false;
+
+        inline double fraction() const {
+            return done ? 1.0
+                        : total_bytes ? (double)bytes_parsed / total_bytes
+                                      : 0.0;
+        }
+    };
+
+    PointCloudStream();
+    // Stops the parser threads
+    ~PointCloudStream();
+    PointCloudStream(const PointCloudStream&) = delete;
+    PointCloudStream& operator=(const PointCloudStream&) = delete;
+
+    // Map path, read its header and start the parser threads; prints an
+    // error and returns false if the file cannot be read
+    bool open(const std::string& path, const Options& options);
+    inline bool open(const std::string& path) {
+        return open(path, Options());
+    }
+    // Stop the parser threads and unmap the file
+    void close();
+    bool is_open() const;
+
+    // Take the next decoded chunk (in no particular order); if wait, block
+    // until one is ready. False if none is ready (or left, if wait).
+    bool next_chunk(PointsRGB& out, bool wait = true);
+    // Append up to max_chunks ready chunks to point_cloud's GPU buffers
+    // (without waiting; needs a current context); returns the number
+    // appended
+    size_t upload(PointCloud& point_cloud, size_t max_chunks = (size_t)-1);
+
+    // True until all chunks have been taken
+    bool loading() const;
+    // Counters so far (thread-safe)
+    Progress progress() const;
+    // Called on the thread taking chunks, after each one
+    std::function<void(const Progress&)> on_progress;
+
+    // Offset subtracted from positions (see Options::recenter): the center
+    // of the bounds of LAS files, the first point of text or
+    // double-precision PCD files, else zero
+    inline const Eigen::Vector3d& origin() const { return _origin; }
+    inline const Options& options() const { return _options; }
+
+    // Point cloud the chunks are shown in (see Viewer::add_point_stream)
+    PointCloud* point_cloud = nullptr;
+
+   private:
+    struct Layout;
+    // Decode chunk i; returns the bytes it covered
+    size_t decode(size_t i, PointsRGB& out, size_t& skipped) const;
+    void parser();
+    void stop();
+
+    std::unique_ptr<internal::MappedFile> _file;
+    std::unique_ptr<Layout> _layout;
+    Options _options;
+    Eigen::Vector3d _origin = Eigen::Vector3d::Zero();
+
+    std::vector<std::thread> _parsers;
+    std::atomic<size_t> _next_chunk{0};
+
+    mutable std::mutex _mtx;
+    // Signalled when a chunk is queued or a parser exits
+    std::condition_variable _cv_ready;
+    // Signalled when a chunk is taken or on stop
+    std::condition_variable _cv_space;
+    std::deque<PointsRGB> _ready;
+    bool _stop = false;
+    size_t _running = 0;
+    Progress _progress;
+};
+
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_POINT_STREAM_9E6C02CE_2CD4_4C68_AD70_AAB257F2A935
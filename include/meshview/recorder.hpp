@@ -0,0 +1,137 @@
+#pragma once
+#ifndef MESHVIEW_RECORDER_CD1CDADA_4A9B_4D83_A2F1_2A7169244FCD
+#define MESHVIEW_RECORDER_CD1CDADA_4A9B_4D83_A2F1_2A7169244FCD
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace meshview {
+
+// Writes frames (RGBA8, rows top to bottom) on background writer threads,
+// either as numbered PNG files or as a raw video stream piped into an
+// external encoder process. Frames wait in a bounded queue; when it is full
+// they are either dropped or the producer blocks, depending on the policy.
+// Used by Viewer::start_recording, but can also be fed directly.
+class Recorder {
+   public:
+    enum class Format {
+        // One PNG file per frame
+        png,
+        // Raw RGB (or RGBA with Options::alpha) frames written to the stdin
+        // of a shell command, e.g. "ffmpeg -y -f rawvideo -pix_fmt rgb24 -s "
+        // "1000x600 -r 60 -i - out.mp4" (-pix_fmt rgba if alpha). All
+        // frames must have the size of the first one; others (e.g. after
+        // resizing the window) are dropped.
+        raw_pipe,
+    };
+    // What to do with a new frame when the queue is full
+    enum class QueuePolicy {
+        // Drop the new frame (never stalls rendering)
+        drop,
+        // Wait for a writer to free a queue slot (never loses frames)
+        block,
+    };
+
+    struct Options {
+        Format format = Format::png;
+        // PNG: printf-style pattern taking the frame number,
+        // e.g. "frames/%05d.png"; raw_pipe: shell command to pipe into
+        std::string path = "frame%05d.png";
+        // Number of writer threads (PNG only; the pipe always uses one so
+        // frames stay in order); 0 = half the hardware concurrency
+        size_t num_writers = 0;
+        // Maximum number of frames waiting to be written
+        size_t max_queue = 8;
+        QueuePolicy policy = QueuePolicy::drop;
+        // zlib compression level for PNG (0-9); low levels are much faster
+        int png_compression = 1;
+        // Keep the alpha channel (else frames are written as RGB)
+        bool alpha = false;
+    };
+
+    struct Stats {
+        // Frames passed to push()
+        size_t captured = 0;
+        // Frames written successfully
+        size_t written = 0;
+        // Frames dropped because the queue was full (or failed to write)
+        size_t dropped = 0;
+        // Largest queue length seen
+        size_t max_queued = 0;
+        // Bytes written (PNG files / to the pipe)
+        size_t bytes_written = 0;
+    };
+
+    // Starts the writers (and the encoder process); check ok() afterwards
+    explicit Recorder(const Options& options);
+    // Writes all queued frames, then stops the writers
+    ~Recorder();
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // Queue an RGBA8 frame, rows top to bottom (width * height * 4 bytes).
+    // The frame is taken over; get a recycled buffer from buffer() to avoid
+    // reallocating per frame. Returns false if the frame was dropped.
+    bool push(std::vector<uint8_t>&& frame, int width, int height);
+    // A buffer of size bytes for the next frame, reused from written frames
+    // when possible
+    std::vector<uint8_t> buffer(size_t size);
+
+    // Wait until all queued frames are written
+    void flush();
+
+    // Counters so far
+    Stats stats();
+
+    // False if the encoder process could not be started or a write to it
+    // failed
+    inline bool ok() const { return _ok; }
+
+    inline const Options& options() const { return _options; }
+
+   private:
+    struct Frame {
+        std::vector<uint8_t> data;
+        int width, height;
+        size_t index;
+    };
+    void writer();
+    // Write a frame; returns bytes written, or 0 on failure
+    size_t write(Frame& frame);
+
+    Options _options;
+    std::vector<std::thread> _writers;
+    FILE* _pipe = nullptr;
+    std::atomic<bool> _ok{true};
+
+    std::mutex _mtx;
+    // Signalled when a frame is queued or on stop
+    std::condition_variable _cv_push;
+    // Signalled when a frame is taken or finishes writing
+    std::condition_variable _cv_pop;
+    std::deque<Frame> _queue;
+    // Buffers of written frames, for reuse
+    std::vector<std::vector<uint8_t>> _free;
+    // Frames taken by writers but not yet written
+    size_t _writing = 0;
+    // Number of the next accepted frame (PNG file numbers have no gaps)
+    size_t _next_index = 0;
+    // raw_pipe: size of the stream (of the first frame; 0 before it), and
+    // whether a frame of another size was reported
+    int _width = 0, _height = 0;
+    bool _size_warned = false;
+    bool _stop = false;
+    Stats _stats;
+};
+
+}  // namespace meshview
+
+#endif  // ifndef MESHVIEW_RECORDER_CD1CDADA_4A9B_4D83_A2F1_2A7169244FCD
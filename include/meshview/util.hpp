@@ -46,6 +46,33 @@ Eigen::Matrix<Index, Eigen::Dynamic, 1> make_uv_to_vert_map(
                         const Eigen::Ref<const Triangles>& tri_faces,
                         const Eigen::Ref<const Triangles>& uv_tri_faces);
 
+// Decode a normal packed by the auxiliary normal buffer
+// (Viewer::render_aux): 2x16-bit octahedral encoding, 0 = no normal
+Vector3f unpack_normal(uint32_t packed);
+
+// Decode all normals of a packed normal buffer (N pixels) into N x 3 points
+Points unpack_normals(const Eigen::Ref<const ImageU32>& packed);
+
+// Write 8-bit image data (rows top to bottom, channels = 1 (grey), 3 (RGB)
+// or 4 (RGBA) interleaved per pixel) as a PNG file. Uses zlib at the given
+// compression level (0-9) if meshview was built with it (MESHVIEW_ZLIB),
+// else writes uncompressed deflate blocks. Returns the file size in bytes,
+// or 0 on failure.
+size_t write_png(const std::string& path, const uint8_t* data, int width,
+                 int height, int channels, int compression_level = 6);
+
+// Set the number of threads used by meshview's CPU-side kernels
+// (normal estimation, OBJ parsing, texture conversion, etc).
+// num_threads: total number of threads including the calling thread;
+// 0 = hardware concurrency (default), 1 = serial.
+// pin: pin each worker thread to a core (Linux only)
+// Fails (returns false) while the threads are in use, e.g. by a viewer
+// running in the background; best called before any other use.
+bool set_num_threads(size_t num_threads, bool pin = false);
+
+// Get the number of threads used by meshview's CPU-side kernels
+size_t get_num_threads();
+
 }  // namespace util
 }  // namespace meshview
 
@@ -3,8 +3,12 @@
 #include <pybind11/eigen.h>
 #include <pybind11/stl.h>
 #include <pybind11/functional.h>
+#include <atomic>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 #include <map>
 
@@ -18,6 +22,132 @@ std::map<bool, bool*> bools;
 std::map<bool, float*> floats;
 std::map<bool, int*> ints;
 std::map<bool, std::string*> strs;
+
+// Render thread of a viewer shown with show(block=False)
+struct ViewerThread {
+    std::thread thread;
+    std::shared_ptr<std::atomic<bool>> running;
+};
+// Accessed only with the GIL held
+std::map<Viewer*, ViewerThread> viewer_threads;
+
+// Wait for a viewer's render thread (if any) to exit
+void join_viewer(Viewer& viewer) {
+    auto it = viewer_threads.find(&viewer);
+    if (it == viewer_threads.end()) return;
+    std::thread thread = std::move(it->second.thread);
+    viewer_threads.erase(it);
+    // Release the GIL, since the render thread may need it for callbacks
+    py::gil_scoped_release release;
+    thread.join();
+}
+
+// Closes and joins the render thread before destroying a viewer
+struct ViewerDeleter {
+    void operator()(Viewer* viewer) const {
+        if (viewer_threads.count(viewer)) {
+            viewer->close();
+            join_viewer(*viewer);
+        }
+        delete viewer;
+    }
+};
+
+// Arrays pushed to a mesh/point cloud from Python. They are copied and
+// checked against each other on the calling thread (raising ValueError),
+// and applied on the render thread.
+struct PushedData {
+    bool has_verts = false, has_rgb = false, has_normals = false,
+         has_faces = false;
+    Points verts, rgb, normals;
+    Triangles faces;
+    // Largest vertex index of faces + 1 (0 if none)
+    size_t faces_bound = 0;
+
+    PushedData(py::object verts_, py::object rgb_, py::object normals_,
+               py::object faces_ = py::none()) {
+        if ((has_verts = !verts_.is_none())) verts = verts_.cast<Points>();
+        if ((has_rgb = !rgb_.is_none())) rgb = rgb_.cast<Points>();
+        if ((has_normals = !normals_.is_none())) {
+            normals = normals_.cast<Points>();
+        }
+        if ((has_faces = !faces_.is_none())) faces = faces_.cast<Triangles>();
+        if (has_faces && faces.size()) faces_bound = faces.maxCoeff() + 1;
+        if (has_verts) {
+            if (has_rgb && rgb.rows() != verts.rows()) {
+                throw std::invalid_argument(
+                    "rgb must have as many rows as verts");
+            }
+            if (has_normals && normals.rows() != verts.rows()) {
+                throw std::invalid_argument(
+                    "normals must have as many rows as verts");
+            }
+            if (faces_bound > (size_t)verts.rows()) {
+                throw std::invalid_argument(
+                    "faces index past the end of verts");
+            }
+        } else if (has_rgb && has_normals && rgb.rows() != normals.rows()) {
+            throw std::invalid_argument(
+                "rgb and normals must have the same number of rows");
+        }
+    }
+
+    // Whether the arrays fit a target with n_verts vertices and faces
+    // old_faces (if any, kept unless faces are pushed) before apply; checked
+    // on the render thread for what was not pushed together
+    bool fits(size_t n_verts, const Triangles* old_faces = nullptr) const {
+        if (old_faces && !has_faces && old_faces->size()) {
+            const size_t n = has_verts ? (size_t)verts.rows() : n_verts;
+            if ((size_t)old_faces->maxCoeff() >= n) return false;
+        }
+        if (has_verts) return true;
+        return (!has_rgb || (size_t)rgb.rows() == n_verts) &&
+               (!has_normals || (size_t)normals.rows() == n_verts) &&
+               faces_bound <= n_verts;
+    }
+
+    // Copy into mesh/point cloud data, resizing if the number of vertices
+    // changed; attributes of added vertices not pushed are zero
+    template <class T>
+    void apply(T& target) const {
+        if (has_verts) {
+            const auto n_old = target.data.rows();
+            if (verts.rows() != n_old) {
+                target.data.conservativeResize(verts.rows(),
+                                               target.data.ColsAtCompileTime);
+                if (verts.rows() > n_old) {
+                    target.data.bottomRows(verts.rows() - n_old).setZero();
+                }
+            }
+            target.verts_pos() = verts;
+        }
+        if (has_rgb) target.verts_rgb() = rgb;
+    }
+};
+
+// Check that arr is a writable C-contiguous array of dtype T with the given
+// shape (-1 = any), so that it can be written to without copies
+template <class T>
+void check_out_array(const py::array& arr,
+                     const std::vector<py::ssize_t>& shape, const char* name) {
+    const bool ok_dtype = arr.dtype().is(py::dtype::of<T>());
+    const bool ok_flags = (arr.flags() & py::array::c_style) && arr.writeable();
+    bool ok_shape = arr.ndim() == (py::ssize_t)shape.size();
+    for (size_t i = 0; ok_shape && i < shape.size(); ++i) {
+        ok_shape = shape[i] < 0 || arr.shape(i) == shape[i];
+    }
+    if (!ok_dtype || !ok_flags || !ok_shape) {
+        std::string expected;
+        for (py::ssize_t dim : shape) {
+            expected += (expected.empty() ? "" : ", ") +
+                        (dim < 0 ? std::string("*") : std::to_string(dim));
+        }
+        throw std::invalid_argument(
+            std::string(name) + " must be a writable C-contiguous " +
+            py::str(py::dtype::of<T>()).cast<std::string>() +
+            " array of shape (" + expected + ")");
+    }
+}
 }  // namespace
 
 PYBIND11_MODULE(meshview, m) {
@@ -37,6 +167,16 @@ PYBIND11_MODULE(meshview, m) {
         .def("update", &Mesh::update, py::arg("force_init") = false)
         .def("save_basic_obj", &Mesh::save_basic_obj)
         .def("load_basic_obj", &Mesh::load_basic_obj)
+        .def("load_ply", &Mesh::load_ply, py::arg("path"))
+        .def("save_ply", &Mesh::save_ply, py::arg("path"),
+             py::arg("binary") = true)
+        .def("load_compressed", &Mesh::load_compressed, py::arg("path"))
+        .def("save_compressed", &Mesh::save_compressed, py::arg("path"),
+             py::arg("position_bits") = 16)
+        .def("save", &Mesh::save, py::arg("path"))
+        .def("load_npz", &Mesh::load_npz, py::arg("path"))
+        .def("load_npy", &Mesh::load_npy, py::arg("verts_path"),
+             py::arg("faces_path") = "", py::arg("rgb_path") = "")
         .def("resize", &Mesh::resize, py::arg("num_verts"),
              py::arg("num_triangles") = 0)
         .def_property_readonly("n_verts",
@@ -135,6 +275,12 @@ PYBIND11_MODULE(meshview, m) {
     py::class_<PointCloud>(m, "PointCloud")
         .def("update", &PointCloud::update, py::arg("force_init") = false)
         .def("resize", &PointCloud::resize, py::arg("num_verts"))
+        .def("load_ply", &PointCloud::load_ply, py::arg("path"))
+        .def("save_ply", &PointCloud::save_ply, py::arg("path"),
+             py::arg("binary") = true)
+        .def("load_npz", &PointCloud::load_npz, py::arg("path"))
+        .def("load_npy", &PointCloud::load_npy, py::arg("points_path"),
+             py::arg("rgb_path") = "")
         .def_property_readonly(
             "n_verts", [](PointCloud& self) { return self.data.rows(); })
         .def("translate", &PointCloud::translate,
@@ -184,7 +330,105 @@ PYBIND11_MODULE(meshview, m) {
         .def_readwrite("lines", &PointCloud::lines,
                        "If true, draws polylines instead of points");
 
+    py::class_<MeshAnimation> animation(m, "MeshAnimation");
+    animation.def(py::init<>())
+        .def("open", &MeshAnimation::open, py::arg("path"))
+        .def("open_raw", &MeshAnimation::open_raw, py::arg("path"),
+             py::arg("num_verts"), py::arg("normals") = false,
+             py::arg("fps") = 30.f)
+        .def("close", &MeshAnimation::close)
+        .def("is_open", &MeshAnimation::is_open)
+        .def_property_readonly("num_frames", &MeshAnimation::num_frames)
+        .def_property_readonly("num_verts", &MeshAnimation::num_verts)
+        .def_property_readonly("has_normals", &MeshAnimation::has_normals)
+        // Read-only views of the mapped file
+        .def("positions", &MeshAnimation::positions, py::arg("frame"),
+             py::return_value_policy::reference_internal)
+        .def("normals", &MeshAnimation::normals, py::arg("frame"),
+             py::return_value_policy::reference_internal)
+        .def("apply", &MeshAnimation::apply, py::arg("frame"),
+             py::arg("mesh"))
+        .def("play", &MeshAnimation::play)
+        .def("pause", &MeshAnimation::pause)
+        .def("seek", &MeshAnimation::seek, py::arg("frame"))
+        .def_property_readonly("playing", &MeshAnimation::playing)
+        .def_property_readonly("current_frame",
+                               &MeshAnimation::current_frame)
+        .def_readwrite("fps", &MeshAnimation::fps)
+        .def_readwrite("speed", &MeshAnimation::speed)
+        .def_readwrite("loop", &MeshAnimation::loop)
+        .def_readwrite("prefetch_frames", &MeshAnimation::prefetch_frames);
+
+    py::class_<MeshAnimation::Writer>(animation, "Writer")
+        .def(py::init<>())
+        .def("open", &MeshAnimation::Writer::open, py::arg("path"),
+             py::arg("num_verts"), py::arg("normals") = false,
+             py::arg("fps") = 30.f)
+        .def("add_frame", &MeshAnimation::Writer::add_frame,
+             py::arg("positions"), py::arg("normals") = Points())
+        .def("close", &MeshAnimation::Writer::close)
+        .def_property_readonly("num_frames",
+                               &MeshAnimation::Writer::num_frames);
+
+    py::class_<PointCloudStream> point_stream(m, "PointCloudStream");
+    py::class_<PointCloudStream::Options>(point_stream, "Options")
+        .def(py::init<>())
+        .def_readwrite("chunk_points", &PointCloudStream::Options::chunk_points)
+        .def_readwrite("num_threads", &PointCloudStream::Options::num_threads)
+        .def_readwrite("max_queued_chunks",
+                       &PointCloudStream::Options::max_queued_chunks)
+        .def_readwrite("chunks_per_frame",
+                       &PointCloudStream::Options::chunks_per_frame)
+        .def_readwrite("stride", &PointCloudStream::Options::stride)
+        .def_readwrite("max_points", &PointCloudStream::Options::max_points)
+        .def_readwrite("recenter", &PointCloudStream::Options::recenter)
+        .def_readwrite("color", &PointCloudStream::Options::color);
+    py::class_<PointCloudStream::Progress>(point_stream, "Progress")
+        .def_readonly("bytes_parsed", &PointCloudStream::Progress::bytes_parsed)
+        .def_readonly("total_bytes", &PointCloudStream::Progress::total_bytes)
+        .def_readonly("points_loaded",
+                      &PointCloudStream::Progress::points_loaded)
+        .def_readonly("total_points", &PointCloudStream::Progress::total_points)
+        .def_readonly("chunks_loaded",
+                      &PointCloudStream::Progress::chunks_loaded)
+        .def_readonly("total_chunks", &PointCloudStream::Progress::total_chunks)
+        .def_readonly("skipped_lines",
+                      &PointCloudStream::Progress::skipped_lines)
+        .def_readonly("done", &PointCloudStream::Progress::done)
+        .def_property_readonly("fraction",
+                               &PointCloudStream::Progress::fraction);
+    point_stream.def(py::init<>())
+        .def("open",
+             py::overload_cast<const std::string&,
+                               const PointCloudStream::Options&>(
+                 &PointCloudStream::open),
+             py::arg("path"), py::arg("options") = PointCloudStream::Options())
+        .def("close", &PointCloudStream::close)
+        .def("is_open", &PointCloudStream::is_open)
+        .def(
+            "next_chunk",
+            [](PointCloudStream& self, bool wait) -> py::object {
+                PointsRGB chunk;
+                bool got;
+                {
+                    py::gil_scoped_release release;
+                    got = self.next_chunk(chunk, wait);
+                }
+                if (!got) return py::none();
+                return py::cast(std::move(chunk));
+            },
+            py::arg("wait") = true,
+            "Next decoded chunk (N x 6 array), or None")
+        .def("upload", &PointCloudStream::upload, py::arg("point_cloud"),
+             py::arg("max_chunks") = (size_t)-1)
+        .def_property_readonly("loading", &PointCloudStream::loading)
+        .def_property_readonly("progress", &PointCloudStream::progress)
+        .def_property_readonly("origin", &PointCloudStream::origin)
+        .def_property_readonly("options", &PointCloudStream::options)
+        .def_readwrite("on_progress", &PointCloudStream::on_progress);
+
     py::class_<Camera>(m, "Camera")
+        .def(py::init<>())
         .def("update_view", &Camera::update_view)
         .def("update_proj", &Camera::update_proj)
         .def("reset_view", &Camera::reset_view)
@@ -219,7 +463,30 @@ PYBIND11_MODULE(meshview, m) {
         .def_readonly("up", &Camera::up)
         .def_readonly("world_up", &Camera::world_up);
 
-    py::class_<Viewer>(m, "Viewer")
+    py::class_<Viewer::LatencyStats>(m, "LatencyStats")
+        .def_readonly("last", &Viewer::LatencyStats::last)
+        .def_readonly("mean", &Viewer::LatencyStats::mean)
+        .def_readonly("max", &Viewer::LatencyStats::max)
+        .def_readonly("count", &Viewer::LatencyStats::count);
+
+    py::class_<Viewer::Viewport>(m, "Viewport")
+        .def(py::init<>())
+        // Rectangle in the window, as fractions of its size (origin top left)
+        .def_readwrite("x", &Viewer::Viewport::x)
+        .def_readwrite("y", &Viewer::Viewport::y)
+        .def_readwrite("width", &Viewer::Viewport::width)
+        .def_readwrite("height", &Viewer::Viewport::height)
+        .def_readwrite("linked", &Viewer::Viewport::linked,
+                       "Whether the viewport shows (and controls) "
+                       "Viewer.camera, else its own camera")
+        .def_readwrite("camera", &Viewer::Viewport::camera)
+        .def_readwrite("all_objects", &Viewer::Viewport::all_objects)
+        .def_readwrite("meshes", &Viewer::Viewport::meshes,
+                       "Mesh indices drawn if all_objects is False")
+        .def_readwrite("point_clouds", &Viewer::Viewport::point_clouds,
+                       "Point cloud indices drawn if all_objects is False");
+
+    py::class_<Viewer, std::unique_ptr<Viewer, ViewerDeleter>>(m, "Viewer")
         .def(py::init<>())
         .def(
             "add_mesh",
@@ -286,6 +553,22 @@ PYBIND11_MODULE(meshview, m) {
              py::arg("side_len") = 1.0f,
              py::arg("color") = Eigen::Vector3f(1.f, 0.5f, 0.f),
              py::return_value_policy::reference_internal)
+        .def("add_obj", &Viewer::add_obj, py::arg("path"),
+             py::return_value_policy::reference_internal)
+        .def("add_gltf", &Viewer::add_gltf, py::arg("path"),
+             py::return_value_policy::reference_internal)
+        .def("add_cache", &Viewer::add_cache, py::arg("path"))
+        .def("add_animation", &Viewer::add_animation, py::arg("path"),
+             py::arg("mesh"), py::arg("play") = true,
+             py::return_value_policy::reference_internal)
+        .def("add_point_stream",
+             py::overload_cast<const std::string&,
+                               const PointCloudStream::Options&>(
+                 &Viewer::add_point_stream),
+             py::arg("path"), py::arg("options") = PointCloudStream::Options(),
+             py::return_value_policy::reference_internal)
+        .def("save_cache", &Viewer::save_cache, py::arg("path"),
+             py::arg("raw_textures") = false)
         .def("add_square", &Viewer::add_square,
              py::arg("cen") = Eigen::Vector3f(0.f, 0.f, 0.f),
              py::arg("side_len") = 1.0f,
@@ -307,6 +590,11 @@ PYBIND11_MODULE(meshview, m) {
         .def_readwrite("light_color_ambient", &Viewer::light_color_ambient)
         .def_readwrite("light_color_diffuse", &Viewer::light_color_diffuse)
         .def_readwrite("light_color_specular", &Viewer::light_color_specular)
+        .def_readwrite("low_latency", &Viewer::low_latency)
+        .def_readwrite("swap_interval", &Viewer::swap_interval)
+        .def_readwrite("finish_after_swap", &Viewer::finish_after_swap)
+        .def_property_readonly("latency_stats", &Viewer::latency_stats)
+        .def("reset_latency_stats", &Viewer::reset_latency_stats)
         .def_readwrite("on_key", &Viewer::on_key)
         .def_readwrite("on_loop", &Viewer::on_loop)
         .def_readwrite("on_open", &Viewer::on_open)
@@ -340,5 +628,225 @@ PYBIND11_MODULE(meshview, m) {
         .def("clear_meshes", [](Viewer& self) { self.meshes.clear(); })
         .def("clear_point_clouds",
              [](Viewer& self) { self.point_clouds.clear(); })
-        .def("show", &Viewer::show);
+        .def_readwrite("async_upload", &Viewer::async_upload)
+        .def_readwrite("viewports", &Viewer::viewports,
+                       "Split screen views (list of Viewport; assign the "
+                       "whole list to change it)")
+        .def("split_viewports", &Viewer::split_viewports, py::arg("rows"),
+             py::arg("cols"), py::arg("linked") = true,
+             "Replace viewports by a rows x cols grid (row-major)")
+        .def("viewport_at", &Viewer::viewport_at, py::arg("x"), py::arg("y"),
+             "Index of the viewport at window coordinates (x, y), or -1")
+        .def(
+            "show",
+            [](Viewer& self, bool block) {
+                auto it = viewer_threads.find(&self);
+                if (it != viewer_threads.end()) {
+                    if (*it->second.running) {
+                        throw std::runtime_error("Viewer is already shown");
+                    }
+                    join_viewer(self);
+                }
+                if (block) {
+                    py::gil_scoped_release release;
+                    self.show();
+                    return;
+                }
+                auto running = std::make_shared<std::atomic<bool>>(true);
+                // A close() before the thread reaches show() is kept
+                self.begin_show();
+                ViewerThread& vt = viewer_threads[&self];
+                vt.running = running;
+                vt.thread = std::thread([&self, running]() {
+                    self.show();
+                    *running = false;
+                });
+            },
+            py::arg("block") = true,
+            R"pbdoc(Show window and run the render loop.
+The GIL is released while rendering (callbacks re-acquire it).
+If block=False, the render loop runs on a background native thread and this
+returns immediately; while it runs, only set_mesh_data,
+set_point_cloud_data, post, close and join may be used from Python.
+NOTE: GLFW does not support this on macOS, where windows must be managed by
+the main thread.)pbdoc")
+        .def(
+            "render",
+            [](Viewer& self, py::object cameras, py::object out,
+               py::object depth, int width, int height) -> py::object {
+                auto it = viewer_threads.find(&self);
+                if (it != viewer_threads.end() && *it->second.running) {
+                    throw std::runtime_error(
+                        "Cannot render headlessly while the viewer is shown");
+                }
+                // A single camera gives images without the batch dimension
+                const bool single = py::isinstance<Camera>(cameras);
+                std::vector<Camera> cams;
+                if (single) {
+                    cams.push_back(cameras.cast<Camera>());
+                } else {
+                    cams = cameras.cast<std::vector<Camera>>();
+                }
+                const py::ssize_t n = (py::ssize_t)cams.size();
+                const int batch_dims = single ? 0 : 1;
+
+                // Image size from the arguments, else from the arrays
+                bool has_out = !out.is_none(), has_depth = !depth.is_none();
+                py::array out_arr, depth_arr;
+                if (has_out) out_arr = out.cast<py::array>();
+                if (has_depth) depth_arr = depth.cast<py::array>();
+                if (width <= 0 || height <= 0) {
+                    const py::array& ref = has_out ? out_arr : depth_arr;
+                    if ((!has_out && !has_depth) ||
+                        ref.ndim() < batch_dims + 2) {
+                        throw std::invalid_argument(
+                            "width and height are required if out and depth "
+                            "are not given");
+                    }
+                    height = (int)ref.shape(batch_dims);
+                    width = (int)ref.shape(batch_dims + 1);
+                }
+                auto shape = [&](std::vector<py::ssize_t> dims) {
+                    if (!single) dims.insert(dims.begin(), n);
+                    return dims;
+                };
+                if (!has_out && !has_depth) {
+                    out_arr = py::array_t<uint8_t>(shape({height, width, 3}));
+                    has_out = true;
+                }
+                int channels = 0;
+                if (has_out) {
+                    channels = out_arr.ndim() == batch_dims + 3
+                                   ? (int)out_arr.shape(batch_dims + 2)
+                                   : 0;
+                    check_out_array<uint8_t>(
+                        out_arr,
+                        shape({height, width, channels == 4 ? 4 : 3}), "out");
+                }
+                if (has_depth) {
+                    check_out_array<float>(depth_arr, shape({height, width}),
+                                           "depth");
+                }
+
+                uint8_t* color_ptr =
+                    has_out ? (uint8_t*)out_arr.mutable_data() : nullptr;
+                float* depth_ptr =
+                    has_depth ? (float*)depth_arr.mutable_data() : nullptr;
+                const size_t n_pixels = (size_t)width * height;
+                bool ok = true;
+                {
+                    py::gil_scoped_release release;
+                    if (channels == 4 && !depth_ptr) {
+                        // Pipelined readback straight into out
+                        ok = self.render_batch_to_buffer(cams, color_ptr,
+                                                         width, height) > 0.0;
+                    } else {
+                        for (size_t i = 0; ok && i < cams.size(); ++i) {
+                            Viewer::AuxTargets targets;
+                            if (color_ptr) {
+                                targets.color =
+                                    color_ptr + i * n_pixels * channels;
+                                targets.color_channels = channels;
+                            }
+                            if (depth_ptr) {
+                                targets.depth = depth_ptr + i * n_pixels;
+                            }
+                            ok = self.render_aux_to_buffer(cams[i], targets,
+                                                           width, height);
+                        }
+                    }
+                }
+                if (!ok) {
+                    throw std::runtime_error(
+                        "Headless rendering is not available");
+                }
+                if (has_out && has_depth) {
+                    return py::make_tuple(out_arr, depth_arr);
+                }
+                return has_out ? py::object(out_arr) : py::object(depth_arr);
+            },
+            py::arg("cameras"), py::arg("out") = py::none(),
+            py::arg("depth") = py::none(), py::arg("width") = 0,
+            py::arg("height") = 0,
+            R"pbdoc(Render the scene headlessly (without a window) from a Camera
+or a list of N cameras, writing directly into preallocated arrays with the
+GIL released, e.g. inside data loader workers.
+out: uint8 array of shape (N, height, width, 3) for RGB or 4 for RGBA
+(no N for a single camera); depth: float32 array of shape (N, height, width)
+receiving linear depth (0 = background). Both must be C-contiguous; other
+arrays raise ValueError rather than being copied. The size comes from the
+arrays unless width/height are given; if neither array is given, an RGB
+array is allocated. Returns out, depth or (out, depth).
+Cameras' aspect should match width / height. Call from one thread, and not
+while the viewer is shown.)pbdoc")
+        .def("join", [](Viewer& self) { join_viewer(self); },
+             "Wait for a viewer shown with block=False to close")
+        .def("close", &Viewer::close, "Close the window (thread-safe)")
+        .def_property_readonly(
+            "is_open",
+            [](Viewer& self) {
+                auto it = viewer_threads.find(&self);
+                return it != viewer_threads.end() && *it->second.running;
+            },
+            "True while a viewer shown with block=False is running")
+        .def(
+            "post",
+            [](Viewer& self, std::function<void()> task) {
+                self.post(std::move(task));
+            },
+            py::arg("task"),
+            "Call task() on the render thread at the start of the next frame")
+        .def(
+            "set_mesh_data",
+            [](Viewer& self, size_t idx, py::object verts, py::object rgb,
+               py::object normals, py::object faces) {
+                auto data =
+                    std::make_shared<PushedData>(verts, rgb, normals, faces);
+                self.post([&self, idx, data]() {
+                    if (idx >= self.meshes.size()) return;
+                    Mesh& mesh = *self.meshes[idx];
+                    if (!data->fits(mesh.data.rows(), &mesh.faces)) {
+                        std::cerr << "set_mesh_data: arrays do not match the "
+                                     "vertices of mesh "
+                                  << idx << "\n";
+                        return;
+                    }
+                    data->apply(mesh);
+                    if (data->has_normals) mesh.verts_norm() = data->normals;
+                    if (data->has_faces) mesh.faces = data->faces;
+                    self.update(mesh);
+                });
+            },
+            py::arg("idx"), py::arg("verts") = py::none(),
+            py::arg("rgb") = py::none(), py::arg("normals") = py::none(),
+            py::arg("faces") = py::none(),
+            R"pbdoc(Thread-safe update of mesh idx: arrays are copied now and
+uploaded on the render thread at the start of the next frame. Raises
+ValueError if rgb/normals do not match verts or faces index past them;
+arrays pushed without verts must match the mesh's vertices, else they are
+ignored with an error message.)pbdoc")
+        .def(
+            "set_point_cloud_data",
+            [](Viewer& self, size_t idx, py::object verts, py::object rgb) {
+                auto data = std::make_shared<PushedData>(verts, rgb,
+                                                         py::none());
+                self.post([&self, idx, data]() {
+                    if (idx >= self.point_clouds.size()) return;
+                    PointCloud& pc = *self.point_clouds[idx];
+                    if (!data->fits(pc.data.rows())) {
+                        std::cerr << "set_point_cloud_data: rgb does not match "
+                                     "the points of point cloud "
+                                  << idx << "\n";
+                        return;
+                    }
+                    data->apply(pc);
+                    self.update(pc);
+                });
+            },
+            py::arg("idx"), py::arg("verts") = py::none(),
+            py::arg("rgb") = py::none(),
+            R"pbdoc(Thread-safe update of point cloud idx: arrays are copied now
+and uploaded on the render thread at the start of the next frame. Raises
+ValueError if rgb does not match verts; rgb pushed without verts must match
+the point cloud, else it is ignored with an error message.)pbdoc");
 }
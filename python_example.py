@@ -10,3 +10,25 @@ sph.verts_rgb[:] = [1, 0, 0]  # red
 cube = v.add_cube([2, 0, 0], 0.25)
 
 v.show()
+
+# Alternatively, run the render loop on a background thread and keep pushing
+# new data from Python while the window stays live:
+# v.show(block=False)
+# while v.is_open:
+#     v.set_mesh_data(0, verts=new_verts)  # thread-safe, copied immediately
+# v.join()
+
+# Headless rendering straight into preallocated arrays (no window needed; the
+# GIL is released while rendering, e.g. in data loader workers):
+# import numpy as np
+# cams = []
+# for i in range(8):
+#     cam = meshview.Camera()
+#     cam.yaw += i * 0.1
+#     cam.aspect = 640 / 480
+#     cam.update_view()
+#     cam.update_proj()
+#     cams.append(cam)
+# rgb = np.empty((8, 480, 640, 3), dtype=np.uint8)
+# depth = np.empty((8, 480, 640), dtype=np.float32)
+# v.render(cams, out=rgb, depth=depth)
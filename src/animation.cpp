@@ -0,0 +1,399 @@
+#include "meshview/animation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "meshview/meshview.hpp"
+#include "meshview/internal/mapped_file.hpp"
+#include "meshview/internal/thread_pool.hpp"
+
+namespace meshview {
+namespace {
+
+const char MAGIC[8] = {'M', 'V', 'A', 'N', 'I', 'M', '\0', '\0'};
+const uint32_t VERSION = 1;
+// Reads back differently on a host of the other byte order
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t n_frames, n_verts;
+    uint32_t flags;
+    float fps;
+    // Offset of the first frame
+    uint64_t data;
+    char reserved[16];
+};
+
+enum : uint32_t {
+    FLAG_NORMALS = 1,
+};
+
+static_assert(sizeof(FileHeader) == 64, "animation header layout");
+
+// Granularity of reads when touching frames
+const size_t PAGE = 4096;
+// Rows copied per task in apply
+const size_t COPY_GRAIN = 1 << 14;
+
+}  // namespace
+
+MeshAnimation::MeshAnimation()
+    : _file(std::make_unique<internal::MappedFile>()) {}
+
+MeshAnimation::~MeshAnimation() { close(); }
+
+bool MeshAnimation::map(const std::string& path) {
+    close();
+    // Frames are read where playback is, not front to back
+    return _file->open(path, internal::MappedFile::Access::random);
+}
+
+bool MeshAnimation::open(const std::string& path) {
+    if (!map(path)) return false;
+    auto fail = [&](const char* message) {
+        std::cerr << path << ": " << message << "\n";
+        close();
+        return false;
+    };
+    if (_file->size() < sizeof(FileHeader)) {
+        return fail("not a meshview animation");
+    }
+    FileHeader header;
+    std::memcpy(&header, _file->data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        return fail("not a meshview animation");
+    }
+    if (header.version != VERSION) {
+        return fail("unsupported meshview animation version");
+    }
+    if (header.byte_order != BYTE_ORDER_MARK) {
+        return fail("meshview animation written with another byte order");
+    }
+    const uint64_t size = _file->size();
+    const uint64_t frame_bytes =
+        header.n_verts * ((header.flags & FLAG_NORMALS) ? 6 : 3) *
+        sizeof(float);
+    if (header.data < sizeof(FileHeader) || header.data > size ||
+        header.data % sizeof(float) != 0 ||
+        header.n_verts > size / (6 * sizeof(float)) ||
+        (frame_bytes > 0 &&
+         header.n_frames > (size - header.data) / frame_bytes)) {
+        return fail("truncated meshview animation");
+    }
+    _num_frames = header.n_frames;
+    _num_verts = header.n_verts;
+    _normals = (header.flags & FLAG_NORMALS) != 0;
+    _offset = header.data;
+    _frame_bytes = frame_bytes;
+    if (header.fps > 0.f) fps = header.fps;
+    seek(0);
+    return true;
+}
+
+bool MeshAnimation::open_raw(const std::string& path, size_t num_verts,
+                             bool normals, float fps) {
+    if (!map(path)) return false;
+    const size_t frame_bytes = num_verts * (normals ? 6 : 3) * sizeof(float);
+    if (frame_bytes == 0 || _file->size() % frame_bytes != 0) {
+        std::cerr << path << ": size is not a multiple of the frame size ("
+                  << frame_bytes << " bytes)\n";
+        close();
+        return false;
+    }
+    _num_frames = _file->size() / frame_bytes;
+    _num_verts = num_verts;
+    _normals = normals;
+    _offset = 0;
+    _frame_bytes = frame_bytes;
+    this->fps = fps;
+    seek(0);
+    return true;
+}
+
+void MeshAnimation::close() {
+    stop_prefetcher();
+    _file->close();
+    _num_frames = _num_verts = 0;
+    _normals = false;
+    _offset = _frame_bytes = 0;
+    _playing = false;
+    _position = 0.0;
+    _last_time = -1.0;
+    _frame = 0;
+    _changed = true;
+}
+
+bool MeshAnimation::is_open() const { return _file->valid(); }
+
+Eigen::Map<const Points> MeshAnimation::positions(size_t frame) const {
+    if (frame >= _num_frames) return Eigen::Map<const Points>(nullptr, 0, 3);
+    return Eigen::Map<const Points>(
+        (const float*)(_file->data() + _offset + frame * _frame_bytes),
+        _num_verts, 3);
+}
+
+Eigen::Map<const Points> MeshAnimation::normals(size_t frame) const {
+    if (frame >= _num_frames || !_normals) {
+        return Eigen::Map<const Points>(nullptr, 0, 3);
+    }
+    return Eigen::Map<const Points>(
+        (const float*)(_file->data() + _offset + frame * _frame_bytes) +
+            _num_verts * 3,
+        _num_verts, 3);
+}
+
+bool MeshAnimation::apply(size_t frame, Mesh& mesh) const {
+    if (frame >= _num_frames) return false;
+    if ((size_t)mesh.data.rows() != _num_verts) {
+        std::cerr << "MeshAnimation: mesh has " << mesh.data.rows()
+                  << " vertices, animation " << _num_verts << "\n";
+        return false;
+    }
+    const auto pos = positions(frame);
+    const auto norm = normals(frame);
+    if (_normals) mesh.verts_norm();
+    // Strided copies into the interleaved vertex data
+    internal::ThreadPool::get().parallel_for(
+        0, _num_verts,
+        [&](size_t begin, size_t end) {
+            const size_t rows = end - begin;
+            mesh.data.block(begin, 0, rows, 3) = pos.middleRows(begin, rows);
+            if (_normals) {
+                mesh.data.block(begin, 6, rows, 3) =
+                    norm.middleRows(begin, rows);
+            }
+        },
+        COPY_GRAIN);
+    return true;
+}
+
+void MeshAnimation::play() {
+    if (_num_frames == 0) return;
+    // Restart from the beginning if paused at the end
+    if (!loop && !_playing) {
+        if (speed >= 0.f && _frame + 1 >= _num_frames) seek(0);
+        if (speed < 0.f && _frame == 0) seek(_num_frames - 1);
+    }
+    _playing = true;
+    _last_time = -1.0;
+    request_prefetch(_frame);
+}
+
+void MeshAnimation::pause() { _playing = false; }
+
+void MeshAnimation::seek(size_t frame) {
+    if (_num_frames == 0) return;
+    frame = std::min(frame, _num_frames - 1);
+    if (frame != _frame) _changed = true;
+    _frame = frame;
+    _position = (double)frame;
+    _last_time = -1.0;
+    request_prefetch(frame);
+}
+
+bool MeshAnimation::advance(double time) {
+    if (_playing && _num_frames > 0) {
+        if (_last_time >= 0.0) {
+            _position += (time - _last_time) * fps * speed;
+            const double n = (double)_num_frames;
+            if (loop) {
+                _position = std::fmod(_position, n);
+                if (_position < 0.0) _position += n;
+            } else if (speed > 0.f && _position >= n - 1.0) {
+                _position = n - 1.0;
+                _playing = false;
+            } else if (speed < 0.f && _position <= 0.0) {
+                _position = 0.0;
+                _playing = false;
+            }
+        }
+        _last_time = time;
+        const size_t frame = std::min((size_t)_position, _num_frames - 1);
+        if (frame != _frame) {
+            _frame = frame;
+            _changed = true;
+            request_prefetch(frame);
+        }
+    }
+    const bool changed = _changed;
+    _changed = false;
+    return changed;
+}
+
+double MeshAnimation::time_to_next_frame(double time) const {
+    const double rate = std::abs((double)fps * speed);
+    if (!_playing || rate == 0.0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    if (_last_time < 0.0) return 0.0;
+    // Fraction of a frame left until the position crosses a frame boundary
+    const double frac = _position - std::floor(_position);
+    double left = speed > 0.f ? 1.0 - frac : frac;
+    if (left == 0.0) left = 1.0;
+    return std::max(0.0, left / rate - (time - _last_time));
+}
+
+void MeshAnimation::request_prefetch(size_t frame) {
+    if (prefetch_frames == 0 || _num_frames <= 1) return;
+    {
+        std::lock_guard<std::mutex> lock(_prefetch_mtx);
+        _prefetch_pending = true;
+        _prefetch_frame = frame;
+        _prefetch_count = std::min(prefetch_frames, _num_frames - 1);
+        _prefetch_step = speed < 0.f ? -1 : 1;
+        _prefetch_wrap = loop;
+        _prefetch_restart = true;
+    }
+    if (!_prefetch_thread.joinable()) {
+        _prefetch_stop = false;
+        _prefetch_thread = std::thread(&MeshAnimation::prefetcher, this);
+    } else {
+        _prefetch_cv.notify_one();
+    }
+}
+
+void MeshAnimation::prefetcher() {
+    std::unique_lock<std::mutex> lock(_prefetch_mtx);
+    for (;;) {
+        _prefetch_cv.wait(
+            lock, [this] { return _prefetch_stop || _prefetch_pending; });
+        if (_prefetch_stop) return;
+        const long long n = (long long)_num_frames;
+        const long long first = (long long)_prefetch_frame;
+        const size_t count = _prefetch_count;
+        const int step = _prefetch_step;
+        const bool wrap = _prefetch_wrap;
+        _prefetch_pending = false;
+        _prefetch_restart = false;
+        lock.unlock();
+
+        // Ask the OS to start reading the whole range, then fault the pages
+        // in (read-ahead hints may be ignored), nearest frames first
+        for (size_t k = 1; k <= count && !_prefetch_restart; ++k) {
+            long long frame = first + (long long)k * step;
+            if (wrap) {
+                frame = ((frame % n) + n) % n;
+            } else if (frame < 0 || frame >= n) {
+                break;
+            }
+            _file->prefetch(_offset + (size_t)frame * _frame_bytes,
+                            _frame_bytes);
+        }
+        for (size_t k = 1; k <= count && !_prefetch_restart; ++k) {
+            long long frame = first + (long long)k * step;
+            if (wrap) {
+                frame = ((frame % n) + n) % n;
+            } else if (frame < 0 || frame >= n) {
+                break;
+            }
+            touch((size_t)frame);
+        }
+        lock.lock();
+    }
+}
+
+void MeshAnimation::touch(size_t frame) const {
+    if (_frame_bytes == 0) return;
+    const char* begin = _file->data() + _offset + frame * _frame_bytes;
+    const char* end = begin + _frame_bytes;
+    // Volatile reads are never optimized away, so nothing consumes them
+    for (const char* p = begin; p < end; p += PAGE) {
+        (void)*(const volatile char*)p;
+    }
+    (void)*(const volatile char*)(end - 1);
+}
+
+void MeshAnimation::stop_prefetcher() {
+    if (!_prefetch_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(_prefetch_mtx);
+        _prefetch_stop = true;
+        _prefetch_pending = false;
+    }
+    _prefetch_restart = true;
+    _prefetch_cv.notify_one();
+    _prefetch_thread.join();
+}
+
+MeshAnimation::Writer::Writer() = default;
+
+MeshAnimation::Writer::~Writer() { close(); }
+
+bool MeshAnimation::Writer::open(const std::string& path, size_t num_verts,
+                                 bool normals, float fps) {
+    close();
+    _ofs = std::make_unique<std::ofstream>(path, std::ios::binary);
+    if (!*_ofs) {
+        std::cerr << "Failed to open " << path << " for writing\n";
+        _ofs.reset();
+        return false;
+    }
+    _num_verts = num_verts;
+    _num_frames = 0;
+    _normals = normals;
+    FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.n_verts = num_verts;
+    header.flags = normals ? (uint32_t)FLAG_NORMALS : 0u;
+    header.fps = fps;
+    header.data = sizeof(FileHeader);
+    _ofs->write((const char*)&header, sizeof(header));
+    return (bool)*_ofs;
+}
+
+bool MeshAnimation::Writer::write(const Eigen::Ref<const Points>& values) {
+    if (values.outerStride() == 3) {
+        _ofs->write((const char*)values.data(),
+                    values.rows() * 3 * sizeof(float));
+    } else {
+        for (Eigen::Index i = 0; i < values.rows(); ++i) {
+            _ofs->write((const char*)values.row(i).data(), 3 * sizeof(float));
+        }
+    }
+    return (bool)*_ofs;
+}
+
+bool MeshAnimation::Writer::add_frame(
+    const Eigen::Ref<const Points>& positions,
+    const Eigen::Ref<const Points>& normals) {
+    if (!_ofs) return false;
+    if ((size_t)positions.rows() != _num_verts ||
+        (_normals && (size_t)normals.rows() != _num_verts)) {
+        std::cerr << "MeshAnimation::Writer: frame has "
+                  << positions.rows() << " positions, "
+                  << normals.rows() << " normals; expected " << _num_verts
+                  << (_normals ? " each" : " positions") << "\n";
+        return false;
+    }
+    if (!write(positions) || (_normals && !write(normals))) {
+        std::cerr << "MeshAnimation::Writer: write failed\n";
+        return false;
+    }
+    ++_num_frames;
+    return true;
+}
+
+bool MeshAnimation::Writer::close() {
+    if (!_ofs) return true;
+    const uint64_t n_frames = _num_frames;
+    _ofs->seekp(offsetof(FileHeader, n_frames));
+    _ofs->write((const char*)&n_frames, sizeof(n_frames));
+    _ofs->flush();
+    const bool ok = (bool)*_ofs;
+    if (!ok) std::cerr << "MeshAnimation::Writer: write failed\n";
+    _ofs.reset();
+    return ok;
+}
+
+}  // namespace meshview
@@ -0,0 +1,333 @@
+#include "meshview/backend.hpp"
+
+#include <iostream>
+#include <string>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "meshview/internal/headless.hpp"
+
+namespace meshview {
+
+namespace {
+
+void check_compile_errors(GLuint shader, const std::string& type) {
+    GLint success;
+    GLchar infoLog[1024];
+    if(type != "PROGRAM") {
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if(!success) {
+            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type <<
+                "\n" << infoLog <<
+                "\n -- ---------------------------------------------------  " << std::endl;
+        }
+    }
+    else {
+        glGetProgramiv(shader, GL_LINK_STATUS, &success);
+        if(!success) {
+            glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type <<
+                "\n" << infoLog <<
+                "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+    }
+}
+
+GLuint compile_shader(GLenum type, const char* code, const std::string& name) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &code, NULL);
+    glCompileShader(shader);
+    check_compile_errors(shader, name);
+    return shader;
+}
+
+// Number of channels for a GL pixel format
+size_t format_channels(unsigned format) {
+    switch (format) {
+        case GL_RED: case GL_DEPTH_COMPONENT: case GL_RED_INTEGER: return 1;
+        case GL_RG: case GL_RG_INTEGER: return 2;
+        case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: return 3;
+        default: return 4;
+    }
+}
+
+// Size in bytes of a GL pixel component type
+size_t type_size(unsigned type) {
+    switch (type) {
+        case GL_UNSIGNED_BYTE: case GL_BYTE: return 1;
+        case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return 2;
+        default: return 4;
+    }
+}
+
+GLBackend gl_backend;
+Backend* current_backend = &gl_backend;
+
+}  // namespace
+
+Backend& backend() { return *current_backend; }
+void set_backend(Backend* backend) {
+    current_backend = backend ? backend : &gl_backend;
+}
+
+// *** GLBackend ***
+bool GLBackend::has_context() {
+    // Check EGL first: GLFW may not be initialized when rendering headless
+    return internal::egl_context_current() ||
+           glfwGetCurrentContext() != nullptr;
+}
+
+void GLBackend::gen_buffers(int n, Index* ids) { glGenBuffers(n, ids); }
+void GLBackend::delete_buffers(int n, const Index* ids) {
+    glDeleteBuffers(n, ids);
+}
+void GLBackend::bind_buffer(unsigned target, Index id) {
+    glBindBuffer(target, id);
+}
+void GLBackend::buffer_data(unsigned target, size_t size, const void* data,
+                            unsigned usage) {
+    glBufferData(target, (GLsizeiptr)size, data, usage);
+}
+
+void GLBackend::gen_vertex_arrays(int n, Index* ids) {
+    glGenVertexArrays(n, ids);
+}
+void GLBackend::delete_vertex_arrays(int n, const Index* ids) {
+    glDeleteVertexArrays(n, ids);
+}
+void GLBackend::bind_vertex_array(Index id) { glBindVertexArray(id); }
+void GLBackend::vertex_attrib_pointer(Index index, int size, size_t stride,
+                                      size_t offset) {
+    glEnableVertexAttribArray(index);
+    glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, (GLsizei)stride,
+                          (GLvoid*)offset);
+}
+
+void GLBackend::gen_textures(int n, Index* ids) { glGenTextures(n, ids); }
+void GLBackend::delete_textures(int n, const Index* ids) {
+    glDeleteTextures(n, ids);
+}
+void GLBackend::active_texture(Index unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+}
+void GLBackend::bind_texture(unsigned target, Index id) {
+    glBindTexture(target, id);
+}
+void GLBackend::tex_parameter(unsigned target, unsigned pname, int value) {
+    glTexParameteri(target, pname, value);
+}
+void GLBackend::tex_image_2d(unsigned target, int level, int internal_format,
+                             int width, int height, unsigned format,
+                             unsigned type, const void* data) {
+    // Rows of 8-bit RGB images are tightly packed
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(target, level, internal_format, width, height, 0, format,
+                 type, data);
+}
+void GLBackend::generate_mipmap(unsigned target) { glGenerateMipmap(target); }
+
+Index GLBackend::create_program(const char* vertex, const char* fragment,
+                                const char* geometry) {
+    const bool has_geometry = geometry != nullptr && geometry[0] != 0;
+    GLuint vs = compile_shader(GL_VERTEX_SHADER, vertex, "VERTEX");
+    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, fragment, "FRAGMENT");
+    GLuint gs = 0;
+    if (has_geometry) {
+        gs = compile_shader(GL_GEOMETRY_SHADER, geometry, "GEOMETRY");
+    }
+    // Shader program
+    GLuint id = glCreateProgram();
+    glAttachShader(id, vs);
+    glAttachShader(id, fs);
+    if (has_geometry) glAttachShader(id, gs);
+    glLinkProgram(id);
+    check_compile_errors(id, "PROGRAM");
+    // Delete the shaders as they're linked into our program now and no longer necessery
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    if (has_geometry) glDeleteShader(gs);
+    return id;
+}
+void GLBackend::delete_program(Index id) { glDeleteProgram(id); }
+void GLBackend::use_program(Index id) { glUseProgram(id); }
+int GLBackend::uniform_location(Index program, const char* name) {
+    return glGetUniformLocation(program, name);
+}
+void GLBackend::uniform_int(int location, int value) {
+    glUniform1i(location, value);
+}
+void GLBackend::uniform_float(int location, float value) {
+    glUniform1f(location, value);
+}
+void GLBackend::uniform_vec(int location, int components, const float* value) {
+    switch (components) {
+        case 2: glUniform2fv(location, 1, value); break;
+        case 3: glUniform3fv(location, 1, value); break;
+        case 4: glUniform4fv(location, 1, value); break;
+    }
+}
+void GLBackend::uniform_mat(int location, int dim, const float* value) {
+    switch (dim) {
+        case 2: glUniformMatrix2fv(location, 1, GL_FALSE, value); break;
+        case 3: glUniformMatrix3fv(location, 1, GL_FALSE, value); break;
+        case 4: glUniformMatrix4fv(location, 1, GL_FALSE, value); break;
+    }
+}
+
+void GLBackend::clear(float r, float g, float b, float a) {
+    glClearColor(r, g, b, a);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+void GLBackend::set_enabled(unsigned cap, bool enabled) {
+    if (enabled) glEnable(cap);
+    else glDisable(cap);
+}
+void GLBackend::depth_func(unsigned func) { glDepthFunc(func); }
+void GLBackend::polygon_mode(unsigned mode) {
+    glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+void GLBackend::point_size(float size) { glPointSize(size); }
+void GLBackend::viewport(int x, int y, int width, int height) {
+    glViewport(x, y, width, height);
+}
+void GLBackend::scissor(int x, int y, int width, int height) {
+    glScissor(x, y, width, height);
+}
+void GLBackend::draw_elements(unsigned mode, size_t count) {
+    glDrawElements(mode, (GLsizei)count, GL_UNSIGNED_INT, 0);
+}
+void GLBackend::draw_arrays(unsigned mode, size_t first, size_t count) {
+    glDrawArrays(mode, (GLint)first, (GLsizei)count);
+}
+
+// *** NullBackend ***
+void NullBackend::gen(int n, Index* ids) {
+    ++stats.calls;
+    for (int i = 0; i < n; ++i) ids[i] = _next_id++;
+    stats.objects_created += n;
+}
+void NullBackend::del(int n, const Index* ids) {
+    ++stats.calls;
+    for (int i = 0; i < n; ++i) {
+        if (~ids[i] && ids[i] != 0) ++stats.objects_deleted;
+    }
+}
+
+bool NullBackend::has_context() { return true; }
+
+void NullBackend::gen_buffers(int n, Index* ids) { gen(n, ids); }
+void NullBackend::delete_buffers(int n, const Index* ids) { del(n, ids); }
+void NullBackend::bind_buffer(unsigned, Index) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+void NullBackend::buffer_data(unsigned, size_t size, const void*, unsigned) {
+    ++stats.calls;
+    ++stats.buffer_uploads;
+    stats.buffer_bytes += size;
+}
+
+void NullBackend::gen_vertex_arrays(int n, Index* ids) { gen(n, ids); }
+void NullBackend::delete_vertex_arrays(int n, const Index* ids) {
+    del(n, ids);
+}
+void NullBackend::bind_vertex_array(Index) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+void NullBackend::vertex_attrib_pointer(Index, int, size_t, size_t) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+
+void NullBackend::gen_textures(int n, Index* ids) { gen(n, ids); }
+void NullBackend::delete_textures(int n, const Index* ids) { del(n, ids); }
+void NullBackend::active_texture(Index) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+void NullBackend::bind_texture(unsigned, Index) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+void NullBackend::tex_parameter(unsigned, unsigned, int) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+void NullBackend::tex_image_2d(unsigned, int, int, int width, int height,
+                               unsigned format, unsigned type, const void*) {
+    ++stats.calls;
+    ++stats.texture_uploads;
+    stats.texture_bytes +=
+        (size_t)width * height * format_channels(format) * type_size(type);
+}
+void NullBackend::generate_mipmap(unsigned) { ++stats.calls; }
+
+Index NullBackend::create_program(const char*, const char*, const char*) {
+    Index id;
+    gen(1, &id);
+    return id;
+}
+void NullBackend::delete_program(Index id) { del(1, &id); }
+void NullBackend::use_program(Index) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+int NullBackend::uniform_location(Index, const char*) {
+    ++stats.calls;
+    return 0;
+}
+void NullBackend::uniform_int(int, int) {
+    ++stats.calls;
+    ++stats.uniform_sets;
+}
+void NullBackend::uniform_float(int, float) {
+    ++stats.calls;
+    ++stats.uniform_sets;
+}
+void NullBackend::uniform_vec(int, int, const float*) {
+    ++stats.calls;
+    ++stats.uniform_sets;
+}
+void NullBackend::uniform_mat(int, int, const float*) {
+    ++stats.calls;
+    ++stats.uniform_sets;
+}
+
+void NullBackend::clear(float, float, float, float) { ++stats.calls; }
+void NullBackend::set_enabled(unsigned, bool) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+void NullBackend::depth_func(unsigned) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+void NullBackend::polygon_mode(unsigned) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+void NullBackend::point_size(float) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+void NullBackend::viewport(int, int, int, int) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+void NullBackend::scissor(int, int, int, int) {
+    ++stats.calls;
+    ++stats.state_changes;
+}
+void NullBackend::draw_elements(unsigned, size_t count) {
+    ++stats.calls;
+    ++stats.draw_calls;
+    stats.draw_vertices += count;
+}
+void NullBackend::draw_arrays(unsigned, size_t, size_t count) {
+    ++stats.calls;
+    ++stats.draw_calls;
+    stats.draw_vertices += count;
+}
+
+}  // namespace meshview
@@ -0,0 +1,264 @@
+#include "meshview/internal/benchmark.hpp"
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace meshview {
+namespace internal {
+
+namespace {
+// Uniform Catmull-Rom spline through b (t = 0) and c (t = 1)
+template <class T>
+T catmull_rom(const T& a, const T& b, const T& c, const T& d, float t) {
+    const float t2 = t * t, t3 = t2 * t;
+    return 0.5f * ((2.f * b) + (c - a) * t +
+                   (2.f * a - 5.f * b + 4.f * c - d) * t2 +
+                   (3.f * b - a - 3.f * c + d) * t3);
+}
+
+// Set the view parameters of camera to the path's pose at s in [0, 1]
+void camera_on_path(const std::vector<Camera>& keys, float s,
+                    Camera& camera) {
+    const Camera& first = keys[0];
+    camera.world_up = first.world_up;
+    camera.ortho = first.ortho;
+    camera.z_close = first.z_close;
+    camera.z_far = first.z_far;
+    if (keys.size() == 1) {
+        camera.center_of_rot = first.center_of_rot;
+        camera.dist_to_center = first.dist_to_center;
+        camera.yaw = first.yaw;
+        camera.pitch = first.pitch;
+        camera.roll = first.roll;
+        camera.fovy = first.fovy;
+    } else {
+        const int last = (int)keys.size() - 1;
+        const float x = std::min(std::max(s, 0.f), 1.f) * last;
+        const int k = std::min((int)x, last - 1);
+        const float t = x - k;
+        const Camera& a = keys[std::max(k - 1, 0)];
+        const Camera& b = keys[k];
+        const Camera& c = keys[k + 1];
+        const Camera& d = keys[std::min(k + 2, last)];
+        camera.center_of_rot = catmull_rom<Vector3f>(
+            a.center_of_rot, b.center_of_rot, c.center_of_rot,
+            d.center_of_rot, t);
+        camera.dist_to_center = catmull_rom(a.dist_to_center, b.dist_to_center,
+                                            c.dist_to_center, d.dist_to_center,
+                                            t);
+        camera.yaw = catmull_rom(a.yaw, b.yaw, c.yaw, d.yaw, t);
+        camera.pitch = catmull_rom(a.pitch, b.pitch, c.pitch, d.pitch, t);
+        camera.roll = catmull_rom(a.roll, b.roll, c.roll, d.roll, t);
+        camera.fovy = catmull_rom(a.fovy, b.fovy, c.fovy, d.fovy, t);
+    }
+    camera.update_view();
+    camera.update_proj();
+}
+
+Viewer::TimeStats compute_stats(std::vector<double> times) {
+    Viewer::TimeStats stats;
+    if (times.empty()) return stats;
+    std::sort(times.begin(), times.end());
+    const size_t n = times.size();
+    stats.min = times.front();
+    stats.max = times.back();
+    stats.median = n % 2 ? times[n / 2]
+                         : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+    stats.p99 = times[std::min(
+        n - 1, (size_t)std::max(std::ceil(0.99 * n) - 1.0, 0.0))];
+    for (double t : times) stats.mean += t;
+    stats.mean /= n;
+    return stats;
+}
+
+double ms_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::high_resolution_clock::now() - start)
+        .count();
+}
+}  // namespace
+
+BenchmarkRun::BenchmarkRun(const Viewer::BenchmarkOptions& options,
+                           const Camera& start, bool gpu_timing)
+    : _options(options), _gpu_timing(gpu_timing) {
+    if (_options.keyframes.empty()) {
+        // Orbit once around the center of rotation
+        for (int i = 0; i <= 4; ++i) {
+            Camera key = start;
+            key.yaw += i * 0.5f * (float)M_PI;
+            _options.keyframes.push_back(key);
+        }
+    }
+    _options.frames = std::max<size_t>(_options.frames, 1);
+    _result.frame_ms.reserve(_options.frames);
+    _result.cpu_ms.reserve(_options.frames);
+    if (_gpu_timing) _result.gpu_ms.reserve(_options.frames);
+}
+
+void BenchmarkRun::begin_frame(Camera& camera) {
+    if (_gpu_timing && _queries.empty()) {
+        _queries.resize(RING_SIZE);
+        glGenQueries((GLsizei)RING_SIZE, _queries.data());
+    }
+    const float s = _frame < _options.warmup_frames
+                        ? 0.f
+                        : (float)(_frame - _options.warmup_frames) /
+                              std::max<size_t>(_options.frames - 1, 1);
+    camera_on_path(_options.keyframes, s, camera);
+    _frame_start = std::chrono::high_resolution_clock::now();
+    if (_gpu_timing) {
+        glBeginQuery(GL_TIME_ELAPSED, _queries[_frame % RING_SIZE]);
+    }
+}
+
+void BenchmarkRun::end_submit() {
+    if (_gpu_timing) glEndQuery(GL_TIME_ELAPSED);
+    if (_frame >= _options.warmup_frames) {
+        _result.cpu_ms.push_back(ms_since(_frame_start));
+    }
+}
+
+bool BenchmarkRun::end_frame() {
+    // The query of frame - (RING_SIZE - 1) must be read before its slot is
+    // reused
+    if (_gpu_timing && _frame >= RING_SIZE - 1) {
+        read_query(_frame - (RING_SIZE - 1));
+    }
+    if (_frame >= _options.warmup_frames) {
+        _result.frame_ms.push_back(ms_since(_frame_start));
+    }
+    ++_frame;
+    return _frame >= _options.warmup_frames + _options.frames;
+}
+
+void BenchmarkRun::read_query(size_t frame) {
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(_queries[frame % RING_SIZE], GL_QUERY_RESULT, &ns);
+    if (frame >= _options.warmup_frames) _result.gpu_ms.push_back(ns * 1e-6);
+}
+
+const Viewer::BenchmarkResult& BenchmarkRun::finish() {
+    if (_finished) return _result;
+    _finished = true;
+    if (!_queries.empty()) {
+        const size_t first =
+            _frame >= RING_SIZE - 1 ? _frame - (RING_SIZE - 1) : 0;
+        for (size_t frame = first; frame < _frame; ++frame) read_query(frame);
+        glDeleteQueries((GLsizei)_queries.size(), _queries.data());
+        _queries.clear();
+    }
+    _result.frame = compute_stats(_result.frame_ms);
+    _result.cpu = compute_stats(_result.cpu_ms);
+    _result.gpu = compute_stats(_result.gpu_ms);
+    return _result;
+}
+
+}  // namespace internal
+
+void Viewer::BenchmarkResult::print(std::ostream& os) const {
+    os << "meshview benchmark: " << frame_ms.size() << " frames, " << width
+       << "x" << height << (headless ? " headless" : " window") << "\n";
+    const std::ios::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+    os << "  (ms)  " << std::setw(9) << "min" << std::setw(9) << "median"
+       << std::setw(9) << "p99" << std::setw(9) << "mean" << std::setw(9)
+       << "max"
+       << "\n";
+    auto row = [&](const char* name, const std::vector<double>& times,
+                   const TimeStats& stats) {
+        os << "  " << std::left << std::setw(6) << name << std::right;
+        if (times.empty()) {
+            os << "  unavailable\n";
+            return;
+        }
+        os << std::setw(9) << stats.min << std::setw(9) << stats.median
+           << std::setw(9) << stats.p99 << std::setw(9) << stats.mean
+           << std::setw(9) << stats.max << "\n";
+    };
+    row("frame", frame_ms, frame);
+    row("cpu", cpu_ms, cpu);
+    row("gpu", gpu_ms, gpu);
+    if (frame.median > 0.0) {
+        os << "  median fps " << std::setprecision(1) << 1e3 / frame.median
+           << "\n";
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+bool Viewer::BenchmarkResult::write_csv(const std::string& path) const {
+    std::ofstream ofs(path);
+    if (!ofs) {
+        std::cerr << "Failed to open " << path << " for writing\n";
+        return false;
+    }
+    ofs << "frame,frame_ms,cpu_ms,gpu_ms\n";
+    for (size_t i = 0; i < frame_ms.size(); ++i) {
+        ofs << i << "," << frame_ms[i] << ","
+            << (i < cpu_ms.size() ? cpu_ms[i] : 0.0) << ",";
+        if (i < gpu_ms.size()) ofs << gpu_ms[i];
+        ofs << "\n";
+    }
+    return (bool)ofs;
+}
+
+Viewer::BenchmarkResult Viewer::benchmark(const BenchmarkOptions& options) {
+    if (options.headless) {
+        int width = options.width > 0 ? options.width : _width;
+        int height = options.height > 0 ? options.height : _height;
+        const bool use_gl = !use_software() && begin_headless(width, height);
+        if (!use_gl && !use_software()) {
+            std::cerr << "Benchmark: no headless context available\n";
+            return BenchmarkResult();
+        }
+        Camera cam = camera;
+        cam.aspect = (float)width / (float)height;
+        internal::BenchmarkRun run(options, cam, use_gl);
+        std::vector<uint8_t> image(use_gl ? 0 : (size_t)width * height * 4);
+        do {
+            run.begin_frame(cam);
+            if (use_gl) {
+                draw_scene(cam);
+            } else {
+                render_software(cam, width, height, image.data());
+            }
+            run.end_submit();
+            if (use_gl) glFlush();
+        } while (!run.end_frame());
+        BenchmarkResult result = run.finish();
+        result.width = width;
+        result.height = height;
+        result.headless = true;
+        return result;
+    }
+
+    const Camera saved_camera = camera;
+    const bool saved_loop_wait_events = loop_wait_events;
+    const int saved_swap_interval = swap_interval;
+    const int saved_width = _width, saved_height = _height;
+    if (options.width > 0) _width = options.width;
+    if (options.height > 0) _height = options.height;
+    loop_wait_events = false;
+    swap_interval = 0;
+    internal::BenchmarkRun run(options, camera, true);
+    _benchmark = &run;
+    show();  // Finishes the run before destroying the window
+    _benchmark = nullptr;
+
+    BenchmarkResult result = run.finish();
+    result.width = _width;
+    result.height = _height;
+    camera = saved_camera;
+    loop_wait_events = saved_loop_wait_events;
+    swap_interval = saved_swap_interval;
+    _width = saved_width;
+    _height = saved_height;
+    return result;
+}
+
+}  // namespace meshview
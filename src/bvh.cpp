@@ -0,0 +1,215 @@
+#include "meshview/internal/bvh.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include "meshview/internal/thread_pool.hpp"
+
+namespace meshview {
+namespace internal {
+
+namespace {
+// Number of SAH bins per axis
+const int NUM_BINS = 16;
+// Nodes with more primitives are binned in parallel, and their children
+// built in parallel
+const size_t PARALLEL_SIZE = 16384;
+// Leaves are never larger than this, even if splitting costs more
+const size_t MAX_LEAF_SIZE = 16;
+
+struct Bin {
+    Eigen::AlignedBox3f box;
+    size_t count = 0;
+};
+
+inline float half_area(const Eigen::AlignedBox3f& box) {
+    if (box.isEmpty()) return 0.f;
+    const Vector3f e = box.sizes();
+    return e.x() * e.y() + e.y() * e.z() + e.z() * e.x();
+}
+}  // namespace
+
+void RayPacket::init() {
+    for (int a = 0; a < 3; ++a) inv_d[a] = d[a].inverse();
+    u.setZero();
+    v.setZero();
+    prim.setConstant(~0u);
+    object.setConstant(~0u);
+}
+
+void Bvh::build(const std::vector<Eigen::AlignedBox3f>& boxes,
+                size_t max_leaf_size) {
+    const size_t n = boxes.size();
+    _nodes.clear();
+    _indices.resize(n);
+    std::iota(_indices.begin(), _indices.end(), 0u);
+    if (n == 0) return;
+    std::vector<Vector3f> centroids(n);
+    ThreadPool::get().parallel_for(0, n, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) centroids[i] = boxes[i].center();
+    });
+    _nodes.resize(2 * n - 1);
+    build_node(0, 0, n, 0, boxes, centroids,
+               std::min(std::max<size_t>(max_leaf_size, 1), MAX_LEAF_SIZE));
+}
+
+Eigen::AlignedBox3f Bvh::bounds() const {
+    if (_nodes.empty()) return Eigen::AlignedBox3f();
+    return Eigen::AlignedBox3f(Eigen::Map<const Vector3f>(_nodes[0].min),
+                               Eigen::Map<const Vector3f>(_nodes[0].max));
+}
+
+void Bvh::build_node(uint32_t id, size_t begin, size_t end, int depth,
+                     const std::vector<Eigen::AlignedBox3f>& boxes,
+                     const std::vector<Vector3f>& centroids,
+                     size_t max_leaf_size) {
+    const size_t count = end - begin;
+    const bool parallel = count > PARALLEL_SIZE;
+    std::mutex mtx;
+    // Run fn(chunk_begin, chunk_end) over the node's primitives, in parallel
+    // if large
+    auto for_prims = [&](const std::function<void(size_t, size_t)>& fn) {
+        if (parallel) {
+            ThreadPool::get().parallel_for(begin, end, fn);
+        } else {
+            fn(begin, end);
+        }
+    };
+
+    // Bounds of the primitives and of their centroids
+    Eigen::AlignedBox3f box, centroid_box;
+    for_prims([&](size_t chunk_begin, size_t chunk_end) {
+        Eigen::AlignedBox3f b, cb;
+        for (size_t i = chunk_begin; i < chunk_end; ++i) {
+            b.extend(boxes[_indices[i]]);
+            cb.extend(centroids[_indices[i]]);
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        box.extend(b);
+        centroid_box.extend(cb);
+    });
+    Node& node = _nodes[id];
+    Eigen::Map<Vector3f>(node.min) = box.min();
+    Eigen::Map<Vector3f>(node.max) = box.max();
+
+    auto make_leaf = [&]() {
+        node.index = (uint32_t)begin;
+        node.count = (uint16_t)count;
+        node.axis = 0;
+    };
+    const bool too_deep = depth >= MAX_DEPTH;
+    if ((count <= max_leaf_size || too_deep) &&
+        count <= std::numeric_limits<uint16_t>::max()) {
+        make_leaf();
+        return;
+    }
+
+    // Binned SAH: cost of a split relative to traversing the node, with
+    // primitive intersection cost 1 and node traversal cost 1
+    const Vector3f extent = centroid_box.sizes();
+    float best_cost = std::numeric_limits<float>::max();
+    int best_axis = -1, best_split = 0;
+    for (int axis = 0; axis < 3 && !too_deep; ++axis) {
+        if (!(extent[axis] > 0.f)) continue;
+        const float scale = NUM_BINS / extent[axis];
+        const float lo = centroid_box.min()[axis];
+        Bin bins[NUM_BINS];
+        for_prims([&](size_t chunk_begin, size_t chunk_end) {
+            Bin local[NUM_BINS];
+            for (size_t i = chunk_begin; i < chunk_end; ++i) {
+                const uint32_t prim = _indices[i];
+                const int b = std::min(
+                    (int)((centroids[prim][axis] - lo) * scale), NUM_BINS - 1);
+                local[b].box.extend(boxes[prim]);
+                ++local[b].count;
+            }
+            std::lock_guard<std::mutex> lock(mtx);
+            for (int b = 0; b < NUM_BINS; ++b) {
+                bins[b].box.extend(local[b].box);
+                bins[b].count += local[b].count;
+            }
+        });
+        // Sweep from the right, then from the left
+        float right_area[NUM_BINS];
+        size_t right_count[NUM_BINS];
+        Eigen::AlignedBox3f acc;
+        size_t acc_count = 0;
+        for (int b = NUM_BINS - 1; b > 0; --b) {
+            acc.extend(bins[b].box);
+            acc_count += bins[b].count;
+            right_area[b] = half_area(acc);
+            right_count[b] = acc_count;
+        }
+        acc.setEmpty();
+        acc_count = 0;
+        for (int b = 1; b < NUM_BINS; ++b) {
+            acc.extend(bins[b - 1].box);
+            acc_count += bins[b - 1].count;
+            if (acc_count == 0 || right_count[b] == 0) continue;
+            const float cost =
+                acc_count * half_area(acc) + right_count[b] * right_area[b];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = b;
+            }
+        }
+    }
+    const float node_area = half_area(box);
+    if (count <= MAX_LEAF_SIZE &&
+        (best_axis < 0 || 1.f + best_cost / node_area >= (float)count)) {
+        make_leaf();
+        return;
+    }
+
+    // Partition; split in the middle if binning failed (e.g. all centroids
+    // equal) or the node is too deep
+    size_t mid;
+    if (best_axis >= 0) {
+        const float scale = NUM_BINS / extent[best_axis];
+        const float lo = centroid_box.min()[best_axis];
+        mid = std::partition(_indices.begin() + begin, _indices.begin() + end,
+                             [&](uint32_t prim) {
+                                 return std::min((int)((centroids[prim][best_axis] -
+                                                        lo) *
+                                                       scale),
+                                                 NUM_BINS - 1) < best_split;
+                             }) -
+              _indices.begin();
+    } else {
+        best_axis = 0;
+        mid = begin + count / 2;
+    }
+    if (mid == begin || mid == end) mid = begin + count / 2;
+
+    const uint32_t left = id + 1;
+    const uint32_t right = left + 2 * (uint32_t)(mid - begin) - 1;
+    node.index = right;
+    node.count = 0;
+    node.axis = (uint16_t)best_axis;
+    auto build_child = [&](size_t child) {
+        if (child == 0) {
+            build_node(left, begin, mid, depth + 1, boxes, centroids,
+                       max_leaf_size);
+        } else {
+            build_node(right, mid, end, depth + 1, boxes, centroids,
+                       max_leaf_size);
+        }
+    };
+    if (parallel) {
+        ThreadPool::get().parallel_for(
+            0, 2,
+            [&](size_t chunk_begin, size_t chunk_end) {
+                for (size_t c = chunk_begin; c < chunk_end; ++c) build_child(c);
+            },
+            1);
+    } else {
+        build_child(0);
+        build_child(1);
+    }
+}
+
+}  // namespace internal
+}  // namespace meshview
@@ -0,0 +1,543 @@
+#include "meshview/cache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <iterator>
+
+#include "meshview/util.hpp"
+#include "meshview/internal/mapped_file.hpp"
+#include "meshview/internal/thread_pool.hpp"
+
+namespace meshview {
+namespace {
+
+const char MAGIC[8] = {'M', 'V', 'C', 'A', 'C', 'H', 'E', '\0'};
+const uint32_t VERSION = 1;
+// Reads back differently on a host of the other byte order
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+// Alignment of every array in the file
+const size_t ALIGN = 64;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t n_meshes, n_point_clouds, n_textures;
+    // Offsets of the record tables
+    uint64_t meshes, point_clouds, textures;
+};
+
+enum : uint32_t {
+    FLAG_ENABLED = 1,
+    // Mesh: normals estimated on update; point cloud: draw lines
+    FLAG_AUTO_NORMALS = 2,
+    FLAG_LINES = 2,
+};
+
+struct MeshRecord {
+    uint64_t n_verts, n_faces, n_tex_coords, n_tex_faces;
+    // Offsets of the arrays
+    uint64_t data, faces, tex_coords, tex_faces;
+    // Column-major, as Matrix4f
+    float transform[16];
+    float shininess;
+    uint32_t shading_type;
+    uint32_t flags;
+    // Textures first_texture, first_texture + 1, ..., the diffuse ones first
+    uint32_t first_texture;
+    uint32_t n_textures[Texture::__TYPE_COUNT];
+};
+
+struct PointCloudRecord {
+    uint64_t n_points;
+    uint64_t data;
+    float transform[16];
+    float point_size;
+    uint32_t flags;
+};
+
+enum : uint32_t {
+    // 1x1 texture of the fallback color only
+    TEXTURE_COLOR,
+    // Encoded image file, decoded with stb_image
+    TEXTURE_ENCODED,
+    // height x (width * channels) 8-bit pixels, rows from the bottom
+    TEXTURE_RAW_U8,
+    // height x (width * channels) floats, rows from the bottom
+    TEXTURE_RAW_F32,
+};
+
+struct TextureRecord {
+    uint32_t encoding;
+    uint32_t channels;
+    uint32_t width, height;
+    uint32_t flip;
+    float fallback_color[3];
+    uint64_t data;
+    uint64_t bytes;
+};
+
+static_assert(sizeof(FileHeader) == 64, "cache header layout");
+static_assert(sizeof(MeshRecord) == 4 * 8 + 4 * 8 + 16 * 4 + 4 * 4 +
+                                        4 * Texture::__TYPE_COUNT,
+              "cache mesh record layout");
+static_assert(sizeof(PointCloudRecord) == 2 * 8 + 16 * 4 + 2 * 4,
+              "cache point cloud record layout");
+static_assert(sizeof(TextureRecord) == 8 * 4 + 2 * 8,
+              "cache texture record layout");
+
+size_t align_up(size_t offset) { return (offset + ALIGN - 1) / ALIGN * ALIGN; }
+
+// Copy bytes with the thread pool (large arrays are limited by memory
+// bandwidth of a single core otherwise)
+void parallel_copy(const void* src, size_t bytes, void* dst) {
+    const size_t grain = 1 << 22;
+    internal::ThreadPool::get().parallel_for(
+        0, (bytes + grain - 1) / grain,
+        [&](size_t begin, size_t end) {
+            const size_t from = begin * grain;
+            const size_t to = std::min(end * grain, bytes);
+            std::memcpy((char*)dst + from, (const char*)src + from,
+                        to - from);
+        },
+        1);
+}
+
+// Whether all n indices at data are below bound (scanned on the thread pool)
+bool indices_below(const char* data, size_t n, uint64_t bound) {
+    const Index* indices = (const Index*)data;
+    std::atomic<bool> below(true);
+    internal::ThreadPool::get().parallel_for(
+        0, n,
+        [&](size_t begin, size_t end) {
+            if (Eigen::Map<const Eigen::Matrix<Index, Eigen::Dynamic, 1>>(
+                    indices + begin, end - begin)
+                    .maxCoeff() >= bound) {
+                below = false;
+            }
+        },
+        1 << 20);
+    return below;
+}
+
+// Texture contents resolved for writing
+struct TextureBlob {
+    TextureRecord record;
+    // Owned bytes (encoded file) or a view of the texture's pixels
+    std::vector<char> file;
+    std::shared_ptr<const ImageU> pixels_u8;
+    const float* pixels_f32 = nullptr;
+};
+
+// Writes the arrays of a cache file sequentially, padding each to ALIGN
+class AlignedWriter {
+   public:
+    explicit AlignedWriter(std::ofstream& ofs) : _ofs(ofs) {}
+
+    // Offset of the next array
+    size_t reserve(size_t bytes) {
+        const size_t offset = align_up(_end);
+        _end = offset + bytes;
+        return offset;
+    }
+    // Write the array reserved at offset (in reservation order)
+    void write(size_t offset, const void* data, size_t bytes) {
+        static const char zeros[ALIGN] = {};
+        _ofs.write(zeros, offset - _pos);
+        _ofs.write((const char*)data, bytes);
+        _pos = offset + bytes;
+    }
+    size_t end() const { return _end; }
+
+   private:
+    std::ofstream& _ofs;
+    size_t _pos = 0, _end = 0;
+};
+
+}  // namespace
+
+SceneCache::SceneCache() : _file(new internal::MappedFile()) {}
+SceneCache::~SceneCache() = default;
+
+bool SceneCache::write(const std::string& path,
+                       const std::vector<const Mesh*>& meshes,
+                       const std::vector<const PointCloud*>& point_clouds,
+                       bool raw_textures) {
+    // Resolve the textures first, decoding/reading files in parallel
+    std::vector<const Texture*> textures;
+    std::vector<MeshRecord> mesh_records(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        MeshRecord& rec = mesh_records[i];
+        rec.first_texture = (uint32_t)textures.size();
+        for (int type = 0; type < Texture::__TYPE_COUNT; ++type) {
+            rec.n_textures[type] = (uint32_t)meshes[i]->textures[type].size();
+            for (auto& tex : meshes[i]->textures[type]) {
+                textures.push_back(&tex);
+            }
+        }
+    }
+    std::vector<TextureBlob> blobs(textures.size());
+    std::vector<std::future<void>> resolved;
+    for (size_t i = 0; i < textures.size(); ++i) {
+        resolved.push_back(internal::ThreadPool::get().submit([&, i]() {
+            const Texture& tex = *textures[i];
+            TextureBlob& blob = blobs[i];
+            TextureRecord& rec = blob.record;
+            std::memset(&rec, 0, sizeof(rec));
+            rec.flip = tex.flip;
+            std::copy(tex.fallback_color.data(),
+                      tex.fallback_color.data() + 3, rec.fallback_color);
+            rec.encoding = TEXTURE_COLOR;
+            // Prefer the image file itself, unless raw pixels are wanted
+            if (tex.path.size() && !raw_textures) {
+                std::ifstream ifs(tex.path, std::ios::binary);
+                blob.file.assign(std::istreambuf_iterator<char>(ifs),
+                                 std::istreambuf_iterator<char>());
+                if (blob.file.size()) {
+                    rec.encoding = TEXTURE_ENCODED;
+                    rec.bytes = blob.file.size();
+                    return;
+                }
+            }
+            std::shared_ptr<const ImageU> pixels = tex.im_u8;
+            int channels = tex.n_channels;
+            if (!pixels && tex.path.size()) {
+                Texture copy(tex.path, tex.flip);
+                if (copy.preload()) {
+                    pixels = copy.im_u8;
+                    channels = copy.n_channels;
+                }
+            }
+            if (pixels) {
+                rec.encoding = TEXTURE_RAW_U8;
+                rec.channels = channels;
+                rec.width = (uint32_t)(pixels->cols() / channels);
+                rec.height = (uint32_t)pixels->rows();
+                rec.bytes = pixels->size();
+                blob.pixels_u8 = pixels;
+            } else if (tex.im_data.rows() && !tex.path.size()) {
+                rec.encoding = TEXTURE_RAW_F32;
+                rec.channels = tex.n_channels;
+                rec.width = (uint32_t)(tex.im_data.cols() / tex.n_channels);
+                rec.height = (uint32_t)tex.im_data.rows();
+                rec.bytes = tex.im_data.size() * sizeof(float);
+                blob.pixels_f32 = tex.im_data.data();
+            } else if (tex.path.size()) {
+                std::cerr << "Failed to read texture " << tex.path
+                          << ", caching its fallback color\n";
+            }
+        }));
+    }
+    for (auto& future : resolved) future.get();
+
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs) {
+        std::cerr << "Failed to open " << path << " for writing\n";
+        return false;
+    }
+    // Lay out the file: header, tables, arrays
+    AlignedWriter out(ofs);
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::copy(MAGIC, MAGIC + sizeof(MAGIC), header.magic);
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.n_meshes = meshes.size();
+    header.n_point_clouds = point_clouds.size();
+    header.n_textures = textures.size();
+    out.reserve(sizeof(header));
+    header.meshes = out.reserve(meshes.size() * sizeof(MeshRecord));
+    header.point_clouds =
+        out.reserve(point_clouds.size() * sizeof(PointCloudRecord));
+    header.textures = out.reserve(textures.size() * sizeof(TextureRecord));
+
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const Mesh& mesh = *meshes[i];
+        MeshRecord& rec = mesh_records[i];
+        rec.n_verts = mesh.data.rows();
+        rec.n_faces = mesh.faces.rows();
+        rec.n_tex_coords = mesh._tex_coords.rows();
+        rec.n_tex_faces = mesh._tex_faces.rows();
+        rec.data = out.reserve(mesh.data.size() * sizeof(float));
+        rec.faces = out.reserve(mesh.faces.size() * sizeof(Index));
+        rec.tex_coords = out.reserve(mesh._tex_coords.size() * sizeof(float));
+        rec.tex_faces = out.reserve(mesh._tex_faces.size() * sizeof(Index));
+        std::copy(mesh.transform.data(), mesh.transform.data() + 16,
+                  rec.transform);
+        rec.shininess = mesh.shininess;
+        rec.shading_type = (uint32_t)mesh.shading_type;
+        rec.flags = (mesh.enabled ? (uint32_t)FLAG_ENABLED : 0u) |
+                    (mesh._auto_normals ? (uint32_t)FLAG_AUTO_NORMALS : 0u);
+    }
+    std::vector<PointCloudRecord> point_cloud_records(point_clouds.size());
+    for (size_t i = 0; i < point_clouds.size(); ++i) {
+        const PointCloud& pc = *point_clouds[i];
+        PointCloudRecord& rec = point_cloud_records[i];
+        rec.n_points = pc.data.rows();
+        rec.data = out.reserve(pc.data.size() * sizeof(float));
+        std::copy(pc.transform.data(), pc.transform.data() + 16,
+                  rec.transform);
+        rec.point_size = pc.point_size;
+        rec.flags = (pc.enabled ? (uint32_t)FLAG_ENABLED : 0u) |
+                    (pc.lines ? (uint32_t)FLAG_LINES : 0u);
+    }
+    for (auto& blob : blobs) {
+        blob.record.data = out.reserve(blob.record.bytes);
+    }
+
+    // Write it in the same order
+    out.write(0, &header, sizeof(header));
+    out.write(header.meshes, mesh_records.data(),
+              mesh_records.size() * sizeof(MeshRecord));
+    out.write(header.point_clouds, point_cloud_records.data(),
+              point_cloud_records.size() * sizeof(PointCloudRecord));
+    std::vector<TextureRecord> texture_records;
+    for (auto& blob : blobs) texture_records.push_back(blob.record);
+    out.write(header.textures, texture_records.data(),
+              texture_records.size() * sizeof(TextureRecord));
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const Mesh& mesh = *meshes[i];
+        const MeshRecord& rec = mesh_records[i];
+        out.write(rec.data, mesh.data.data(), mesh.data.size() * sizeof(float));
+        out.write(rec.faces, mesh.faces.data(),
+                  mesh.faces.size() * sizeof(Index));
+        out.write(rec.tex_coords, mesh._tex_coords.data(),
+                  mesh._tex_coords.size() * sizeof(float));
+        out.write(rec.tex_faces, mesh._tex_faces.data(),
+                  mesh._tex_faces.size() * sizeof(Index));
+    }
+    for (size_t i = 0; i < point_clouds.size(); ++i) {
+        out.write(point_cloud_records[i].data, point_clouds[i]->data.data(),
+                  point_clouds[i]->data.size() * sizeof(float));
+    }
+    for (auto& blob : blobs) {
+        const void* data = blob.file.data();
+        if (blob.pixels_u8) data = blob.pixels_u8->data();
+        if (blob.pixels_f32) data = blob.pixels_f32;
+        out.write(blob.record.data, data, blob.record.bytes);
+    }
+    ofs.flush();
+    if (!ofs) {
+        std::cerr << "Failed to write " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool SceneCache::open(const std::string& path) {
+    if (!_file->open(path)) return false;
+    const char* base = _file->data();
+    const size_t size = _file->size();
+    auto fail = [&](const char* message) {
+        std::cerr << path << ": " << message << "\n";
+        close();
+        return false;
+    };
+    // Whether [offset, offset + count * item) lies in the file
+    auto in_file = [size](uint64_t offset, uint64_t count, uint64_t item) {
+        return offset <= size && (item == 0 || count <= (size - offset) / item);
+    };
+
+    if (size < sizeof(FileHeader)) return fail("not a meshview cache");
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        return fail("not a meshview cache");
+    }
+    if (header.version != VERSION) {
+        return fail("unsupported meshview cache version");
+    }
+    if (header.byte_order != BYTE_ORDER_MARK) {
+        return fail("meshview cache written with another byte order");
+    }
+    if (!in_file(header.meshes, header.n_meshes, sizeof(MeshRecord)) ||
+        !in_file(header.point_clouds, header.n_point_clouds,
+                 sizeof(PointCloudRecord)) ||
+        !in_file(header.textures, header.n_textures, sizeof(TextureRecord))) {
+        return fail("truncated meshview cache");
+    }
+    auto meshes = (const MeshRecord*)(base + header.meshes);
+    for (size_t i = 0; i < header.n_meshes; ++i) {
+        const MeshRecord& rec = meshes[i];
+        uint64_t n_textures = 0;
+        for (uint32_t n : rec.n_textures) n_textures += n;
+        if (!in_file(rec.data, rec.n_verts, sizeof(float) * 9) ||
+            !in_file(rec.faces, rec.n_faces, sizeof(Index) * 3) ||
+            !in_file(rec.tex_coords, rec.n_tex_coords, sizeof(float) * 2) ||
+            !in_file(rec.tex_faces, rec.n_tex_faces, sizeof(Index) * 3) ||
+            rec.first_texture + n_textures > header.n_textures) {
+            return fail("truncated meshview cache");
+        }
+        if (rec.shading_type > (uint32_t)Mesh::ShadingType::texture) {
+            return fail("bad shading type in meshview cache");
+        }
+        // Indices are used unchecked when drawing and when mapping uvs to
+        // vertices (load_mesh)
+        if (rec.n_tex_coords && rec.n_tex_faces != rec.n_faces) {
+            return fail("bad uv faces in meshview cache");
+        }
+        if (!indices_below(base + rec.faces, rec.n_faces * 3, rec.n_verts) ||
+            !indices_below(base + rec.tex_faces, rec.n_tex_faces * 3,
+                           rec.n_tex_coords)) {
+            return fail("face index out of range in meshview cache");
+        }
+    }
+    auto point_clouds =
+        (const PointCloudRecord*)(base + header.point_clouds);
+    for (size_t i = 0; i < header.n_point_clouds; ++i) {
+        if (!in_file(point_clouds[i].data, point_clouds[i].n_points,
+                     sizeof(float) * 6)) {
+            return fail("truncated meshview cache");
+        }
+    }
+    auto textures = (const TextureRecord*)(base + header.textures);
+    for (size_t i = 0; i < header.n_textures; ++i) {
+        const TextureRecord& rec = textures[i];
+        const uint64_t pixels = (uint64_t)rec.width * rec.height * rec.channels;
+        const bool raw = rec.encoding == TEXTURE_RAW_U8 ||
+                         rec.encoding == TEXTURE_RAW_F32;
+        if (!in_file(rec.data, rec.bytes, 1) ||
+            rec.encoding > TEXTURE_RAW_F32 ||
+            (raw && (rec.bytes != pixels * (rec.encoding == TEXTURE_RAW_U8
+                                                ? 1
+                                                : sizeof(float)) ||
+                     (rec.channels != 1 && rec.channels != 3 &&
+                      rec.channels != 4)))) {
+            return fail("bad texture in meshview cache");
+        }
+    }
+    return true;
+}
+
+void SceneCache::close() { _file->close(); }
+
+bool SceneCache::is_open() const { return _file->valid(); }
+
+size_t SceneCache::num_meshes() const {
+    if (!is_open()) return 0;
+    return ((const FileHeader*)_file->data())->n_meshes;
+}
+
+size_t SceneCache::num_point_clouds() const {
+    if (!is_open()) return 0;
+    return ((const FileHeader*)_file->data())->n_point_clouds;
+}
+
+namespace {
+const MeshRecord& mesh_record(const internal::MappedFile& file, size_t i) {
+    auto header = (const FileHeader*)file.data();
+    return ((const MeshRecord*)(file.data() + header->meshes))[i];
+}
+
+const PointCloudRecord& point_cloud_record(const internal::MappedFile& file,
+                                           size_t i) {
+    auto header = (const FileHeader*)file.data();
+    return ((const PointCloudRecord*)(file.data() + header->point_clouds))[i];
+}
+}  // namespace
+
+Eigen::Map<const PointsRGBNormal> SceneCache::mesh_data(size_t i) const {
+    const MeshRecord& rec = mesh_record(*_file, i);
+    return Eigen::Map<const PointsRGBNormal>(
+        (const float*)(_file->data() + rec.data), rec.n_verts, 9);
+}
+
+Eigen::Map<const Triangles> SceneCache::mesh_faces(size_t i) const {
+    const MeshRecord& rec = mesh_record(*_file, i);
+    return Eigen::Map<const Triangles>(
+        (const Index*)(_file->data() + rec.faces), rec.n_faces, 3);
+}
+
+Eigen::Map<const PointsRGB> SceneCache::point_cloud_data(size_t i) const {
+    const PointCloudRecord& rec = point_cloud_record(*_file, i);
+    return Eigen::Map<const PointsRGB>(
+        (const float*)(_file->data() + rec.data), rec.n_points, 6);
+}
+
+std::unique_ptr<Mesh> SceneCache::load_mesh(size_t i) const {
+    const MeshRecord& rec = mesh_record(*_file, i);
+    const char* base = _file->data();
+    auto mesh = std::make_unique<Mesh>(rec.n_verts, rec.n_faces);
+    parallel_copy(base + rec.data, mesh->data.size() * sizeof(float),
+                  mesh->data.data());
+    parallel_copy(base + rec.faces, mesh->faces.size() * sizeof(Index),
+                  mesh->faces.data());
+    mesh->_tex_coords = Eigen::Map<const Points2D>(
+        (const float*)(base + rec.tex_coords), rec.n_tex_coords, 2);
+    mesh->_tex_faces = Eigen::Map<const Triangles>(
+        (const Index*)(base + rec.tex_faces), rec.n_tex_faces, 3);
+    if (rec.n_tex_coords) {
+        mesh->_tex_to_vert = util::make_uv_to_vert_map(
+            rec.n_tex_coords, mesh->faces, mesh->_tex_faces);
+    }
+    mesh->transform = Eigen::Map<const Matrix4f>(rec.transform);
+    mesh->shininess = rec.shininess;
+    mesh->shading_type = (Mesh::ShadingType)rec.shading_type;
+    mesh->enabled = (rec.flags & FLAG_ENABLED) != 0;
+    mesh->_auto_normals = (rec.flags & FLAG_AUTO_NORMALS) != 0;
+
+    auto header = (const FileHeader*)base;
+    auto textures =
+        (const TextureRecord*)(base + header->textures) + rec.first_texture;
+    std::vector<std::future<void>> decoded;
+    for (int type = 0; type < Texture::__TYPE_COUNT; ++type) {
+        auto& mesh_textures = mesh->textures[type];
+        mesh_textures.reserve(rec.n_textures[type]);
+        for (uint32_t j = 0; j < rec.n_textures[type]; ++j) {
+            const TextureRecord& tex_rec = *textures++;
+            const char* data = base + tex_rec.data;
+            if (tex_rec.encoding == TEXTURE_RAW_F32) {
+                mesh_textures.emplace_back(
+                    Eigen::Map<const Image>((const float*)data, tex_rec.height,
+                                            tex_rec.width * tex_rec.channels),
+                    (int)tex_rec.channels);
+                continue;
+            }
+            if (tex_rec.encoding == TEXTURE_ENCODED) {
+                // Decoded below, in parallel
+                mesh_textures.emplace_back(tex_rec.fallback_color[0],
+                                           tex_rec.fallback_color[1],
+                                           tex_rec.fallback_color[2]);
+                Texture* tex = &mesh_textures.back();
+                decoded.push_back(internal::ThreadPool::get().submit(
+                    [tex, &tex_rec, data]() {
+                        *tex = Texture(data, tex_rec.bytes, tex_rec.flip != 0);
+                    }));
+                continue;
+            }
+            mesh_textures.emplace_back(tex_rec.fallback_color[0],
+                                       tex_rec.fallback_color[1],
+                                       tex_rec.fallback_color[2]);
+            Texture& tex = mesh_textures.back();
+            tex.flip = tex_rec.flip != 0;
+            if (tex_rec.encoding == TEXTURE_RAW_U8) {
+                tex.n_channels = tex_rec.channels;
+                tex.im_u8 = std::make_shared<const ImageU>(
+                    Eigen::Map<const ImageU>((const uint8_t*)data,
+                                             tex_rec.height,
+                                             tex_rec.width * tex_rec.channels));
+            }
+        }
+    }
+    for (auto& future : decoded) future.get();
+    return mesh;
+}
+
+std::unique_ptr<PointCloud> SceneCache::load_point_cloud(size_t i) const {
+    const PointCloudRecord& rec = point_cloud_record(*_file, i);
+    auto pc = std::make_unique<PointCloud>(rec.n_points);
+    parallel_copy(_file->data() + rec.data, pc->data.size() * sizeof(float),
+                  pc->data.data());
+    pc->transform = Eigen::Map<const Matrix4f>(rec.transform);
+    pc->point_size = rec.point_size;
+    pc->enabled = (rec.flags & FLAG_ENABLED) != 0;
+    pc->lines = (rec.flags & FLAG_LINES) != 0;
+    return pc;
+}
+
+}  // namespace meshview
@@ -0,0 +1,799 @@
+#include "meshview/meshview.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include "meshview/internal/binary.hpp"
+#include "meshview/internal/mapped_file.hpp"
+#include "meshview/internal/thread_pool.hpp"
+
+// Compressed mesh files: quantized attributes and vertex cache ordered
+// triangles, coded in independent blocks so that both encoding and
+// decoding run on all threads. There is no entropy coder; the codes are
+// simple enough (bit-packed deltas, byte varints) to decode at memory
+// speeds.
+namespace meshview {
+namespace {
+
+const char MAGIC[8] = {'M', 'V', 'M', 'E', 'S', 'H', 'Z', '\0'};
+const uint32_t VERSION = 1;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Vertices/triangles per independently coded block
+const size_t BLOCK = 1 << 14;
+// Post-transform vertex cache size assumed when ordering triangles
+const int CACHE_SIZE = 16;
+// Bits of quantized texture coordinates and octahedral normals
+const int UV_BITS = 16;
+const int NORMAL_BITS = 16;
+
+enum : uint32_t {
+    FLAG_ENABLED = 1,
+    // Vertex shading: 8-bit rgb per vertex
+    FLAG_RGB = 2,
+    // Texture shading without texture coordinates: uv per vertex
+    FLAG_VERTEX_UV = 4,
+    // Explicit normals (else estimated on update)
+    FLAG_NORMALS = 8,
+    // Texture coordinates and texture triangles
+    FLAG_TEX_COORDS = 16,
+};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t n_verts, n_faces, n_tex_coords;
+    uint32_t flags;
+    uint32_t position_bits;
+    // Dequantized value = min + q * step
+    float position_min[3], position_step[3];
+    float uv_min[2], uv_step[2];
+    // Column-major, as Matrix4f
+    float transform[16];
+    float shininess;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 8 + 2 * 4 + 3 * 8 + 2 * 4 + 10 * 4 +
+                                        16 * 4 + 2 * 4,
+              "compressed mesh header layout");
+
+// * Byte codes
+inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+inline int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+inline void put_varint(std::vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+inline bool get_varint(const uint8_t*& p, const uint8_t* end, uint32_t& v) {
+    if (end - p >= 5) {
+        // Unrolled, without bounds checks
+        uint32_t byte = *p++;
+        v = byte & 0x7F;
+        if (byte < 0x80) return true;
+        byte = *p++;
+        v |= (byte & 0x7F) << 7;
+        if (byte < 0x80) return true;
+        byte = *p++;
+        v |= (byte & 0x7F) << 14;
+        if (byte < 0x80) return true;
+        byte = *p++;
+        v |= (byte & 0x7F) << 21;
+        if (byte < 0x80) return true;
+        byte = *p++;
+        v |= byte << 28;
+        return byte < 0x10;
+    }
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        const uint8_t byte = *p++;
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (byte < 0x80) {
+            v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Encoded stream: blocks of bytes, each decodable on its own
+struct Stream {
+    std::vector<std::vector<uint8_t>> blocks;
+
+    void write(std::ofstream& ofs) const {
+        const uint64_t n_blocks = blocks.size();
+        std::vector<uint64_t> offsets(1, 0);
+        for (auto& block : blocks) {
+            offsets.push_back(offsets.back() + block.size());
+        }
+        ofs.write((const char*)&n_blocks, sizeof(n_blocks));
+        ofs.write((const char*)offsets.data(),
+                  offsets.size() * sizeof(uint64_t));
+        for (auto& block : blocks) {
+            ofs.write((const char*)block.data(), block.size());
+        }
+    }
+};
+
+// Stream inside the mapped file (see Stream::write)
+struct StreamView {
+    // Block offsets, n_blocks + 1 uint64s, at any alignment (see offset)
+    const char* offsets = nullptr;
+    const uint8_t* data = nullptr;
+    size_t n_blocks = 0;
+
+    // Read the stream at p, advancing p; false if it overruns end or does
+    // not have n_blocks blocks
+    bool read(const char*& p, const char* end, size_t expect_blocks) {
+        if (end - p < 8) return false;
+        uint64_t n;
+        std::memcpy(&n, p, 8);
+        if (n != expect_blocks || (uint64_t)(end - p - 8) / 8 < n + 1) {
+            return false;
+        }
+        n_blocks = n;
+        offsets = p + 8;
+        data = (const uint8_t*)(p + 8 * (n + 2));
+        for (size_t i = 0; i < n_blocks; ++i) {
+            if (offset(i) > offset(i + 1)) return false;
+        }
+        if (offset(0) != 0 ||
+            offset(n_blocks) > (uint64_t)(end - (const char*)data)) {
+            return false;
+        }
+        p = (const char*)data + offset(n_blocks);
+        return true;
+    }
+
+    // Offset of block i in data; streams follow each other's variable
+    // length blocks, so the offsets are usually misaligned
+    inline uint64_t offset(size_t i) const {
+        return internal::load<uint64_t>(offsets + 8 * i);
+    }
+};
+
+size_t num_blocks(size_t n) { return (n + BLOCK - 1) / BLOCK; }
+
+// Rows per bit-packed group of the attribute codec
+const size_t GROUP = 16;
+
+// Pack GROUP values of w bits, LSB first, into 2 * w bytes
+void pack_group(const uint32_t* values, int w, std::vector<uint8_t>& out) {
+    uint64_t buf = 0;
+    int bits = 0;
+    for (size_t k = 0; k < GROUP; ++k) {
+        buf |= (uint64_t)values[k] << bits;
+        for (bits += w; bits >= 8; bits -= 8) {
+            out.push_back((uint8_t)buf);
+            buf >>= 8;
+        }
+    }
+}
+
+// Unpack a pack_group of W bits (a template so the loop fully unrolls)
+template <int W>
+const uint8_t* unpack_group(const uint8_t* p, uint32_t* values) {
+    const uint64_t mask = ((uint64_t)1 << W) - 1;
+    uint64_t buf = 0;
+    int bits = 0;
+    for (size_t k = 0; k < GROUP; ++k) {
+        while (bits < W) {
+            buf |= (uint64_t)*p++ << bits;
+            bits += 8;
+        }
+        values[k] = (uint32_t)(buf & mask);
+        buf >>= W;
+        bits -= W;
+    }
+    return p;
+}
+
+typedef const uint8_t* (*UnpackGroup)(const uint8_t*, uint32_t*);
+
+template <size_t... W>
+const UnpackGroup* unpack_table(std::index_sequence<W...>) {
+    static const UnpackGroup table[] = {unpack_group<(int)W>...};
+    return table;
+}
+
+// Code n rows of C quantized components as per-component deltas from the
+// previous row (0 at the start of each block), zigzagged. For each group
+// of GROUP rows and each component: a byte with the bit width w of its
+// largest delta, then the deltas packed in w bits. Unlike varints, decoding
+// this has no data dependent branches but one per group.
+template <int C>
+Stream encode_deltas(const std::vector<int32_t>& values, size_t n) {
+    Stream stream;
+    stream.blocks.resize(num_blocks(n));
+    internal::ThreadPool::get().parallel_for(
+        0, stream.blocks.size(),
+        [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b) {
+                auto& out = stream.blocks[b];
+                const size_t to = std::min(n, (b + 1) * BLOCK);
+                int32_t prev[C] = {};
+                for (size_t g = b * BLOCK; g < to; g += GROUP) {
+                    for (int c = 0; c < C; ++c) {
+                        // (rows past n code as zero deltas)
+                        uint32_t deltas[GROUP] = {}, all = 0;
+                        int32_t last = prev[c];
+                        for (size_t k = 0; k < GROUP && g + k < to; ++k) {
+                            const int32_t v = values[(g + k) * C + c];
+                            deltas[k] = zigzag(v - last);
+                            all |= deltas[k];
+                            last = v;
+                        }
+                        prev[c] = last;
+                        int w = 0;
+                        while (w < 32 && (all >> w)) ++w;
+                        out.push_back((uint8_t)w);
+                        pack_group(deltas, w, out);
+                    }
+                }
+            }
+        },
+        1);
+    return stream;
+}
+
+// Decode a stream of encode_deltas, calling store(row, values) per row
+template <int C, class Store>
+bool decode_deltas(const StreamView& stream, size_t n, const Store& store) {
+    static const UnpackGroup* unpack =
+        unpack_table(std::make_index_sequence<33>());
+    std::atomic<bool> ok(true);
+    internal::ThreadPool::get().parallel_for(
+        0, stream.n_blocks,
+        [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b) {
+                const uint8_t* p = stream.data + stream.offset(b);
+                const uint8_t* block_end = stream.data + stream.offset(b + 1);
+                const size_t to = std::min(n, (b + 1) * BLOCK);
+                int32_t value[C] = {};
+                uint32_t deltas[C][GROUP];
+                for (size_t g = b * BLOCK; g < to; g += GROUP) {
+                    for (int c = 0; c < C; ++c) {
+                        if (p == block_end || *p > 32 ||
+                            block_end - p - 1 < 2 * *p) {
+                            ok = false;
+                            return;
+                        }
+                        const int w = *p++;
+                        p = unpack[w](p, deltas[c]);
+                    }
+                    const size_t rows = std::min(GROUP, to - g);
+                    for (size_t k = 0; k < rows; ++k) {
+                        for (int c = 0; c < C; ++c) {
+                            // (wrapping, corrupt input must not overflow)
+                            value[c] = (int32_t)((uint32_t)value[c] +
+                                                 (uint32_t)unzigzag(
+                                                     deltas[c][k]));
+                        }
+                        store(g + k, value);
+                    }
+                }
+            }
+        },
+        1);
+    return ok;
+}
+
+// Recently referenced indices remembered by the index codec (power of 2)
+const uint32_t FIFO_SIZE = 16;
+const Index NO_INDEX = (Index)-1;
+
+// Age of v in the FIFO (0: most recent), FIFO_SIZE if absent
+inline uint32_t find_recent(const Index* fifo, uint32_t head, Index v) {
+    uint32_t k = 0;
+    while (k < FIFO_SIZE && fifo[(head - 1 - k) & (FIFO_SIZE - 1)] != v) ++k;
+    return k;
+}
+
+// Code triangles whose vertices are numbered in order of first use, with
+// next the first unused vertex. Each index codes as
+//   0                          new vertex (next)
+//   1 + k, k < FIFO_SIZE       k-th most recently coded index
+//   1 + FIFO_SIZE + d          next - 1 - d
+// After vertex cache ordering most indices are FIFO hits, so triangles
+// take about 3 bytes. Blocks start with next and an empty FIFO.
+Stream encode_indices(const Triangles& tris) {
+    const size_t n = tris.rows();
+    std::vector<Index> block_next(num_blocks(n) + 1, 0);
+    Index next = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (i % BLOCK == 0) block_next[i / BLOCK] = next;
+        for (int j = 0; j < 3; ++j) next = std::max(next, tris(i, j) + 1);
+    }
+    Stream stream;
+    stream.blocks.resize(num_blocks(n));
+    internal::ThreadPool::get().parallel_for(
+        0, stream.blocks.size(),
+        [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b) {
+                auto& out = stream.blocks[b];
+                Index next = block_next[b];
+                Index fifo[FIFO_SIZE];
+                std::fill(fifo, fifo + FIFO_SIZE, NO_INDEX);
+                uint32_t head = 0;
+                put_varint(out, next);
+                const size_t to = std::min(n, (b + 1) * BLOCK);
+                for (size_t i = b * BLOCK; i < to; ++i) {
+                    for (int j = 0; j < 3; ++j) {
+                        const Index v = tris(i, j);
+                        uint32_t code = 0;
+                        if (v == next) {
+                            ++next;
+                        } else {
+                            const uint32_t k = find_recent(fifo, head, v);
+                            code = k < FIFO_SIZE ? 1 + k
+                                                 : 1 + FIFO_SIZE + next - 1 - v;
+                        }
+                        put_varint(out, code);
+                        fifo[head++ & (FIFO_SIZE - 1)] = v;
+                    }
+                }
+            }
+        },
+        1);
+    return stream;
+}
+
+// Decode encode_indices into tris (n rows); false if corrupt or any index
+// is >= n_verts
+bool decode_indices(const StreamView& stream, size_t n, size_t n_verts,
+                    Triangles& tris) {
+    std::atomic<bool> ok(true);
+    internal::ThreadPool::get().parallel_for(
+        0, stream.n_blocks,
+        [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b) {
+                const uint8_t* p = stream.data + stream.offset(b);
+                const uint8_t* block_end = stream.data + stream.offset(b + 1);
+                uint32_t next, code;
+                Index fifo[FIFO_SIZE];
+                std::fill(fifo, fifo + FIFO_SIZE, NO_INDEX);
+                uint32_t head = 0;
+                if (!get_varint(p, block_end, next) || next > n_verts) {
+                    ok = false;
+                    return;
+                }
+                const size_t to = std::min(n, (b + 1) * BLOCK);
+                Index* out = tris.data() + b * BLOCK * 3;
+                for (size_t i = b * BLOCK * 3; i < to * 3; ++i) {
+                    if (!get_varint(p, block_end, code)) {
+                        ok = false;
+                        return;
+                    }
+                    // Select without branching (the three cases are
+                    // mixed unpredictably); invalid codes give indices
+                    // >= n_verts, either wrapped around or NO_INDEX
+                    const Index recent = fifo[(head - code) & (FIFO_SIZE - 1)];
+                    const Index back = next + FIFO_SIZE - code;
+                    const Index v =
+                        code == 0 ? next : code <= FIFO_SIZE ? recent : back;
+                    next += code == 0;
+                    if (v >= n_verts) {
+                        ok = false;
+                        return;
+                    }
+                    *out++ = v;
+                    fifo[head++ & (FIFO_SIZE - 1)] = v;
+                }
+            }
+        },
+        1);
+    return ok;
+}
+
+// * Ordering
+// Triangle order for a post-transform vertex cache (Tipsify: Sander,
+// Nehab and Barczak, "Fast triangle reordering for vertex locality and
+// reduced overdraw", 2007); linear time
+std::vector<Index> order_triangles(const Triangles& faces, size_t n_verts) {
+    const size_t n_faces = faces.rows();
+    // Triangles around each vertex (CSR)
+    std::vector<uint32_t> live(n_verts, 0), start(n_verts + 1, 0);
+    for (size_t i = 0; i < n_faces * 3; ++i) ++live[faces.data()[i]];
+    for (size_t v = 0; v < n_verts; ++v) start[v + 1] = start[v] + live[v];
+    std::vector<Index> adjacent(n_faces * 3);
+    {
+        std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+        for (size_t i = 0; i < n_faces * 3; ++i) {
+            adjacent[fill[faces.data()[i]]++] = (Index)(i / 3);
+        }
+    }
+    std::vector<int64_t> cache_time(n_verts, 0);
+    std::vector<char> emitted(n_faces, 0);
+    std::vector<Index> order, dead_end, candidates;
+    order.reserve(n_faces);
+    int64_t time = CACHE_SIZE + 1;
+    size_t cursor = 0;
+    int64_t fan = -1;
+    for (;;) {
+        if (fan < 0) {
+            // Restart from the next vertex with triangles left
+            while (cursor < n_verts && live[cursor] == 0) ++cursor;
+            if (cursor == n_verts) break;
+            fan = (int64_t)cursor;
+        }
+        candidates.clear();
+        for (uint32_t k = start[fan]; k < start[fan + 1]; ++k) {
+            const Index t = adjacent[k];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            order.push_back(t);
+            for (int j = 0; j < 3; ++j) {
+                const Index v = faces(t, j);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - cache_time[v] > CACHE_SIZE) cache_time[v] = time++;
+            }
+        }
+        // Next fan: a candidate still in the cache that will stay there
+        // while its remaining triangles are emitted, the oldest such one
+        fan = -1;
+        int64_t best = -1;
+        for (Index v : candidates) {
+            if (live[v] == 0) continue;
+            int64_t priority = 0;
+            if (time - cache_time[v] + 2 * (int64_t)live[v] <= CACHE_SIZE) {
+                priority = time - cache_time[v];
+            }
+            if (priority > best) {
+                best = priority;
+                fan = v;
+            }
+        }
+        while (fan < 0 && !dead_end.empty()) {
+            const Index v = dead_end.back();
+            dead_end.pop_back();
+            if (live[v] > 0) fan = v;
+        }
+    }
+    return order;
+}
+
+// Renumber the vertices of tris (in place) in order of first use;
+// returns the old index of each new vertex (unused vertices last)
+std::vector<Index> order_vertices(Triangles& tris, size_t n_verts) {
+    const Index NONE = (Index)-1;
+    std::vector<Index> remap(n_verts, NONE), old_index;
+    old_index.reserve(n_verts);
+    for (size_t i = 0; i < (size_t)tris.size(); ++i) {
+        Index& v = tris.data()[i];
+        if (remap[v] == NONE) {
+            remap[v] = (Index)old_index.size();
+            old_index.push_back(v);
+        }
+        v = remap[v];
+    }
+    for (size_t v = 0; v < n_verts; ++v) {
+        if (remap[v] == NONE) old_index.push_back((Index)v);
+    }
+    return old_index;
+}
+
+// * Quantization
+// Per-column min and step mapping the range of cols [col, col + C) of the
+// rows to bits-bit integers
+template <int C, class Mat>
+void quantization_range(const Mat& mat, int col, int bits, float* min,
+                        float* step) {
+    const float levels = (float)((1u << bits) - 1);
+    for (int c = 0; c < C; ++c) {
+        if (mat.rows() == 0) {
+            min[c] = step[c] = 0.f;
+            continue;
+        }
+        min[c] = mat.col(col + c).minCoeff();
+        step[c] = (mat.col(col + c).maxCoeff() - min[c]) / levels;
+    }
+}
+
+// Quantize cols [col, col + C) of rows order[0], order[1], ...
+template <int C, class Mat>
+std::vector<int32_t> quantize(const Mat& mat, const std::vector<Index>& order,
+                              int col, const float* min, const float* step,
+                              int bits) {
+    std::vector<int32_t> out(order.size() * C);
+    const int32_t max_q = (int32_t)((1u << bits) - 1);
+    internal::ThreadPool::get().parallel_for(
+        0, order.size(),
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                for (int c = 0; c < C; ++c) {
+                    const float v = mat(order[i], col + c);
+                    const int32_t q =
+                        step[c] > 0.f ? (int32_t)std::lround((v - min[c]) /
+                                                             step[c])
+                                      : 0;
+                    out[i * C + c] = std::min(std::max(q, 0), max_q);
+                }
+            }
+        },
+        BLOCK);
+    return out;
+}
+
+// Octahedral normal encoding: unit vectors to a square, as bits-bit
+// signed integers
+inline void encode_octahedral(const float* n, int bits, int32_t* out) {
+    const float scale = (float)((1 << (bits - 1)) - 1);
+    const float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+    float x = l1 > 0.f ? n[0] / l1 : 0.f;
+    float y = l1 > 0.f ? n[1] / l1 : 0.f;
+    if (n[2] < 0.f) {
+        const float ox = x;
+        x = (1.f - std::abs(y)) * (ox >= 0.f ? 1.f : -1.f);
+        y = (1.f - std::abs(ox)) * (y >= 0.f ? 1.f : -1.f);
+    }
+    out[0] = (int32_t)std::lround(x * scale);
+    out[1] = (int32_t)std::lround(y * scale);
+}
+
+inline void decode_octahedral(const int32_t* q, int bits, float* n) {
+    const float scale = 1.f / (float)((1 << (bits - 1)) - 1);
+    float x = q[0] * scale, y = q[1] * scale;
+    const float z = 1.f - std::abs(x) - std::abs(y);
+    // Unfold the lower hemisphere (branch-free form of encode_octahedral's
+    // fold, see Cigolle et al., "A survey of efficient representations for
+    // independent unit vectors", 2014)
+    const float t = std::max(-z, 0.f);
+    x -= std::copysign(t, x);
+    y -= std::copysign(t, y);
+    const float inv_len = 1.f / std::sqrt(x * x + y * y + z * z);
+    n[0] = x * inv_len;
+    n[1] = y * inv_len;
+    n[2] = z * inv_len;
+}
+
+}  // namespace
+
+bool Mesh::save_compressed(const std::string& path, int position_bits) const {
+    if (position_bits < 8 || position_bits > 24) {
+        std::cerr << "save_compressed: position_bits must be in [8, 24]\n";
+        return false;
+    }
+    const size_t n_verts = data.rows();
+    const bool has_tex_coords = _tex_coords.rows() > 0;
+    const bool bad_tex_faces =
+        has_tex_coords &&
+        (_tex_faces.rows() != faces.rows() ||
+         (_tex_faces.size() && _tex_faces.maxCoeff() >= _tex_coords.rows()));
+    if ((faces.size() && faces.maxCoeff() >= n_verts) || bad_tex_faces) {
+        std::cerr << "save_compressed: triangle index out of range\n";
+        return false;
+    }
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::copy(MAGIC, MAGIC + 8, header.magic);
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.n_verts = n_verts;
+    header.n_faces = faces.rows();
+    header.n_tex_coords = _tex_coords.rows();
+    header.position_bits = position_bits;
+    header.flags = (enabled ? (uint32_t)FLAG_ENABLED : 0u) |
+                   (_auto_normals ? 0u : (uint32_t)FLAG_NORMALS) |
+                   (has_tex_coords ? (uint32_t)FLAG_TEX_COORDS : 0u);
+    if (shading_type == ShadingType::vertex) {
+        header.flags |= FLAG_RGB;
+    } else if (!has_tex_coords) {
+        header.flags |= FLAG_VERTEX_UV;
+    }
+    std::copy(transform.data(), transform.data() + 16, header.transform);
+    header.shininess = shininess;
+
+    // Reorder: triangles for the vertex cache, vertices by first use
+    const std::vector<Index> tri_order = order_triangles(faces, n_verts);
+    Triangles tris(faces.rows(), 3), tex_tris;
+    for (size_t i = 0; i < tri_order.size(); ++i) {
+        tris.row(i) = faces.row(tri_order[i]);
+    }
+    const std::vector<Index> vert_order = order_vertices(tris, n_verts);
+    std::vector<Index> tex_order;
+    if (has_tex_coords) {
+        tex_tris.resize(faces.rows(), 3);
+        for (size_t i = 0; i < tri_order.size(); ++i) {
+            tex_tris.row(i) = _tex_faces.row(tri_order[i]);
+        }
+        tex_order = order_vertices(tex_tris, _tex_coords.rows());
+    }
+
+    // Quantize and code each stream
+    std::vector<Stream> streams;
+    quantization_range<3>(data, 0, position_bits, header.position_min,
+                          header.position_step);
+    streams.push_back(encode_deltas<3>(
+        quantize<3>(data, vert_order, 0, header.position_min,
+                    header.position_step, position_bits),
+        n_verts));
+    if (header.flags & FLAG_RGB) {
+        const float min[3] = {0.f, 0.f, 0.f};
+        const float step[3] = {1.f / 255.f, 1.f / 255.f, 1.f / 255.f};
+        streams.push_back(encode_deltas<3>(
+            quantize<3>(data, vert_order, 3, min, step, 8), n_verts));
+    } else if (header.flags & FLAG_VERTEX_UV) {
+        quantization_range<2>(data, 3, UV_BITS, header.uv_min,
+                              header.uv_step);
+        streams.push_back(encode_deltas<2>(
+            quantize<2>(data, vert_order, 3, header.uv_min, header.uv_step,
+                        UV_BITS),
+            n_verts));
+    }
+    if (header.flags & FLAG_NORMALS) {
+        std::vector<int32_t> oct(n_verts * 2);
+        internal::ThreadPool::get().parallel_for(
+            0, n_verts,
+            [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    Eigen::Matrix<float, 1, 3> n =
+                        data.block<1, 3>(vert_order[i], 6);
+                    encode_octahedral(n.data(), NORMAL_BITS, &oct[i * 2]);
+                }
+            },
+            BLOCK);
+        streams.push_back(encode_deltas<2>(oct, n_verts));
+    }
+    streams.push_back(encode_indices(tris));
+    if (has_tex_coords) {
+        quantization_range<2>(_tex_coords, 0, UV_BITS, header.uv_min,
+                              header.uv_step);
+        streams.push_back(encode_deltas<2>(
+            quantize<2>(_tex_coords, tex_order, 0, header.uv_min,
+                        header.uv_step, UV_BITS),
+            _tex_coords.rows()));
+        streams.push_back(encode_indices(tex_tris));
+    }
+
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs) {
+        std::cerr << "Failed to open " << path << " for writing\n";
+        return false;
+    }
+    ofs.write((const char*)&header, sizeof(header));
+    for (auto& stream : streams) stream.write(ofs);
+    if (!ofs) {
+        std::cerr << "Failed to write " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool Mesh::load_compressed(const std::string& path) {
+    internal::MappedFile file;
+    if (!file.open(path)) return false;
+    auto fail = [&](const char* message) {
+        std::cerr << path << ": " << message << "\n";
+        return false;
+    };
+    FileHeader header;
+    if (file.size() < sizeof(header)) return fail("not a compressed mesh");
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, 8) != 0) {
+        return fail("not a compressed mesh");
+    }
+    if (header.version != VERSION) {
+        return fail("unsupported compressed mesh version");
+    }
+    if (header.byte_order != BYTE_ORDER_MARK) {
+        return fail("compressed mesh written with the other byte order");
+    }
+    const size_t n_verts = header.n_verts, n_faces = header.n_faces;
+    const size_t n_tex_coords = header.n_tex_coords;
+    const bool has_tex_coords = (header.flags & FLAG_TEX_COORDS) != 0;
+    // Each vertex/triangle takes at least a byte per component
+    if (n_verts > file.size() / 3 || n_faces > file.size() / 3 ||
+        n_tex_coords > file.size() / 2 ||
+        (has_tex_coords && n_tex_coords < n_verts)) {
+        return fail("corrupt compressed mesh");
+    }
+
+    // Locate the streams (in the order written)
+    const char* p = file.data() + sizeof(header);
+    const char* end = file.data() + file.size();
+    StreamView pos, attr, normals, tris, uv, tex_tris;
+    const size_t vert_blocks = num_blocks(n_verts);
+    const size_t face_blocks = num_blocks(n_faces);
+    if (!pos.read(p, end, vert_blocks) ||
+        ((header.flags & (FLAG_RGB | FLAG_VERTEX_UV)) &&
+         !attr.read(p, end, vert_blocks)) ||
+        ((header.flags & FLAG_NORMALS) &&
+         !normals.read(p, end, vert_blocks)) ||
+        !tris.read(p, end, face_blocks) ||
+        (has_tex_coords && (!uv.read(p, end, num_blocks(n_tex_coords)) ||
+                            !tex_tris.read(p, end, face_blocks)))) {
+        return fail("corrupt compressed mesh");
+    }
+
+    // Decode into new arrays, so the mesh is unchanged on failure
+    PointsRGBNormal new_data(n_verts, data.ColsAtCompileTime);
+    // (Only the columns not decoded into)
+    if (!(header.flags & FLAG_RGB)) new_data.middleCols<3>(3).setZero();
+    if (!(header.flags & FLAG_NORMALS)) new_data.rightCols<3>().setZero();
+    Triangles new_faces(n_faces, 3), new_tex_faces;
+    Points2D new_tex_coords;
+    float* out = new_data.data();
+    const size_t stride = new_data.cols();
+    bool ok = decode_deltas<3>(pos, n_verts, [&](size_t i, const int32_t* q) {
+        for (int c = 0; c < 3; ++c) {
+            out[i * stride + c] =
+                header.position_min[c] + q[c] * header.position_step[c];
+        }
+    });
+    if (header.flags & FLAG_RGB) {
+        ok = ok &&
+             decode_deltas<3>(attr, n_verts, [&](size_t i, const int32_t* q) {
+                 for (int c = 0; c < 3; ++c) {
+                     out[i * stride + 3 + c] = q[c] * (1.f / 255.f);
+                 }
+             });
+    } else if (header.flags & FLAG_VERTEX_UV) {
+        ok = ok &&
+             decode_deltas<2>(attr, n_verts, [&](size_t i, const int32_t* q) {
+                 for (int c = 0; c < 2; ++c) {
+                     out[i * stride + 3 + c] =
+                         header.uv_min[c] + q[c] * header.uv_step[c];
+                 }
+             });
+    }
+    if (header.flags & FLAG_NORMALS) {
+        ok = ok && decode_deltas<2>(
+                       normals, n_verts, [&](size_t i, const int32_t* q) {
+                           decode_octahedral(q, NORMAL_BITS,
+                                             out + i * stride + 6);
+                       });
+    }
+    ok = ok && decode_indices(tris, n_faces, n_verts, new_faces);
+    if (has_tex_coords) {
+        new_tex_coords.resize(n_tex_coords, 2);
+        new_tex_faces.resize(n_faces, 3);
+        float* uv_out = new_tex_coords.data();
+        ok = ok &&
+             decode_deltas<2>(uv, n_tex_coords,
+                              [&](size_t i, const int32_t* q) {
+                                  for (int c = 0; c < 2; ++c) {
+                                      uv_out[i * 2 + c] =
+                                          header.uv_min[c] +
+                                          q[c] * header.uv_step[c];
+                                  }
+                              }) &&
+             decode_indices(tex_tris, n_faces, n_tex_coords, new_tex_faces);
+    }
+    if (!ok) return fail("corrupt compressed mesh");
+
+    data.swap(new_data);
+    faces.swap(new_faces);
+    _auto_normals = (header.flags & FLAG_NORMALS) == 0;
+    enabled = (header.flags & FLAG_ENABLED) != 0;
+    shininess = header.shininess;
+    std::copy(header.transform, header.transform + 16, transform.data());
+    if (has_tex_coords) {
+        set_tex_coords(new_tex_coords, new_tex_faces);
+    } else {
+        unset_tex_coords();
+        if (header.flags & FLAG_VERTEX_UV) {
+            shading_type = ShadingType::texture;
+        }
+    }
+    return true;
+}
+
+}  // namespace meshview
@@ -0,0 +1,194 @@
+#include "meshview/internal/framebuffer.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <GL/glew.h>
+
+namespace meshview {
+namespace internal {
+
+Framebuffer::Framebuffer(int width, int height)
+    : width(width), height(height) {
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &color_rb);
+    glGenRenderbuffers(1, &depth_rb);
+    alloc();
+}
+
+Framebuffer::~Framebuffer() {
+    if (~fbo) glDeleteFramebuffers(1, &fbo);
+    if (~color_rb) glDeleteRenderbuffers(1, &color_rb);
+    if (~depth_rb) glDeleteRenderbuffers(1, &depth_rb);
+    for (Index rb : aux_rb) {
+        if (~rb) glDeleteRenderbuffers(1, &rb);
+    }
+}
+
+void Framebuffer::resize(int width, int height) {
+    if (width == this->width && height == this->height) return;
+    this->width = width;
+    this->height = height;
+    alloc();
+}
+
+void Framebuffer::alloc() {
+    glBindRenderbuffer(GL_RENDERBUFFER, color_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width,
+                          height);
+    const GLenum aux_formats[3] = {GL_R32F, GL_R32UI, GL_RG32UI};
+    for (int i = 0; i < 3; ++i) {
+        if (!~aux_rb[i]) continue;
+        glBindRenderbuffer(GL_RENDERBUFFER, aux_rb[i]);
+        glRenderbufferStorage(GL_RENDERBUFFER, aux_formats[i], width, height);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, color_rb);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                              GL_RENDERBUFFER, depth_rb);
+    for (int i = 0; i < 3; ++i) {
+        if (!~aux_rb[i]) continue;
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1 + i,
+                                  GL_RENDERBUFFER, aux_rb[i]);
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Offscreen framebuffer is incomplete\n";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::bind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+void Framebuffer::unbind() { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+
+void Framebuffer::set_aux(bool enabled) {
+    if (enabled && !~aux_rb[0]) {
+        glGenRenderbuffers(3, aux_rb);
+        alloc();
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    }
+    _aux = enabled;
+    const GLenum draw_buffers[4] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1,
+                                    GL_COLOR_ATTACHMENT2,
+                                    GL_COLOR_ATTACHMENT3};
+    glDrawBuffers(enabled ? 4 : 1, draw_buffers);
+}
+
+void Framebuffer::clear(float r, float g, float b) {
+    const GLfloat color[4] = {r, g, b, 1.f};
+    glClearBufferfv(GL_COLOR, 0, color);
+    const GLfloat depth = 1.f;
+    glClearBufferfv(GL_DEPTH, 0, &depth);
+    if (_aux) {
+        const GLfloat zero_f[4] = {0.f, 0.f, 0.f, 0.f};
+        const GLuint zero_u[4] = {0, 0, 0, 0};
+        glClearBufferfv(GL_COLOR, 1, zero_f);
+        glClearBufferuiv(GL_COLOR, 2, zero_u);
+        glClearBufferuiv(GL_COLOR, 3, zero_u);
+    }
+}
+
+void Framebuffer::read_rgba(uint8_t* out) {
+    read(0, GL_RGBA, GL_UNSIGNED_BYTE, 4, out);
+}
+
+void Framebuffer::read(int attachment, unsigned format, unsigned type,
+                       size_t pixel_bytes, void* out) {
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadBuffer(GL_COLOR_ATTACHMENT0 + attachment);
+    glReadPixels(0, 0, width, height, format, type, out);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    // GL rows are bottom-up
+    flip_rows((uint8_t*)out, height, (size_t)width * pixel_bytes);
+}
+
+AsyncReadback::AsyncReadback(size_t n_slots) : _slots(n_slots) {
+    for (auto& slot : _slots) glGenBuffers(1, &slot.pbo);
+}
+
+AsyncReadback::~AsyncReadback() {
+    for (auto& slot : _slots) {
+        if (slot.fence) glDeleteSync((GLsync)slot.fence);
+        glDeleteBuffers(1, &slot.pbo);
+    }
+}
+
+void AsyncReadback::push(int width, int height, unsigned format,
+                         unsigned type, size_t pixel_bytes, size_t tag, int x,
+                         int y) {
+    Slot& slot = _slots[(_head + _count) % _slots.size()];
+    slot.bytes = (size_t)width * height * pixel_bytes;
+    slot.tag = tag;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (slot.capacity < slot.bytes) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, slot.bytes, NULL, GL_STREAM_READ);
+        slot.capacity = slot.bytes;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    // Into the bound PBO: returns without waiting for the GPU
+    glReadPixels(x, y, width, height, format, type, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = (void*)glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++_count;
+}
+
+bool AsyncReadback::front_ready() {
+    if (empty()) return false;
+    GLenum status = glClientWaitSync((GLsync)_slots[_head].fence,
+                                     GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+bool AsyncReadback::pop(const std::function<void(size_t, const uint8_t*)>& fn,
+                        bool wait) {
+    if (empty()) return false;
+    Slot& slot = _slots[_head];
+    if (wait) {
+        GLenum status;
+        do {
+            status = glClientWaitSync((GLsync)slot.fence,
+                                      GL_SYNC_FLUSH_COMMANDS_BIT,
+                                      /* 10 ms */ 10000000);
+        } while (status == GL_TIMEOUT_EXPIRED);
+    } else if (!front_ready()) {
+        return false;
+    }
+    glDeleteSync((GLsync)slot.fence);
+    slot.fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const uint8_t* data = (const uint8_t*)glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, slot.bytes, GL_MAP_READ_BIT);
+    if (data) {
+        fn(slot.tag, data);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        std::cerr << "Failed to map pixel buffer for readback\n";
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    _head = (_head + 1) % _slots.size();
+    --_count;
+    return true;
+}
+
+void flip_rows(uint8_t* data, size_t height, size_t row_bytes) {
+    std::vector<uint8_t> tmp(row_bytes);
+    for (size_t i = 0; i < height / 2; ++i) {
+        uint8_t* a = data + i * row_bytes;
+        uint8_t* b = data + (height - 1 - i) * row_bytes;
+        std::copy(a, a + row_bytes, tmp.data());
+        std::copy(b, b + row_bytes, a);
+        std::copy(tmp.data(), tmp.data() + row_bytes, b);
+    }
+}
+
+}  // namespace internal
+}  // namespace meshview
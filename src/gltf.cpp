@@ -0,0 +1,619 @@
+#include "meshview/meshview.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <Eigen/Geometry>
+
+#include "meshview/internal/binary.hpp"
+#include "meshview/internal/json.hpp"
+#include "meshview/internal/mapped_file.hpp"
+#include "meshview/internal/thread_pool.hpp"
+
+namespace meshview {
+namespace {
+
+using internal::Json;
+using internal::ScalarType;
+
+// Rows converted per task
+const size_t BLOCK_ROWS = 1 << 16;
+// Node hierarchy depth limit (glTF forbids cycles, but files may be broken)
+const int MAX_NODE_DEPTH = 256;
+
+const uint32_t GLB_MAGIC = 0x46546C67;  // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+enum { MODE_TRIANGLES = 4, MODE_TRIANGLE_STRIP = 5, MODE_TRIANGLE_FAN = 6 };
+
+struct Buffer {
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+// An accessor resolved to memory: count elements of components values of
+// type, stride bytes apart; data is null for accessors without a buffer
+// view (all zeros)
+struct AccessorView {
+    const char* data = nullptr;
+    size_t count = 0, stride = 0;
+    int components = 0;
+    ScalarType type = ScalarType::f32;
+    bool normalized = false;
+};
+
+bool component_type(int code, ScalarType& type) {
+    switch (code) {
+        case 5120:
+            type = ScalarType::int8;
+            return true;
+        case 5121:
+            type = ScalarType::uint8;
+            return true;
+        case 5122:
+            type = ScalarType::int16;
+            return true;
+        case 5123:
+            type = ScalarType::uint16;
+            return true;
+        case 5125:
+            type = ScalarType::uint32;
+            return true;
+        case 5126:
+            type = ScalarType::f32;
+            return true;
+        default:
+            return false;
+    }
+}
+
+int num_components(const std::string& type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    if (type == "MAT2") return 4;
+    if (type == "MAT3") return 9;
+    if (type == "MAT4") return 16;
+    return 0;
+}
+
+// Decode base64 (ignoring anything outside the alphabet, e.g. padding)
+void decode_base64(const char* p, const char* end, std::vector<char>& out) {
+    static int8_t table[256];
+    static const bool init = []() {
+        const char* alphabet =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::fill(table, table + 256, -1);
+        for (int i = 0; i < 64; ++i) table[(uint8_t)alphabet[i]] = (int8_t)i;
+        return true;
+    }();
+    (void)init;
+    out.clear();
+    out.reserve((end - p) / 4 * 3);
+    uint32_t bits = 0;
+    int n_bits = 0;
+    for (; p < end; ++p) {
+        const int8_t value = table[(uint8_t)*p];
+        if (value < 0) continue;
+        bits = (bits << 6) | (uint32_t)value;
+        n_bits += 6;
+        if (n_bits >= 8) {
+            n_bits -= 8;
+            out.push_back((char)((bits >> n_bits) & 0xFF));
+        }
+    }
+}
+
+// Decode %XX escapes of a relative URI
+std::string decode_uri(const std::string& uri) {
+    std::string out;
+    for (size_t i = 0; i < uri.size(); ++i) {
+        if (uri[i] == '%' && i + 2 < uri.size()) {
+            out += (char)std::strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+            i += 2;
+        } else {
+            out += uri[i];
+        }
+    }
+    return out;
+}
+
+// Local transform of a node (matrix, or translation * rotation * scale)
+Matrix4f node_transform(const Json& node) {
+    Matrix4f mat = Matrix4f::Identity();
+    const Json& matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        for (int i = 0; i < 16; ++i) mat.data()[i] = (float)matrix[i].number();
+        return mat;
+    }
+    const Json& t = node["translation"];
+    const Json& r = node["rotation"];
+    const Json& s = node["scale"];
+    Eigen::Affine3f affine = Eigen::Affine3f::Identity();
+    if (t.size() == 3) {
+        affine.translate(Vector3f((float)t[0].number(), (float)t[1].number(),
+                                  (float)t[2].number()));
+    }
+    if (r.size() == 4) {
+        // glTF quaternions are (x, y, z, w)
+        affine.rotate(Eigen::Quaternionf((float)r[3].number(1.0),
+                                         (float)r[0].number(),
+                                         (float)r[1].number(),
+                                         (float)r[2].number())
+                          .normalized());
+    }
+    if (s.size() == 3) {
+        affine.scale(Vector3f((float)s[0].number(1.0), (float)s[1].number(1.0),
+                              (float)s[2].number(1.0)));
+    }
+    return affine.matrix();
+}
+
+// Reads a glTF 2.0 (.gltf, with external or data: URI buffers) or binary
+// (.glb) file into meshes, one per primitive of each node instance
+class GltfLoader {
+   public:
+    explicit GltfLoader(const std::string& path) : _path(path) {
+        const size_t sep = path.find_last_of("/\\");
+        _dir = sep == std::string::npos ? "" : path.substr(0, sep + 1);
+    }
+
+    bool load(std::vector<std::unique_ptr<Mesh>>& out);
+
+   private:
+    bool fail(const std::string& message) const {
+        std::cerr << _path << ": " << message << "\n";
+        return false;
+    }
+    // Parse the JSON (from the GLB container or the whole file)
+    bool read_document();
+    bool load_buffers();
+    // Start decoding the base color images of all materials
+    void load_images();
+    // Resolve and bounds-check accessor index
+    bool accessor(size_t index, AccessorView& view) const;
+    // Convert the first n components of each element to floats, dst_stride
+    // apart in dst (elements in parallel blocks)
+    void read_floats(const AccessorView& view, int n, float* dst,
+                     size_t dst_stride) const;
+    void add_node(size_t index, const Matrix4f& parent, int depth);
+    void add_primitive(const Json& prim, const Matrix4f& world);
+
+    std::string _path, _dir;
+    internal::MappedFile _file;
+    Json _doc;
+    Buffer _glb_bin;
+    // Storage of the buffers: external files and decoded data URIs
+    std::vector<std::unique_ptr<internal::MappedFile>> _external;
+    std::vector<std::vector<char>> _decoded;
+    std::vector<Buffer> _buffers;
+    // Decoded images by image index (if used), pending until load finishes
+    std::vector<std::shared_future<Texture>> _images;
+    // Meshes and the image of their base color texture (or -1)
+    std::vector<std::unique_ptr<Mesh>>* _out = nullptr;
+    std::vector<int> _out_images;
+    size_t _skipped = 0;
+};
+
+bool GltfLoader::read_document() {
+    if (!_file.open(_path)) return false;
+    const char* data = _file.data();
+    const size_t size = _file.size();
+    const bool swap = internal::host_is_big_endian();
+    if (size < 12 || internal::load<uint32_t>(data, swap) != GLB_MAGIC) {
+        return _doc.parse(data, size, _path);
+    }
+    // GLB: 12-byte header, then (length, type, data) chunks
+    if (internal::load<uint32_t>(data + 4, swap) != 2) {
+        return fail("unsupported GLB version");
+    }
+    const size_t length =
+        std::min<size_t>(internal::load<uint32_t>(data + 8, swap), size);
+    const char* json = nullptr;
+    size_t json_size = 0;
+    for (size_t pos = 12; pos + 8 <= length;) {
+        const size_t chunk_size = internal::load<uint32_t>(data + pos, swap);
+        const uint32_t type = internal::load<uint32_t>(data + pos + 4, swap);
+        pos += 8;
+        if (chunk_size > length - pos) return fail("truncated GLB chunk");
+        if (type == GLB_CHUNK_JSON && json == nullptr) {
+            json = data + pos;
+            json_size = chunk_size;
+        } else if (type == GLB_CHUNK_BIN && _glb_bin.data == nullptr) {
+            _glb_bin.data = data + pos;
+            _glb_bin.size = chunk_size;
+        }
+        pos += (chunk_size + 3) & ~(size_t)3;
+    }
+    if (json == nullptr) return fail("GLB without JSON chunk");
+    return _doc.parse(json, json_size, _path);
+}
+
+bool GltfLoader::load_buffers() {
+    const Json& buffers = _doc["buffers"];
+    _buffers.resize(buffers.size());
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        const Json& buffer = buffers[i];
+        const size_t byte_length = buffer["byteLength"].integer(0);
+        Buffer& out = _buffers[i];
+        if (!buffer.has("uri")) {
+            // The GLB binary chunk (may be padded)
+            if (i != 0 || _glb_bin.data == nullptr) {
+                return fail("buffer without data");
+            }
+            out = _glb_bin;
+        } else {
+            const std::string& uri = buffer["uri"].string();
+            if (uri.compare(0, 5, "data:") == 0) {
+                const size_t comma = uri.find(',');
+                if (comma == std::string::npos ||
+                    uri.rfind(";base64", comma) == std::string::npos) {
+                    return fail("unsupported data URI");
+                }
+                _decoded.emplace_back();
+                decode_base64(uri.data() + comma + 1, uri.data() + uri.size(),
+                              _decoded.back());
+                out.data = _decoded.back().data();
+                out.size = _decoded.back().size();
+            } else {
+                _external.emplace_back(new internal::MappedFile());
+                if (!_external.back()->open(_dir + decode_uri(uri))) {
+                    return false;
+                }
+                out.data = _external.back()->data();
+                out.size = _external.back()->size();
+            }
+        }
+        if (out.size < byte_length) return fail("buffer shorter than stated");
+        out.size = byte_length;
+    }
+    return true;
+}
+
+bool GltfLoader::accessor(size_t index, AccessorView& view) const {
+    const Json& acc = _doc["accessors"][index];
+    if (!acc.is_object()) return fail("missing accessor");
+    int code = (int)acc["componentType"].integer(0);
+    if (!component_type(code, view.type)) {
+        return fail("bad accessor component type");
+    }
+    view.components = num_components(acc["type"].string());
+    view.count = acc["count"].integer(0);
+    view.normalized = acc["normalized"].boolean();
+    if (view.components == 0) return fail("bad accessor type");
+    if (acc.has("sparse")) {
+        std::cerr << _path << ": sparse accessors are not supported, "
+                  << "using their base values\n";
+    }
+    const size_t elem_size = internal::scalar_size(view.type) * view.components;
+    view.stride = elem_size;
+    if (!acc.has("bufferView")) return true;
+
+    const Json& bv = _doc["bufferViews"][acc["bufferView"].integer()];
+    const size_t buffer = bv["buffer"].integer();
+    if (!bv.is_object() || buffer >= _buffers.size()) {
+        return fail("bad buffer view");
+    }
+    const size_t bv_offset = bv["byteOffset"].integer(0);
+    const size_t bv_length = bv["byteLength"].integer(0);
+    const size_t offset = acc["byteOffset"].integer(0);
+    if (bv.has("byteStride")) view.stride = bv["byteStride"].integer(0);
+    const Buffer& buf = _buffers[buffer];
+    if (bv_offset > buf.size || bv_length > buf.size - bv_offset ||
+        view.stride < elem_size || offset > bv_length) {
+        return fail("accessor out of its buffer view");
+    }
+    // Last element must end within the view (without overflowing)
+    const size_t avail = bv_length - offset;
+    if (view.count &&
+        (avail < elem_size ||
+         view.count - 1 > (avail - elem_size) / view.stride)) {
+        return fail("accessor out of its buffer view");
+    }
+    view.data = buf.data + bv_offset + offset;
+    return true;
+}
+
+void GltfLoader::read_floats(const AccessorView& view, int n, float* dst,
+                             size_t dst_stride) const {
+    const size_t comp_size = internal::scalar_size(view.type);
+    const float scale =
+        view.normalized ? internal::normalize_scale(view.type) : 1.f;
+    const bool swap = internal::host_is_big_endian();
+    n = std::min(n, view.components);
+    internal::ThreadPool::get().parallel_for(
+        0, view.count,
+        [&](size_t begin, size_t end) {
+            for (int c = 0; c < n; ++c) {
+                float* out = dst + begin * dst_stride + c;
+                if (view.data == nullptr) {
+                    for (size_t i = begin; i < end; ++i, out += dst_stride) {
+                        *out = 0.f;
+                    }
+                    continue;
+                }
+                internal::convert_strided(
+                    view.type, view.data + begin * view.stride + c * comp_size,
+                    view.stride, end - begin, out, dst_stride, scale, swap);
+            }
+        },
+        BLOCK_ROWS);
+}
+
+void GltfLoader::load_images() {
+    const Json& images = _doc["images"];
+    const Json& textures = _doc["textures"];
+    const Json& materials = _doc["materials"];
+    _images.resize(images.size());
+    auto& pool = internal::ThreadPool::get();
+    for (size_t m = 0; m < materials.size(); ++m) {
+        const Json& tex_info =
+            materials[m]["pbrMetallicRoughness"]["baseColorTexture"];
+        if (!tex_info.is_object()) continue;
+        const size_t image =
+            textures[tex_info["index"].integer()]["source"].integer();
+        if (image >= images.size() || _images[image].valid()) continue;
+        const Json& img = images[image];
+        if (img.has("bufferView")) {
+            const Json& bv =
+                _doc["bufferViews"][img["bufferView"].integer()];
+            const size_t buffer = bv["buffer"].integer();
+            const size_t offset = bv["byteOffset"].integer(0);
+            const size_t length = bv["byteLength"].integer(0);
+            if (buffer >= _buffers.size() || offset > _buffers[buffer].size ||
+                length > _buffers[buffer].size - offset) {
+                fail("image out of its buffer");
+                continue;
+            }
+            const char* data = _buffers[buffer].data + offset;
+            _images[image] =
+                pool.submit([data, length]() { return Texture(data, length); })
+                    .share();
+        } else if (img.has("uri")) {
+            const std::string& uri = img["uri"].string();
+            if (uri.compare(0, 5, "data:") == 0) {
+                const size_t comma = uri.find(',');
+                if (comma == std::string::npos) continue;
+                _images[image] = pool.submit([&uri, comma]() {
+                                         std::vector<char> bytes;
+                                         decode_base64(uri.data() + comma + 1,
+                                                       uri.data() + uri.size(),
+                                                       bytes);
+                                         return Texture(bytes.data(),
+                                                        bytes.size());
+                                     })
+                                     .share();
+            } else {
+                const std::string file = _dir + decode_uri(uri);
+                _images[image] = pool.submit([file]() {
+                                         Texture tex(file);
+                                         tex.preload();
+                                         return tex;
+                                     })
+                                     .share();
+            }
+        }
+    }
+}
+
+void GltfLoader::add_node(size_t index, const Matrix4f& parent, int depth) {
+    const Json& node = _doc["nodes"][index];
+    if (!node.is_object() || depth > MAX_NODE_DEPTH) return;
+    const Matrix4f world = parent * node_transform(node);
+    if (node.has("mesh")) {
+        const Json& prims =
+            _doc["meshes"][node["mesh"].integer()]["primitives"];
+        for (size_t i = 0; i < prims.size(); ++i) {
+            add_primitive(prims[i], world);
+        }
+    }
+    const Json& children = node["children"];
+    for (size_t i = 0; i < children.size(); ++i) {
+        add_node(children[i].integer(), world, depth + 1);
+    }
+}
+
+void GltfLoader::add_primitive(const Json& prim, const Matrix4f& world) {
+    const int mode = (int)prim["mode"].integer(MODE_TRIANGLES);
+    const Json& attrs = prim["attributes"];
+    AccessorView pos;
+    if ((mode != MODE_TRIANGLES && mode != MODE_TRIANGLE_STRIP &&
+         mode != MODE_TRIANGLE_FAN) ||
+        !attrs.has("POSITION") ||
+        !accessor(attrs["POSITION"].integer(), pos) ||
+        pos.components != 3) {
+        // Points/lines or unusable
+        ++_skipped;
+        return;
+    }
+    const size_t n_verts = pos.count;
+
+    // Vertex indices, in drawing order
+    std::vector<Index> indices;
+    bool indices_ok = true;
+    if (prim.has("indices")) {
+        AccessorView idx;
+        if (!accessor(prim["indices"].integer(), idx) ||
+            idx.components != 1) {
+            ++_skipped;
+            return;
+        }
+        indices.resize(idx.count);
+        if (idx.data != nullptr && idx.type == ScalarType::uint32 &&
+            idx.stride == 4 && !internal::host_is_big_endian()) {
+            std::memcpy(indices.data(), idx.data, idx.count * 4);
+        } else if (idx.data != nullptr) {
+            internal::convert_strided(idx.type, idx.data, idx.stride,
+                                      idx.count, indices.data(), 1, 1.f,
+                                      internal::host_is_big_endian());
+        }
+        for (Index i : indices) indices_ok &= i < n_verts;
+    } else {
+        indices.resize(n_verts);
+        for (size_t i = 0; i < n_verts; ++i) indices[i] = (Index)i;
+    }
+    std::vector<Index> triangles;
+    if (mode == MODE_TRIANGLES && indices_ok) {
+        indices.resize(indices.size() / 3 * 3);
+        triangles.swap(indices);
+    } else {
+        // Strips/fans, or dropping triangles with bad indices
+        const size_t n = indices.size();
+        const size_t n_tri =
+            mode == MODE_TRIANGLES ? n / 3 : (n < 3 ? 0 : n - 2);
+        triangles.reserve(n_tri * 3);
+        for (size_t t = 0; t < n_tri; ++t) {
+            Index tri[3];
+            if (mode == MODE_TRIANGLES) {
+                std::copy(&indices[t * 3], &indices[t * 3] + 3, tri);
+            } else if (mode == MODE_TRIANGLE_STRIP) {
+                tri[0] = indices[t + (t & 1)];
+                tri[1] = indices[t + 1 - (t & 1)];
+                tri[2] = indices[t + 2];
+            } else {
+                tri[0] = indices[0];
+                tri[1] = indices[t + 1];
+                tri[2] = indices[t + 2];
+            }
+            if (tri[0] < n_verts && tri[1] < n_verts && tri[2] < n_verts) {
+                triangles.insert(triangles.end(), tri, tri + 3);
+            }
+        }
+    }
+
+    const size_t n_faces = triangles.size() / 3;
+    auto mesh = std::make_unique<Mesh>(n_verts, n_faces);
+    mesh->data.setZero();
+    if (n_faces) {
+        mesh->faces =
+            Eigen::Map<const Triangles>(triangles.data(), n_faces, 3);
+    }
+    read_floats(pos, 3, mesh->data.data(), mesh->data.cols());
+    AccessorView normals;
+    if (attrs.has("NORMAL") &&
+        accessor(attrs["NORMAL"].integer(), normals) &&
+        normals.components == 3 && normals.count == n_verts) {
+        read_floats(normals, 3, mesh->verts_norm().data(), mesh->data.cols());
+    }
+
+    // Material: base color factor, times COLOR_0, or the base color texture
+    const Json& material = _doc["materials"][prim["material"].integer()];
+    const Json& pbr = material["pbrMetallicRoughness"];
+    const Json& factor = pbr["baseColorFactor"];
+    Vector3f base_color(1.f, 1.f, 1.f);
+    if (factor.size() >= 3) {
+        for (int j = 0; j < 3; ++j) base_color[j] = (float)factor[j].number();
+    }
+    AccessorView colors;
+    if (attrs.has("COLOR_0") &&
+        accessor(attrs["COLOR_0"].integer(), colors) &&
+        colors.count == n_verts && colors.components >= 3) {
+        read_floats(colors, 3, mesh->data.data() + 3, mesh->data.cols());
+        mesh->verts_rgb().array().rowwise() *= base_color.transpose().array();
+    } else {
+        mesh->verts_rgb().rowwise() = base_color.transpose();
+    }
+    int image = -1;
+    const Json& tex_info = pbr["baseColorTexture"];
+    if (tex_info.is_object()) {
+        const std::string uv_name =
+            "TEXCOORD_" + std::to_string((int)tex_info["texCoord"].integer(0));
+        const size_t source =
+            _doc["textures"][tex_info["index"].integer()]["source"].integer();
+        AccessorView uv;
+        if (source < _images.size() && _images[source].valid() &&
+            attrs.has(uv_name.c_str()) &&
+            accessor(attrs[uv_name.c_str()].integer(), uv) &&
+            uv.count == n_verts && uv.components == 2) {
+            Points2D coords(n_verts, 2);
+            read_floats(uv, 2, coords.data(), 2);
+            // glTF's v runs down the image, textures are loaded bottom-up
+            coords.col(1) = 1.f - coords.col(1).array();
+            mesh->set_tex_coords(coords, mesh->faces);
+            image = (int)source;
+        }
+    }
+    // Rough approximation of roughness as Blinn-Phong shininess
+    if (pbr.has("roughnessFactor")) {
+        const float alpha = std::max(
+            (float)std::pow(pbr["roughnessFactor"].number(), 2.0), 1e-3f);
+        mesh->set_shininess(std::min(std::max(2.f / (alpha * alpha) - 2.f, 1.f),
+                                     256.f));
+    }
+    mesh->transform = world;
+    _out->push_back(std::move(mesh));
+    _out_images.push_back(image);
+}
+
+bool GltfLoader::load(std::vector<std::unique_ptr<Mesh>>& out) {
+    if (!read_document()) return false;
+    if (_doc["asset"]["version"].string().compare(0, 2, "2.") != 0) {
+        return fail("not a glTF 2.0 file");
+    }
+    const Json& required = _doc["extensionsRequired"];
+    for (size_t i = 0; i < required.size(); ++i) {
+        // Quantized attributes are read as normalized/integer accessors
+        if (required[i].string() != "KHR_mesh_quantization") {
+            return fail("unsupported required extension " +
+                        required[i].string());
+        }
+    }
+    if (!load_buffers()) return false;
+    // Decode images in the background while the meshes are built
+    load_images();
+
+    _out = &out;
+    const Json& nodes = _doc["nodes"];
+    const Json& scene =
+        _doc["scenes"][_doc["scene"].integer(0)]["nodes"];
+    if (scene.is_array()) {
+        for (size_t i = 0; i < scene.size(); ++i) {
+            add_node(scene[i].integer(), Matrix4f::Identity(), 0);
+        }
+    } else {
+        // No scene: every root node
+        std::vector<bool> is_child(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            const Json& children = nodes[i]["children"];
+            for (size_t j = 0; j < children.size(); ++j) {
+                const size_t child = children[j].integer();
+                if (child < is_child.size()) is_child[child] = true;
+            }
+        }
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (!is_child[i]) add_node(i, Matrix4f::Identity(), 0);
+        }
+    }
+    if (_skipped) {
+        std::cerr << _path << ": skipped " << _skipped
+                  << " primitives (not triangles, or bad accessors)\n";
+    }
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (_out_images[i] >= 0) {
+            out[i]->textures[Texture::TYPE_DIFFUSE].push_back(
+                _images[_out_images[i]].get());
+        }
+    }
+    // Images not used by any mesh must still finish before we return
+    for (auto& image : _images) {
+        if (image.valid()) image.wait();
+    }
+    return true;
+}
+
+}  // namespace
+
+std::vector<std::unique_ptr<Mesh>> Mesh::load_gltf(const std::string& path) {
+    std::vector<std::unique_ptr<Mesh>> meshes;
+    GltfLoader loader(path);
+    if (!loader.load(meshes)) meshes.clear();
+    return meshes;
+}
+
+}  // namespace meshview
@@ -0,0 +1,203 @@
+#include "meshview/internal/headless.hpp"
+
+#include <iostream>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "meshview/common.hpp"
+#ifdef MESHVIEW_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace meshview {
+namespace internal {
+
+namespace {
+bool init_glew() {
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW built for GLX reports this under EGL without an X display, after
+    // having loaded the core GL functions
+    if (err == GLEW_ERROR_NO_GLX_DISPLAY) err = GLEW_OK;
+#endif
+    return err == GLEW_OK;
+}
+}  // namespace
+
+HeadlessContext::HeadlessContext() {
+    if (!create_egl() && !create_glfw()) {
+        std::cerr << "Failed to create headless OpenGL context\n";
+        return;
+    }
+    if (!init_glew()) {
+        std::cerr << "GLEW init failed for headless context\n";
+    }
+}
+
+HeadlessContext::~HeadlessContext() {
+#ifdef MESHVIEW_EGL
+    if (_display) {
+        EGLDisplay display = (EGLDisplay)_display;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                       EGL_NO_CONTEXT);
+        if (_surface) eglDestroySurface(display, (EGLSurface)_surface);
+        if (_context) eglDestroyContext(display, (EGLContext)_context);
+        eglTerminate(display);
+    }
+#endif
+    if (_window) {
+        if (glfwGetCurrentContext() == (GLFWwindow*)_window) {
+            glfwMakeContextCurrent(nullptr);
+        }
+        glfwDestroyWindow((GLFWwindow*)_window);
+    }
+}
+
+void HeadlessContext::make_current() {
+#ifdef MESHVIEW_EGL
+    if (_context) {
+        eglMakeCurrent((EGLDisplay)_display, (EGLSurface)_surface,
+                       (EGLSurface)_surface, (EGLContext)_context);
+        return;
+    }
+#endif
+    if (_window) glfwMakeContextCurrent((GLFWwindow*)_window);
+}
+
+bool HeadlessContext::create_egl() {
+#ifdef MESHVIEW_EGL
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "EGL: desktop OpenGL API not supported\n";
+        return false;
+    }
+    auto get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+            "eglGetPlatformDisplayEXT");
+    auto query_devices =
+        (PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+    // Each candidate display is tried through context creation, so that
+    // one which initializes but has no usable config moves on to the next
+    if (get_platform_display) {
+        // Prefer rendering devices (GPUs, or Mesa's software device)
+        if (query_devices) {
+            const EGLint MAX_DEVICES = 16;
+            EGLDeviceEXT devices[MAX_DEVICES];
+            EGLint n_devices = 0;
+            if (query_devices(MAX_DEVICES, devices, &n_devices)) {
+                for (EGLint i = 0; i < n_devices; ++i) {
+                    if (try_egl_display(get_platform_display(
+                            EGL_PLATFORM_DEVICE_EXT, devices[i], nullptr))) {
+                        return true;
+                    }
+                }
+            }
+        }
+        if (try_egl_display(get_platform_display(
+                EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY,
+                nullptr))) {
+            return true;
+        }
+    }
+    if (try_egl_display(eglGetDisplay(EGL_DEFAULT_DISPLAY))) return true;
+    std::cerr << "EGL: no display supports an OpenGL 3.3 context\n";
+    return false;
+#else
+    return false;
+#endif
+}
+
+bool HeadlessContext::try_egl_display(void* disp) {
+#ifdef MESHVIEW_EGL
+    EGLDisplay display = (EGLDisplay)disp;
+    if (display == EGL_NO_DISPLAY) return false;
+    if (!eglInitialize(display, nullptr, nullptr)) return false;
+
+    const EGLint config_attribs[] = {EGL_SURFACE_TYPE,
+                                     EGL_PBUFFER_BIT,
+                                     EGL_RENDERABLE_TYPE,
+                                     EGL_OPENGL_BIT,
+                                     EGL_RED_SIZE,
+                                     8,
+                                     EGL_GREEN_SIZE,
+                                     8,
+                                     EGL_BLUE_SIZE,
+                                     8,
+                                     EGL_ALPHA_SIZE,
+                                     8,
+                                     EGL_DEPTH_SIZE,
+                                     24,
+                                     EGL_NONE};
+    EGLConfig config;
+    EGLint n_configs = 0;
+    if (!eglChooseConfig(display, config_attribs, &config, 1, &n_configs) ||
+        n_configs == 0) {
+        eglTerminate(display);
+        return false;
+    }
+    const EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                      3,
+                                      EGL_CONTEXT_MINOR_VERSION,
+                                      3,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                      EGL_NONE};
+    EGLContext context =
+        eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (context == EGL_NO_CONTEXT) {
+        eglTerminate(display);
+        return false;
+    }
+
+    // We always render into FBOs, so try without any surface first
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        const EGLint pbuffer_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1,
+                                          EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, pbuffer_attribs);
+        if (surface == EGL_NO_SURFACE ||
+            !eglMakeCurrent(display, surface, surface, context)) {
+            if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+            eglDestroyContext(display, context);
+            eglTerminate(display);
+            return false;
+        }
+    }
+    _display = (void*)display;
+    _context = (void*)context;
+    _surface = surface == EGL_NO_SURFACE ? nullptr : (void*)surface;
+    return true;
+#else
+    (void)disp;
+    return false;
+#endif
+}
+
+bool HeadlessContext::create_glfw() {
+    if (!glfwInit()) return false;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window =
+        glfwCreateWindow(1, 1, "meshview-headless", NULL, NULL);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!window) return false;
+    _window = (void*)window;
+    glfwMakeContextCurrent(window);
+    return true;
+}
+
+bool egl_context_current() {
+#ifdef MESHVIEW_EGL
+    return eglGetCurrentContext() != EGL_NO_CONTEXT;
+#else
+    return false;
+#endif
+}
+
+}  // namespace internal
+}  // namespace meshview
@@ -0,0 +1,250 @@
+#include "meshview/internal/json.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "meshview/internal/parse.hpp"
+
+namespace meshview {
+namespace internal {
+
+namespace {
+const Json NULL_JSON;
+
+// Nesting limit, against stack overflow on hostile input
+const int MAX_DEPTH = 256;
+
+void append_utf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += (char)code;
+    } else if (code < 0x800) {
+        out += (char)(0xC0 | (code >> 6));
+        out += (char)(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += (char)(0xE0 | (code >> 12));
+        out += (char)(0x80 | ((code >> 6) & 0x3F));
+        out += (char)(0x80 | (code & 0x3F));
+    } else {
+        out += (char)(0xF0 | (code >> 18));
+        out += (char)(0x80 | ((code >> 12) & 0x3F));
+        out += (char)(0x80 | ((code >> 6) & 0x3F));
+        out += (char)(0x80 | (code & 0x3F));
+    }
+}
+}  // namespace
+
+// Recursive descent parser over [p, end)
+class JsonParser {
+   public:
+    JsonParser(const char* text, size_t size) : p(text), end(text + size) {}
+
+    bool document(Json& out) {
+        if (!value(out, 0)) return false;
+        skip_space();
+        return p == end || fail("trailing characters");
+    }
+
+    const char* error = nullptr;
+    const char* p;
+    const char* end;
+
+   private:
+    bool fail(const char* message) {
+        if (!error) error = message;
+        return false;
+    }
+
+    void skip_space() {
+        while (p < end &&
+               (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            ++p;
+        }
+    }
+
+    bool literal(const char* word) {
+        const size_t len = std::strlen(word);
+        if ((size_t)(end - p) < len || std::memcmp(p, word, len) != 0) {
+            return fail("invalid literal");
+        }
+        p += len;
+        return true;
+    }
+
+    bool hex4(uint32_t& code) {
+        if (end - p < 4) return fail("truncated \\u escape");
+        code = 0;
+        for (int i = 0; i < 4; ++i, ++p) {
+            const char c = *p;
+            code <<= 4;
+            if (c >= '0' && c <= '9') {
+                code |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                code |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                code |= c - 'A' + 10;
+            } else {
+                return fail("invalid \\u escape");
+            }
+        }
+        return true;
+    }
+
+    bool string(std::string& out) {
+        ++p;  // '"'
+        for (;;) {
+            // Copy runs without escapes at once
+            const char* run = p;
+            while (p < end && *p != '"' && *p != '\\') ++p;
+            out.append(run, p);
+            if (p >= end) return fail("unterminated string");
+            if (*p++ == '"') return true;
+            if (p >= end) return fail("unterminated string");
+            const char c = *p++;
+            switch (c) {
+                case '"':
+                case '\\':
+                case '/':
+                    out += c;
+                    break;
+                case 'b':
+                    out += '\b';
+                    break;
+                case 'f':
+                    out += '\f';
+                    break;
+                case 'n':
+                    out += '\n';
+                    break;
+                case 'r':
+                    out += '\r';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                case 'u': {
+                    uint32_t code;
+                    if (!hex4(code)) return false;
+                    if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 &&
+                        p[0] == '\\' && p[1] == 'u') {
+                        p += 2;
+                        uint32_t low;
+                        if (!hex4(low)) return false;
+                        code = 0x10000 + ((code - 0xD800) << 10) +
+                               (low - 0xDC00);
+                    }
+                    append_utf8(out, code);
+                    break;
+                }
+                default:
+                    return fail("invalid escape");
+            }
+        }
+    }
+
+    bool value(Json& out, int depth) {
+        if (depth > MAX_DEPTH) return fail("nested too deeply");
+        skip_space();
+        if (p >= end) return fail("unexpected end");
+        switch (*p) {
+            case '{': {
+                out._type = Json::Type::object;
+                ++p;
+                skip_space();
+                if (p < end && *p == '}') {
+                    ++p;
+                    return true;
+                }
+                for (;;) {
+                    skip_space();
+                    if (p >= end || *p != '"') return fail("expected key");
+                    out._members.emplace_back();
+                    if (!string(out._members.back().first)) return false;
+                    skip_space();
+                    if (p >= end || *p++ != ':') return fail("expected ':'");
+                    if (!value(out._members.back().second, depth + 1)) {
+                        return false;
+                    }
+                    skip_space();
+                    if (p < end && *p == ',') {
+                        ++p;
+                    } else if (p < end && *p == '}') {
+                        ++p;
+                        return true;
+                    } else {
+                        return fail("expected ',' or '}'");
+                    }
+                }
+            }
+            case '[': {
+                out._type = Json::Type::array;
+                ++p;
+                skip_space();
+                if (p < end && *p == ']') {
+                    ++p;
+                    return true;
+                }
+                for (;;) {
+                    out._elements.emplace_back();
+                    if (!value(out._elements.back(), depth + 1)) return false;
+                    skip_space();
+                    if (p < end && *p == ',') {
+                        ++p;
+                    } else if (p < end && *p == ']') {
+                        ++p;
+                        return true;
+                    } else {
+                        return fail("expected ',' or ']'");
+                    }
+                }
+            }
+            case '"':
+                out._type = Json::Type::string;
+                return string(out._string);
+            case 't':
+                out._type = Json::Type::boolean;
+                out._boolean = true;
+                return literal("true");
+            case 'f':
+                out._type = Json::Type::boolean;
+                return literal("false");
+            case 'n':
+                return literal("null");
+            default:
+                out._type = Json::Type::number;
+                if (!parse_double(p, end, out._number)) {
+                    return fail("unexpected character");
+                }
+                return true;
+        }
+    }
+};
+
+bool Json::parse(const char* text, size_t size, const std::string& what) {
+    *this = Json();
+    JsonParser parser(text, size);
+    if (parser.document(*this)) return true;
+    std::cerr << what << ": JSON error (" << parser.error << ") at byte "
+              << (parser.p - text) << "\n";
+    *this = Json();
+    return false;
+}
+
+const Json& Json::operator[](size_t index) const {
+    return _type == Type::array && index < _elements.size() ? _elements[index]
+                                                            : NULL_JSON;
+}
+
+const Json& Json::operator[](const char* key) const {
+    if (_type == Type::object) {
+        for (auto& member : _members) {
+            if (member.first == key) return member.second;
+        }
+    }
+    return NULL_JSON;
+}
+
+bool Json::has(const char* key) const { return !(*this)[key].is_null(); }
+
+}  // namespace internal
+}  // namespace meshview
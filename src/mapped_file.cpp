@@ -0,0 +1,137 @@
+#include "meshview/internal/mapped_file.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace meshview {
+namespace internal {
+
+MappedFile::MappedFile(const std::string& path) { open(path); }
+
+MappedFile::~MappedFile() { close(); }
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path, Access access) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING,
+                              access == Access::sequential
+                                  ? FILE_FLAG_SEQUENTIAL_SCAN
+                                  : FILE_FLAG_RANDOM_ACCESS,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open " << path << "\n";
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        std::cerr << "Failed to get the size of " << path << "\n";
+        CloseHandle(file);
+        return false;
+    }
+    _file = file;
+    _size = (size_t)size.QuadPart;
+    _valid = true;
+    if (_size == 0) return true;
+    _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping != nullptr) {
+        _data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (_data == nullptr) {
+        std::cerr << "Failed to map " << path << "\n";
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (_data) UnmapViewOfFile(_data);
+    if (_mapping) CloseHandle((HANDLE)_mapping);
+    if (_file) CloseHandle((HANDLE)_file);
+    _data = nullptr;
+    _mapping = _file = nullptr;
+    _size = 0;
+    _valid = false;
+}
+
+// (Pages are read on first access)
+void MappedFile::prefetch(size_t, size_t) const {}
+
+void MappedFile::evict(size_t, size_t) const {}
+#else
+bool MappedFile::open(const std::string& path, Access access) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << path << "\n";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::cerr << "Failed to get the size of " << path << "\n";
+        ::close(fd);
+        return false;
+    }
+    _size = (size_t)st.st_size;
+    if (_size > 0) {
+        void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            std::cerr << "Failed to map " << path << "\n";
+            ::close(fd);
+            _size = 0;
+            return false;
+        }
+        if (access == Access::sequential) {
+            // Loaders scan the whole file front to back
+            madvise(data, _size, MADV_SEQUENTIAL);
+            madvise(data, _size, MADV_WILLNEED);
+        } else {
+            madvise(data, _size, MADV_RANDOM);
+        }
+        _data = (const char*)data;
+    }
+    // The mapping stays valid without the descriptor
+    ::close(fd);
+    _valid = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (_data) munmap((void*)_data, _size);
+    _data = nullptr;
+    _size = 0;
+    _valid = false;
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const {
+    if (offset >= _size) return;
+    size = std::min(size, _size - offset);
+    // madvise needs a page-aligned start
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t start = offset / page * page;
+    madvise((void*)(_data + start), size + (offset - start), MADV_WILLNEED);
+}
+
+void MappedFile::evict(size_t offset, size_t size) const {
+    if (offset >= _size) return;
+    size = std::min(size, _size - offset);
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t start = offset / page * page;
+    madvise((void*)(_data + start), size + (offset - start), MADV_DONTNEED);
+}
+#endif
+
+}  // namespace internal
+}  // namespace meshview
@@ -1,23 +1,178 @@
 #include "meshview/meshview.hpp"
 
+#include <algorithm>
+#include <cctype>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <GL/glew.h>
-#include <GLFW/glfw3.h>
 #include <Eigen/Geometry>
 
 #include "meshview/util.hpp"
+#include "meshview/backend.hpp"
+#include "meshview/cache.hpp"
 #include "meshview/internal/shader.hpp"
 #include "meshview/internal/assert.hpp"
+#include "meshview/internal/format.hpp"
+#include "meshview/internal/mapped_file.hpp"
+#include "meshview/internal/parse.hpp"
+#include "meshview/internal/thread_pool.hpp"
+#include "meshview/internal/upload.hpp"
 
 namespace meshview {
 namespace {
 
+// Vertex buffer layouts
+const size_t SCALAR_SZ = sizeof(float);
+const size_t MESH_POS_OFFSET = 0;
+const size_t MESH_COLOR_OFFSET = 3;
+const size_t MESH_NORMALS_OFFSET = 6;
+const size_t PC_POS_OFFSET = 0;
+const size_t PC_RGB_OFFSET = 3;
+
+// Lowercase extension of path, without the dot
+std::string extension(const std::string& path) {
+    const size_t dot = path.find_last_of("./\\");
+    if (dot == std::string::npos || path[dot] != '.') return "";
+    std::string ext = path.substr(dot + 1);
+    for (char& c : ext) c = (char)std::tolower((unsigned char)c);
+    return ext;
+}
+
+// Set vertex attribute pointers for the currently bound mesh VAO/VBO
+void mesh_set_attrib_pointers() {
+    const size_t VERT_SZ = PointsRGBNormal::ColsAtCompileTime * SCALAR_SZ;
+    // vertex positions
+    backend().vertex_attrib_pointer(0, 3, VERT_SZ, MESH_POS_OFFSET * SCALAR_SZ);
+    // vertex texture coords
+    backend().vertex_attrib_pointer(1, 3, VERT_SZ,
+                                    MESH_COLOR_OFFSET * SCALAR_SZ);
+    // vertex normals
+    backend().vertex_attrib_pointer(2, 3, VERT_SZ,
+                                    MESH_NORMALS_OFFSET * SCALAR_SZ);
+}
+
+// Set vertex attribute pointers for the currently bound point cloud VAO/VBO
+void point_cloud_set_attrib_pointers() {
+    const size_t VERT_SZ = PointsRGB::ColsAtCompileTime * SCALAR_SZ;
+    // vertex positions
+    backend().vertex_attrib_pointer(0, 3, VERT_SZ, PC_POS_OFFSET * SCALAR_SZ);
+    // vertex color
+    backend().vertex_attrib_pointer(1, 3, VERT_SZ, PC_RGB_OFFSET * SCALAR_SZ);
+}
+
+// Convert vertex data to texture coordinate indexing (data -> out)
+void gather_tex_data(const PointsRGBNormal& data, const Points2D& tex_coords,
+                     const Eigen::Matrix<Index, Eigen::Dynamic, 1>& tex_to_vert,
+                     PointsRGBNormal& out) {
+    out.resize(tex_coords.rows(), data.ColsAtCompileTime);
+    internal::ThreadPool::get().parallel_for(
+        0, tex_coords.rows(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out.block<1, 3>(i, MESH_POS_OFFSET).noalias() =
+                    data.block<1, 3>(tex_to_vert[i], MESH_POS_OFFSET);
+                out.block<1, 2>(i, MESH_COLOR_OFFSET).noalias() =
+                    tex_coords.row(i);
+                out.block<1, 3>(i, MESH_NORMALS_OFFSET).noalias() =
+                    data.block<1, 3>(tex_to_vert[i], MESH_NORMALS_OFFSET);
+            }
+        });
+}
+
+// A line-aligned chunk of a basic OBJ file and its parsed contents
+struct BasicObjChunk {
+    const char* begin;
+    const char* end;
+    // attrs_per_vert floats per vertex
+    std::vector<float> verts;
+    std::vector<Index> faces;
+    // Positions in faces of negative (relative) indices, which are stored
+    // relative to the chunk's first vertex until merged
+    std::vector<size_t> relative;
+    // Number of attributes of 1st v line (0 if none)
+    size_t attrs_per_vert = 0;
+    // Number of v lines with a different number of attributes
+    size_t bad_verts = 0;
+    // First vertex/triangle row of the chunk (prefix sums)
+    size_t vert_offset = 0, triangle_offset = 0;
+};
+
+// Parse the lines of chunk; polygons become triangle fans
+void parse_basic_obj_chunk(BasicObjChunk& chunk) {
+    size_t n_verts = 0;
+    for (const char* line = chunk.begin; line < chunk.end;) {
+        const char* line_end = internal::find_line_end(line, chunk.end);
+        const char* p = line;
+        line = line_end + 1;
+        internal::skip_blanks(p, line_end);
+        if (line_end - p < 2 || !internal::is_blank(p[1])) continue;
+        const char keyword = p[0];
+        p += 2;
+        if (keyword == 'v') {
+            float attrs[6];
+            size_t cnt = 0;
+            for (float value;; ++cnt) {
+                internal::skip_blanks(p, line_end);
+                if (!internal::parse_float(p, line_end, value)) break;
+                if (cnt < 6) attrs[cnt] = value;
+            }
+            if (!chunk.attrs_per_vert) {
+                chunk.attrs_per_vert = std::min<size_t>(cnt, 6);
+            } else if (cnt != chunk.attrs_per_vert) {
+                ++chunk.bad_verts;
+            }
+            chunk.verts.insert(chunk.verts.end(), attrs,
+                               attrs + chunk.attrs_per_vert);
+            ++n_verts;
+        } else if (keyword == 'f') {
+            // Vertex index of each corner: the number before any '/'
+            Index corners[3];
+            bool relative[3];
+            for (size_t corner = 0;; ++corner) {
+                internal::skip_blanks(p, line_end);
+                int64_t index;
+                if (!internal::parse_int(p, line_end, index)) break;
+                internal::skip_token(p, line_end);
+                // Triangle fan: the first corner and the latest two
+                const size_t k = std::min<size_t>(corner, 2);
+                if (k == 2 && corner > 2) {
+                    corners[1] = corners[2];
+                    relative[1] = relative[2];
+                }
+                relative[k] = index < 0;
+                corners[k] = (Index)(relative[k] ? (int64_t)n_verts + index
+                                                 : index - 1);
+                if (k < 2) continue;
+                for (int j = 0; j < 3; ++j) {
+                    if (relative[j]) {
+                        chunk.relative.push_back(chunk.faces.size());
+                    }
+                    chunk.faces.push_back(corners[j]);
+                }
+            }
+        }
+    }
+}
+
+// Snapshot of everything needed to upload a mesh in the background
+struct MeshUploadData {
+    PointsRGBNormal data;
+    Triangles faces;
+    Points2D tex_coords;
+    Triangles tex_faces;
+    Eigen::Matrix<Index, Eigen::Dynamic, 1> tex_to_vert;
+    bool auto_normals;
+    // Textures not yet loaded, with their (type, index) in Mesh::textures
+    std::vector<Texture> textures;
+    std::vector<std::array<Index, 2>> texture_slots;
+};
+
 void shader_set_transform_matrices(const internal::Shader& shader,
                                    const Camera& camera,
                                    const Matrix4f& transform) {
     shader.set_mat4("M", transform);
+    shader.set_mat4("V", camera.view);
     shader.set_mat4("MVP", camera.proj * camera.view * transform);
 
     auto normal_matrix = transform.topLeftCorner<3, 3>().inverse().transpose();
@@ -31,7 +186,19 @@ Mesh::Mesh(size_t num_verts, size_t num_triangles) : VAO((Index)-1) {
     resize(num_verts, num_triangles);
 }
 
-Mesh::Mesh(const std::string& path) { load_basic_obj(path); }
+Mesh::Mesh(const std::string& path) : Mesh() {
+    if (extension(path) == "npz") {
+        load_npz(path);
+    } else {
+        load_basic_obj(path);
+    }
+}
+
+Mesh::Mesh(const std::string& verts_path, const std::string& faces_path,
+           const std::string& rgb_path)
+    : Mesh() {
+    load_npy(verts_path, faces_path, rgb_path);
+}
 
 Mesh::Mesh(const Eigen::Ref<const Points>& pos,
            const Eigen::Ref<const Triangles>& tri_faces,
@@ -83,10 +250,14 @@ void Mesh::resize(size_t num_verts, size_t num_triangles) {
 }
 
 void Mesh::draw(Index shader_id, const Camera& camera) {
+    finish_upload();
     if (!enabled || data.rows() == 0) return;
     if (!~VAO) {
-        std::cerr << "ERROR: Please call meshview::Mesh::update() before "
-                     "Mesh::draw()\n";
+        // Nothing to draw yet if the first upload is still in flight
+        if (!_pending) {
+            std::cerr << "ERROR: Please call meshview::Mesh::update() before "
+                         "Mesh::draw()\n";
+        }
         return;
     }
     internal::Shader shader(shader_id);
@@ -99,8 +270,8 @@ void Mesh::draw(Index shader_id, const Camera& camera) {
                 // No texture, create default (grey)
                 gen_blank_texture();
                 shader.set_int("material." + std::string(ttype_name), 0);
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, blank_tex_id);
+                backend().active_texture(0);
+                backend().bind_texture(GL_TEXTURE_2D, blank_tex_id);
             }
         }
         Index tex_id = 1;
@@ -109,16 +280,18 @@ void Mesh::draw(Index shader_id, const Camera& camera) {
             auto& tex_vec = textures[ttype];
             Index cnt = 0;
             for (size_t i = tex_vec.size() - 1; ~i; --i, ++tex_id) {
-                glActiveTexture(
-                    GL_TEXTURE0 +
-                    tex_id);  // Active proper texture unit before binding
+                // Active proper texture unit before binding
+                backend().active_texture(tex_id);
                 // Now set the sampler to the correct texture unit
                 shader.set_int("material." + std::string(ttype_name) +
                                    (cnt ? std::to_string(cnt) : ""),
                                tex_id);
                 ++cnt;
                 // And finally bind the texture
-                glBindTexture(GL_TEXTURE_2D, tex_vec[i].id);
+                // (blank if it is still being uploaded in the background)
+                if (!~tex_vec[i].id) gen_blank_texture();
+                backend().bind_texture(GL_TEXTURE_2D,
+                              ~tex_vec[i].id ? tex_vec[i].id : blank_tex_id);
             }
         }
     }
@@ -128,12 +301,12 @@ void Mesh::draw(Index shader_id, const Camera& camera) {
     shader_set_transform_matrices(shader, camera, transform);
 
     // Draw mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, (GLsizei)faces.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    backend().bind_vertex_array(VAO);
+    backend().draw_elements(GL_TRIANGLES, _draw_count);
+    backend().bind_vertex_array(0);
 
     // Always good practice to set everything back to defaults once configured.
-    glActiveTexture(GL_TEXTURE0);
+    backend().active_texture(0);
 }
 
 Mesh& Mesh::set_tex_coords(const Eigen::Ref<const Points2D>& coords,
@@ -149,8 +322,8 @@ Mesh& Mesh::set_tex_coords(const Eigen::Ref<const Points2D>& coords,
 }
 
 Mesh& Mesh::unset_tex_coords() {
-    _tex_coords.resize(0, 0);
-    _tex_faces.resize(0, 0);
+    _tex_coords.resize(0, _tex_coords.ColsAtCompileTime);
+    _tex_faces.resize(0, _tex_faces.ColsAtCompileTime);
     shading_type = ShadingType::vertex;
     return *this;
 }
@@ -161,22 +334,21 @@ Mesh& Mesh::set_shininess(float val) {
 }
 
 void Mesh::update(bool force_init) {
-    static const size_t SCALAR_SZ = sizeof(float);
-    static const size_t POS_OFFSET = 0;
-    static const size_t COLOR_OFFSET = 3;
-    static const size_t NORMALS_OFFSET = 6;
-    static const size_t VERT_INDICES = data.ColsAtCompileTime;
-    static const size_t VERT_SZ = VERT_INDICES * SCALAR_SZ;
-
-    if (glfwGetCurrentContext() == nullptr) {
+    ++_version;
+    if (!backend().has_context()) {
         // No OpenGL context is created, exit
         return;
     }
-
-    // Auto normals
-    if (_auto_normals) {
-        util::estimate_normals(verts_pos(), faces, data.rightCols<3>());
+    if (_pending) {
+        // Superseded by this update
+        _pending->abandon();
+        _pending.reset();
     }
+    _upload_stale = false;
+
+    const PointsRGBNormal* vert_data;
+    const Triangles* face_data;
+    buffer_data(vert_data, face_data);
 
     if (!force_init && ~VAO) {
         // Already initialized, load any new textures
@@ -196,84 +368,183 @@ void Mesh::update(bool force_init) {
         blank_tex_id = -1;
 
         // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        backend().gen_vertex_arrays(1, &VAO);
+        backend().gen_buffers(1, &VBO);
+        backend().gen_buffers(1, &EBO);
     }
 
     // Figure out buffer sizes
-    Eigen::Index n_verts, n_faces;
-    float* vert_data_ptr;
-    Index* face_data_ptr;
+    const Eigen::Index n_faces = face_data->rows();
+    const size_t BUF_SZ = vert_data->size() * SCALAR_SZ;
+    const size_t INDEX_SZ = face_data->size() * sizeof(Index);
+
+    backend().bind_vertex_array(VAO);
+    // load data into vertex buffers
+    backend().bind_buffer(GL_ARRAY_BUFFER, VBO);
+    backend().buffer_data(GL_ARRAY_BUFFER, BUF_SZ, vert_data->data(),
+                          GL_STATIC_DRAW);
+
+    backend().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    backend().buffer_data(GL_ELEMENT_ARRAY_BUFFER, INDEX_SZ,
+                          face_data->data(), GL_STATIC_DRAW);
+
+    // set the vertex attribute pointers
+    mesh_set_attrib_pointers();
+    backend().bind_vertex_array(0);
+    _draw_count = n_faces * faces.ColsAtCompileTime;
+}
+
+void Mesh::buffer_data(const PointsRGBNormal*& vert_data,
+                       const Triangles*& face_data) {
+    // Auto normals
+    if (_auto_normals) {
+        util::estimate_normals(verts_pos(), faces, data.rightCols<3>());
+    }
     if (_tex_coords.rows()) {
-        n_verts = _tex_coords.rows();
-        n_faces = _tex_faces.rows();
-        _data_tex.resize(n_verts, data.ColsAtCompileTime);
         // Convert to texture indexing data -> data_tex
-        for (size_t i = 0; i < n_verts; ++i) {
-            _data_tex.block<1, 3>(i, POS_OFFSET).noalias() =
-                data.block<1, 3>(_tex_to_vert[i], POS_OFFSET);
-            _data_tex.block<1, 3>(i, NORMALS_OFFSET).noalias() =
-                data.block<1, 3>(_tex_to_vert[i], NORMALS_OFFSET);
-        }
-        _data_tex.middleCols<2>(COLOR_OFFSET).noalias() = _tex_coords;
-        vert_data_ptr = _data_tex.data();
-        face_data_ptr = _tex_faces.data();
+        gather_tex_data(data, _tex_coords, _tex_to_vert, _data_tex);
+        vert_data = &_data_tex;
+        face_data = &_tex_faces;
     } else {
-        n_verts = data.rows();
-        n_faces = faces.rows();
-        vert_data_ptr = data.data();
-        face_data_ptr = faces.data();
+        vert_data = &data;
+        face_data = &faces;
     }
-    const size_t BUF_SZ = n_verts * data.ColsAtCompileTime * SCALAR_SZ;
-    const size_t INDEX_SZ = n_faces * faces.ColsAtCompileTime * SCALAR_SZ;
+}
 
-    glBindVertexArray(VAO);
-    // load data into vertex buffers
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, BUF_SZ, (GLvoid*)vert_data_ptr,
-                 GL_STATIC_DRAW);
+void Mesh::update_async(internal::UploadWorker& worker) {
+    ++_version;
+    _upload_worker = &worker;
+    _upload_stale = true;
+    // Adopt a completed upload; one still in flight is left to finish, and
+    // the latest data uploaded after it (see finish_upload)
+    finish_upload();
+    if (!_pending) submit_upload();
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, INDEX_SZ, (GLvoid*)face_data_ptr,
-                 GL_STATIC_DRAW);
+void Mesh::submit_upload() {
+    _upload_stale = false;
+    auto pending = std::make_shared<internal::PendingUpload>();
+    _pending = pending;
+
+    // Snapshot the data, so that the mesh may be modified or destroyed while
+    // the upload is in flight
+    auto snap = std::make_shared<MeshUploadData>();
+    snap->data = data;
+    snap->faces = faces;
+    snap->auto_normals = _auto_normals;
+    if (_tex_coords.rows()) {
+        snap->tex_coords = _tex_coords;
+        snap->tex_faces = _tex_faces;
+        snap->tex_to_vert = _tex_to_vert;
+    }
+    for (int ttype = 0; ttype < Texture::__TYPE_COUNT; ++ttype) {
+        for (size_t i = 0; i < textures[ttype].size(); ++i) {
+            if (~textures[ttype][i].id) continue;
+            snap->textures.push_back(textures[ttype][i]);
+            snap->texture_slots.push_back({(Index)ttype, (Index)i});
+        }
+    }
 
-    // set the vertex attribute pointers
-    // vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VERT_SZ,
-                          (GLvoid*)(POS_OFFSET * SCALAR_SZ));
-    // vertex texture coords
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, VERT_SZ,
-                          (GLvoid*)(COLOR_OFFSET * SCALAR_SZ));
-    // vertex normals
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, VERT_SZ,
-                          (GLvoid*)(NORMALS_OFFSET * SCALAR_SZ));
-    glBindVertexArray(0);
+    _upload_worker->submit(
+        [pending, snap]() {
+            if (pending->abandoned()) return;
+            if (snap->auto_normals) {
+                util::estimate_normals(snap->data.leftCols<3>(), snap->faces,
+                                       snap->data.rightCols<3>());
+            }
+            const PointsRGBNormal* vert_data = &snap->data;
+            const Triangles* face_data = &snap->faces;
+            PointsRGBNormal data_tex;
+            if (snap->tex_coords.rows()) {
+                gather_tex_data(snap->data, snap->tex_coords, snap->tex_to_vert,
+                                data_tex);
+                vert_data = &data_tex;
+                face_data = &snap->tex_faces;
+            }
+            // Element buffer binding is VAO state, so upload both buffers
+            // through non-VAO targets; VAOs are set up in finish_upload
+            backend().gen_buffers(1, &pending->VBO);
+            backend().bind_buffer(GL_ARRAY_BUFFER, pending->VBO);
+            backend().buffer_data(GL_ARRAY_BUFFER,
+                                  vert_data->size() * SCALAR_SZ,
+                                  vert_data->data(), GL_STATIC_DRAW);
+            backend().gen_buffers(1, &pending->EBO);
+            backend().bind_buffer(GL_COPY_WRITE_BUFFER, pending->EBO);
+            backend().buffer_data(GL_COPY_WRITE_BUFFER,
+                                  face_data->size() * sizeof(Index),
+                                  face_data->data(), GL_STATIC_DRAW);
+            backend().bind_buffer(GL_ARRAY_BUFFER, 0);
+            backend().bind_buffer(GL_COPY_WRITE_BUFFER, 0);
+            pending->count = face_data->size();
+
+            for (size_t i = 0; i < snap->textures.size(); ++i) {
+                Texture& tex = snap->textures[i];
+                tex.load();
+                pending->textures.push_back({snap->texture_slots[i][0],
+                                             snap->texture_slots[i][1],
+                                             tex.id});
+                // Now owned by pending
+                tex.id = -1;
+            }
+        },
+        [pending]() { pending->complete(); });
+}
+
+void Mesh::finish_upload() {
+    if (!_pending || !_pending->ready()) return;
+    if (~VAO) backend().delete_vertex_arrays(1, &VAO);
+    if (~VBO) backend().delete_buffers(1, &VBO);
+    if (~EBO) backend().delete_buffers(1, &EBO);
+    VBO = _pending->VBO;
+    EBO = _pending->EBO;
+    backend().gen_vertex_arrays(1, &VAO);
+    backend().bind_vertex_array(VAO);
+    backend().bind_buffer(GL_ARRAY_BUFFER, VBO);
+    backend().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    mesh_set_attrib_pointers();
+    backend().bind_vertex_array(0);
+    _draw_count = _pending->count;
+
+    for (auto& tex : _pending->textures) {
+        auto& tex_vec = textures[tex[0]];
+        if (tex[1] < tex_vec.size() && !~tex_vec[tex[1]].id) {
+            tex_vec[tex[1]].id = tex[2];
+        } else {
+            // Texture was removed or loaded elsewhere in the meantime
+            backend().delete_textures(1, &tex[2]);
+        }
+    }
+    _pending.reset();
+    if (_upload_stale) submit_upload();
 }
 
 void Mesh::free_bufs() {
-    if (~VAO) glDeleteVertexArrays(1, &VAO);
-    if (~VBO) glDeleteBuffers(1, &VBO);
-    if (~EBO) glDeleteBuffers(1, &EBO);
-    if (~blank_tex_id) glDeleteTextures(1, &blank_tex_id);
+    if (_pending) {
+        _pending->abandon();
+        _pending.reset();
+    }
+    _upload_stale = false;
+    _upload_worker = nullptr;
+    if (~VAO) backend().delete_vertex_arrays(1, &VAO);
+    if (~VBO) backend().delete_buffers(1, &VBO);
+    if (~EBO) backend().delete_buffers(1, &EBO);
+    if (~blank_tex_id) backend().delete_textures(1, &blank_tex_id);
+    VAO = VBO = EBO = blank_tex_id = -1;
 }
 
 void Mesh::gen_blank_texture() {
     if (~blank_tex_id) return;
-    glGenTextures(1, &blank_tex_id);
-    glBindTexture(GL_TEXTURE_2D, blank_tex_id);
+    backend().gen_textures(1, &blank_tex_id);
+    backend().bind_texture(GL_TEXTURE_2D, blank_tex_id);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    backend().tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    backend().tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    backend().tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     Vector3f grey(0.7f, 0.7f, 0.7f);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_FLOAT,
-                 grey.data());
-    glGenerateMipmap(GL_TEXTURE_2D);
+    backend().tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    backend().tex_image_2d(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, GL_RGB, GL_FLOAT,
+                           grey.data());
+    backend().generate_mipmap(GL_TEXTURE_2D);
 }
 
 Mesh Mesh::Triangle(const Eigen::Ref<const Vector3f>& a,
@@ -378,102 +649,153 @@ Mesh Mesh::Sphere(int rings, int sectors) {
     return m;
 }
 
-void Mesh::save_basic_obj(const std::string& path) const {
-    std::ofstream ofs(path);
-    for (int i = 0; i < data.rows(); ++i) {
-        ofs << "v";
-        // Transform point
-        Vector4f v =
-            transform * data.block<1, 3>(i, 0).transpose().homogeneous();
-        for (int j = 0; j < 3; ++j) {
-            ofs << " " << v(j);
-        }
-        if (shading_type == ShadingType::vertex) {
-            for (int j = 3; j < 6; ++j) {
-                ofs << " " << data(i, j);
-            }
-        }
-        ofs << "\n";
+bool Mesh::save_basic_obj(const std::string& path) const {
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs) {
+        std::cerr << "Failed to open " << path << " for writing\n";
+        return false;
     }
-    for (int i = 0; i < faces.rows(); ++i) {
-        ofs << "f";
-        for (int j = 0; j < 3; ++j) {
-            ofs << " " << faces(i, j) + 1;
-        }
-        ofs << "\n";
+    const bool rgb = shading_type == ShadingType::vertex;
+    // Row vectors are transformed by the transposes
+    const Matrix3f rot_t = transform.topLeftCorner<3, 3>().transpose();
+    const Eigen::RowVector3f trans =
+        transform.topRightCorner<3, 1>().transpose();
+    using internal::MAX_FLOAT_CHARS;
+    using internal::MAX_UINT_CHARS;
+    bool ok = internal::write_blocks(
+        ofs, data.rows(), 2 + (rgb ? 6 : 3) * (MAX_FLOAT_CHARS + 1),
+        [&](size_t begin, size_t end, char* out) {
+            // Transform the whole block at once
+            const Points pos =
+                (data.block(begin, 0, end - begin, 3) * rot_t).rowwise() +
+                trans;
+            for (size_t i = begin; i < end; ++i) {
+                *out++ = 'v';
+                for (int j = 0; j < 3; ++j) {
+                    *out++ = ' ';
+                    out = internal::format_float(out, pos(i - begin, j));
+                }
+                if (rgb) {
+                    for (int j = 3; j < 6; ++j) {
+                        *out++ = ' ';
+                        out = internal::format_float(out, data(i, j));
+                    }
+                }
+                *out++ = '\n';
+            }
+            return out;
+        });
+    ok = ok && internal::write_blocks(
+                   ofs, faces.rows(), 2 + 3 * (MAX_UINT_CHARS + 1),
+                   [&](size_t begin, size_t end, char* out) {
+                       for (size_t i = begin; i < end; ++i) {
+                           *out++ = 'f';
+                           for (int j = 0; j < 3; ++j) {
+                               *out++ = ' ';
+                               out = internal::format_uint(
+                                   out, (uint32_t)faces(i, j) + 1);
+                           }
+                           *out++ = '\n';
+                       }
+                       return out;
+                   });
+    if (!ok) {
+        std::cerr << "Failed to write " << path << "\n";
+        return false;
     }
+    return true;
+}
+
+bool Mesh::save(const std::string& path) const {
+    const std::string ext = extension(path);
+    if (ext == "obj") return save_basic_obj(path);
+    if (ext == "ply") return save_ply(path);
+    if (ext == "mvz") return save_compressed(path);
+    if (ext == "mvc") return SceneCache::write(path, {this});
+    std::cerr << "Mesh::save: unknown extension of " << path
+              << " (expected .obj, .ply, .mvz or .mvc)\n";
+    return false;
 }
 
 void Mesh::load_basic_obj(const std::string& path) {
-    std::ifstream ifs(path);
-    std::string line;
-    std::vector<float> tmp_pos, tmp_rgb;
-    std::vector<Index> tmp_faces;
-    size_t attrs_per_vert = 0;
-    while (std::getline(ifs, line)) {
-        if (line.size() < 2 || line[1] != ' ') continue;
-        if (line[0] == 'v') {
-            std::stringstream ss(line.substr(2));
-            double tmp;
-            size_t cnt = 0;
-            while (ss >> tmp) {
-                if (cnt >= 3) {
-                    tmp_rgb.push_back(tmp);
-                } else {
-                    tmp_pos.push_back(tmp);
-                }
-                ++cnt;
+    internal::MappedFile file(path);
+    const char* text = file.data();
+    const size_t size = file.size();
+
+    // Split into line-aligned chunks and parse them in parallel
+    auto& pool = internal::ThreadPool::get();
+    const size_t n_chunks = size < (1 << 16) ? 1 : pool.size() * 4;
+    std::vector<BasicObjChunk> chunks(n_chunks);
+    const auto ranges = internal::split_lines(text, size, n_chunks);
+    for (size_t i = 0; i < n_chunks; ++i) {
+        chunks[i].begin = ranges[i].first;
+        chunks[i].end = ranges[i].second;
+    }
+    pool.parallel_for(
+        0, n_chunks,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                parse_basic_obj_chunk(chunks[i]);
             }
+        },
+        1);
+
+    // Place each chunk's rows with prefix sums, then copy them in parallel
+    size_t attrs_per_vert = 0, n_verts = 0, n_triangles = 0;
+    for (auto& chunk : chunks) {
+        _MESHVIEW_ASSERT_EQ(chunk.bad_verts, 0);
+        if (chunk.attrs_per_vert) {
             if (attrs_per_vert) {
-                _MESHVIEW_ASSERT_EQ(cnt, attrs_per_vert);
+                _MESHVIEW_ASSERT_EQ(chunk.attrs_per_vert, attrs_per_vert);
             } else {
-                _MESHVIEW_ASSERT(cnt == 3 || cnt == 6);
-                attrs_per_vert = cnt;
-            }
-        } else if (line[0] == 'f') {
-            size_t i = 2, j = 0;
-            while (i < line.size() && std::isspace(i)) ++i;
-            std::string num;
-            for (; i < line.size(); ++i) {
-                if (line[i] == '/') {
-                    ++j;
-                } else if (std::isspace(line[i])) {
-                    tmp_faces.push_back((Index)std::atoll(num.c_str()) - 1);
-                    j = 0;
-                    num.clear();
-                } else if (j == 0) {
-                    num.push_back(line[i]);
-                }
-            }
-            if (num.size()) {
-                tmp_faces.push_back((Index)std::atoll(num.c_str()) - 1);
+                _MESHVIEW_ASSERT(chunk.attrs_per_vert == 3 ||
+                                 chunk.attrs_per_vert == 6);
+                attrs_per_vert = chunk.attrs_per_vert;
             }
         }
+        chunk.vert_offset = n_verts;
+        chunk.triangle_offset = n_triangles;
+        if (chunk.attrs_per_vert) {
+            n_verts += chunk.verts.size() / chunk.attrs_per_vert;
+        }
+        n_triangles += chunk.faces.size() / 3;
     }
-    if (attrs_per_vert == 6) {
-        shading_type = ShadingType::vertex;
-        _MESHVIEW_ASSERT_EQ(tmp_rgb.size(), tmp_pos.size());
-        _MESHVIEW_ASSERT_EQ(tmp_rgb.size() % 3, 0);
-    } else {
-        shading_type = ShadingType::texture;
-        _MESHVIEW_ASSERT_EQ(tmp_rgb.size(), 0);
-    }
-    _MESHVIEW_ASSERT_EQ(tmp_faces.size() % 3, 0);
-    data.resize(tmp_pos.size() / 3, data.ColsAtCompileTime);
-
-    data.leftCols<3>().noalias() =
-        Eigen::Map<Points>(tmp_pos.data(), data.rows(), 3);
-    if (tmp_rgb.size()) {
-        data.middleCols<3>(3).noalias() =
-            Eigen::Map<Points>(tmp_rgb.data(), data.rows(), 3);
-    }
-    if (tmp_faces.size()) {
-        faces.resize(tmp_faces.size() / 3, faces.ColsAtCompileTime);
-        faces.noalias() =
-            Eigen::Map<Triangles>(tmp_faces.data(), faces.rows(), 3);
-    } else {
+    data.resize(n_verts, data.ColsAtCompileTime);
+    faces.resize(n_triangles, faces.ColsAtCompileTime);
+    pool.parallel_for(
+        0, n_chunks,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                BasicObjChunk& chunk = chunks[i];
+                const size_t rows = chunk.attrs_per_vert
+                                        ? chunk.verts.size() /
+                                              chunk.attrs_per_vert
+                                        : 0;
+                for (size_t r = 0; r < rows; ++r) {
+                    float* row = data.row(chunk.vert_offset + r).data();
+                    const float* attrs =
+                        chunk.verts.data() + r * chunk.attrs_per_vert;
+                    std::copy(attrs, attrs + chunk.attrs_per_vert, row);
+                    std::fill(row + chunk.attrs_per_vert,
+                              row + data.ColsAtCompileTime, 0.f);
+                }
+                for (size_t pos : chunk.relative) {
+                    chunk.faces[pos] += (Index)chunk.vert_offset;
+                }
+                std::copy(chunk.faces.begin(), chunk.faces.end(),
+                          faces.data() + chunk.triangle_offset * 3);
+                // Free as we go
+                std::vector<float>().swap(chunk.verts);
+                std::vector<Index>().swap(chunk.faces);
+            }
+        },
+        1);
+    shading_type =
+        attrs_per_vert == 6 ? ShadingType::vertex : ShadingType::texture;
+    if (n_triangles == 0) {
+        // No f lines: consecutive vertex triples are triangles
         faces.resize(data.rows() / 3, faces.ColsAtCompileTime);
-        for (Index i = 0; i < (Index)data.rows(); ++i) {
+        for (Index i = 0; i < (Index)faces.size(); ++i) {
             faces.data()[i] = i;
         }
     }
@@ -502,6 +824,17 @@ PointCloud::PointCloud(const Eigen::Ref<const Points>& pos, float r, float g,
     verts_pos().noalias() = pos;
     verts_rgb().rowwise() = Eigen::RowVector3f(r, g, b);
 }
+PointCloud::PointCloud(const std::string& path, const std::string& rgb_path)
+    : PointCloud() {
+    const std::string ext = extension(path);
+    if (ext == "npz") {
+        load_npz(path);
+    } else if (ext == "ply") {
+        load_ply(path);
+    } else {
+        load_npy(path, rgb_path);
+    }
+}
 PointCloud::~PointCloud() { free_bufs(); }
 
 void PointCloud::resize(size_t num_verts) {
@@ -510,74 +843,163 @@ void PointCloud::resize(size_t num_verts) {
 }
 
 void PointCloud::update(bool force_init) {
-    static const size_t SCALAR_SZ = sizeof(float);
-    static const size_t POS_OFFSET = 0;
-    static const size_t RGB_OFFSET = 3 * SCALAR_SZ;
-    static const size_t VERT_INDICES = data.ColsAtCompileTime;
-    static const size_t VERT_SZ = VERT_INDICES * SCALAR_SZ;
-
-    if (glfwGetCurrentContext() == nullptr) {
+    ++_version;
+    if (!backend().has_context()) {
         // No OpenGL context is created, exit
         return;
     }
+    if (_pending) {
+        // Superseded by this update
+        _pending->abandon();
+        _pending.reset();
+    }
+    _upload_stale = false;
 
     const size_t BUF_SZ = data.size() * SCALAR_SZ;
 
     // Already initialized
     if (force_init || !~VAO) {
         // Create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
+        backend().gen_vertex_arrays(1, &VAO);
+        backend().gen_buffers(1, &VBO);
     }
-    glBindVertexArray(VAO);
+    if (force_init) {
+        // Extra buffers belonged to a previous context
+        _gpu_chunks.clear();
+        _gpu_points = 0;
+    }
+    backend().bind_vertex_array(VAO);
     // load data into vertex buffers
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    backend().bind_buffer(GL_ARRAY_BUFFER, VBO);
     // A great thing about structs is that their memory layout is sequential
     // for all its items. The effect is that we can simply pass a pointer to
     // the struct and it translates perfectly to a glm::vec3/2 array which
     // again translates to 3/2 floats which translates to a byte array.
-    glBufferData(GL_ARRAY_BUFFER, BUF_SZ, (GLvoid*)data.data(), GL_STATIC_DRAW);
+    backend().buffer_data(GL_ARRAY_BUFFER, BUF_SZ, data.data(), GL_STATIC_DRAW);
 
     // set the vertex attribute pointers
-    // vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, VERT_SZ,
-                          (GLvoid*)POS_OFFSET);
-    // vertex color
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, VERT_SZ,
-                          (GLvoid*)RGB_OFFSET);
-    glBindVertexArray(0);
+    point_cloud_set_attrib_pointers();
+    backend().bind_vertex_array(0);
+    _draw_count = data.rows();
+}
+
+void PointCloud::update_async(internal::UploadWorker& worker) {
+    ++_version;
+    _upload_worker = &worker;
+    _upload_stale = true;
+    // Adopt a completed upload; one still in flight is left to finish, and
+    // the latest data uploaded after it (see finish_upload)
+    finish_upload();
+    if (!_pending) submit_upload();
+}
+
+void PointCloud::submit_upload() {
+    _upload_stale = false;
+    auto pending = std::make_shared<internal::PendingUpload>();
+    _pending = pending;
+
+    // Snapshot the data, so that the point cloud may be modified or destroyed
+    // while the upload is in flight
+    auto snap = std::make_shared<PointsRGB>(data);
+    _upload_worker->submit(
+        [pending, snap]() {
+            if (pending->abandoned()) return;
+            backend().gen_buffers(1, &pending->VBO);
+            backend().bind_buffer(GL_ARRAY_BUFFER, pending->VBO);
+            backend().buffer_data(GL_ARRAY_BUFFER, snap->size() * SCALAR_SZ,
+                                  snap->data(), GL_STATIC_DRAW);
+            backend().bind_buffer(GL_ARRAY_BUFFER, 0);
+            pending->count = snap->rows();
+        },
+        [pending]() { pending->complete(); });
+}
+
+void PointCloud::finish_upload() {
+    if (!_pending || !_pending->ready()) return;
+    if (~VAO) backend().delete_vertex_arrays(1, &VAO);
+    if (~VBO) backend().delete_buffers(1, &VBO);
+    VBO = _pending->VBO;
+    backend().gen_vertex_arrays(1, &VAO);
+    backend().bind_vertex_array(VAO);
+    backend().bind_buffer(GL_ARRAY_BUFFER, VBO);
+    point_cloud_set_attrib_pointers();
+    backend().bind_vertex_array(0);
+    _draw_count = _pending->count;
+    _pending.reset();
+    if (_upload_stale) submit_upload();
 }
 
 void PointCloud::draw(Index shader_id, const Camera& camera) {
+    finish_upload();
     if (!enabled) return;
     if (!~VAO) {
-        std::cerr << "ERROR: Please call meshview::PointCloud::update() before "
-                     "PointCloud::draw()\n";
+        // Nothing to draw yet if the first upload is still in flight
+        if (!_pending) {
+            std::cerr << "ERROR: Please call meshview::PointCloud::update() "
+                         "before PointCloud::draw()\n";
+        }
         return;
     }
     internal::Shader shader(shader_id);
 
     // Set point size
-    glPointSize(point_size);
+    backend().point_size(point_size);
 
     // Set space transform matrices
     shader_set_transform_matrices(shader, camera, transform);
 
     // Draw mesh
-    glBindVertexArray(VAO);
-    glDrawArrays(lines ? GL_LINES : GL_POINTS, 0, (GLsizei)data.rows());
-    glBindVertexArray(0);
+    backend().bind_vertex_array(VAO);
+    backend().draw_arrays(lines ? GL_LINES : GL_POINTS, 0, _draw_count);
+    for (auto& chunk : _gpu_chunks) {
+        backend().bind_vertex_array(chunk.VAO);
+        backend().draw_arrays(lines ? GL_LINES : GL_POINTS, 0, chunk.count);
+    }
+    backend().bind_vertex_array(0);
 
     // Always good practice to set everything back to defaults once
     // configured.
-    glActiveTexture(GL_TEXTURE0);
+    backend().active_texture(0);
 }
 
 void PointCloud::free_bufs() {
-    if (~VAO) glDeleteVertexArrays(1, &VAO);
-    if (~VBO) glDeleteBuffers(1, &VBO);
+    if (_pending) {
+        _pending->abandon();
+        _pending.reset();
+    }
+    _upload_stale = false;
+    _upload_worker = nullptr;
+    if (~VAO) backend().delete_vertex_arrays(1, &VAO);
+    if (~VBO) backend().delete_buffers(1, &VBO);
+    VAO = VBO = -1;
+    for (auto& chunk : _gpu_chunks) {
+        backend().delete_vertex_arrays(1, &chunk.VAO);
+        backend().delete_buffers(1, &chunk.VBO);
+    }
+    _gpu_chunks.clear();
+    _gpu_points = 0;
+}
+
+void PointCloud::append_gpu(const Eigen::Ref<const PointsRGB>& points) {
+    if (!backend().has_context() || points.rows() == 0) return;
+    if (points.outerStride() != PointsRGB::ColsAtCompileTime) {
+        // Rows of a wider matrix
+        append_gpu(PointsRGB(points));
+        return;
+    }
+    ++_version;
+    GpuChunk chunk;
+    backend().gen_vertex_arrays(1, &chunk.VAO);
+    backend().gen_buffers(1, &chunk.VBO);
+    backend().bind_vertex_array(chunk.VAO);
+    backend().bind_buffer(GL_ARRAY_BUFFER, chunk.VBO);
+    backend().buffer_data(GL_ARRAY_BUFFER, points.size() * SCALAR_SZ,
+                          points.data(), GL_STATIC_DRAW);
+    point_cloud_set_attrib_pointers();
+    backend().bind_vertex_array(0);
+    chunk.count = points.rows();
+    _gpu_chunks.push_back(chunk);
+    _gpu_points += chunk.count;
 }
 
 PointCloud PointCloud::Line(const Eigen::Ref<const Vector3f>& a,
@@ -0,0 +1,752 @@
+#include "meshview/npy.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+
+#include "meshview/meshview.hpp"
+#include "meshview/internal/binary.hpp"
+#include "meshview/internal/mapped_file.hpp"
+#include "meshview/internal/parse.hpp"
+#include "meshview/internal/thread_pool.hpp"
+#ifdef MESHVIEW_ZLIB
+#include <zlib.h>
+#endif
+
+namespace meshview {
+namespace {
+
+using internal::ScalarType;
+using internal::host_is_big_endian;
+using internal::load;
+
+const char NPY_MAGIC[6] = {'\x93', 'N', 'U', 'M', 'P', 'Y'};
+// Values converted per task
+const size_t BLOCK_VALUES = 1 << 18;
+
+// Zip record signatures
+const uint32_t ZIP_LOCAL_HEADER = 0x04034b50;
+const uint32_t ZIP_CENTRAL_HEADER = 0x02014b50;
+const uint32_t ZIP_END = 0x06054b50;
+const uint32_t ZIP64_END = 0x06064b50;
+const uint32_t ZIP64_END_LOCATOR = 0x07064b50;
+
+// Names looked up, in order, for each attribute in .npz files
+const std::initializer_list<const char*> POSITION_NAMES = {
+    "verts", "vertices", "v", "points", "positions", "xyz"};
+const std::initializer_list<const char*> FACE_NAMES = {"faces", "triangles",
+                                                       "f"};
+const std::initializer_list<const char*> RGB_NAMES = {"colors", "rgb",
+                                                      "vertex_colors"};
+const std::initializer_list<const char*> NORMAL_NAMES = {
+    "normals", "vn", "vertex_normals"};
+
+// Little-endian zip fields
+template <class T>
+inline T load_le(const char* p) {
+    return load<T>(p, host_is_big_endian());
+}
+
+// Start of the value of key in the header dict of a .npy file (after the
+// quoted key, ':' and blanks), or null
+const char* find_value(const char* p, const char* end,
+                       const std::string& key) {
+    for (const char* q = p; (q = std::search(q, end, key.begin(),
+                                             key.end())) != end;
+         ++q) {
+        if (q == p || (q[-1] != '\'' && q[-1] != '"') ||
+            end - q <= (ptrdiff_t)key.size() || q[key.size()] != q[-1]) {
+            continue;
+        }
+        const char* v = q + key.size() + 1;
+        internal::skip_blanks(v, end);
+        if (v == end || *v != ':') continue;
+        ++v;
+        internal::skip_blanks(v, end);
+        return v < end ? v : nullptr;
+    }
+    return nullptr;
+}
+
+// Type and byte order of a NumPy dtype string such as "<f4"
+bool parse_dtype(const std::string& descr, ScalarType& type, bool& swap) {
+    static const struct {
+        const char* code;
+        ScalarType type;
+    } types[] = {
+        {"b1", ScalarType::uint8},  {"i1", ScalarType::int8},
+        {"u1", ScalarType::uint8},  {"i2", ScalarType::int16},
+        {"u2", ScalarType::uint16}, {"i4", ScalarType::int32},
+        {"u4", ScalarType::uint32}, {"i8", ScalarType::int64},
+        {"u8", ScalarType::uint64}, {"f4", ScalarType::f32},
+        {"f8", ScalarType::f64},
+    };
+    if (descr.size() != 3) return false;
+    const char order = descr[0];
+    if (order != '<' && order != '>' && order != '|' && order != '=') {
+        return false;
+    }
+    for (const auto& t : types) {
+        if (descr.compare(1, 2, t.code) == 0) {
+            type = t.type;
+            swap = (order == '<' && host_is_big_endian()) ||
+                   (order == '>' && !host_is_big_endian());
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string shape_string(const std::vector<size_t>& shape) {
+    std::string str = "(";
+    for (size_t i = 0; i < shape.size(); ++i) {
+        if (i) str += ", ";
+        str += std::to_string(shape[i]);
+    }
+    return str + (shape.size() == 1 ? ",)" : ")");
+}
+
+// First of names in npz, or empty
+std::string find_name(const NpzFile& npz,
+                      std::initializer_list<const char*> names) {
+    for (const char* name : names) {
+        if (npz.contains(name)) return name;
+    }
+    return "";
+}
+
+// Open array name of npz into out if names has one; false only if it
+// exists but can't be read
+bool get_optional(const NpzFile& npz,
+                  std::initializer_list<const char*> names, NpyArray& out) {
+    const std::string name = find_name(npz, names);
+    return name.empty() || npz.get(name, out);
+}
+
+// Open path into out unless it is empty
+bool open_optional(const std::string& path, NpyArray& out) {
+    return path.empty() || out.open(path);
+}
+
+// Check that the (optional) per-vertex array a is (n, 3)
+bool check_per_vertex(const NpyArray& a, size_t n, const char* what) {
+    if (!a.is_open()) return true;
+    if (!a.check_cols(3)) return false;
+    if (a.rows() != n) {
+        std::cerr << "meshview: " << a.rows() << " " << what << " for " << n
+                  << " vertices\n";
+        return false;
+    }
+    return true;
+}
+
+// Mesh data and faces from vertex positions and the optional arrays
+// (those not open)
+bool mesh_arrays(const NpyArray& verts, const NpyArray& faces,
+                 const NpyArray& rgb, const NpyArray& normals,
+                 PointsRGBNormal& data, Triangles& triangles) {
+    if (!verts.check_cols(3)) return false;
+    const size_t n = verts.rows();
+    if (!check_per_vertex(rgb, n, "colors") ||
+        !check_per_vertex(normals, n, "normals")) {
+        return false;
+    }
+    if (faces.is_open()) {
+        if (!faces.to_triangles(triangles)) return false;
+        if (triangles.size() && triangles.maxCoeff() >= n) {
+            std::cerr << "meshview: face indices out of range for " << n
+                      << " vertices\n";
+            return false;
+        }
+    } else {
+        // As the Mesh constructors: vertices 0 1 2, 3 4 5, ...
+        if (n % 3) {
+            std::cerr << "meshview: without faces, the number of vertices ("
+                      << n << ") must be a multiple of 3\n";
+            return false;
+        }
+        triangles.resize(n / 3, 3);
+        for (Index i = 0; i < (Index)n; ++i) triangles.data()[i] = i;
+    }
+    data.resize(n, data.ColsAtCompileTime);
+    data.setZero();
+    verts.read(data.data(), data.cols());
+    if (rgb.is_open()) rgb.read(data.data() + 3, data.cols(), true);
+    if (normals.is_open()) normals.read(data.data() + 6, data.cols());
+    return true;
+}
+
+// Point cloud data from (N, 3) points and optional (N, 3) colors, or
+// (N, 6) points with colors
+bool point_cloud_arrays(const NpyArray& points, const NpyArray& rgb,
+                        PointsRGB& data) {
+    const size_t n = points.rows();
+    if (!rgb.is_open() && points.shape().size() == 2 && points.cols() == 6) {
+        data.resize(n, data.ColsAtCompileTime);
+        points.read(data.data(), data.cols());
+        return true;
+    }
+    if (!points.check_cols(3) || !check_per_vertex(rgb, n, "colors")) {
+        return false;
+    }
+    data.resize(n, data.ColsAtCompileTime);
+    points.read(data.data(), data.cols());
+    if (rgb.is_open()) {
+        rgb.read(data.data() + 3, data.cols(), true);
+    } else {
+        // Uncolored points are white
+        data.rightCols<3>().setOnes();
+    }
+    return true;
+}
+}  // namespace
+
+NpyArray::NpyArray() : _type(ScalarType::f32) {}
+NpyArray::~NpyArray() = default;
+
+bool NpyArray::open(const std::string& path) {
+    close();
+    auto file = std::make_shared<internal::MappedFile>();
+    if (!file->open(path)) return false;
+    if (!parse(file->data(), file->size(), path)) {
+        close();
+        return false;
+    }
+    _file = file;
+    return true;
+}
+
+void NpyArray::close() {
+    _file.reset();
+    _buffer.reset();
+    _name.clear();
+    _dtype.clear();
+    _shape.clear();
+    _fortran = _swap = false;
+    _data = nullptr;
+    _size = 0;
+}
+
+bool NpyArray::is_open() const { return _file || _buffer; }
+
+bool NpyArray::parse(const char* data, size_t size,
+                     const std::string& name) {
+    _name = name;
+    auto fail = [&](const std::string& msg) {
+        std::cerr << name << ": " << msg << "\n";
+        return false;
+    };
+    if (size < 10 || std::memcmp(data, NPY_MAGIC, sizeof(NPY_MAGIC))) {
+        return fail("not a .npy file");
+    }
+    // Version 1 has a 16-bit header length, 2 and 3 a 32-bit one
+    const int version = (uint8_t)data[6];
+    size_t offset = 10, header_size;
+    if (version == 1) {
+        header_size = load_le<uint16_t>(data + 8);
+    } else if ((version == 2 || version == 3) && size >= 12) {
+        header_size = load_le<uint32_t>(data + 8);
+        offset = 12;
+    } else {
+        return fail("unsupported .npy version " + std::to_string(version));
+    }
+    if (header_size > size - offset) return fail("truncated header");
+    const char* p = data + offset;
+    const char* end = p + header_size;
+
+    const char* value = find_value(p, end, "descr");
+    if (!value || (*value != '\'' && *value != '"')) {
+        return fail("unsupported dtype (structured arrays are not "
+                    "supported)");
+    }
+    const char* value_end = std::find(value + 1, end, *value);
+    if (value_end == end) return fail("invalid header");
+    _dtype.assign(value + 1, value_end);
+    if (!parse_dtype(_dtype, _type, _swap)) {
+        return fail("unsupported dtype " + _dtype);
+    }
+    value = find_value(p, end, "fortran_order");
+    if (!value) return fail("invalid header");
+    _fortran = end - value >= 4 && std::memcmp(value, "True", 4) == 0;
+    value = find_value(p, end, "shape");
+    if (!value || *value != '(') return fail("invalid header");
+    _shape.clear();
+    for (++value;;) {
+        while (value < end && (internal::is_blank(*value) || *value == ',')) {
+            ++value;
+        }
+        if (value < end && *value == ')') break;
+        int64_t dim;
+        if (!internal::parse_int(value, end, dim) || dim < 0) {
+            return fail("invalid shape");
+        }
+        // Python 2 long suffix
+        if (value < end && *value == 'L') ++value;
+        _shape.push_back((size_t)dim);
+    }
+    if (_fortran && _shape.size() > 2) {
+        return fail("Fortran order arrays of more than 2 dimensions are not "
+                    "supported");
+    }
+    size_t count = 1;
+    for (size_t dim : _shape) {
+        if (dim && count > SIZE_MAX / dim) return fail("invalid shape");
+        count *= dim;
+    }
+    const size_t item = internal::scalar_size(_type);
+    const size_t available = size - offset - header_size;
+    if (count > available / item) return fail("truncated data");
+    _data = end;
+    _size = count * item;
+    return true;
+}
+
+size_t NpyArray::rows() const { return _shape.empty() ? 1 : _shape[0]; }
+
+size_t NpyArray::cols() const {
+    size_t cols = 1;
+    for (size_t i = 1; i < _shape.size(); ++i) cols *= _shape[i];
+    return cols;
+}
+
+bool NpyArray::check_cols(size_t cols) const {
+    if (_shape.size() != 2 || _shape[1] != cols) {
+        std::cerr << _name << ": expected an (N, " << cols
+                  << ") array, got shape " << shape_string(_shape) << "\n";
+        return false;
+    }
+    return true;
+}
+
+Eigen::Map<const Points> NpyArray::points_view() const {
+    const bool in_place = _type == ScalarType::f32 && !_swap && !_fortran &&
+                          _shape.size() == 2 && _shape[1] == 3 &&
+                          (uintptr_t)_data % sizeof(float) == 0;
+    return Eigen::Map<const Points>(in_place ? (const float*)_data : nullptr,
+                                    in_place ? rows() : 0, 3);
+}
+
+Eigen::Map<const Triangles> NpyArray::triangles_view() const {
+    // Indices are never negative, so int32 has the bits of uint32
+    const bool in_place =
+        (_type == ScalarType::int32 || _type == ScalarType::uint32) &&
+        !_swap && !_fortran && _shape.size() == 2 && _shape[1] == 3 &&
+        (uintptr_t)_data % sizeof(Index) == 0;
+    return Eigen::Map<const Triangles>(
+        in_place ? (const Index*)_data : nullptr, in_place ? rows() : 0, 3);
+}
+
+Eigen::Map<const Matrix> NpyArray::matrix_view() const {
+    const bool in_place = _type == ScalarType::f32 && !_swap &&
+                          (!_fortran || _shape.size() < 2) &&
+                          (uintptr_t)_data % sizeof(float) == 0;
+    return Eigen::Map<const Matrix>(in_place ? (const float*)_data : nullptr,
+                                    in_place ? rows() : 0,
+                                    in_place ? cols() : 0);
+}
+
+template <class Out>
+void NpyArray::convert(Out* dst, size_t row_stride, float scale) const {
+    const size_t n_rows = rows(), n_cols = cols();
+    const size_t item = internal::scalar_size(_type);
+    if (!n_rows || !n_cols) return;
+    auto& pool = internal::ThreadPool::get();
+    if (!_fortran || _shape.size() < 2) {
+        if (row_stride == n_cols) {
+            // Contiguous on both sides: a single flat pass
+            pool.parallel_for(
+                0, n_rows * n_cols,
+                [&](size_t begin, size_t end) {
+                    internal::convert_strided(_type, _data + begin * item,
+                                              item, end - begin, dst + begin,
+                                              1, scale, _swap);
+                },
+                BLOCK_VALUES);
+            return;
+        }
+        pool.parallel_for(
+            0, n_rows,
+            [&](size_t begin, size_t end) {
+                for (size_t j = 0; j < n_cols; ++j) {
+                    internal::convert_strided(
+                        _type, _data + (begin * n_cols + j) * item,
+                        n_cols * item, end - begin,
+                        dst + begin * row_stride + j, row_stride, scale,
+                        _swap);
+                }
+            },
+            std::max<size_t>(BLOCK_VALUES / n_cols, 1));
+        return;
+    }
+    // Fortran order: each column is contiguous
+    pool.parallel_for(
+        0, n_rows,
+        [&](size_t begin, size_t end) {
+            for (size_t j = 0; j < n_cols; ++j) {
+                internal::convert_strided(
+                    _type, _data + (j * n_rows + begin) * item, item,
+                    end - begin, dst + begin * row_stride + j, row_stride,
+                    scale, _swap);
+            }
+        },
+        std::max<size_t>(BLOCK_VALUES / n_cols, 1));
+}
+
+void NpyArray::read(float* dst, size_t row_stride, bool normalize) const {
+    convert(dst, row_stride,
+            normalize ? internal::normalize_scale(_type) : 1.f);
+}
+
+bool NpyArray::read(Index* dst, size_t row_stride) const {
+    // Check first, as narrowing a negative, fractional or too large value
+    // to Index is undefined or could wrap into a valid index
+    const size_t item = internal::scalar_size(_type);
+    std::atomic<bool> ok(true);
+    internal::ThreadPool::get().parallel_for(
+        0, _size / item,
+        [&](size_t begin, size_t end) {
+            if (ok && !internal::fit_uint32(_type, _data + begin * item, item,
+                                            end - begin, _swap)) {
+                ok = false;
+            }
+        },
+        BLOCK_VALUES);
+    if (!ok) {
+        std::cerr << _name << ": indices must be integers in [0, 2^32)\n";
+        return false;
+    }
+    convert(dst, row_stride, 1.f);
+    return true;
+}
+
+bool NpyArray::to_points(Points& out) const {
+    if (!check_cols(3)) return false;
+    out.resize(rows(), 3);
+    read(out.data(), 3);
+    return true;
+}
+
+bool NpyArray::to_triangles(Triangles& out) const {
+    if (!check_cols(3)) return false;
+    out.resize(rows(), 3);
+    return read(out.data(), 3);
+}
+
+bool NpyArray::to_matrix(Matrix& out) const {
+    out.resize(rows(), cols());
+    read(out.data(), out.cols());
+    return true;
+}
+
+bool NpyArray::to_image(Image& out, int& channels) const {
+    if (_shape.size() == 2) {
+        channels = 1;
+    } else if (_shape.size() == 3 &&
+               (_shape[2] == 1 || _shape[2] == 3 || _shape[2] == 4)) {
+        channels = (int)_shape[2];
+    } else {
+        std::cerr << _name << ": expected an (H, W) or (H, W, 1/3/4) image, "
+                  << "got shape " << shape_string(_shape) << "\n";
+        return false;
+    }
+    out.resize(rows(), cols());
+    read(out.data(), out.cols(), true);
+    return true;
+}
+
+NpzFile::NpzFile() = default;
+NpzFile::~NpzFile() = default;
+
+bool NpzFile::open(const std::string& path) {
+    close();
+    auto file = std::make_shared<internal::MappedFile>();
+    if (!file->open(path, internal::MappedFile::Access::random)) {
+        return false;
+    }
+    auto fail = [&](const char* msg) {
+        std::cerr << path << ": " << msg << "\n";
+        _entries.clear();
+        return false;
+    };
+    const char* data = file->data();
+    const size_t size = file->size();
+    // The end of central directory record is followed by a comment of up
+    // to 64K
+    size_t eocd = size;
+    for (size_t i = size >= 22 ? size - 22 : 0; size >= 22; --i) {
+        if (load_le<uint32_t>(data + i) == ZIP_END) {
+            eocd = i;
+            break;
+        }
+        if (i == 0 || size - i > 22 + 0xFFFF) break;
+    }
+    if (eocd == size) return fail("not a zip (.npz) archive");
+    uint64_t n_entries = load_le<uint16_t>(data + eocd + 10);
+    uint64_t dir_size = load_le<uint32_t>(data + eocd + 12);
+    uint64_t dir_offset = load_le<uint32_t>(data + eocd + 16);
+    // Zip64 (np.savez writes it for large archives)
+    if (eocd >= 20 &&
+        load_le<uint32_t>(data + eocd - 20) == ZIP64_END_LOCATOR) {
+        const uint64_t end64 = load_le<uint64_t>(data + eocd - 20 + 8);
+        if (size < 56 || end64 > size - 56 ||
+            load_le<uint32_t>(data + end64) != ZIP64_END) {
+            return fail("invalid zip64 directory");
+        }
+        n_entries = load_le<uint64_t>(data + end64 + 32);
+        dir_size = load_le<uint64_t>(data + end64 + 40);
+        dir_offset = load_le<uint64_t>(data + end64 + 48);
+    }
+    if (dir_offset > size || dir_size > size - dir_offset) {
+        return fail("invalid central directory");
+    }
+    const char* p = data + dir_offset;
+    const char* end = p + dir_size;
+    for (uint64_t i = 0; i < n_entries; ++i) {
+        if (end - p < 46 || load_le<uint32_t>(p) != ZIP_CENTRAL_HEADER) {
+            return fail("invalid central directory");
+        }
+        const uint16_t flags = load_le<uint16_t>(p + 8);
+        const size_t name_size = load_le<uint16_t>(p + 28);
+        const size_t extra_size = load_le<uint16_t>(p + 30);
+        const size_t comment_size = load_le<uint16_t>(p + 32);
+        if ((size_t)(end - p) < 46 + name_size + extra_size + comment_size) {
+            return fail("invalid central directory");
+        }
+        if (flags & 1) return fail("encrypted archives are not supported");
+        Entry entry;
+        entry.name.assign(p + 46, name_size);
+        entry.method = load_le<uint16_t>(p + 10);
+        uint64_t compressed_size = load_le<uint32_t>(p + 20);
+        uint64_t entry_size = load_le<uint32_t>(p + 24);
+        uint64_t header_offset = load_le<uint32_t>(p + 42);
+        // Zip64 extra field: 64-bit values of the fields set to 0xFFFFFFFF
+        const char* extra = p + 46 + name_size;
+        const char* extra_end = extra + extra_size;
+        while (extra_end - extra >= 4) {
+            const uint16_t id = load_le<uint16_t>(extra);
+            const size_t len = load_le<uint16_t>(extra + 2);
+            if (len > (size_t)(extra_end - extra) - 4) break;
+            if (id == 1) {
+                const char* field = extra + 4;
+                for (uint64_t* value :
+                     {&entry_size, &compressed_size, &header_offset}) {
+                    if (*value == 0xFFFFFFFF && extra + 4 + len - field >= 8) {
+                        *value = load_le<uint64_t>(field);
+                        field += 8;
+                    }
+                }
+            }
+            extra += 4 + len;
+        }
+        entry.compressed_size = compressed_size;
+        entry.size = entry_size;
+        entry.header_offset = header_offset;
+        _entries.push_back(std::move(entry));
+        p += 46 + name_size + extra_size + comment_size;
+    }
+    _file = file;
+    _path = path;
+    return true;
+}
+
+void NpzFile::close() {
+    _file.reset();
+    _path.clear();
+    _entries.clear();
+}
+
+bool NpzFile::is_open() const { return (bool)_file; }
+
+std::vector<std::string> NpzFile::names() const {
+    std::vector<std::string> names;
+    for (const Entry& entry : _entries) {
+        const std::string& name = entry.name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".npy") == 0) {
+            names.push_back(name.substr(0, name.size() - 4));
+        }
+    }
+    return names;
+}
+
+bool NpzFile::contains(const std::string& name) const {
+    return find(name) != nullptr;
+}
+
+const NpzFile::Entry* NpzFile::find(const std::string& name) const {
+    const std::string file_name = name + ".npy";
+    for (const Entry& entry : _entries) {
+        if (entry.name == file_name || entry.name == name) return &entry;
+    }
+    return nullptr;
+}
+
+bool NpzFile::get(const std::string& name, NpyArray& out) const {
+    out.close();
+    const std::string member = _path + ":" + name;
+    auto fail = [&](const std::string& msg) {
+        std::cerr << member << ": " << msg << "\n";
+        out.close();
+        return false;
+    };
+    const Entry* entry = find(name);
+    if (!entry) return fail("no such array");
+    const char* data = _file->data();
+    const size_t size = _file->size();
+    const size_t offset = entry->header_offset;
+    if (size < 30 || offset > size - 30 ||
+        load_le<uint32_t>(data + offset) != ZIP_LOCAL_HEADER) {
+        return fail("invalid local header");
+    }
+    const size_t start = offset + 30 + load_le<uint16_t>(data + offset + 26) +
+                         load_le<uint16_t>(data + offset + 28);
+    if (start > size || entry->compressed_size > size - start) {
+        return fail("truncated archive");
+    }
+    const char* src = data + start;
+    if (entry->method == 0) {
+        // Stored: use the array in place
+        if (!out.parse(src, entry->compressed_size, member)) {
+            out.close();
+            return false;
+        }
+        out._file = _file;
+        return true;
+    }
+    if (entry->method != 8) {
+        return fail("unsupported compression method " +
+                    std::to_string(entry->method));
+    }
+#ifdef MESHVIEW_ZLIB
+    // Deflate expands at most 1032:1, so a larger stated size is corrupt
+    // (and must not be allocated)
+    if (entry->size / 1032 > entry->compressed_size) {
+        return fail("uncompressed size too large for its data");
+    }
+    auto buffer = std::make_shared<std::vector<char>>(entry->size);
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // Raw deflate data, without a zlib header
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return fail("inflate failed");
+    }
+    const char* in = src;
+    char* dst = buffer->data();
+    size_t in_left = entry->compressed_size, out_left = entry->size;
+    int ret;
+    do {
+        // zlib counts in 32 bits
+        const uInt in_chunk = (uInt)std::min<size_t>(in_left, UINT_MAX);
+        const uInt out_chunk = (uInt)std::min<size_t>(out_left, UINT_MAX);
+        stream.next_in = (Bytef*)in;
+        stream.avail_in = in_chunk;
+        stream.next_out = (Bytef*)dst;
+        stream.avail_out = out_chunk;
+        ret = inflate(&stream, Z_NO_FLUSH);
+        in += in_chunk - stream.avail_in;
+        in_left -= in_chunk - stream.avail_in;
+        dst += out_chunk - stream.avail_out;
+        out_left -= out_chunk - stream.avail_out;
+    } while (ret == Z_OK);
+    inflateEnd(&stream);
+    if (ret != Z_STREAM_END || out_left) return fail("corrupt data");
+    if (!out.parse(buffer->data(), buffer->size(), member)) {
+        out.close();
+        return false;
+    }
+    out._buffer = buffer;
+    return true;
+#else
+    return fail(
+        "compressed arrays (np.savez_compressed) need meshview built "
+        "with zlib");
+#endif
+}
+
+bool Mesh::load_npz(const std::string& path) {
+    NpzFile npz;
+    if (!npz.open(path)) return false;
+    const std::string verts_name = find_name(npz, POSITION_NAMES);
+    if (verts_name.empty()) {
+        std::cerr << path << ": no vertex array (verts, vertices, v, "
+                             "points, positions or xyz)\n";
+        return false;
+    }
+    NpyArray verts, tris, rgb, normals;
+    if (!npz.get(verts_name, verts) || !get_optional(npz, FACE_NAMES, tris) ||
+        !get_optional(npz, RGB_NAMES, rgb) ||
+        !get_optional(npz, NORMAL_NAMES, normals)) {
+        return false;
+    }
+    PointsRGBNormal new_data;
+    Triangles new_faces;
+    if (!mesh_arrays(verts, tris, rgb, normals, new_data, new_faces)) {
+        return false;
+    }
+    data.swap(new_data);
+    faces.swap(new_faces);
+    unset_tex_coords();
+    // As load_basic_obj: uncolored meshes use the textures (white if none)
+    shading_type =
+        rgb.is_open() ? ShadingType::vertex : ShadingType::texture;
+    _auto_normals = !normals.is_open();
+    return true;
+}
+
+bool Mesh::load_npy(const std::string& verts_path,
+                    const std::string& faces_path,
+                    const std::string& rgb_path) {
+    NpyArray verts, tris, rgb;
+    if (!verts.open(verts_path) || !open_optional(faces_path, tris) ||
+        !open_optional(rgb_path, rgb)) {
+        return false;
+    }
+    PointsRGBNormal new_data;
+    Triangles new_faces;
+    if (!mesh_arrays(verts, tris, rgb, NpyArray(), new_data, new_faces)) {
+        return false;
+    }
+    data.swap(new_data);
+    faces.swap(new_faces);
+    unset_tex_coords();
+    shading_type =
+        rgb.is_open() ? ShadingType::vertex : ShadingType::texture;
+    _auto_normals = true;
+    return true;
+}
+
+bool PointCloud::load_npz(const std::string& path) {
+    NpzFile npz;
+    if (!npz.open(path)) return false;
+    const std::string points_name = find_name(npz, POSITION_NAMES);
+    if (points_name.empty()) {
+        std::cerr << path << ": no point array (points, verts, vertices, v, "
+                             "positions or xyz)\n";
+        return false;
+    }
+    NpyArray points, rgb;
+    if (!npz.get(points_name, points) || !get_optional(npz, RGB_NAMES, rgb)) {
+        return false;
+    }
+    PointsRGB new_data;
+    if (!point_cloud_arrays(points, rgb, new_data)) return false;
+    data.swap(new_data);
+    return true;
+}
+
+bool PointCloud::load_npy(const std::string& points_path,
+                          const std::string& rgb_path) {
+    NpyArray points, rgb;
+    if (!points.open(points_path) || !open_optional(rgb_path, rgb)) {
+        return false;
+    }
+    PointsRGB new_data;
+    if (!point_cloud_arrays(points, rgb, new_data)) return false;
+    data.swap(new_data);
+    return true;
+}
+
+}  // namespace meshview
@@ -0,0 +1,548 @@
+#include "meshview/meshview.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+
+#include "meshview/internal/mapped_file.hpp"
+#include "meshview/internal/parse.hpp"
+#include "meshview/internal/thread_pool.hpp"
+
+namespace meshview {
+namespace {
+
+const Index NONE = (Index)-1;
+// A corner index referring to no element (0, or relative to before the
+// first): out of range, so that it is counted as bad rather than absent
+const Index BAD = (Index)-2;
+
+// Element kinds indexed by face corners
+enum { ATTR_POS, ATTR_UV, ATTR_NORMAL, ATTR_COUNT };
+
+// The part of an MTL material meshview can show
+struct ObjMaterial {
+    Vector3f diffuse = Vector3f(1.f, 1.f, 1.f);
+    Vector3f specular = Vector3f::Zero();
+    bool has_specular = false;
+    // Ns; <= 0 if not given
+    float shininess = 0.f;
+    // Resolved texture paths (map_Kd, map_Ks), empty if none
+    std::string diffuse_map, specular_map;
+};
+
+// A line-aligned chunk of an OBJ file and its parsed contents
+struct ObjChunk {
+    const char* begin;
+    const char* end;
+    // v positions, rgb of v lines which have it, vt and vn
+    std::vector<float> pos, rgb, uv, normals;
+    // (v, vt, vn) of each triangle corner, 0-based; NONE if absent
+    std::vector<Index> corners;
+    // Positions in corners of negative (relative) indices, per attribute;
+    // stored relative to the chunk's first element until merged
+    std::vector<size_t> relative[ATTR_COUNT];
+    // usemtl lines: (first triangle after it, within the chunk; name)
+    std::vector<std::pair<size_t, std::string>> usemtl;
+    std::vector<std::string> mtllib;
+    // Number of v, vt, vn lines, and of v lines with rgb
+    size_t count[ATTR_COUNT] = {0, 0, 0};
+    size_t n_rgb = 0;
+    // First v, vt, vn and triangle of the chunk (prefix sums)
+    size_t offset[ATTR_COUNT] = {0, 0, 0};
+    size_t triangle_offset = 0;
+};
+
+// Whether the token [p, end) is keyword
+bool token_is(const char* p, const char* end, const char* keyword) {
+    const size_t len = std::strlen(keyword);
+    return (size_t)(end - p) == len && std::memcmp(p, keyword, len) == 0;
+}
+
+// The rest of a line, without surrounding blanks
+std::string rest_of_line(const char* p, const char* end) {
+    internal::skip_blanks(p, end);
+    while (end > p && internal::is_blank(end[-1])) --end;
+    return std::string(p, end);
+}
+
+// Parse up to max_count floats into out, returning how many were read
+size_t parse_floats(const char*& p, const char* end, float* out,
+                    size_t max_count) {
+    size_t cnt = 0;
+    for (float value;; ++cnt) {
+        internal::skip_blanks(p, end);
+        if (!internal::parse_float(p, end, value)) break;
+        if (cnt < max_count) out[cnt] = value;
+    }
+    return cnt;
+}
+
+// Parse a face corner v[/[vt][/vn]] into corner; false if it has no v
+bool parse_corner(const char*& p, const char* end, ObjChunk& chunk,
+                  Index* corner, bool* relative) {
+    int64_t index[ATTR_COUNT];
+    bool given[ATTR_COUNT] = {false, false, false};
+    given[ATTR_POS] = internal::parse_int(p, end, index[ATTR_POS]);
+    if (!given[ATTR_POS]) return false;
+    for (int attr = ATTR_UV; attr < ATTR_COUNT && p < end && *p == '/';
+         ++attr) {
+        ++p;
+        given[attr] = internal::parse_int(p, end, index[attr]);
+    }
+    internal::skip_token(p, end);
+    for (int attr = 0; attr < ATTR_COUNT; ++attr) {
+        relative[attr] = given[attr] && index[attr] < 0;
+        if (!given[attr]) {
+            corner[attr] = NONE;
+        } else if (relative[attr]) {
+            corner[attr] = (Index)((int64_t)chunk.count[attr] + index[attr]);
+        } else {
+            corner[attr] = index[attr] > 0 ? (Index)(index[attr] - 1) : BAD;
+        }
+    }
+    return true;
+}
+
+void parse_obj_chunk(ObjChunk& chunk) {
+    for (const char* line = chunk.begin; line < chunk.end;) {
+        const char* line_end = internal::find_line_end(line, chunk.end);
+        const char* p = line;
+        line = line_end + 1;
+        internal::skip_blanks(p, line_end);
+        const char* keyword = p;
+        internal::skip_token(p, line_end);
+        const char* keyword_end = p;
+        if (keyword == keyword_end) continue;
+        if (token_is(keyword, keyword_end, "v")) {
+            float attrs[6] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+            if (parse_floats(p, line_end, attrs, 6) >= 6) {
+                chunk.rgb.insert(chunk.rgb.end(), attrs + 3, attrs + 6);
+                ++chunk.n_rgb;
+            }
+            chunk.pos.insert(chunk.pos.end(), attrs, attrs + 3);
+            ++chunk.count[ATTR_POS];
+        } else if (token_is(keyword, keyword_end, "vt")) {
+            float attrs[2] = {0.f, 0.f};
+            parse_floats(p, line_end, attrs, 2);
+            chunk.uv.insert(chunk.uv.end(), attrs, attrs + 2);
+            ++chunk.count[ATTR_UV];
+        } else if (token_is(keyword, keyword_end, "vn")) {
+            float attrs[3] = {0.f, 0.f, 0.f};
+            parse_floats(p, line_end, attrs, 3);
+            chunk.normals.insert(chunk.normals.end(), attrs, attrs + 3);
+            ++chunk.count[ATTR_NORMAL];
+        } else if (token_is(keyword, keyword_end, "f")) {
+            // Triangle fan: the first corner and the latest two
+            Index corners[3][ATTR_COUNT];
+            bool relative[3][ATTR_COUNT];
+            for (size_t corner = 0;; ++corner) {
+                internal::skip_blanks(p, line_end);
+                const size_t k = std::min<size_t>(corner, 2);
+                if (k == 2 && corner > 2) {
+                    std::copy(corners[2], corners[2] + ATTR_COUNT, corners[1]);
+                    std::copy(relative[2], relative[2] + ATTR_COUNT,
+                              relative[1]);
+                }
+                if (!parse_corner(p, line_end, chunk, corners[k],
+                                  relative[k])) {
+                    break;
+                }
+                if (k < 2) continue;
+                for (int j = 0; j < 3; ++j) {
+                    for (int attr = 0; attr < ATTR_COUNT; ++attr) {
+                        if (relative[j][attr]) {
+                            chunk.relative[attr].push_back(
+                                chunk.corners.size());
+                        }
+                        chunk.corners.push_back(corners[j][attr]);
+                    }
+                }
+            }
+        } else if (token_is(keyword, keyword_end, "usemtl")) {
+            chunk.usemtl.emplace_back(chunk.corners.size() / 9,
+                                      rest_of_line(p, line_end));
+        } else if (token_is(keyword, keyword_end, "mtllib")) {
+            chunk.mtllib.push_back(rest_of_line(p, line_end));
+        }
+    }
+}
+
+// Directory part of path, including the final separator
+std::string dir_name(const std::string& path) {
+    const size_t sep = path.find_last_of("/\\");
+    return sep == std::string::npos ? "" : path.substr(0, sep + 1);
+}
+
+// Path of a file referenced from a file in directory dir
+std::string resolve_path(const std::string& dir, std::string name) {
+#ifndef _WIN32
+    std::replace(name.begin(), name.end(), '\\', '/');
+#endif
+    const bool absolute = !name.empty() && (name[0] == '/' || name[0] == '\\' ||
+                                            (name.size() > 1 && name[1] == ':'));
+    return absolute ? name : dir + name;
+}
+
+// File name of a map_* statement, after any options (-name args)
+std::string map_file_name(const char* p, const char* end) {
+    internal::skip_blanks(p, end);
+    while (p < end && *p == '-') {
+        internal::skip_token(p, end);
+        internal::skip_blanks(p, end);
+        // Option arguments: numbers, or on/off
+        while (p < end) {
+            const char* arg = p;
+            internal::skip_token(arg, end);
+            const char* q = p;
+            double value;
+            if ((internal::parse_double(q, end, value) && q == arg) ||
+                token_is(p, arg, "on") || token_is(p, arg, "off")) {
+                p = arg;
+                internal::skip_blanks(p, end);
+            } else {
+                break;
+            }
+        }
+    }
+    return rest_of_line(p, end);
+}
+
+// Add the materials of an MTL file to materials; false if it can't be read
+bool load_mtl(const std::string& path,
+              std::unordered_map<std::string, ObjMaterial>& materials) {
+    std::ifstream ifs(path);
+    if (!ifs) return false;
+    const std::string dir = dir_name(path);
+    ObjMaterial* material = nullptr;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        const char* p = line.data();
+        const char* end = p + line.size();
+        internal::skip_blanks(p, end);
+        const char* keyword = p;
+        internal::skip_token(p, end);
+        const char* keyword_end = p;
+        if (token_is(keyword, keyword_end, "newmtl")) {
+            material = &materials[rest_of_line(p, end)];
+            *material = ObjMaterial();
+        } else if (material == nullptr) {
+            continue;
+        } else if (token_is(keyword, keyword_end, "Kd")) {
+            parse_floats(p, end, material->diffuse.data(), 3);
+        } else if (token_is(keyword, keyword_end, "Ks")) {
+            material->has_specular =
+                parse_floats(p, end, material->specular.data(), 3) > 0;
+        } else if (token_is(keyword, keyword_end, "Ns")) {
+            parse_floats(p, end, &material->shininess, 1);
+        } else if (token_is(keyword, keyword_end, "map_Kd")) {
+            material->diffuse_map = resolve_path(dir, map_file_name(p, end));
+        } else if (token_is(keyword, keyword_end, "map_Ks")) {
+            material->specular_map = resolve_path(dir, map_file_name(p, end));
+        }
+    }
+    return true;
+}
+
+// All geometry of an OBJ file, merged from the chunks
+struct ObjData {
+    std::vector<float> pos, rgb, uv, normals;
+    std::vector<Index> corners;
+    size_t count[ATTR_COUNT] = {0, 0, 0};
+};
+
+// Build the mesh of the triangles in ranges ([begin, end) triangle index
+// pairs), with one vertex per distinct (v, vt, vn) corner. Triangles with
+// out-of-range v are skipped and out-of-range vt/vn ignored, counting both
+// in bad_refs.
+std::unique_ptr<Mesh> build_submesh(
+    const ObjData& obj, const std::vector<std::pair<size_t, size_t>>& ranges,
+    const ObjMaterial& material, bool textured, size_t& bad_refs) {
+    // Corners seen so far, as chains of local vertices per v
+    std::vector<Index> head(obj.count[ATTR_POS], NONE);
+    std::vector<Index> next, src[ATTR_COUNT];
+    std::vector<Index> faces;
+    bool all_normals = true, any_uv = false;
+    for (auto& range : ranges) {
+        for (size_t t = range.first; t < range.second; ++t) {
+            Index tri[9];
+            bool valid = true;
+            for (int j = 0; j < 9; ++j) {
+                const int attr = j % ATTR_COUNT;
+                tri[j] = obj.corners[t * 9 + j];
+                if (tri[j] >= obj.count[attr] && tri[j] != NONE) {
+                    ++bad_refs;
+                    tri[j] = NONE;
+                }
+                valid &= attr != ATTR_POS || tri[j] != NONE;
+            }
+            if (!valid) continue;
+            for (int j = 0; j < 3; ++j) {
+                const Index* corner = tri + j * ATTR_COUNT;
+                all_normals &= corner[ATTR_NORMAL] != NONE;
+                any_uv |= corner[ATTR_UV] != NONE;
+                Index id = head[corner[ATTR_POS]];
+                while (id != NONE && (src[ATTR_UV][id] != corner[ATTR_UV] ||
+                                      src[ATTR_NORMAL][id] !=
+                                          corner[ATTR_NORMAL])) {
+                    id = next[id];
+                }
+                if (id == NONE) {
+                    id = (Index)next.size();
+                    for (int attr = 0; attr < ATTR_COUNT; ++attr) {
+                        src[attr].push_back(corner[attr]);
+                    }
+                    next.push_back(head[corner[ATTR_POS]]);
+                    head[corner[ATTR_POS]] = id;
+                }
+                faces.push_back(id);
+            }
+        }
+    }
+
+    const size_t n_verts = next.size(), n_faces = faces.size() / 3;
+    auto mesh = std::make_unique<Mesh>(n_verts, n_faces);
+    if (n_faces) {
+        mesh->faces = Eigen::Map<const Triangles>(faces.data(), n_faces, 3);
+    }
+    const bool has_rgb = !obj.rgb.empty();
+    for (size_t i = 0; i < n_verts; ++i) {
+        const size_t v = src[ATTR_POS][i];
+        mesh->data.block<1, 3>(i, 0) =
+            Eigen::Map<const Eigen::RowVector3f>(&obj.pos[v * 3]);
+        if (has_rgb) {
+            mesh->data.block<1, 3>(i, 3) =
+                Eigen::Map<const Eigen::RowVector3f>(&obj.rgb[v * 3]);
+        } else {
+            mesh->data.block<1, 3>(i, 3) = material.diffuse.transpose();
+        }
+        mesh->data.block<1, 3>(i, 6).setZero();
+    }
+    if (all_normals && n_faces) {
+        auto normals = mesh->verts_norm();
+        for (size_t i = 0; i < n_verts; ++i) {
+            normals.row(i) = Eigen::Map<const Eigen::RowVector3f>(
+                &obj.normals[src[ATTR_NORMAL][i] * 3]);
+        }
+    }
+    if (textured && any_uv) {
+        Points2D coords(n_verts, 2);
+        for (size_t i = 0; i < n_verts; ++i) {
+            const Index vt = src[ATTR_UV][i];
+            if (vt == NONE) {
+                coords.row(i).setZero();
+            } else {
+                coords.row(i) =
+                    Eigen::Map<const Eigen::RowVector2f>(&obj.uv[vt * 2]);
+            }
+        }
+        mesh->set_tex_coords(coords, mesh->faces);
+    }
+    if (material.shininess > 0.f) mesh->set_shininess(material.shininess);
+    return mesh;
+}
+
+}  // namespace
+
+std::vector<std::unique_ptr<Mesh>> Mesh::load_obj(const std::string& path) {
+    std::vector<std::unique_ptr<Mesh>> result;
+    internal::MappedFile file(path);
+    if (!file.valid()) return result;
+
+    // Parse line-aligned chunks in parallel
+    auto& pool = internal::ThreadPool::get();
+    const size_t n_chunks = file.size() < (1 << 16) ? 1 : pool.size() * 4;
+    std::vector<ObjChunk> chunks(n_chunks);
+    const auto ranges =
+        internal::split_lines(file.data(), file.size(), n_chunks);
+    for (size_t i = 0; i < n_chunks; ++i) {
+        chunks[i].begin = ranges[i].first;
+        chunks[i].end = ranges[i].second;
+    }
+    pool.parallel_for(
+        0, n_chunks,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) parse_obj_chunk(chunks[i]);
+        },
+        1);
+
+    // Place chunks with prefix sums and merge them in parallel, resolving
+    // relative indices
+    ObjData obj;
+    size_t n_triangles = 0, n_rgb = 0;
+    for (auto& chunk : chunks) {
+        for (int attr = 0; attr < ATTR_COUNT; ++attr) {
+            chunk.offset[attr] = obj.count[attr];
+            obj.count[attr] += chunk.count[attr];
+        }
+        chunk.triangle_offset = n_triangles;
+        n_triangles += chunk.corners.size() / 9;
+        n_rgb += chunk.n_rgb;
+    }
+    // Vertex colors only if every v line has them
+    const bool has_rgb = n_rgb > 0 && n_rgb == obj.count[ATTR_POS];
+    obj.pos.resize(obj.count[ATTR_POS] * 3);
+    obj.rgb.resize(has_rgb ? obj.count[ATTR_POS] * 3 : 0);
+    obj.uv.resize(obj.count[ATTR_UV] * 2);
+    obj.normals.resize(obj.count[ATTR_NORMAL] * 3);
+    obj.corners.resize(n_triangles * 9);
+    pool.parallel_for(
+        0, n_chunks,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                ObjChunk& chunk = chunks[i];
+                std::copy(chunk.pos.begin(), chunk.pos.end(),
+                          obj.pos.begin() + chunk.offset[ATTR_POS] * 3);
+                if (has_rgb) {
+                    std::copy(chunk.rgb.begin(), chunk.rgb.end(),
+                              obj.rgb.begin() + chunk.offset[ATTR_POS] * 3);
+                }
+                std::copy(chunk.uv.begin(), chunk.uv.end(),
+                          obj.uv.begin() + chunk.offset[ATTR_UV] * 2);
+                std::copy(chunk.normals.begin(), chunk.normals.end(),
+                          obj.normals.begin() + chunk.offset[ATTR_NORMAL] * 3);
+                for (int attr = 0; attr < ATTR_COUNT; ++attr) {
+                    for (size_t pos : chunk.relative[attr]) {
+                        const int64_t index =
+                            (int32_t)chunk.corners[pos] +
+                            (int64_t)chunk.offset[attr];
+                        chunk.corners[pos] = index >= 0 ? (Index)index : BAD;
+                    }
+                }
+                std::copy(chunk.corners.begin(), chunk.corners.end(),
+                          obj.corners.begin() + chunk.triangle_offset * 9);
+                // Free as we go
+                chunk.pos = chunk.rgb = chunk.uv = chunk.normals =
+                    std::vector<float>();
+                chunk.corners = std::vector<Index>();
+            }
+        },
+        1);
+
+    // Triangle ranges of each material, in order of first use
+    std::vector<std::string> material_names;
+    std::vector<std::vector<std::pair<size_t, size_t>>> material_ranges;
+    {
+        std::unordered_map<std::string, size_t> material_ids;
+        std::string current;
+        size_t run_begin = 0;
+        auto end_run = [&](size_t run_end) {
+            if (run_end <= run_begin) return;
+            auto it = material_ids.find(current);
+            if (it == material_ids.end()) {
+                it = material_ids.emplace(current, material_names.size())
+                         .first;
+                material_names.push_back(current);
+                material_ranges.emplace_back();
+            }
+            material_ranges[it->second].emplace_back(run_begin, run_end);
+            run_begin = run_end;
+        };
+        for (auto& chunk : chunks) {
+            for (auto& usemtl : chunk.usemtl) {
+                end_run(chunk.triangle_offset + usemtl.first);
+                current = usemtl.second;
+                run_begin = chunk.triangle_offset + usemtl.first;
+            }
+        }
+        end_run(n_triangles);
+    }
+
+    // Materials, from every mtllib (relative to the OBJ file)
+    std::unordered_map<std::string, ObjMaterial> materials;
+    const std::string dir = dir_name(path);
+    for (auto& chunk : chunks) {
+        for (auto& name : chunk.mtllib) {
+            if (load_mtl(resolve_path(dir, name), materials)) continue;
+            // Several files separated by blanks
+            bool found = false;
+            for (const char* p = name.data(); p < name.data() + name.size();) {
+                const char* end = name.data() + name.size();
+                internal::skip_blanks(p, end);
+                const char* token = p;
+                internal::skip_token(p, end);
+                if (p > token) {
+                    found |= load_mtl(
+                        resolve_path(dir, std::string(token, p)), materials);
+                }
+            }
+            if (!found) {
+                std::cerr << "Failed to open material library " << name
+                          << "\n";
+            }
+        }
+    }
+    std::vector<ObjMaterial> used(material_names.size());
+    for (size_t i = 0; i < material_names.size(); ++i) {
+        auto it = materials.find(material_names[i]);
+        if (it != materials.end()) used[i] = it->second;
+    }
+
+    // Start decoding every distinct texture image in the background
+    std::vector<std::string> image_paths;
+    for (auto& material : used) {
+        for (auto* map : {&material.diffuse_map, &material.specular_map}) {
+            if (!map->empty() && std::find(image_paths.begin(),
+                                           image_paths.end(),
+                                           *map) == image_paths.end()) {
+                image_paths.push_back(*map);
+            }
+        }
+    }
+    std::vector<Texture> images;
+    images.reserve(image_paths.size());
+    for (auto& image_path : image_paths) images.emplace_back(image_path);
+    std::vector<std::future<bool>> decoded;
+    for (auto& image : images) {
+        decoded.push_back(pool.submit([&image]() { return image.preload(); }));
+    }
+
+    // Meanwhile build one mesh per material
+    result.resize(material_names.size());
+    std::vector<size_t> bad_refs(material_names.size(), 0);
+    pool.parallel_for(
+        0, material_names.size(),
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                result[i] =
+                    build_submesh(obj, material_ranges[i], used[i],
+                                  !used[i].diffuse_map.empty(),
+                                  bad_refs[i]);
+            }
+        },
+        1);
+    size_t n_bad = 0;
+    for (size_t count : bad_refs) n_bad += count;
+    if (n_bad) {
+        std::cerr << path << ": ignored " << n_bad
+                  << " out-of-range indices (faces with one in v skipped)\n";
+    }
+
+    // Attach textures (copies share the decoded pixels)
+    for (auto& future : decoded) future.get();
+    auto image_of = [&](const std::string& map) -> const Texture& {
+        return images[std::find(image_paths.begin(), image_paths.end(), map) -
+                      image_paths.begin()];
+    };
+    for (size_t i = 0; i < result.size(); ++i) {
+        Mesh& mesh = *result[i];
+        const ObjMaterial& material = used[i];
+        if (mesh.shading_type != ShadingType::texture) continue;
+        mesh.textures[Texture::TYPE_DIFFUSE].push_back(
+            image_of(material.diffuse_map));
+        if (!material.specular_map.empty()) {
+            mesh.textures[Texture::TYPE_SPECULAR].push_back(
+                image_of(material.specular_map));
+        } else if (material.has_specular) {
+            mesh.add_texture<Texture::TYPE_SPECULAR>(material.specular[0],
+                                                     material.specular[1],
+                                                     material.specular[2]);
+        }
+    }
+    return result;
+}
+
+}  // namespace meshview
@@ -0,0 +1,726 @@
+#include "meshview/meshview.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <Eigen/Geometry>
+
+#include "meshview/internal/binary.hpp"
+#include "meshview/internal/format.hpp"
+#include "meshview/internal/mapped_file.hpp"
+#include "meshview/internal/parse.hpp"
+#include "meshview/internal/thread_pool.hpp"
+
+namespace meshview {
+namespace {
+
+// Rows converted per task
+const size_t BLOCK_ROWS = 1 << 16;
+
+enum class PlyFormat { ascii, binary_le, binary_be };
+
+using internal::ScalarType;
+using internal::convert_strided;
+using internal::host_is_big_endian;
+using internal::load_value;
+using internal::normalize_scale;
+using internal::scalar_size;
+
+bool parse_type(const std::string& name, ScalarType& type) {
+    static const struct {
+        const char* name;
+        ScalarType type;
+    } names[] = {
+        {"char", ScalarType::int8}, {"int8", ScalarType::int8},
+        {"uchar", ScalarType::uint8}, {"uint8", ScalarType::uint8},
+        {"short", ScalarType::int16}, {"int16", ScalarType::int16},
+        {"ushort", ScalarType::uint16}, {"uint16", ScalarType::uint16},
+        {"int", ScalarType::int32}, {"int32", ScalarType::int32},
+        {"uint", ScalarType::uint32}, {"uint32", ScalarType::uint32},
+        {"float", ScalarType::f32}, {"float32", ScalarType::f32},
+        {"double", ScalarType::f64}, {"float64", ScalarType::f64}};
+    for (auto& entry : names) {
+        if (name == entry.name) {
+            type = entry.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct PlyProperty {
+    std::string name;
+    ScalarType type;
+    // List property: a count of count_type, then that many values of type
+    bool is_list = false;
+    ScalarType count_type;
+    // Byte offset within the element (fixed-size binary elements only)
+    size_t offset = 0;
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> props;
+    // Bytes per element in binary files; 0 if it has list properties
+    size_t stride = 0;
+    // Start of the element's data in binary files
+    const char* data = nullptr;
+
+    // Index of the first property named one of names, or -1
+    int find(std::initializer_list<const char*> names) const {
+        for (const char* name : names) {
+            for (size_t i = 0; i < props.size(); ++i) {
+                if (props[i].name == name) return (int)i;
+            }
+        }
+        return -1;
+    }
+};
+
+// Vertex attributes read into float rows
+struct PlyVertexLayout {
+    // Row-major destination with row_size floats per vertex
+    float* rows;
+    size_t row_size;
+    // Columns of rgb and normals in a row, or -1 to ignore
+    int rgb_col, normal_col;
+};
+
+// A memory-mapped PLY file: parses the header and reads the vertex and
+// face elements straight from the mapping
+class PlyReader {
+   public:
+    // Map and parse the header of path, locating the elements; prints an
+    // error and returns false if the file can't be read
+    bool open(const std::string& path);
+
+    size_t num_verts() const {
+        return _vertex >= 0 ? _elements[_vertex].count : 0;
+    }
+    bool has_rgb() const {
+        return _rgb[0] >= 0 && _rgb[1] >= 0 && _rgb[2] >= 0;
+    }
+    bool has_normals() const {
+        return _normal[0] >= 0 && _normal[1] >= 0 && _normal[2] >= 0;
+    }
+
+    // Fill positions (and rgb/normals if present and wanted) of every
+    // vertex; other columns are left untouched
+    bool read_vertices(const PlyVertexLayout& layout);
+
+    // Read faces as triangles (polygons as fans), skipping those with
+    // out-of-range indices
+    bool read_faces(std::vector<Index>& triangles);
+
+   private:
+    // Error about the file, for returning false
+    bool fail(const std::string& message) const {
+        std::cerr << _path << ": " << message << "\n";
+        return false;
+    }
+    bool parse_header();
+    // Locate the elements of a binary body
+    bool locate_binary();
+    // Skip an element of a binary body with list properties at p; false if
+    // it runs past the end
+    bool skip_binary_element(const PlyElement& elem, const char*& p) const;
+    // Parse the vertex/face elements of an ASCII body
+    bool read_ascii(const PlyVertexLayout* layout,
+                    std::vector<Index>* triangles);
+
+    // Add the fan triangles of a face with n corners (read by index(i))
+    template <class IndexFn>
+    void add_face(size_t n, IndexFn index, std::vector<Index>& triangles) {
+        const size_t n_verts = num_verts();
+        for (size_t i = 0; i < n; ++i) {
+            if (index(i) < 0 || (size_t)index(i) >= n_verts) {
+                ++_bad_faces;
+                return;
+            }
+        }
+        for (size_t i = 2; i < n; ++i) {
+            triangles.push_back((Index)index(0));
+            triangles.push_back((Index)index(i - 1));
+            triangles.push_back((Index)index(i));
+        }
+    }
+
+    std::string _path;
+    internal::MappedFile _file;
+    PlyFormat _format;
+    bool _swap = false;
+    std::vector<PlyElement> _elements;
+    const char* _body = nullptr;
+    int _vertex = -1, _face = -1;
+    // Property indices in the vertex element (-1 if absent)
+    int _pos[3], _rgb[3], _normal[3];
+    // Vertex index list property of the face element (-1 if absent)
+    int _indices = -1;
+    size_t _bad_faces = 0;
+};
+
+bool PlyReader::open(const std::string& path) {
+    _path = path;
+    if (!_file.open(path)) return false;
+    if (!parse_header()) return false;
+    if (_format != PlyFormat::ascii && !locate_binary()) return false;
+    return true;
+}
+
+bool PlyReader::parse_header() {
+    const char* p = _file.data();
+    const char* end = p + _file.size();
+    bool first = true, has_format = false;
+    PlyElement* elem = nullptr;
+    while (p < end) {
+        const char* line_end = internal::find_line_end(p, end);
+        std::vector<std::string> tokens;
+        for (const char* q = p; q < line_end;) {
+            internal::skip_blanks(q, line_end);
+            const char* token = q;
+            internal::skip_token(q, line_end);
+            if (q > token) tokens.emplace_back(token, q);
+        }
+        p = line_end < end ? line_end + 1 : end;
+        if (first) {
+            if (tokens.size() != 1 || tokens[0] != "ply") {
+                return fail("not a PLY file");
+            }
+            first = false;
+            continue;
+        }
+        if (tokens.empty() || tokens[0] == "comment" ||
+            tokens[0] == "obj_info") {
+            continue;
+        }
+        if (tokens[0] == "end_header") {
+            _body = p;
+            break;
+        }
+        if (tokens[0] == "format" && tokens.size() >= 2) {
+            if (tokens[1] == "ascii") {
+                _format = PlyFormat::ascii;
+            } else if (tokens[1] == "binary_little_endian") {
+                _format = PlyFormat::binary_le;
+            } else if (tokens[1] == "binary_big_endian") {
+                _format = PlyFormat::binary_be;
+            } else {
+                return fail("unknown format " + tokens[1]);
+            }
+            has_format = true;
+        } else if (tokens[0] == "element" && tokens.size() == 3) {
+            _elements.emplace_back();
+            elem = &_elements.back();
+            elem->name = tokens[1];
+            elem->count = std::strtoull(tokens[2].c_str(), nullptr, 10);
+        } else if (tokens[0] == "property" && elem != nullptr) {
+            PlyProperty prop;
+            bool ok;
+            if (tokens.size() == 5 && tokens[1] == "list") {
+                prop.is_list = true;
+                ok = parse_type(tokens[2], prop.count_type) &&
+                     parse_type(tokens[3], prop.type);
+                prop.name = tokens[4];
+            } else {
+                ok = tokens.size() == 3 && parse_type(tokens[1], prop.type);
+                prop.name = tokens.back();
+            }
+            if (!ok) return fail("bad property line");
+            elem->props.push_back(prop);
+        } else {
+            return fail("bad header line " + tokens[0]);
+        }
+    }
+    if (_body == nullptr) return fail("missing end_header");
+    if (!has_format) return fail("missing format");
+    _swap = _format != PlyFormat::ascii &&
+            (_format == PlyFormat::binary_be) != host_is_big_endian();
+
+    for (size_t i = 0; i < _elements.size(); ++i) {
+        PlyElement& e = _elements[i];
+        bool fixed = true;
+        for (auto& prop : e.props) {
+            prop.offset = e.stride;
+            e.stride += scalar_size(prop.type);
+            fixed &= !prop.is_list;
+        }
+        if (!fixed) e.stride = 0;
+        if (e.name == "vertex" && _vertex < 0) _vertex = (int)i;
+        if (e.name == "face" && _face < 0) _face = (int)i;
+    }
+    if (_vertex >= 0) {
+        const PlyElement& v = _elements[_vertex];
+        static const char* const axes[] = {"x", "y", "z"};
+        static const char* const colors[][2] = {
+            {"red", "diffuse_red"}, {"green", "diffuse_green"},
+            {"blue", "diffuse_blue"}};
+        static const char* const normals[] = {"nx", "ny", "nz"};
+        for (int j = 0; j < 3; ++j) {
+            _pos[j] = v.find({axes[j]});
+            _rgb[j] = v.find({colors[j][0], colors[j][1]});
+            _normal[j] = v.find({normals[j]});
+            for (int* index : {&_pos[j], &_rgb[j], &_normal[j]}) {
+                if (*index >= 0 && v.props[*index].is_list) *index = -1;
+            }
+        }
+        if (_pos[0] < 0 || _pos[1] < 0 || _pos[2] < 0) {
+            return fail("vertex element without x, y, z");
+        }
+    }
+    if (_face >= 0) {
+        _indices = _elements[_face].find({"vertex_indices", "vertex_index"});
+        if (_indices >= 0 && !_elements[_face].props[_indices].is_list) {
+            _indices = -1;
+        }
+    }
+    return true;
+}
+
+bool PlyReader::skip_binary_element(const PlyElement& elem,
+                                    const char*& p) const {
+    const char* end = _file.data() + _file.size();
+    for (auto& prop : elem.props) {
+        size_t n = 1;
+        if (prop.is_list) {
+            if ((size_t)(end - p) < scalar_size(prop.count_type)) return false;
+            const double count = load_value(p, prop.count_type, _swap);
+            if (count < 0) return false;
+            n = (size_t)count;
+            p += scalar_size(prop.count_type);
+        }
+        if ((size_t)(end - p) < n * scalar_size(prop.type)) return false;
+        p += n * scalar_size(prop.type);
+    }
+    return true;
+}
+
+bool PlyReader::locate_binary() {
+    const char* p = _body;
+    const char* end = _file.data() + _file.size();
+    for (auto& elem : _elements) {
+        elem.data = p;
+        if (elem.stride) {
+            if ((size_t)(end - p) / elem.stride < elem.count) {
+                return fail("truncated element " + elem.name);
+            }
+            p += elem.count * elem.stride;
+            continue;
+        }
+        for (size_t i = 0; i < elem.count; ++i) {
+            if (!skip_binary_element(elem, p)) {
+                return fail("truncated element " + elem.name);
+            }
+        }
+    }
+    return true;
+}
+
+bool PlyReader::read_vertices(const PlyVertexLayout& layout) {
+    if (_vertex < 0) return true;
+    if (_format == PlyFormat::ascii) return read_ascii(&layout, nullptr);
+    const PlyElement& v = _elements[_vertex];
+    // (property, destination column, scale) of each converted attribute
+    struct Column {
+        int prop, col;
+        float scale;
+    };
+    std::vector<Column> columns;
+    for (int j = 0; j < 3; ++j) {
+        columns.push_back({_pos[j], j, 1.f});
+        if (layout.rgb_col >= 0 && has_rgb()) {
+            columns.push_back({_rgb[j], layout.rgb_col + j,
+                               normalize_scale(v.props[_rgb[j]].type)});
+        }
+        if (layout.normal_col >= 0 && has_normals()) {
+            columns.push_back({_normal[j], layout.normal_col + j, 1.f});
+        }
+    }
+
+    if (v.stride) {
+        // Fixed-size vertices: convert column by column over row blocks
+        internal::ThreadPool::get().parallel_for(
+            0, v.count,
+            [&](size_t begin, size_t end) {
+                for (auto& column : columns) {
+                    const PlyProperty& prop = v.props[column.prop];
+                    convert_strided(prop.type,
+                                   v.data + begin * v.stride + prop.offset,
+                                   v.stride, end - begin,
+                                   layout.rows + begin * layout.row_size +
+                                       column.col,
+                                   layout.row_size, column.scale, _swap);
+                }
+            },
+            BLOCK_ROWS);
+        return true;
+    }
+
+    // Vertices with list properties: walk them
+    std::vector<size_t> offsets(v.props.size());
+    const char* p = v.data;
+    for (size_t i = 0; i < v.count; ++i) {
+        const char* q = p;
+        for (size_t k = 0; k < v.props.size(); ++k) {
+            offsets[k] = q - p;
+            const PlyProperty& prop = v.props[k];
+            size_t n = 1;
+            if (prop.is_list) {
+                n = (size_t)load_value(q, prop.count_type, _swap);
+                q += scalar_size(prop.count_type);
+            }
+            q += n * scalar_size(prop.type);
+        }
+        float* row = layout.rows + i * layout.row_size;
+        for (auto& column : columns) {
+            row[column.col] =
+                (float)load_value(p + offsets[column.prop],
+                                  v.props[column.prop].type, _swap) *
+                column.scale;
+        }
+        p = q;
+    }
+    return true;
+}
+
+bool PlyReader::read_faces(std::vector<Index>& triangles) {
+    if (_face < 0 || _indices < 0) return true;
+    if (_format == PlyFormat::ascii) return read_ascii(nullptr, &triangles);
+    const PlyElement& f = _elements[_face];
+    const PlyProperty& list = f.props[_indices];
+    const size_t count_size = scalar_size(list.count_type);
+    const size_t index_size = scalar_size(list.type);
+    _bad_faces = 0;
+
+    // Common case: only the index list, and all faces triangles. Check the
+    // counts where they would be, then convert in parallel.
+    const size_t tri_stride = count_size + 3 * index_size;
+    const char* end = _file.data() + _file.size();
+    if (f.props.size() == 1 && (size_t)(end - f.data) / tri_stride >= f.count) {
+        auto& pool = internal::ThreadPool::get();
+        std::vector<char> all_triangles(pool.size() * 4, 1);
+        const size_t n_tasks = all_triangles.size();
+        pool.parallel_for(
+            0, n_tasks,
+            [&](size_t task_begin, size_t task_end) {
+                for (size_t t = task_begin; t < task_end; ++t) {
+                    const size_t begin = f.count * t / n_tasks;
+                    const size_t stop = f.count * (t + 1) / n_tasks;
+                    for (size_t i = begin; i < stop; ++i) {
+                        if (load_value(f.data + i * tri_stride,
+                                       list.count_type, _swap) != 3.0) {
+                            all_triangles[t] = 0;
+                            break;
+                        }
+                    }
+                }
+            },
+            1);
+        if (std::find(all_triangles.begin(), all_triangles.end(), 0) ==
+            all_triangles.end()) {
+            const size_t n_verts = num_verts();
+            triangles.resize(f.count * 3);
+            std::atomic<bool> valid(true);
+            pool.parallel_for(
+                0, f.count,
+                [&](size_t begin, size_t stop) {
+                    for (size_t i = begin; i < stop; ++i) {
+                        const char* p = f.data + i * tri_stride + count_size;
+                        for (int j = 0; j < 3; ++j) {
+                            const double index = load_value(
+                                p + j * index_size, list.type, _swap);
+                            triangles[i * 3 + j] = (Index)index;
+                            if (index < 0 || index >= (double)n_verts) {
+                                valid = false;
+                            }
+                        }
+                    }
+                },
+                BLOCK_ROWS);
+            if (valid) return true;
+            // Rare: redo serially, dropping the bad faces
+            triangles.clear();
+        }
+    }
+
+    // General case: walk the faces
+    triangles.reserve(f.count * 3);
+    const char* p = f.data;
+    for (size_t i = 0; i < f.count; ++i) {
+        for (size_t k = 0; k < f.props.size(); ++k) {
+            const PlyProperty& prop = f.props[k];
+            size_t n = 1;
+            if (prop.is_list) {
+                n = (size_t)load_value(p, prop.count_type, _swap);
+                p += scalar_size(prop.count_type);
+            }
+            if ((int)k == _indices) {
+                const char* indices = p;
+                add_face(
+                    n,
+                    [&](size_t j) {
+                        return (int64_t)load_value(indices + j * index_size,
+                                                   prop.type, _swap);
+                    },
+                    triangles);
+            }
+            p += n * scalar_size(prop.type);
+        }
+    }
+    if (_bad_faces) {
+        std::cerr << _path << ": skipped " << _bad_faces
+                  << " faces with out-of-range indices\n";
+    }
+    return true;
+}
+
+bool PlyReader::read_ascii(const PlyVertexLayout* layout,
+                           std::vector<Index>* triangles) {
+    const char* p = _body;
+    const char* end = _file.data() + _file.size();
+    // Next number, skipping whitespace including newlines
+    auto next = [&](double& value) {
+        while (p < end && (internal::is_blank(*p) || *p == '\n')) ++p;
+        return internal::parse_double(p, end, value);
+    };
+    std::vector<double> values;
+    std::vector<int64_t> indices;
+    _bad_faces = 0;
+    for (size_t e = 0; e < _elements.size(); ++e) {
+        const PlyElement& elem = _elements[e];
+        const bool is_vertex = (int)e == _vertex && layout != nullptr;
+        const bool is_face = (int)e == _face && triangles != nullptr;
+        values.resize(elem.props.size());
+        for (size_t i = 0; i < elem.count; ++i) {
+            for (size_t k = 0; k < elem.props.size(); ++k) {
+                double value;
+                if (!elem.props[k].is_list) {
+                    if (!next(values[k])) return fail("bad ASCII data");
+                    continue;
+                }
+                if (!next(value) || value < 0) return fail("bad ASCII data");
+                const size_t n = (size_t)value;
+                const bool keep = is_face && (int)k == _indices;
+                if (keep) indices.resize(n);
+                for (size_t j = 0; j < n; ++j) {
+                    if (!next(value)) return fail("bad ASCII data");
+                    if (keep) indices[j] = (int64_t)value;
+                }
+                if (keep) {
+                    add_face(
+                        n, [&](size_t j) { return indices[j]; }, *triangles);
+                }
+            }
+            if (!is_vertex) continue;
+            float* row = layout->rows + i * layout->row_size;
+            for (int j = 0; j < 3; ++j) {
+                row[j] = (float)values[_pos[j]];
+                if (layout->rgb_col >= 0 && has_rgb()) {
+                    row[layout->rgb_col + j] =
+                        (float)values[_rgb[j]] *
+                        normalize_scale(elem.props[_rgb[j]].type);
+                }
+                if (layout->normal_col >= 0 && has_normals()) {
+                    row[layout->normal_col + j] = (float)values[_normal[j]];
+                }
+            }
+        }
+        // Nothing needed after the requested element
+        if ((is_vertex && triangles == nullptr) || is_face) break;
+    }
+    if (_bad_faces) {
+        std::cerr << _path << ": skipped " << _bad_faces
+                  << " faces with out-of-range indices\n";
+    }
+    return true;
+}
+
+// Append v at out in the PLY's byte order (host order)
+template <class T>
+inline void put(char*& out, T v) {
+    std::memcpy(out, &v, sizeof(T));
+    out += sizeof(T);
+}
+
+inline uint8_t to_u8(float v) {
+    return (uint8_t)(std::min(std::max(v, 0.f), 1.f) * 255.f + 0.5f);
+}
+
+// Write a PLY file of n_verts vertices (x, y, z, [nx, ny, nz], [red, green,
+// blue as uchar]) and the triangles of faces (if not null).
+// block(begin, end, out) fills the rows of out (resized to end - begin) with
+// position, rgb and normal of vertices [begin, end). Blocks of rows are
+// transformed and formatted in parallel (see internal::write_blocks).
+template <class BlockFn>
+bool write_ply(const std::string& path, bool binary, size_t n_verts,
+               bool rgb, bool normals, BlockFn block, const Triangles* faces) {
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs) {
+        std::cerr << "Failed to open " << path << " for writing\n";
+        return false;
+    }
+    const size_t n_faces = faces ? (size_t)faces->rows() : 0;
+    std::string header = "ply\nformat ";
+    header += binary ? (host_is_big_endian() ? "binary_big_endian"
+                                             : "binary_little_endian")
+                     : "ascii";
+    header += " 1.0\ncomment meshview\nelement vertex " +
+              std::to_string(n_verts) +
+              "\nproperty float x\nproperty float y\nproperty float z\n";
+    if (normals) {
+        header += "property float nx\nproperty float ny\nproperty float nz\n";
+    }
+    if (rgb) {
+        header +=
+            "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+    }
+    if (faces) {
+        header += "element face " + std::to_string(n_faces) +
+                  "\nproperty list uchar int vertex_indices\n";
+    }
+    header += "end_header\n";
+    ofs.write(header.data(), header.size());
+
+    using internal::MAX_FLOAT_CHARS;
+    using internal::MAX_UINT_CHARS;
+    const size_t vert_bytes = binary ? 12 + (normals ? 12 : 0) + (rgb ? 3 : 0)
+                                     : 6 * (MAX_FLOAT_CHARS + 1) + 3 * 4;
+    const size_t face_bytes = binary ? 13 : 2 + 3 * (MAX_UINT_CHARS + 1);
+    bool ok = internal::write_blocks(
+        ofs, n_verts, vert_bytes, [&](size_t begin, size_t end, char* out) {
+            PointsRGBNormal v;
+            block(begin, end, v);
+            for (size_t i = 0; i < end - begin; ++i) {
+                if (binary) {
+                    for (int j = 0; j < 3; ++j) put(out, v(i, j));
+                    if (normals) {
+                        for (int j = 6; j < 9; ++j) put(out, v(i, j));
+                    }
+                    if (rgb) {
+                        for (int j = 3; j < 6; ++j) put(out, to_u8(v(i, j)));
+                    }
+                    continue;
+                }
+                // Positions, then normals
+                static const int cols[] = {0, 1, 2, 6, 7, 8};
+                for (int j = 0; j < (normals ? 6 : 3); ++j) {
+                    if (j) *out++ = ' ';
+                    out = internal::format_float(out, v(i, cols[j]));
+                }
+                if (rgb) {
+                    for (int j = 3; j < 6; ++j) {
+                        *out++ = ' ';
+                        out = internal::format_uint(out, to_u8(v(i, j)));
+                    }
+                }
+                *out++ = '\n';
+            }
+            return out;
+        });
+    ok = ok && internal::write_blocks(
+                   ofs, n_faces, face_bytes,
+                   [&](size_t begin, size_t end, char* out) {
+                       for (size_t i = begin; i < end; ++i) {
+                           if (binary) {
+                               put(out, (uint8_t)3);
+                               for (int j = 0; j < 3; ++j) {
+                                   put(out, (int32_t)(*faces)(i, j));
+                               }
+                               continue;
+                           }
+                           *out++ = '3';
+                           for (int j = 0; j < 3; ++j) {
+                               *out++ = ' ';
+                               out = internal::format_uint(
+                                   out, (uint32_t)(*faces)(i, j));
+                           }
+                           *out++ = '\n';
+                       }
+                       return out;
+                   });
+    if (!ok) {
+        std::cerr << "Failed to write " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool Mesh::load_ply(const std::string& path) {
+    PlyReader ply;
+    if (!ply.open(path)) return false;
+    PointsRGBNormal new_data(ply.num_verts(), data.ColsAtCompileTime);
+    new_data.setZero();
+    if (!ply.read_vertices(
+            {new_data.data(), (size_t)new_data.cols(), 3, 6})) {
+        return false;
+    }
+    std::vector<Index> triangles;
+    if (!ply.read_faces(triangles)) return false;
+    data.swap(new_data);
+    faces = Eigen::Map<const Triangles>(triangles.data(),
+                                        triangles.size() / 3, 3);
+    unset_tex_coords();
+    // As load_basic_obj: uncolored meshes use the textures (white if none)
+    shading_type =
+        ply.has_rgb() ? ShadingType::vertex : ShadingType::texture;
+    _auto_normals = !ply.has_normals();
+    return true;
+}
+
+bool Mesh::save_ply(const std::string& path, bool binary) const {
+    // Row vectors are transformed by the transposes
+    const Matrix3f rot_t = transform.topLeftCorner<3, 3>().transpose();
+    const Eigen::RowVector3f trans =
+        transform.topRightCorner<3, 1>().transpose();
+    const Matrix3f normal_mat_t = rot_t.inverse().transpose();
+    return write_ply(
+        path, binary, data.rows(), shading_type == ShadingType::vertex,
+        !_auto_normals,
+        [&](size_t begin, size_t end, PointsRGBNormal& out) {
+            const auto rows = data.middleRows(begin, end - begin);
+            out.resize(rows.rows(), out.ColsAtCompileTime);
+            out.leftCols<3>() = (rows.leftCols<3>() * rot_t).rowwise() + trans;
+            out.middleCols<3>(3) = rows.middleCols<3>(3);
+            out.rightCols<3>() =
+                (rows.rightCols<3>() * normal_mat_t).rowwise().normalized();
+        },
+        &faces);
+}
+
+bool PointCloud::load_ply(const std::string& path) {
+    PlyReader ply;
+    if (!ply.open(path)) return false;
+    PointsRGB new_data(ply.num_verts(), data.ColsAtCompileTime);
+    // Uncolored points are white
+    new_data.setOnes();
+    if (!ply.read_vertices(
+            {new_data.data(), (size_t)new_data.cols(), 3, -1})) {
+        return false;
+    }
+    data.swap(new_data);
+    return true;
+}
+
+bool PointCloud::save_ply(const std::string& path, bool binary) const {
+    const Matrix3f rot_t = transform.topLeftCorner<3, 3>().transpose();
+    const Eigen::RowVector3f trans =
+        transform.topRightCorner<3, 1>().transpose();
+    return write_ply(
+        path, binary, data.rows(), true, false,
+        [&](size_t begin, size_t end, PointsRGBNormal& out) {
+            const auto rows = data.middleRows(begin, end - begin);
+            out.resize(rows.rows(), out.ColsAtCompileTime);
+            out.leftCols<3>() = (rows.leftCols<3>() * rot_t).rowwise() + trans;
+            out.middleCols<3>(3) = rows.rightCols<3>();
+        },
+        nullptr);
+}
+
+}  // namespace meshview
@@ -0,0 +1,778 @@
+#include "meshview/point_stream.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "meshview/meshview.hpp"
+#include "meshview/internal/binary.hpp"
+#include "meshview/internal/mapped_file.hpp"
+#include "meshview/internal/parse.hpp"
+
+namespace meshview {
+namespace {
+
+using internal::ScalarType;
+using internal::load;
+
+// Bytes of text sampled at open to find the columns and line length
+const size_t SAMPLE_BYTES = 1 << 16;
+// Records sampled at open (LAS color depth, first valid PCD point)
+const size_t SAMPLE_RECORDS = 1024;
+// Most text columns read per line
+const int MAX_COLUMNS = 64;
+
+enum class Format { text, binary };
+
+// Lowercase extension of path, without the dot
+std::string extension(const std::string& path) {
+    const size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) return "";
+    std::string ext = path.substr(dot + 1);
+    for (char& c : ext) c = (char)std::tolower((unsigned char)c);
+    return ext;
+}
+
+// Parse up to n numbers of the line [p, end) separated by blanks or commas;
+// returns how many were read
+int parse_columns(const char* p, const char* end, double* values, int n) {
+    int count = 0;
+    while (count < n) {
+        internal::skip_blanks(p, end);
+        if (p < end && *p == ',') {
+            ++p;
+            internal::skip_blanks(p, end);
+        }
+        if (!internal::parse_double(p, end, values[count])) break;
+        ++count;
+    }
+    return count;
+}
+
+// Whether the line [p, end) has only blanks
+bool is_empty_line(const char* p, const char* end) {
+    internal::skip_blanks(p, end);
+    return p == end;
+}
+
+// Convert n values of type T, stride bytes apart from src, to
+// value * scale + shift (in double), dst_stride floats apart in dst
+template <class T>
+void convert_column(const char* src, size_t stride, size_t n, float* dst,
+                    size_t dst_stride, double scale, double shift,
+                    bool swap) {
+    for (size_t i = 0; i < n; ++i) {
+        const T value = load<T>(src + i * stride, swap);
+        dst[i * dst_stride] = (float)((double)value * scale + shift);
+    }
+}
+
+void convert_column(ScalarType type, const char* src, size_t stride,
+                    size_t n, float* dst, size_t dst_stride, double scale,
+                    double shift, bool swap) {
+    switch (type) {
+        case ScalarType::int8:
+            convert_column<int8_t>(src, stride, n, dst, dst_stride, scale,
+                                   shift, swap);
+            break;
+        case ScalarType::uint8:
+            convert_column<uint8_t>(src, stride, n, dst, dst_stride, scale,
+                                    shift, swap);
+            break;
+        case ScalarType::int16:
+            convert_column<int16_t>(src, stride, n, dst, dst_stride, scale,
+                                    shift, swap);
+            break;
+        case ScalarType::uint16:
+            convert_column<uint16_t>(src, stride, n, dst, dst_stride, scale,
+                                     shift, swap);
+            break;
+        case ScalarType::int32:
+            convert_column<int32_t>(src, stride, n, dst, dst_stride, scale,
+                                    shift, swap);
+            break;
+        case ScalarType::uint32:
+            convert_column<uint32_t>(src, stride, n, dst, dst_stride, scale,
+                                     shift, swap);
+            break;
+        case ScalarType::int64:
+            convert_column<int64_t>(src, stride, n, dst, dst_stride, scale,
+                                    shift, swap);
+            break;
+        case ScalarType::uint64:
+            convert_column<uint64_t>(src, stride, n, dst, dst_stride, scale,
+                                     shift, swap);
+            break;
+        case ScalarType::f32:
+            convert_column<float>(src, stride, n, dst, dst_stride, scale,
+                                  shift, swap);
+            break;
+        case ScalarType::f64:
+            convert_column<double>(src, stride, n, dst, dst_stride, scale,
+                                   shift, swap);
+            break;
+    }
+}
+
+// Colors of a PCD packed rgb/rgba value (0x00RRGGBB, also when typed F)
+inline void unpack_rgb(uint32_t rgb, float* out) {
+    out[0] = (float)((rgb >> 16) & 0xFF) * (1.f / 255.f);
+    out[1] = (float)((rgb >> 8) & 0xFF) * (1.f / 255.f);
+    out[2] = (float)(rgb & 0xFF) * (1.f / 255.f);
+}
+
+// Drop rows of out with non-finite positions (e.g. invalid points of
+// organized PCD clouds); returns the rows kept
+size_t drop_invalid(PointsRGB& out, size_t rows) {
+    size_t kept = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        if (std::isfinite(out(i, 0)) && std::isfinite(out(i, 1)) &&
+            std::isfinite(out(i, 2))) {
+            if (kept != i) out.row(kept) = out.row(i);
+            ++kept;
+        }
+    }
+    return kept;
+}
+
+}  // namespace
+
+// Where the points are in the file and how to decode them
+struct PointCloudStream::Layout {
+    Format format = Format::text;
+    // Point data [begin, end) in the file
+    size_t begin = 0, end = 0;
+    size_t num_chunks = 0;
+    size_t stride = 1;
+
+    // * Text: bytes per chunk (before snapping to lines)
+    size_t chunk_bytes = 0;
+    // Columns of x, y, z, r, g, b (-1: none), packed rgb (-1: none,
+    // packed_float: the column is the float with the bits of the value)
+    int xyz_col[3] = {0, 1, 2};
+    int rgb_col[3] = {-1, -1, -1};
+    int packed_col = -1;
+    bool packed_float = false;
+    // Columns read per line
+    int num_cols = 3;
+
+    // * Binary: records, their size and the records per chunk (a multiple
+    // of stride)
+    size_t record_size = 0, num_records = 0, chunk_records = 0;
+    ScalarType xyz_type[3];
+    size_t xyz_offset[3] = {0, 0, 0};
+    double xyz_scale[3] = {1.0, 1.0, 1.0};
+    // Shift added after scaling (file offset minus origin)
+    double xyz_shift[3] = {0.0, 0.0, 0.0};
+    bool has_rgb = false;
+    ScalarType rgb_type;
+    size_t rgb_offset[3] = {0, 0, 0};
+    // Offset of a packed rgb value, or -1
+    long long packed_offset = -1;
+    bool swap = false;
+
+    // * Both: scale of color values to [0, 1], color without colors
+    float rgb_scale = 1.f;
+    float color[3] = {1.f, 1.f, 1.f};
+    // Points in the file (estimated for text), before stride
+    size_t num_points = 0;
+};
+
+PointCloudStream::PointCloudStream()
+    : _file(std::make_unique<internal::MappedFile>()) {}
+
+PointCloudStream::~PointCloudStream() { close(); }
+
+bool PointCloudStream::open(const std::string& path, const Options& options) {
+    close();
+    // Chunks are prefetched and evicted one at a time
+    if (!_file->open(path, internal::MappedFile::Access::random)) {
+        return false;
+    }
+    _options = options;
+    _options.max_queued_chunks =
+        std::max<size_t>(options.max_queued_chunks, 1);
+    _options.chunk_points = std::max<size_t>(options.chunk_points, 1);
+    auto fail = [&](const std::string& message) {
+        std::cerr << path << ": " << message << "\n";
+        close();
+        return false;
+    };
+    auto layout = std::make_unique<Layout>();
+    const char* data = _file->data();
+    const size_t size = _file->size();
+    const std::string ext = extension(path);
+    const bool swap = internal::host_is_big_endian();
+    layout->swap = swap;
+    for (int c = 0; c < 3; ++c) layout->color[c] = options.color[c];
+    // First point of double-precision data, for recentering
+    double first[3] = {0.0, 0.0, 0.0};
+    bool has_first = false;
+
+    if (size >= 4 && std::memcmp(data, "LASF", 4) == 0) {
+        // LAS public header block (all versions share the first 227 bytes)
+        if (size < 227) return fail("truncated LAS header");
+        const uint8_t minor = (uint8_t)data[25];
+        const uint16_t header_size = load<uint16_t>(data + 94, swap);
+        const uint32_t point_offset = load<uint32_t>(data + 96, swap);
+        const uint8_t point_format = (uint8_t)data[104];
+        const uint16_t record_size = load<uint16_t>(data + 105, swap);
+        uint64_t count = load<uint32_t>(data + 107, swap);
+        if (minor >= 4 && header_size >= 255 && size >= 255) {
+            const uint64_t count64 = load<uint64_t>(data + 247, swap);
+            if (count64) count = count64;
+        }
+        if (point_format & 0x80) {
+            return fail("LAZ compressed LAS files are not supported");
+        }
+        // Minimum record size and RGB offset (0: none) of formats 0-10
+        static const size_t MIN_SIZE[] = {20, 28, 26, 34, 57, 63,
+                                          30, 36, 38, 59, 67};
+        static const size_t RGB_OFFSET[] = {0, 0, 20, 28, 0, 28,
+                                            0, 30, 30, 0,  30};
+        if (point_format > 10) return fail("unsupported LAS point format");
+        if (record_size < MIN_SIZE[point_format]) {
+            return fail("LAS point records too short for their format");
+        }
+        if (point_offset > size ||
+            count > (size - point_offset) / record_size) {
+            return fail("truncated LAS point data");
+        }
+        layout->format = Format::binary;
+        layout->begin = point_offset;
+        layout->record_size = record_size;
+        layout->num_records = count;
+        layout->end = point_offset + count * record_size;
+        double center[3] = {0.0, 0.0, 0.0};
+        for (int c = 0; c < 3; ++c) {
+            layout->xyz_type[c] = ScalarType::int32;
+            layout->xyz_offset[c] = 4 * c;
+            layout->xyz_scale[c] = load<double>(data + 131 + 8 * c, swap);
+            layout->xyz_shift[c] = load<double>(data + 155 + 8 * c, swap);
+            const double max = load<double>(data + 179 + 16 * c, swap);
+            const double min = load<double>(data + 187 + 16 * c, swap);
+            center[c] = 0.5 * (min + max);
+        }
+        if (options.recenter &&
+            std::isfinite(center[0] + center[1] + center[2])) {
+            _origin = Eigen::Vector3d(center[0], center[1], center[2]);
+        }
+        if (RGB_OFFSET[point_format]) {
+            layout->has_rgb = true;
+            layout->rgb_type = ScalarType::uint16;
+            for (int c = 0; c < 3; ++c) {
+                layout->rgb_offset[c] = RGB_OFFSET[point_format] + 2 * c;
+            }
+            // Many writers store 8-bit colors
+            uint16_t max = 0;
+            const size_t n = std::min<size_t>(count, SAMPLE_RECORDS);
+            for (size_t i = 0; i < n; ++i) {
+                const char* rec = data + point_offset + i * record_size;
+                for (int c = 0; c < 3; ++c) {
+                    max = std::max(max, load<uint16_t>(
+                                            rec + layout->rgb_offset[c], swap));
+                }
+            }
+            layout->rgb_scale = max > 255 ? 1.f / 65535.f : 1.f / 255.f;
+        }
+    } else if (ext == "pcd") {
+        // Header lines up to DATA
+        std::vector<std::string> fields, sizes, types, counts;
+        size_t points = 0, width = 0, height = 1;
+        bool points_given = false;
+        std::string encoding;
+        const char* p = data;
+        const char* end = data + size;
+        while (p < end && encoding.empty()) {
+            const char* line_end = internal::find_line_end(p, end);
+            std::vector<std::string> tokens;
+            const char* q = p;
+            for (;;) {
+                internal::skip_blanks(q, line_end);
+                if (q == line_end) break;
+                const char* start = q;
+                internal::skip_token(q, line_end);
+                tokens.emplace_back(start, q);
+            }
+            p = line_end == end ? end : line_end + 1;
+            if (tokens.empty() || tokens[0][0] == '#') continue;
+            const std::string& key = tokens[0];
+            std::vector<std::string> values(tokens.begin() + 1, tokens.end());
+            if (key == "FIELDS") {
+                fields = values;
+            } else if (key == "SIZE") {
+                sizes = values;
+            } else if (key == "TYPE") {
+                types = values;
+            } else if (key == "COUNT") {
+                counts = values;
+            } else if (key == "WIDTH" && !values.empty()) {
+                width = std::strtoull(values[0].c_str(), nullptr, 10);
+            } else if (key == "HEIGHT" && !values.empty()) {
+                height = std::strtoull(values[0].c_str(), nullptr, 10);
+            } else if (key == "POINTS" && !values.empty()) {
+                points = std::strtoull(values[0].c_str(), nullptr, 10);
+                points_given = true;
+            } else if (key == "DATA") {
+                encoding = values.empty() ? "?" : values[0];
+            }
+        }
+        if (encoding.empty()) return fail("PCD header without DATA");
+        if (!points_given) points = width * height;
+        if (counts.empty()) counts.assign(fields.size(), "1");
+        if (sizes.size() != fields.size() || types.size() != fields.size() ||
+            counts.size() != fields.size()) {
+            return fail("PCD header field lists differ in length");
+        }
+        // Column (text) and byte offset (binary) of each field
+        struct Field {
+            int column;
+            size_t offset;
+            ScalarType type;
+            bool valid_type;
+            char kind;
+        };
+        std::vector<Field> info(fields.size());
+        int column = 0;
+        size_t offset = 0;
+        for (size_t i = 0; i < fields.size(); ++i) {
+            const int count = std::max(1, std::atoi(counts[i].c_str()));
+            const int bytes = std::atoi(sizes[i].c_str());
+            const char kind = types[i].empty() ? '?' : types[i][0];
+            Field& f = info[i];
+            f.column = column;
+            f.offset = offset;
+            f.kind = kind;
+            f.valid_type = true;
+            if (kind == 'F' && bytes == 4) {
+                f.type = ScalarType::f32;
+            } else if (kind == 'F' && bytes == 8) {
+                f.type = ScalarType::f64;
+            } else if (kind == 'U' && bytes == 1) {
+                f.type = ScalarType::uint8;
+            } else if (kind == 'U' && bytes == 2) {
+                f.type = ScalarType::uint16;
+            } else if (kind == 'U' && bytes == 4) {
+                f.type = ScalarType::uint32;
+            } else if (kind == 'I' && bytes == 1) {
+                f.type = ScalarType::int8;
+            } else if (kind == 'I' && bytes == 2) {
+                f.type = ScalarType::int16;
+            } else if (kind == 'I' && bytes == 4) {
+                f.type = ScalarType::int32;
+            } else {
+                f.valid_type = false;
+            }
+            if (bytes <= 0) return fail("invalid PCD field size");
+            column += count;
+            offset += (size_t)bytes * count;
+        }
+        auto find = [&](const char* name) -> int {
+            for (size_t i = 0; i < fields.size(); ++i) {
+                if (fields[i] == name) return (int)i;
+            }
+            return -1;
+        };
+        const int xyz[3] = {find("x"), find("y"), find("z")};
+        const int rgb[3] = {find("r"), find("g"), find("b")};
+        int packed = find("rgb");
+        if (packed < 0) packed = find("rgba");
+        for (int f : xyz) {
+            if (f < 0 || !info[f].valid_type) {
+                return fail("PCD file without x, y, z fields");
+            }
+        }
+        const bool has_rgb = rgb[0] >= 0 && rgb[1] >= 0 && rgb[2] >= 0 &&
+                             info[rgb[0]].valid_type &&
+                             info[rgb[0]].type == info[rgb[1]].type &&
+                             info[rgb[0]].type == info[rgb[2]].type;
+        if (packed >= 0 && std::atoi(sizes[packed].c_str()) != 4) packed = -1;
+        if (has_rgb) {
+            // Integer colors are 0-255 (or the type's range), float 0-1
+            layout->rgb_scale = internal::normalize_scale(info[rgb[0]].type);
+        }
+
+        layout->begin = p - data;
+        if (encoding == "ascii") {
+            layout->format = Format::text;
+            layout->end = size;
+            layout->num_cols = 0;
+            for (int c = 0; c < 3; ++c) {
+                layout->xyz_col[c] = info[xyz[c]].column;
+                if (has_rgb) layout->rgb_col[c] = info[rgb[c]].column;
+                layout->num_cols = std::max(
+                    {layout->num_cols, layout->xyz_col[c] + 1,
+                     layout->rgb_col[c] + 1});
+            }
+            if (!has_rgb && packed >= 0) {
+                layout->packed_col = info[packed].column;
+                layout->packed_float = info[packed].kind == 'F';
+                layout->num_cols =
+                    std::max(layout->num_cols, layout->packed_col + 1);
+            }
+            if (layout->num_cols > MAX_COLUMNS) {
+                return fail("too many PCD columns before x, y, z, rgb");
+            }
+        } else if (encoding == "binary") {
+            layout->format = Format::binary;
+            layout->record_size = offset;
+            if (points > (size - layout->begin) / offset) {
+                return fail("truncated PCD point data");
+            }
+            layout->num_records = points;
+            layout->end = layout->begin + points * offset;
+            for (int c = 0; c < 3; ++c) {
+                layout->xyz_type[c] = info[xyz[c]].type;
+                layout->xyz_offset[c] = info[xyz[c]].offset;
+                if (has_rgb) layout->rgb_offset[c] = info[rgb[c]].offset;
+            }
+            if (has_rgb) {
+                layout->has_rgb = true;
+                layout->rgb_type = info[rgb[0]].type;
+            } else if (packed >= 0) {
+                layout->packed_offset = (long long)info[packed].offset;
+            }
+            if (options.recenter && layout->xyz_type[0] == ScalarType::f64) {
+                // First valid point (organized clouds have NaN points)
+                const size_t n = std::min<size_t>(points, SAMPLE_RECORDS);
+                for (size_t i = 0; i < n && !has_first; ++i) {
+                    const char* rec = data + layout->begin + i * offset;
+                    for (int c = 0; c < 3; ++c) {
+                        first[c] = internal::load_value(
+                            rec + layout->xyz_offset[c], layout->xyz_type[c],
+                            swap);
+                    }
+                    has_first = std::isfinite(first[0] + first[1] + first[2]);
+                }
+            }
+        } else {
+            return fail("unsupported PCD encoding " + encoding +
+                        " (convert to binary or ascii)");
+        }
+    } else if (ext == "xyz" || ext == "txt" || ext == "pts" ||
+               ext == "csv") {
+        layout->format = Format::text;
+        layout->begin = 0;
+        layout->end = size;
+        // Columns of the first line with 3 or more numbers
+        const char* p = data;
+        const char* end = data + std::min(size, SAMPLE_BYTES);
+        double values[MAX_COLUMNS];
+        int columns = 0;
+        while (p < end && columns < 3) {
+            const char* line_end = internal::find_line_end(p, end);
+            columns = parse_columns(p, line_end, values, 8);
+            p = line_end + 1;
+        }
+        if (columns < 3) return fail("no x y z lines found");
+        if (columns >= 6) {
+            const int first_rgb = columns >= 7 ? 4 : 3;
+            for (int c = 0; c < 3; ++c) layout->rgb_col[c] = first_rgb + c;
+            layout->num_cols = first_rgb + 3;
+        }
+    } else {
+        return fail("unsupported point cloud format (not XYZ, PCD or LAS)");
+    }
+
+    // Text: sample line length, first point and color range
+    if (layout->format == Format::text && layout->end > layout->begin) {
+        const char* p = data + layout->begin;
+        const char* end =
+            data + std::min(layout->end, layout->begin + SAMPLE_BYTES);
+        size_t lines = 0;
+        bool found = false, colors_255 = false;
+        double values[MAX_COLUMNS];
+        while (p < end) {
+            const char* line_end = internal::find_line_end(p, end);
+            // (Skip a partial last line)
+            if (line_end == end && end != data + layout->end) break;
+            ++lines;
+            if (parse_columns(p, line_end, values, layout->num_cols) ==
+                layout->num_cols) {
+                for (int c = 0; c < 3; ++c) {
+                    if (!found) first[c] = values[layout->xyz_col[c]];
+                    if (layout->rgb_col[c] >= 0 &&
+                        values[layout->rgb_col[c]] > 1.0) {
+                        colors_255 = true;
+                    }
+                }
+                found = true;
+            }
+            p = line_end + 1;
+        }
+        if (!found) return fail("no point lines found");
+        const double line_bytes =
+            (double)(p - (data + layout->begin)) / std::max<size_t>(lines, 1);
+        has_first = options.recenter;
+        if (layout->rgb_col[0] >= 0 && ext != "pcd") {
+            layout->rgb_scale = colors_255 ? 1.f / 255.f : 1.f;
+        }
+        layout->num_points =
+            (size_t)((layout->end - layout->begin) / line_bytes) + 1;
+        layout->chunk_bytes = (size_t)std::max(
+            4096.0, line_bytes * _options.chunk_points);
+    } else {
+        layout->num_points = layout->num_records;
+    }
+    if (has_first) _origin = Eigen::Vector3d(first[0], first[1], first[2]);
+    for (int c = 0; c < 3; ++c) layout->xyz_shift[c] -= _origin[c];
+
+    layout->stride = std::max<size_t>(options.stride, 1);
+    if (options.max_points > 0) {
+        layout->stride = std::max(
+            layout->stride,
+            (layout->num_points + options.max_points - 1) / options.max_points);
+    }
+    if (layout->format == Format::text) {
+        layout->chunk_bytes *= layout->stride;
+        layout->num_chunks = (layout->end - layout->begin +
+                              layout->chunk_bytes - 1) /
+                             layout->chunk_bytes;
+    } else {
+        layout->chunk_records = _options.chunk_points * layout->stride;
+        layout->num_chunks = (layout->num_records + layout->chunk_records - 1) /
+                             layout->chunk_records;
+    }
+    _layout = std::move(layout);
+
+    _progress = Progress();
+    _progress.total_bytes = _layout->end - _layout->begin;
+    _progress.total_points =
+        (_layout->num_points + _layout->stride - 1) / _layout->stride;
+    if (options.max_points > 0) {
+        _progress.total_points =
+            std::min(_progress.total_points, options.max_points);
+    }
+    _progress.total_chunks = _layout->num_chunks;
+
+    size_t threads = options.num_threads;
+    if (threads == 0) {
+        threads = std::max<size_t>(std::thread::hardware_concurrency(), 2) - 1;
+    }
+    threads = std::min(threads, _layout->num_chunks);
+    _next_chunk = 0;
+    _running = threads;
+    for (size_t i = 0; i < threads; ++i) {
+        _parsers.emplace_back(&PointCloudStream::parser, this);
+    }
+    return true;
+}
+
+size_t PointCloudStream::decode(size_t i, PointsRGB& out,
+                                size_t& skipped) const {
+    const Layout& layout = *_layout;
+    const char* data = _file->data();
+    size_t rows = 0;
+    size_t begin, end;
+    if (layout.format == Format::text) {
+        // Lines starting in [begin + i * chunk_bytes, ...), so that
+        // neighboring chunks split the file without looking at each other
+        auto snap = [&](size_t pos) {
+            if (pos <= layout.begin) return layout.begin;
+            if (pos >= layout.end) return layout.end;
+            const char* nl = internal::find_line_end(data + pos - 1,
+                                                     data + layout.end);
+            return std::min((size_t)(nl - data) + 1, layout.end);
+        };
+        begin = snap(layout.begin + i * layout.chunk_bytes);
+        end = snap(layout.begin + (i + 1) * layout.chunk_bytes);
+        _file->prefetch(begin, end - begin);
+        const char* p = data + begin;
+        const char* chunk_end = data + end;
+        // Upper bound of the points
+        const size_t lines =
+            std::count(p, chunk_end, '\n') + (end == layout.end ? 1 : 0);
+        out.resize(lines / layout.stride + 1, 6);
+        double values[MAX_COLUMNS];
+        size_t index = 0;
+        while (p < chunk_end) {
+            const char* line_end = internal::find_line_end(p, chunk_end);
+            if (parse_columns(p, line_end, values, layout.num_cols) <
+                layout.num_cols) {
+                if (!is_empty_line(p, line_end)) ++skipped;
+            } else if (index++ % layout.stride == 0) {
+                float* row = out.data() + rows * 6;
+                for (int c = 0; c < 3; ++c) {
+                    row[c] = (float)(values[layout.xyz_col[c]] +
+                                     layout.xyz_shift[c]);
+                }
+                if (layout.rgb_col[0] >= 0) {
+                    for (int c = 0; c < 3; ++c) {
+                        row[3 + c] = (float)values[layout.rgb_col[c]] *
+                                     layout.rgb_scale;
+                    }
+                } else if (layout.packed_col >= 0) {
+                    const double value = values[layout.packed_col];
+                    uint32_t rgb;
+                    if (layout.packed_float) {
+                        const float bits = (float)value;
+                        std::memcpy(&rgb, &bits, 4);
+                    } else {
+                        rgb = (uint32_t)value;
+                    }
+                    unpack_rgb(rgb, row + 3);
+                } else {
+                    for (int c = 0; c < 3; ++c) row[3 + c] = layout.color[c];
+                }
+                ++rows;
+            }
+            p = line_end + 1;
+        }
+    } else {
+        const size_t first = i * layout.chunk_records;
+        const size_t last =
+            std::min(first + layout.chunk_records, layout.num_records);
+        begin = layout.begin + first * layout.record_size;
+        end = layout.begin + last * layout.record_size;
+        _file->prefetch(begin, end - begin);
+        // Records first, first + stride, ...
+        rows = (last - first + layout.stride - 1) / layout.stride;
+        out.resize(rows, 6);
+        const char* src = data + begin;
+        const size_t stride = layout.record_size * layout.stride;
+        for (int c = 0; c < 3; ++c) {
+            convert_column(layout.xyz_type[c], src + layout.xyz_offset[c],
+                           stride, rows, out.data() + c, 6,
+                           layout.xyz_scale[c], layout.xyz_shift[c],
+                           layout.swap);
+        }
+        if (layout.has_rgb) {
+            for (int c = 0; c < 3; ++c) {
+                convert_column(layout.rgb_type, src + layout.rgb_offset[c],
+                               stride, rows, out.data() + 3 + c, 6,
+                               layout.rgb_scale, 0.0, layout.swap);
+            }
+        } else if (layout.packed_offset >= 0) {
+            for (size_t r = 0; r < rows; ++r) {
+                unpack_rgb(load<uint32_t>(src + r * stride +
+                                              layout.packed_offset,
+                                          layout.swap),
+                           out.data() + r * 6 + 3);
+            }
+        } else {
+            out.rightCols<3>().rowwise() = Eigen::RowVector3f(
+                layout.color[0], layout.color[1], layout.color[2]);
+        }
+    }
+    rows = drop_invalid(out, rows);
+    if ((size_t)out.rows() != rows) out.conservativeResize(rows, 6);
+    // Decoded: let the OS drop the pages from this process
+    _file->evict(begin, end - begin);
+    return end - begin;
+}
+
+void PointCloudStream::parser() {
+    for (;;) {
+        const size_t i = _next_chunk++;
+        if (i >= _layout->num_chunks) break;
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            if (_stop) break;
+        }
+        PointsRGB chunk;
+        size_t skipped = 0;
+        const size_t bytes = decode(i, chunk, skipped);
+
+        std::unique_lock<std::mutex> lock(_mtx);
+        _cv_space.wait(lock, [this] {
+            return _stop || _ready.size() < _options.max_queued_chunks;
+        });
+        if (_stop) break;
+        _progress.bytes_parsed += bytes;
+        _progress.skipped_lines += skipped;
+        if (chunk.rows() > 0) {
+            _ready.push_back(std::move(chunk));
+        } else {
+            ++_progress.chunks_loaded;
+        }
+        _cv_ready.notify_all();
+    }
+    std::lock_guard<std::mutex> lock(_mtx);
+    --_running;
+    _cv_ready.notify_all();
+}
+
+bool PointCloudStream::next_chunk(PointsRGB& out, bool wait) {
+    std::unique_lock<std::mutex> lock(_mtx);
+    if (wait) {
+        _cv_ready.wait(lock, [this] {
+            return !_ready.empty() || _running == 0 || _progress.done;
+        });
+    }
+    if (_progress.done || _ready.empty()) {
+        if (_running == 0 && _ready.empty()) _progress.done = true;
+        return false;
+    }
+    out = std::move(_ready.front());
+    _ready.pop_front();
+    _cv_space.notify_one();
+    const size_t max_points = _options.max_points;
+    if (max_points > 0 &&
+        _progress.points_loaded + out.rows() >= max_points) {
+        // Enough points: stop the parsers
+        out.conservativeResize(max_points - _progress.points_loaded, 6);
+        _stop = true;
+        _ready.clear();
+        _cv_space.notify_all();
+        _progress.done = true;
+    }
+    _progress.points_loaded += out.rows();
+    ++_progress.chunks_loaded;
+    if (_running == 0 && _ready.empty()) _progress.done = true;
+    const Progress progress = _progress;
+    lock.unlock();
+    if (on_progress) on_progress(progress);
+    return true;
+}
+
+size_t PointCloudStream::upload(PointCloud& point_cloud, size_t max_chunks) {
+    size_t count = 0;
+    PointsRGB chunk;
+    while (count < max_chunks && next_chunk(chunk, false)) {
+        point_cloud.append_gpu(chunk);
+        ++count;
+    }
+    return count;
+}
+
+bool PointCloudStream::loading() const {
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _layout && !_progress.done &&
+           !(_running == 0 && _ready.empty());
+}
+
+PointCloudStream::Progress PointCloudStream::progress() const {
+    std::lock_guard<std::mutex> lock(_mtx);
+    Progress progress = _progress;
+    if (_layout && _running == 0 && _ready.empty()) progress.done = true;
+    return progress;
+}
+
+bool PointCloudStream::is_open() const { return _layout != nullptr; }
+
+void PointCloudStream::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stop = true;
+    }
+    _cv_space.notify_all();
+    _cv_ready.notify_all();
+    for (auto& parser : _parsers) parser.join();
+    _parsers.clear();
+}
+
+void PointCloudStream::close() {
+    stop();
+    _file->close();
+    _layout.reset();
+    _ready.clear();
+    _progress = Progress();
+    _origin.setZero();
+    _stop = false;
+    _running = 0;
+}
+
+}  // namespace meshview
@@ -0,0 +1,613 @@
+#include "meshview/internal/rasterizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <Eigen/Geometry>
+#include "meshview/meshview.hpp"
+#include "meshview/internal/shading.hpp"
+#include "meshview/internal/thread_pool.hpp"
+
+namespace meshview {
+namespace internal {
+
+namespace {
+// Tile size in pixels (a multiple of LANES)
+const int TILE_SIZE = 64;
+// Pixels tested together by the edge function loop
+const int LANES = 8;
+// Sub-pixel precision of triangle vertices (8 bits, as common in GPUs)
+const int64_t SUBPIXEL = 256;
+// Primitives set up per batch
+const size_t BATCH_SIZE = 4096;
+// Triangles and lines are clipped to the view frustum widened by this
+// factor in x/y (guard band), which keeps fixed-point coordinates small
+const float GUARD_BAND = 2.f;
+
+using LaneF = Eigen::Array<float, LANES, 1>;
+using LaneMask = Eigen::Array<bool, LANES, 1>;
+
+// Vertex of a primitive being clipped, with its barycentric coordinates in
+// the original primitive
+struct ClipVert {
+    Vector4f pos;
+    Vector3f bary;
+};
+
+// Position of clip-space point p relative to frustum plane i (near, far,
+// left, right, bottom, top), inside if >= 0; guard widens the x/y planes
+float plane_dist(const Vector4f& p, int plane, float guard) {
+    switch (plane) {
+        case 0:
+            return p.z() + p.w();
+        case 1:
+            return p.w() - p.z();
+        case 2:
+            return p.x() + guard * p.w();
+        case 3:
+            return guard * p.w() - p.x();
+        case 4:
+            return p.y() + guard * p.w();
+        default:
+            return guard * p.w() - p.y();
+    }
+}
+
+// Clip a convex polygon to the guard band frustum (Sutherland-Hodgman)
+void clip_polygon(std::vector<ClipVert>& poly, std::vector<ClipVert>& tmp) {
+    for (int plane = 0; plane < 6 && !poly.empty(); ++plane) {
+        tmp.clear();
+        for (size_t i = 0; i < poly.size(); ++i) {
+            const ClipVert& a = poly[i];
+            const ClipVert& b = poly[(i + 1) % poly.size()];
+            const float da = plane_dist(a.pos, plane, GUARD_BAND),
+                        db = plane_dist(b.pos, plane, GUARD_BAND);
+            if (da >= 0.f) tmp.push_back(a);
+            if ((da >= 0.f) != (db >= 0.f)) {
+                const float t = da / (da - db);
+                tmp.push_back(ClipVert{a.pos + t * (b.pos - a.pos),
+                                       a.bary + t * (b.bary - a.bary)});
+            }
+        }
+        poly.swap(tmp);
+    }
+}
+
+// Clip a line segment to the guard band frustum (Liang-Barsky);
+// false if nothing is left
+bool clip_line(ClipVert& a, ClipVert& b) {
+    float t0 = 0.f, t1 = 1.f;
+    for (int plane = 0; plane < 6; ++plane) {
+        const float da = plane_dist(a.pos, plane, GUARD_BAND),
+                    db = plane_dist(b.pos, plane, GUARD_BAND);
+        if (da < 0.f && db < 0.f) return false;
+        if (da < 0.f) {
+            t0 = std::max(t0, da / (da - db));
+        } else if (db < 0.f) {
+            t1 = std::min(t1, da / (da - db));
+        }
+    }
+    if (t0 > t1) return false;
+    const ClipVert a0 = a;
+    if (t0 > 0.f) {
+        a = ClipVert{a0.pos + t0 * (b.pos - a0.pos),
+                     a0.bary + t0 * (b.bary - a0.bary)};
+    }
+    if (t1 < 1.f) {
+        b = ClipVert{a0.pos + t1 * (b.pos - a0.pos),
+                     a0.bary + t1 * (b.bary - a0.bary)};
+    }
+    return true;
+}
+
+// Twice the signed area of triangle a b p (positive if counter-clockwise)
+inline int64_t edge(int64_t ax, int64_t ay, int64_t bx, int64_t by,
+                    int64_t px, int64_t py) {
+    return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+// Pixel containing fixed-point coordinate v
+inline int floor_pixel(int64_t v) {
+    return (int)(v >= 0 ? v / SUBPIXEL : -((SUBPIXEL - 1 - v) / SUBPIXEL));
+}
+
+// Whether edge a->b of a counter-clockwise triangle (y up) is a top or left
+// edge, which own the pixels exactly on them
+inline bool top_left(int64_t ax, int64_t ay, int64_t bx, int64_t by) {
+    return by < ay || (by == ay && bx < ax);
+}
+
+// First pixel column of the LANES-aligned groups covering [x0, ...) within
+// the tile starting at tile_x
+inline int lane_start(int x0, int tile_x) {
+    return tile_x + (x0 - tile_x) / LANES * LANES;
+}
+
+}  // namespace
+
+void Rasterizer::render(const std::vector<Draw>& draws, const Camera& camera,
+                        const Light& light, const Options& options,
+                        int width, int height, const Target& target) {
+    ThreadPool& pool = ThreadPool::get();
+    _draws = &draws;
+    _light = light;
+    _options = options;
+    _view = camera.view;
+    _view_pos = camera.get_pos();
+    _width = width;
+    _height = height;
+    _tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    _tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    // Vertex stage
+    _vertices.resize(draws.size());
+    for (size_t d = 0; d < draws.size(); ++d) {
+        const Draw& draw = draws[d];
+        Vertices& out = _vertices[d];
+        const Matrix4f mvp = camera.proj * camera.view * draw.model;
+        const Matrix3f normal_matrix =
+            draw.model.topLeftCorner<3, 3>().inverse().transpose();
+        out.clip.resize(draw.n_verts, 4);
+        out.world.resize(draw.n_verts, 3);
+        out.attr.resize(draw.n_verts, 3);
+        out.normal.resize(draw.stride >= 9 ? draw.n_verts : 0, 3);
+        pool.parallel_for(0, draw.n_verts, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const float* v = draw.verts + i * draw.stride;
+                const Vector4f pos(v[0], v[1], v[2], 1.f);
+                out.clip.row(i).noalias() = (mvp * pos).transpose();
+                out.world.row(i).noalias() =
+                    (draw.model * pos).head<3>().transpose();
+                out.attr.row(i) = Eigen::Map<const Eigen::RowVector3f>(v + 3);
+                if (draw.stride >= 9) {
+                    out.normal.row(i).noalias() =
+                        (normal_matrix *
+                         Eigen::Map<const Vector3f>(v + 6))
+                            .transpose();
+                }
+            }
+        });
+    }
+
+    // Primitive setup and binning, in batches
+    size_t n_batches = 0;
+    for (size_t d = 0; d < draws.size(); ++d) {
+        const Draw& draw = draws[d];
+        size_t n_prims;
+        if (draw.primitive == Primitive::triangles) {
+            n_prims = (draw.indices ? draw.n_indices : draw.n_verts) / 3;
+        } else if (draw.primitive == Primitive::lines) {
+            n_prims = draw.n_verts / 2;
+        } else {
+            n_prims = draw.n_verts;
+        }
+        for (size_t begin = 0; begin < n_prims; begin += BATCH_SIZE) {
+            if (n_batches == _batches.size()) _batches.emplace_back();
+            Batch& batch = _batches[n_batches++];
+            batch.draw = d;
+            batch.begin = begin;
+            batch.end = std::min(begin + BATCH_SIZE, n_prims);
+        }
+    }
+    _batches.resize(n_batches);
+    pool.parallel_for(
+        0, n_batches,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) setup(_batches[i]);
+        },
+        1);
+
+    // Rasterize and shade tiles
+    pool.parallel_for(
+        0, (size_t)_tiles_x * _tiles_y,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) raster_tile(i, target);
+        },
+        1);
+}
+
+void Rasterizer::setup(Batch& batch) {
+    const Draw& draw = (*_draws)[batch.draw];
+    const Vertices& vertices = _vertices[batch.draw];
+    batch.prims.clear();
+    batch.bins.resize((size_t)_tiles_x * _tiles_y);
+    for (auto& bin : batch.bins) bin.clear();
+
+    auto to_window = [this](const Vector4f& p, Prim& prim, int k) {
+        const float inv_w = 1.f / p.w();
+        prim.x[k] = (p.x() * inv_w + 1.f) * 0.5f * _width;
+        prim.y[k] = (p.y() * inv_w + 1.f) * 0.5f * _height;
+        prim.z[k] = (p.z() * inv_w + 1.f) * 0.5f;
+        prim.inv_w[k] = inv_w;
+        prim.X[k] = std::llround(prim.x[k] * SUBPIXEL);
+        prim.Y[k] = std::llround(prim.y[k] * SUBPIXEL);
+    };
+    auto set_bary = [](Prim& prim, int k, const Vector3f& bary) {
+        for (int j = 0; j < 3; ++j) prim.bary[k][j] = bary[j];
+    };
+    // Emit a line through the given (clip-space) ends
+    auto emit_line = [&](Prim& prim, ClipVert a, ClipVert b) {
+        if (!clip_line(a, b)) return;
+        prim.n = 2;
+        to_window(a.pos, prim, 0);
+        to_window(b.pos, prim, 1);
+        set_bary(prim, 0, a.bary);
+        set_bary(prim, 1, b.bary);
+        prim.x0 = (int)std::floor(std::min(prim.x[0], prim.x[1]));
+        prim.x1 = (int)std::floor(std::max(prim.x[0], prim.x[1])) + 1;
+        prim.y0 = (int)std::floor(std::min(prim.y[0], prim.y[1]));
+        prim.y1 = (int)std::floor(std::max(prim.y[0], prim.y[1])) + 1;
+        emit(batch, prim);
+    };
+    auto clip_vert = [&](Index v, int k) {
+        Vector3f bary = Vector3f::Zero();
+        bary[k] = 1.f;
+        return ClipVert{vertices.clip.row(v).transpose(), bary};
+    };
+
+    std::vector<ClipVert> poly, tmp;
+    for (size_t i = batch.begin; i < batch.end; ++i) {
+        Prim prim;
+        prim.draw = (uint32_t)batch.draw;
+        prim.id = (uint32_t)i;
+        if (draw.primitive == Primitive::points) {
+            prim.verts[0] = prim.verts[1] = prim.verts[2] = (Index)i;
+            const Vector4f p = vertices.clip.row(i).transpose();
+            bool inside = p.w() > 0.f;
+            for (int plane = 0; plane < 6 && inside; ++plane) {
+                inside = plane_dist(p, plane, 1.f) >= 0.f;
+            }
+            if (!inside) continue;
+            prim.n = 1;
+            to_window(p, prim, 0);
+            set_bary(prim, 0, Vector3f(1.f, 0.f, 0.f));
+            const int size = std::max((int)std::lround(draw.point_size), 1);
+            prim.x0 = (int)std::ceil(prim.x[0] - 0.5f * size - 0.5f);
+            prim.y0 = (int)std::ceil(prim.y[0] - 0.5f * size - 0.5f);
+            prim.x1 = prim.x0 + size;
+            prim.y1 = prim.y0 + size;
+            emit(batch, prim);
+        } else if (draw.primitive == Primitive::lines) {
+            prim.verts[0] = (Index)(2 * i);
+            prim.verts[1] = prim.verts[2] = (Index)(2 * i + 1);
+            emit_line(prim, clip_vert(prim.verts[0], 0),
+                      clip_vert(prim.verts[1], 1));
+        } else {
+            for (int k = 0; k < 3; ++k) {
+                prim.verts[k] =
+                    draw.indices ? draw.indices[3 * i + k] : (Index)(3 * i + k);
+            }
+            poly.clear();
+            for (int k = 0; k < 3; ++k) {
+                poly.push_back(clip_vert(prim.verts[k], k));
+            }
+            // Trivially reject if outside the frustum
+            bool outside = false, needs_clip = false;
+            for (int plane = 0; plane < 6 && !outside; ++plane) {
+                int n_out = 0, n_out_guard = 0;
+                for (const ClipVert& v : poly) {
+                    n_out += plane_dist(v.pos, plane, 1.f) < 0.f;
+                    n_out_guard += plane_dist(v.pos, plane, GUARD_BAND) < 0.f;
+                }
+                outside = n_out == 3;
+                needs_clip |= n_out_guard > 0;
+            }
+            if (outside) continue;
+
+            if (_options.wireframe) {
+                // Cull by the orientation of the unclipped triangle
+                if (_options.cull_face && poly[0].pos.w() > 0.f &&
+                    poly[1].pos.w() > 0.f && poly[2].pos.w() > 0.f) {
+                    Prim tri;
+                    for (int k = 0; k < 3; ++k) to_window(poly[k].pos, tri, k);
+                    if (edge(tri.X[0], tri.Y[0], tri.X[1], tri.Y[1], tri.X[2],
+                             tri.Y[2]) < 0) {
+                        continue;
+                    }
+                }
+                for (int k = 0; k < 3; ++k) {
+                    emit_line(prim, poly[k], poly[(k + 1) % 3]);
+                }
+                continue;
+            }
+
+            if (needs_clip) clip_polygon(poly, tmp);
+            // Triangulate the clipped polygon as a fan
+            for (size_t k = 1; k + 1 < poly.size(); ++k) {
+                const ClipVert* fan[3] = {&poly[0], &poly[k], &poly[k + 1]};
+                for (int j = 0; j < 3; ++j) to_window(fan[j]->pos, prim, j);
+                prim.area = edge(prim.X[0], prim.Y[0], prim.X[1], prim.Y[1],
+                                 prim.X[2], prim.Y[2]);
+                if (prim.area == 0) continue;
+                if (prim.area < 0) {
+                    // Back-facing (clockwise in window coordinates)
+                    if (_options.cull_face) continue;
+                    std::swap(fan[1], fan[2]);
+                    to_window(fan[1]->pos, prim, 1);
+                    to_window(fan[2]->pos, prim, 2);
+                    prim.area = -prim.area;
+                }
+                for (int j = 0; j < 3; ++j) set_bary(prim, j, fan[j]->bary);
+                prim.n = 3;
+                const int64_t x_min = std::min({prim.X[0], prim.X[1], prim.X[2]}),
+                              x_max = std::max({prim.X[0], prim.X[1], prim.X[2]}),
+                              y_min = std::min({prim.Y[0], prim.Y[1], prim.Y[2]}),
+                              y_max = std::max({prim.Y[0], prim.Y[1], prim.Y[2]});
+                // Pixels whose centers may be inside
+                prim.x0 = floor_pixel(x_min - SUBPIXEL / 2);
+                prim.x1 = floor_pixel(x_max - SUBPIXEL / 2) + 1;
+                prim.y0 = floor_pixel(y_min - SUBPIXEL / 2);
+                prim.y1 = floor_pixel(y_max - SUBPIXEL / 2) + 1;
+                emit(batch, prim);
+            }
+        }
+    }
+}
+
+void Rasterizer::emit(Batch& batch, Prim& prim) {
+    prim.x0 = std::max(prim.x0, 0);
+    prim.y0 = std::max(prim.y0, 0);
+    prim.x1 = std::min(prim.x1, _width);
+    prim.y1 = std::min(prim.y1, _height);
+    if (prim.x0 >= prim.x1 || prim.y0 >= prim.y1) return;
+    const uint32_t index = (uint32_t)batch.prims.size();
+    batch.prims.push_back(prim);
+    for (int ty = prim.y0 / TILE_SIZE; ty <= (prim.y1 - 1) / TILE_SIZE; ++ty) {
+        for (int tx = prim.x0 / TILE_SIZE; tx <= (prim.x1 - 1) / TILE_SIZE;
+             ++tx) {
+            batch.bins[(size_t)ty * _tiles_x + tx].push_back(index);
+        }
+    }
+}
+
+template <class Int>
+void Rasterizer::raster_triangle(const Prim& prim, int x0, int y0, int x1,
+                                 int y1, int tile_x, int tile_y, float* depth,
+                                 const Prim** visible) const {
+    using LaneI = Eigen::Array<Int, LANES, 1>;
+    // Start lanes at a multiple of LANES within the tile
+    const int lane_x0 = lane_start(x0, tile_x);
+    Eigen::Array<int, LANES, 1> xs;
+    for (int k = 0; k < LANES; ++k) xs[k] = lane_x0 + k;
+
+    // Edge i is opposite vertex i; evaluated at pixel centers in fixed
+    // point, at the first lane group of the row and stepped incrementally
+    LaneI e_row[3], step_x[3];
+    Int step_y[3], bias[3];
+    const int64_t px = lane_x0 * SUBPIXEL + SUBPIXEL / 2,
+                  py = y0 * SUBPIXEL + SUBPIXEL / 2;
+    for (int e = 0; e < 3; ++e) {
+        const int a = (e + 1) % 3, b = (e + 2) % 3;
+        const int64_t e_start =
+            edge(prim.X[a], prim.Y[a], prim.X[b], prim.Y[b], px, py);
+        const int64_t dx = -(prim.Y[b] - prim.Y[a]) * SUBPIXEL;
+        for (int k = 0; k < LANES; ++k) e_row[e][k] = (Int)(e_start + k * dx);
+        step_x[e].setConstant((Int)(dx * LANES));
+        step_y[e] = (Int)((prim.X[b] - prim.X[a]) * SUBPIXEL);
+        bias[e] = top_left(prim.X[a], prim.Y[a], prim.X[b], prim.Y[b]) ? 0 : 1;
+    }
+    const float inv_area = 1.f / (float)prim.area;
+    for (int y = y0; y < y1; ++y) {
+        float* depth_row = depth + (size_t)(y - tile_y) * TILE_SIZE;
+        const Prim** visible_row = visible + (size_t)(y - tile_y) * TILE_SIZE;
+        LaneI e[3] = {e_row[0], e_row[1], e_row[2]};
+        for (int x = lane_x0; x < x1; x += LANES) {
+            LaneMask mask = (xs >= x0 - (x - lane_x0)) &&
+                            (xs < x1 - (x - lane_x0));
+            for (int k = 0; k < 3; ++k) mask = mask && (e[k] >= bias[k]);
+            if (mask.any()) {
+                const LaneF z = (e[0].template cast<float>() * prim.z[0] +
+                                 e[1].template cast<float>() * prim.z[1] +
+                                 e[2].template cast<float>() * prim.z[2]) *
+                                inv_area;
+                Eigen::Map<LaneF> depth_lanes(depth_row + x - tile_x);
+                mask = mask && (z < depth_lanes);
+                if (mask.any()) {
+                    depth_lanes = mask.select(z, depth_lanes);
+                    for (int k = 0; k < LANES; ++k) {
+                        if (mask[k]) visible_row[x - tile_x + k] = &prim;
+                    }
+                }
+            }
+            for (int k = 0; k < 3; ++k) e[k] += step_x[k];
+        }
+        for (int k = 0; k < 3; ++k) e_row[k] += step_y[k];
+    }
+}
+
+void Rasterizer::raster_tile(size_t tile, const Target& target) {
+    // Visibility buffer: window depth and nearest primitive per pixel
+    thread_local std::vector<float> depth;
+    thread_local std::vector<const Prim*> visible;
+    depth.assign(TILE_SIZE * TILE_SIZE, 1.f);
+    visible.assign(TILE_SIZE * TILE_SIZE, nullptr);
+
+    const int tile_x = (int)(tile % _tiles_x) * TILE_SIZE,
+              tile_y = (int)(tile / _tiles_x) * TILE_SIZE;
+    const int tile_x1 = std::min(tile_x + TILE_SIZE, _width),
+              tile_y1 = std::min(tile_y + TILE_SIZE, _height);
+
+    // Depth test a fragment at tile-local pixel i
+    auto test = [&](const Prim& prim, size_t i, float z) {
+        if (z < depth[i]) {
+            depth[i] = z;
+            visible[i] = &prim;
+        }
+    };
+
+    for (const Batch& batch : _batches) {
+        for (uint32_t index : batch.bins[tile]) {
+            const Prim& prim = batch.prims[index];
+            const int x0 = std::max(prim.x0, tile_x),
+                      x1 = std::min(prim.x1, tile_x1),
+                      y0 = std::max(prim.y0, tile_y),
+                      y1 = std::min(prim.y1, tile_y1);
+            if (prim.n == 3) {
+                // Edge functions (twice the area of a, b and the pixel
+                // center) are at most |bx - ax| * span_y + |by - ay| *
+                // span_x over the spans of the vertices and the evaluated
+                // pixel centers, stepped one past the last group and row.
+                // Those of small triangles, most of a dense mesh, fit in 32
+                // bits: SSE/AVX have vectorized 32-bit adds and compares
+                // but no 64-bit multiplies or conversions to float
+                const int64_t ex0 = lane_start(x0, tile_x) * SUBPIXEL,
+                              ex1 = (x1 + 2 * LANES) * SUBPIXEL,
+                              ey0 = y0 * SUBPIXEL, ey1 = (y1 + 1) * SUBPIXEL;
+                const int64_t span_x =
+                    std::max({prim.X[0], prim.X[1], prim.X[2], ex1}) -
+                    std::min({prim.X[0], prim.X[1], prim.X[2], ex0});
+                const int64_t span_y =
+                    std::max({prim.Y[0], prim.Y[1], prim.Y[2], ey1}) -
+                    std::min({prim.Y[0], prim.Y[1], prim.Y[2], ey0});
+                bool fits = true;
+                for (int e = 0; e < 3; ++e) {
+                    const int a = (e + 1) % 3, b = (e + 2) % 3;
+                    fits &= std::abs(prim.X[b] - prim.X[a]) * span_y +
+                                std::abs(prim.Y[b] - prim.Y[a]) * span_x <
+                            ((int64_t)1 << 31);
+                }
+                if (fits) {
+                    raster_triangle<int32_t>(prim, x0, y0, x1, y1, tile_x,
+                                             tile_y, depth.data(),
+                                             visible.data());
+                } else {
+                    raster_triangle<int64_t>(prim, x0, y0, x1, y1, tile_x,
+                                             tile_y, depth.data(),
+                                             visible.data());
+                }
+            } else if (prim.n == 2) {
+                // One fragment per column (x-major) or row (y-major) whose
+                // center lies within the segment
+                const float dx = prim.x[1] - prim.x[0],
+                            dy = prim.y[1] - prim.y[0];
+                const bool x_major = std::abs(dx) >= std::abs(dy);
+                const float lo = x_major ? std::min(prim.x[0], prim.x[1])
+                                         : std::min(prim.y[0], prim.y[1]),
+                            hi = x_major ? std::max(prim.x[0], prim.x[1])
+                                         : std::max(prim.y[0], prim.y[1]);
+                if (hi == lo) continue;
+                const int i0 = x_major ? x0 : y0, i1 = x_major ? x1 : y1;
+                for (int i = i0; i < i1; ++i) {
+                    const float c = i + 0.5f;
+                    if (c < lo || c >= hi) continue;
+                    const float t = x_major ? (c - prim.x[0]) / dx
+                                            : (c - prim.y[0]) / dy;
+                    const int j = (int)std::floor(
+                        x_major ? prim.y[0] + t * dy : prim.x[0] + t * dx);
+                    const int x = x_major ? i : j, y = x_major ? j : i;
+                    if (x < x0 || x >= x1 || y < y0 || y >= y1) continue;
+                    test(prim,
+                         (size_t)(y - tile_y) * TILE_SIZE + (x - tile_x),
+                         prim.z[0] + t * (prim.z[1] - prim.z[0]));
+                }
+            } else {
+                for (int y = y0; y < y1; ++y) {
+                    for (int x = x0; x < x1; ++x) {
+                        test(prim,
+                             (size_t)(y - tile_y) * TILE_SIZE + (x - tile_x),
+                             prim.z[0]);
+                    }
+                }
+            }
+        }
+    }
+
+    // Shade visible pixels
+    const Vector3f& background = _options.background;
+    for (int y = tile_y; y < tile_y1; ++y) {
+        for (int x = tile_x; x < tile_x1; ++x) {
+            const Prim* prim =
+                visible[(size_t)(y - tile_y) * TILE_SIZE + (x - tile_x)];
+            // Output rows are top to bottom
+            const size_t out = (size_t)(_height - 1 - y) * _width + x;
+            if (prim == nullptr) {
+                if (target.color) {
+                    write_rgba8(background, target.color + out * 4);
+                }
+                if (target.depth) target.depth[out] = 0.f;
+                if (target.normals) target.normals[out] = 0;
+                if (target.ids) target.ids[out * 2] = target.ids[out * 2 + 1] = 0;
+                continue;
+            }
+
+            // Perspective-correct weights of the primitive's vertices
+            float w[3] = {1.f, 0.f, 0.f};
+            if (prim->n == 3) {
+                const int64_t px = x * SUBPIXEL + SUBPIXEL / 2,
+                              py = y * SUBPIXEL + SUBPIXEL / 2;
+                for (int e = 0; e < 3; ++e) {
+                    const int a = (e + 1) % 3, b = (e + 2) % 3;
+                    w[e] = (float)edge(prim->X[a], prim->Y[a], prim->X[b],
+                                       prim->Y[b], px, py) /
+                           (float)prim->area;
+                }
+            } else if (prim->n == 2) {
+                const float dx = prim->x[1] - prim->x[0],
+                            dy = prim->y[1] - prim->y[0];
+                const float t = std::abs(dx) >= std::abs(dy)
+                                    ? (x + 0.5f - prim->x[0]) / dx
+                                    : (y + 0.5f - prim->y[0]) / dy;
+                w[0] = 1.f - t;
+                w[1] = t;
+            }
+            float w_sum = 0.f;
+            for (int k = 0; k < prim->n; ++k) {
+                w[k] *= prim->inv_w[k];
+                w_sum += w[k];
+            }
+            // Barycentric coordinates in the original primitive
+            Vector3f bary = Vector3f::Zero();
+            for (int k = 0; k < prim->n; ++k) {
+                for (int j = 0; j < 3; ++j) {
+                    bary[j] += w[k] / w_sum * prim->bary[k][j];
+                }
+            }
+
+            const Draw& draw = (*_draws)[prim->draw];
+            const Vertices& vertices = _vertices[prim->draw];
+            Vector3f world = Vector3f::Zero(), attr = Vector3f::Zero(),
+                     normal = Vector3f::Zero();
+            for (int j = 0; j < 3; ++j) {
+                if (bary[j] == 0.f) continue;
+                const Index v = prim->verts[j];
+                world += bary[j] * vertices.world.row(v).transpose();
+                attr += bary[j] * vertices.attr.row(v).transpose();
+                if (vertices.normal.rows()) {
+                    normal += bary[j] * vertices.normal.row(v).transpose();
+                }
+            }
+
+            Vector3f color;
+            if (draw.shading == Shading::flat) {
+                color = attr;
+            } else {
+                Vector3f object_color = attr, specular_color = Vector3f::Ones();
+                if (draw.shading == Shading::texture) {
+                    object_color =
+                        sample_texture(draw.diffuse, attr.x(), attr.y());
+                    specular_color =
+                        sample_texture(draw.specular, attr.x(), attr.y());
+                }
+                const Vector3f norm = normal.normalized();
+                color = shade_phong(_light, _view_pos, world, norm,
+                                    object_color, specular_color,
+                                    draw.shininess);
+                if (target.normals) target.normals[out] = pack_normal(norm);
+            }
+            if (target.color) write_rgba8(color, target.color + out * 4);
+            if (target.depth) {
+                target.depth[out] =
+                    -(_view.row(2).head<3>().dot(world) + _view(2, 3));
+            }
+            if (target.normals && draw.shading == Shading::flat) {
+                target.normals[out] = 0;
+            }
+            if (target.ids) {
+                target.ids[out * 2] = draw.object_id;
+                target.ids[out * 2 + 1] = prim->id;
+            }
+        }
+    }
+}
+
+}  // namespace internal
+}  // namespace meshview
@@ -0,0 +1,340 @@
+#include "meshview/internal/ray_tracer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <Eigen/Geometry>
+#include "meshview/meshview.hpp"
+#include "meshview/internal/shading.hpp"
+#include "meshview/internal/thread_pool.hpp"
+
+namespace meshview {
+namespace internal {
+
+namespace {
+// Image tile size in pixels, traced by one task
+const int TILE_SIZE = 16;
+// Pixels per ray packet (PACKET_W x PACKET_H = RAY_PACKET_SIZE)
+const int PACKET_W = 4, PACKET_H = 2;
+// Maximum triangles per BLAS leaf
+const size_t LEAF_SIZE = 4;
+
+// Vertex index j of face f
+inline size_t face_vertex(const RayTracer::Draw& draw, size_t f, int j) {
+    return draw.indices ? (size_t)draw.indices[3 * f + j] : 3 * f + j;
+}
+}  // namespace
+
+double RayTracer::render(const std::vector<Draw>& draws, const Camera& camera,
+                         const Light& light, const Options& options,
+                         int width, int height, const Target& target) {
+    ThreadPool& pool = ThreadPool::get();
+    _light = light;
+    _options = options;
+    _view = camera.view;
+    _view_pos = camera.get_pos();
+    _inv_view_proj =
+        (camera.proj.cast<double>() * camera.view.cast<double>()).inverse();
+    _width = width;
+    _height = height;
+    _tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const int tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    // Bottom level: build or reuse a BVH per triangle draw, dropping those
+    // of draws no longer present
+    for (auto& blas : _blas) blas->used = false;
+    _instances.clear();
+    for (const Draw& draw : draws) {
+        if (draw.primitive != Rasterizer::Primitive::triangles) continue;
+        const Blas* blas = get_blas(draw);
+        if (blas->triangles.empty()) continue;
+        Instance inst;
+        inst.draw = &draw;
+        inst.blas = blas;
+        inst.inv_model = draw.model.inverse();
+        inst.normal_matrix =
+            draw.model.topLeftCorner<3, 3>().inverse().transpose();
+        inst.front_sign =
+            draw.model.topLeftCorner<3, 3>().determinant() < 0.f ? -1.f : 1.f;
+        _instances.push_back(inst);
+    }
+    _blas.erase(std::remove_if(_blas.begin(), _blas.end(),
+                               [](const std::unique_ptr<Blas>& blas) {
+                                   return !blas->used;
+                               }),
+                _blas.end());
+
+    // Top level, over world-space bounds of each instance
+    std::vector<Eigen::AlignedBox3f> boxes(_instances.size());
+    for (size_t i = 0; i < _instances.size(); ++i) {
+        const Eigen::AlignedBox3f local = _instances[i].blas->bvh.bounds();
+        const Matrix4f& model = _instances[i].draw->model;
+        for (int corner = 0; corner < 8; ++corner) {
+            boxes[i].extend(
+                (model * local
+                             .corner((Eigen::AlignedBox3f::CornerType)corner)
+                             .homogeneous())
+                    .head<3>());
+        }
+    }
+    _tlas.build(boxes, 1);
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    pool.parallel_for(
+        0, (size_t)_tiles_x * tiles_y,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) trace_tile(i, target);
+        },
+        1);
+    const double elapsed = std::chrono::duration<double>(
+                               std::chrono::high_resolution_clock::now() -
+                               start)
+                               .count();
+    return (double)width * height / std::max(elapsed, 1e-9);
+}
+
+RayTracer::Blas* RayTracer::get_blas(const Draw& draw) {
+    const size_t n_faces =
+        (draw.indices ? draw.n_indices : draw.n_verts) / 3;
+    for (auto& blas : _blas) {
+        if (draw.key && blas->key == draw.key && !blas->used &&
+            blas->version == draw.version && blas->verts == draw.verts &&
+            blas->indices == draw.indices && blas->n_verts == draw.n_verts &&
+            blas->n_indices == draw.n_indices) {
+            blas->used = true;
+            return blas.get();
+        }
+    }
+
+    _blas.push_back(std::make_unique<Blas>());
+    Blas& blas = *_blas.back();
+    blas.key = draw.key;
+    blas.version = draw.version;
+    blas.verts = draw.verts;
+    blas.indices = draw.indices;
+    blas.n_verts = draw.n_verts;
+    blas.n_indices = draw.n_indices;
+    blas.used = true;
+
+    ThreadPool& pool = ThreadPool::get();
+    auto position = [&](size_t f, int j) {
+        return Eigen::Map<const Vector3f>(draw.verts +
+                                          face_vertex(draw, f, j) * draw.stride);
+    };
+    std::vector<Eigen::AlignedBox3f> boxes(n_faces);
+    pool.parallel_for(0, n_faces, [&](size_t begin, size_t end) {
+        for (size_t f = begin; f < end; ++f) {
+            for (int j = 0; j < 3; ++j) boxes[f].extend(position(f, j));
+        }
+    });
+    blas.bvh.build(boxes, LEAF_SIZE);
+    blas.triangles.resize(n_faces);
+    pool.parallel_for(0, n_faces, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            const uint32_t f = blas.bvh.indices()[k];
+            Triangle& tri = blas.triangles[k];
+            tri.v0 = position(f, 0);
+            tri.e1 = position(f, 1) - tri.v0;
+            tri.e2 = position(f, 2) - tri.v0;
+            tri.id = f;
+        }
+    });
+    return &blas;
+}
+
+void RayTracer::trace(RayPacket& rays) const {
+    using Lanes = RayPacket::Lanes;
+    using Mask = RayPacket::Mask;
+    _tlas.traverse(rays, [&](uint32_t first, uint32_t count) {
+        for (uint32_t i = first; i < first + count; ++i) {
+            const uint32_t instance = _tlas.indices()[i];
+            const Instance& inst = _instances[instance];
+            const Blas& blas = *inst.blas;
+            const Matrix4f& m = inst.inv_model;
+
+            // Same rays (and t) in object space
+            RayPacket local;
+            for (int a = 0; a < 3; ++a) {
+                local.o[a] = m(a, 0) * rays.o[0] + m(a, 1) * rays.o[1] +
+                             m(a, 2) * rays.o[2] + m(a, 3);
+                local.d[a] = m(a, 0) * rays.d[0] + m(a, 1) * rays.d[1] +
+                             m(a, 2) * rays.d[2];
+            }
+            local.t = rays.t;
+            local.active = rays.active;
+            local.init();
+
+            // Moller-Trumbore, one triangle against all rays
+            blas.bvh.traverse(local, [&](uint32_t tri_first,
+                                         uint32_t tri_count) {
+                for (uint32_t k = tri_first; k < tri_first + tri_count; ++k) {
+                    const Triangle& tri = blas.triangles[k];
+                    const Lanes px = local.d[1] * tri.e2.z() -
+                                     local.d[2] * tri.e2.y(),
+                                py = local.d[2] * tri.e2.x() -
+                                     local.d[0] * tri.e2.z(),
+                                pz = local.d[0] * tri.e2.y() -
+                                     local.d[1] * tri.e2.x();
+                    const Lanes det =
+                        tri.e1.x() * px + tri.e1.y() * py + tri.e1.z() * pz;
+                    const Lanes inv_det = det.inverse();
+                    const Lanes sx = local.o[0] - tri.v0.x(),
+                                sy = local.o[1] - tri.v0.y(),
+                                sz = local.o[2] - tri.v0.z();
+                    const Lanes u = (sx * px + sy * py + sz * pz) * inv_det;
+                    const Lanes qx = sy * tri.e1.z() - sz * tri.e1.y(),
+                                qy = sz * tri.e1.x() - sx * tri.e1.z(),
+                                qz = sx * tri.e1.y() - sy * tri.e1.x();
+                    const Lanes v = (local.d[0] * qx + local.d[1] * qy +
+                                     local.d[2] * qz) *
+                                    inv_det;
+                    const Lanes t = (tri.e2.x() * qx + tri.e2.y() * qy +
+                                     tri.e2.z() * qz) *
+                                    inv_det;
+                    // Front faces have det > 0 (the ray opposes the normal)
+                    const Mask facing =
+                        _options.cull_face
+                            ? Mask(det * inst.front_sign > 0.f)
+                            : Mask(det != 0.f);
+                    const Mask hit = local.active && facing && (u >= 0.f) &&
+                                     (v >= 0.f) && (u + v <= 1.f) &&
+                                     (t > 0.f) && (t < local.t);
+                    if (!hit.any()) continue;
+                    local.t = hit.select(t, local.t);
+                    local.u = hit.select(u, local.u);
+                    local.v = hit.select(v, local.v);
+                    local.prim = hit.select(
+                        RayPacket::LanesU::Constant(tri.id), local.prim);
+                }
+            });
+
+            const Mask closer = local.t < rays.t;
+            if (!closer.any()) continue;
+            rays.t = closer.select(local.t, rays.t);
+            rays.u = closer.select(local.u, rays.u);
+            rays.v = closer.select(local.v, rays.v);
+            rays.prim = closer.select(local.prim, rays.prim);
+            rays.object = closer.select(
+                RayPacket::LanesU::Constant(instance), rays.object);
+        }
+    });
+}
+
+void RayTracer::trace_tile(size_t tile, const Target& target) {
+    const int x0 = (int)(tile % _tiles_x) * TILE_SIZE;
+    const int y0 = (int)(tile / _tiles_x) * TILE_SIZE;
+    const int x1 = std::min(x0 + TILE_SIZE, _width);
+    const int y1 = std::min(y0 + TILE_SIZE, _height);
+    for (int py = y0; py < y1; py += PACKET_H) {
+        for (int px = x0; px < x1; px += PACKET_W) {
+            // Rays from the near to the far plane through pixel centers,
+            // t in [0, 1]
+            RayPacket rays;
+            for (int k = 0; k < RAY_PACKET_SIZE; ++k) {
+                const int x = px + k % PACKET_W, y = py + k / PACKET_W;
+                rays.active[k] = x < x1 && y < y1;
+                if (!rays.active[k]) {
+                    for (int a = 0; a < 3; ++a) {
+                        rays.o[a][k] = 0.f;
+                        rays.d[a][k] = 1.f;
+                    }
+                    continue;
+                }
+                const double ndc_x = (x + 0.5) / _width * 2.0 - 1.0;
+                const double ndc_y = 1.0 - (y + 0.5) / _height * 2.0;
+                const Eigen::Vector4d near =
+                    _inv_view_proj * Eigen::Vector4d(ndc_x, ndc_y, -1.0, 1.0);
+                const Eigen::Vector4d far =
+                    _inv_view_proj * Eigen::Vector4d(ndc_x, ndc_y, 1.0, 1.0);
+                const Eigen::Vector3d o = near.head<3>() / near.w();
+                const Eigen::Vector3d d = far.head<3>() / far.w() - o;
+                for (int a = 0; a < 3; ++a) {
+                    rays.o[a][k] = (float)o[a];
+                    rays.d[a][k] = (float)d[a];
+                }
+            }
+            rays.t.setOnes();
+            rays.init();
+            trace(rays);
+
+            for (int k = 0; k < RAY_PACKET_SIZE; ++k) {
+                if (!rays.active[k]) continue;
+                const size_t out = (size_t)(py + k / PACKET_W) * _width + px +
+                                   k % PACKET_W;
+                if (rays.object[k] == ~0u) {
+                    if (target.color) {
+                        write_rgba8(_options.background,
+                                    target.color + out * 4);
+                    }
+                    if (target.depth) target.depth[out] = 0.f;
+                    if (target.normals) target.normals[out] = 0;
+                    if (target.ids) {
+                        target.ids[out * 2] = target.ids[out * 2 + 1] = 0;
+                    }
+                    if (target.barycentrics) {
+                        target.barycentrics[out * 2] =
+                            target.barycentrics[out * 2 + 1] = 0.f;
+                    }
+                    continue;
+                }
+
+                // Interpolate vertex attributes at the hit
+                const Instance& inst = _instances[rays.object[k]];
+                const Draw& draw = *inst.draw;
+                const size_t face = rays.prim[k];
+                const float bary[3] = {1.f - rays.u[k] - rays.v[k], rays.u[k],
+                                       rays.v[k]};
+                Vector3f pos = Vector3f::Zero(), attr = Vector3f::Zero(),
+                         normal = Vector3f::Zero();
+                for (int j = 0; j < 3; ++j) {
+                    const float* v =
+                        draw.verts + face_vertex(draw, face, j) * draw.stride;
+                    pos += bary[j] * Eigen::Map<const Vector3f>(v);
+                    attr += bary[j] * Eigen::Map<const Vector3f>(v + 3);
+                    if (draw.stride >= 9) {
+                        normal += bary[j] * Eigen::Map<const Vector3f>(v + 6);
+                    }
+                }
+                const Vector3f world =
+                    (draw.model * pos.homogeneous()).head<3>();
+
+                Vector3f color;
+                uint32_t packed_normal = 0;
+                if (draw.shading == Rasterizer::Shading::flat) {
+                    color = attr;
+                } else {
+                    Vector3f object_color = attr,
+                             specular_color = Vector3f::Ones();
+                    if (draw.shading == Rasterizer::Shading::texture) {
+                        object_color =
+                            sample_texture(draw.diffuse, attr.x(), attr.y());
+                        specular_color =
+                            sample_texture(draw.specular, attr.x(), attr.y());
+                    }
+                    const Vector3f norm =
+                        (inst.normal_matrix * normal).normalized();
+                    color = shade_phong(_light, _view_pos, world, norm,
+                                        object_color, specular_color,
+                                        draw.shininess);
+                    packed_normal = pack_normal(norm);
+                }
+                if (target.color) write_rgba8(color, target.color + out * 4);
+                if (target.depth) {
+                    target.depth[out] =
+                        -(_view.row(2).head<3>().dot(world) + _view(2, 3));
+                }
+                if (target.normals) target.normals[out] = packed_normal;
+                if (target.ids) {
+                    target.ids[out * 2] = draw.object_id;
+                    target.ids[out * 2 + 1] = (uint32_t)face;
+                }
+                if (target.barycentrics) {
+                    target.barycentrics[out * 2] = rays.u[k];
+                    target.barycentrics[out * 2 + 1] = rays.v[k];
+                }
+            }
+        }
+    }
+}
+
+}  // namespace internal
+}  // namespace meshview
@@ -0,0 +1,182 @@
+#include "meshview/recorder.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "meshview/util.hpp"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <signal.h>
+#endif
+
+namespace meshview {
+
+Recorder::Recorder(const Options& options) : _options(options) {
+    size_t num_writers = _options.num_writers;
+    if (_options.format == Format::raw_pipe) {
+        _pipe = popen(_options.path.c_str(), "w");
+        if (_pipe == nullptr) {
+            std::cerr << "Recorder: failed to start '" << _options.path
+                      << "'\n";
+            _ok = false;
+            return;
+        }
+        num_writers = 1;
+    } else if (num_writers == 0) {
+        num_writers =
+            std::max<size_t>(std::thread::hardware_concurrency() / 2, 1);
+    }
+    _options.max_queue = std::max<size_t>(_options.max_queue, 1);
+    for (size_t i = 0; i < num_writers; ++i) {
+        _writers.emplace_back(&Recorder::writer, this);
+    }
+}
+
+Recorder::~Recorder() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stop = true;
+    }
+    _cv_push.notify_all();
+    for (auto& thd : _writers) thd.join();
+    if (_pipe != nullptr) pclose(_pipe);
+}
+
+bool Recorder::push(std::vector<uint8_t>&& frame, int width, int height) {
+    std::unique_lock<std::mutex> lock(_mtx);
+    ++_stats.captured;
+    if (!_ok || _writers.empty()) {
+        ++_stats.dropped;
+        return false;
+    }
+    if (_options.format == Format::raw_pipe) {
+        // The raw stream has no frame headers: the encoder was told one
+        // size, that of the first frame
+        if (_width == 0) {
+            _width = width;
+            _height = height;
+        } else if (width != _width || height != _height) {
+            if (!_size_warned) {
+                std::cerr << "Recorder: dropping " << width << "x" << height
+                          << " frames, the stream is " << _width << "x"
+                          << _height << "\n";
+                _size_warned = true;
+            }
+            ++_stats.dropped;
+            _free.push_back(std::move(frame));
+            return false;
+        }
+    }
+    if (_queue.size() >= _options.max_queue) {
+        if (_options.policy == QueuePolicy::drop) {
+            ++_stats.dropped;
+            _free.push_back(std::move(frame));
+            return false;
+        }
+        _cv_pop.wait(lock,
+                     [this] { return _queue.size() < _options.max_queue; });
+    }
+    _queue.push_back(Frame{std::move(frame), width, height, _next_index++});
+    _stats.max_queued = std::max(_stats.max_queued, _queue.size());
+    lock.unlock();
+    _cv_push.notify_one();
+    return true;
+}
+
+std::vector<uint8_t> Recorder::buffer(size_t size) {
+    std::vector<uint8_t> buf;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (!_free.empty()) {
+            buf = std::move(_free.back());
+            _free.pop_back();
+        }
+    }
+    buf.resize(size);
+    return buf;
+}
+
+void Recorder::flush() {
+    std::unique_lock<std::mutex> lock(_mtx);
+    _cv_pop.wait(lock, [this] { return _queue.empty() && _writing == 0; });
+}
+
+Recorder::Stats Recorder::stats() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _stats;
+}
+
+void Recorder::writer() {
+#ifndef _WIN32
+    if (_pipe != nullptr) {
+        // An encoder exiting early should fail the write, not kill the
+        // process
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    }
+#endif
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _cv_push.wait(lock, [this] { return _stop || !_queue.empty(); });
+            if (_queue.empty()) break;
+            frame = std::move(_queue.front());
+            _queue.pop_front();
+            ++_writing;
+        }
+        _cv_pop.notify_all();
+        const size_t bytes = write(frame);
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            --_writing;
+            if (bytes > 0) {
+                ++_stats.written;
+                _stats.bytes_written += bytes;
+            } else {
+                ++_stats.dropped;
+            }
+            // Keep enough buffers around to refill the queue
+            if (_free.size() < _options.max_queue + _writers.size()) {
+                _free.push_back(std::move(frame.data));
+            }
+        }
+        _cv_pop.notify_all();
+    }
+}
+
+size_t Recorder::write(Frame& frame) {
+    const size_t n_pixels = (size_t)frame.width * frame.height;
+    const int channels = _options.alpha ? 4 : 3;
+    if (!_options.alpha) {
+        // Drop alpha in place
+        uint8_t* data = frame.data.data();
+        for (size_t i = 0; i < n_pixels; ++i) {
+            data[i * 3] = data[i * 4];
+            data[i * 3 + 1] = data[i * 4 + 1];
+            data[i * 3 + 2] = data[i * 4 + 2];
+        }
+    }
+    const size_t bytes = n_pixels * channels;
+    if (_options.format == Format::raw_pipe) {
+        if (!_ok) return 0;
+        if (fwrite(frame.data.data(), 1, bytes, _pipe) != bytes) {
+            std::cerr << "Recorder: write to encoder process failed\n";
+            _ok = false;
+            return 0;
+        }
+        return bytes;
+    }
+    std::vector<char> path(_options.path.size() + 32);
+    snprintf(path.data(), path.size(), _options.path.c_str(),
+             (int)frame.index);
+    return util::write_png(path.data(), frame.data.data(), frame.width,
+                           frame.height, channels, _options.png_compression);
+}
+
+}  // namespace meshview
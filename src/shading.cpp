@@ -0,0 +1,71 @@
+#include "meshview/internal/shading.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace meshview {
+namespace internal {
+
+Vector3f sample_texture(const TextureImage& tex, float u, float v) {
+    if (tex.data == nullptr) return Vector3f(0.7f, 0.7f, 0.7f);
+    const float fx = u * tex.width - 0.5f, fy = v * tex.height - 0.5f;
+    const float fx0 = std::floor(fx), fy0 = std::floor(fy);
+    const float ax = fx - fx0, ay = fy - fy0;
+    auto wrap = [](float i, int n) {
+        int64_t r = (int64_t)i % n;
+        return (int)(r < 0 ? r + n : r);
+    };
+    const int x0 = wrap(fx0, tex.width), x1 = (x0 + 1) % tex.width;
+    const int y0 = wrap(fy0, tex.height), y1 = (y0 + 1) % tex.height;
+    auto texel = [&](int x, int y) {
+        const float* p =
+            tex.data + ((size_t)y * tex.width + x) * tex.channels;
+        return tex.channels == 1 ? Vector3f(p[0], 0.f, 0.f)
+                                 : Vector3f(p[0], p[1], p[2]);
+    };
+    return (1.f - ay) * ((1.f - ax) * texel(x0, y0) + ax * texel(x1, y0)) +
+           ay * ((1.f - ax) * texel(x0, y1) + ax * texel(x1, y1));
+}
+
+Vector3f shade_phong(const Light& light, const Vector3f& view_pos,
+                     const Vector3f& frag_pos, const Vector3f& norm,
+                     const Vector3f& object_color,
+                     const Vector3f& specular_color, float shininess) {
+    const Vector3f light_dir = (light.position - frag_pos).normalized();
+    const float diff = std::max(norm.dot(light_dir), 0.f);
+    const Vector3f view_dir = (view_pos - frag_pos).normalized();
+    const Vector3f halfway_dir = (light_dir + view_dir).normalized();
+    const float spec =
+        std::pow(std::max(view_dir.dot(halfway_dir), 0.f), shininess);
+    return light.ambient.cwiseProduct(object_color) +
+           diff * light.diffuse.cwiseProduct(object_color) +
+           spec * light.specular.cwiseProduct(specular_color);
+}
+
+uint32_t pack_normal(Vector3f n) {
+    const float len = std::abs(n.x()) + std::abs(n.y()) + std::abs(n.z());
+    if (len == 0.f) return 0u;
+    n /= len;
+    float ox = n.x(), oy = n.y();
+    if (n.z() < 0.f) {
+        ox = (1.f - std::abs(n.y())) * (n.x() >= 0.f ? 1.f : -1.f);
+        oy = (1.f - std::abs(n.x())) * (n.y() >= 0.f ? 1.f : -1.f);
+    }
+    auto quantize = [](float o) {
+        return (uint32_t)(std::round(std::min(std::max(o, -1.f), 1.f) *
+                                     32767.f) +
+                          32768.f);
+    };
+    return quantize(ox) | (quantize(oy) << 16);
+}
+
+void write_rgba8(const Vector3f& color, uint8_t* out) {
+    for (int c = 0; c < 3; ++c) {
+        out[c] = (uint8_t)std::lround(
+            std::min(std::max(color[c], 0.f), 1.f) * 255.f);
+    }
+    out[3] = 255;
+}
+
+}  // namespace internal
+}  // namespace meshview
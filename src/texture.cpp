@@ -3,8 +3,10 @@
 #include <iostream>
 #include <GL/glew.h>
 #include "stb_image.h"
+#include "meshview/backend.hpp"
 #include "meshview/util.hpp"
 #include "meshview/internal/assert.hpp"
+#include "meshview/internal/thread_pool.hpp"
 
 namespace meshview {
 
@@ -13,6 +15,22 @@ Texture::Texture(const std::string& path, bool flip)
     : path(path), fallback_color(/*pink*/ 1.f, 0.75f, 0.8f), flip(flip) {
 }
 
+Texture::Texture(const void* encoded, size_t size, bool flip)
+    : fallback_color(/*pink*/ 1.f, 0.75f, 0.8f), flip(flip) {
+    stbi_set_flip_vertically_on_load_thread(flip);
+    int width, height, chnls;
+    uint8_t* data = stbi_load_from_memory((const stbi_uc*)encoded, (int)size,
+            &width, &height, &chnls, 0);
+    if (!data) {
+        std::cerr << "Failed to decode texture image, using fallback color\n";
+        return;
+    }
+    im_u8 = std::make_shared<const ImageU>(
+        Eigen::Map<ImageU>(data, height, width * chnls));
+    stbi_image_free(data);
+    n_channels = chnls;
+}
+
 Texture::Texture(float r, float g, float b) : fallback_color(r, g, b) { }
 Texture::Texture(const Eigen::Ref<const Image>& im, int n_channels) : im_data(im),
      n_channels(n_channels), fallback_color(/*pink*/ 1.f, 0.75f, 0.8f), flip(false) {
@@ -25,21 +43,82 @@ Texture::~Texture() {
 }
 
 void Texture::free_bufs() {
-    if (~id) glDeleteTextures(1, &id);
+    if (~id) backend().delete_textures(1, &id);
     id = -1;
 }
 
+uint8_t* Texture::read_file(int& width, int& height) {
+    // Per-thread flag, as textures may be read on several threads
+    stbi_set_flip_vertically_on_load_thread(flip);
+    int chnls;
+    uint8_t * data = stbi_load(path.c_str(), &width, &height, &chnls, 0);
+    if (!data) {
+        std::cerr << "Failed to load texture " << path << ", using fallback color\n";
+        return nullptr;
+    }
+    im_data.resize(height, width * chnls);
+    Eigen::Map<ImageU> im_u8(data, height, width * chnls);
+    internal::ThreadPool::get().parallel_for(0, height,
+            [&](size_t begin, size_t end) {
+        im_data.middleRows(begin, end - begin).noalias() =
+            im_u8.middleRows(begin, end - begin).cast<float>() / 255.f;
+    });
+    n_channels = chnls;
+    return data;
+}
+
+bool Texture::preload() {
+    if (im_u8) return true;
+    if (path.empty()) return false;
+    stbi_set_flip_vertically_on_load_thread(flip);
+    int width, height, chnls;
+    uint8_t* data = stbi_load(path.c_str(), &width, &height, &chnls, 0);
+    if (!data) {
+        std::cerr << "Failed to load texture " << path << ", using fallback color\n";
+        return false;
+    }
+    im_u8 = std::make_shared<const ImageU>(
+        Eigen::Map<ImageU>(data, height, width * chnls));
+    stbi_image_free(data);
+    n_channels = chnls;
+    return true;
+}
+
+const Image& Texture::image(int& channels) {
+    if (!im_data.rows() && im_u8) {
+        const ImageU& pixels = *im_u8;
+        im_data.resize(pixels.rows(), pixels.cols());
+        internal::ThreadPool::get().parallel_for(0, pixels.rows(),
+                [&](size_t begin, size_t end) {
+            im_data.middleRows(begin, end - begin).noalias() =
+                pixels.middleRows(begin, end - begin).cast<float>() / 255.f;
+        });
+    }
+    if (!im_data.rows() && path.size()) {
+        int width, height;
+        uint8_t * data = read_file(width, height);
+        if (data) stbi_image_free(data);
+    }
+    if (!im_data.rows()) {
+        im_data = fallback_color.transpose();
+        n_channels = 3;
+    }
+    channels = n_channels;
+    return im_data;
+}
+
 void Texture::load() {
+    Backend& be = backend();
     if (!~id)
-        glGenTextures(1, &id);
-    glBindTexture(GL_TEXTURE_2D, id);
+        be.gen_textures(1, &id);
+    be.bind_texture(GL_TEXTURE_2D, id);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    be.tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    be.tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    be.tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    be.tex_parameter(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    auto gl_load_mipmap = [](int width, int height, int chnls, void* data,
+    auto gl_load_mipmap = [&be](int width, int height, int chnls, void* data,
                              int dtype) {
         _MESHVIEW_ASSERT(chnls == 1 || chnls == 3 || chnls == 4);
         GLenum format;
@@ -49,32 +128,30 @@ void Texture::load() {
             format = GL_RGB;
         else //if (chnls == 4)
             format = GL_RGBA;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height,
-                0, format, dtype, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        be.tex_image_2d(GL_TEXTURE_2D, 0, format, width, height,
+                format, dtype, data);
+        be.generate_mipmap(GL_TEXTURE_2D);
     };
 
     bool success = false;
-    if (im_data.rows()) {
+    if (im_u8) {
+        // Decoded by preload
+        gl_load_mipmap(im_u8->cols() / n_channels, im_u8->rows(), n_channels,
+                (void*) im_u8->data(), GL_UNSIGNED_BYTE);
+        success = true;
+    } else if (im_data.rows()) {
         // From memory
         gl_load_mipmap(im_data.cols() / n_channels, im_data.rows(), n_channels,
                 (void*) im_data.data(), GL_FLOAT);
         success = true;
     } else if (path.size()) {
         // From file
-        stbi_set_flip_vertically_on_load(flip);
-        int width, height, chnls;
-        uint8_t * data = stbi_load(path.c_str(), &width, &height, &chnls, 0);
+        int width, height;
+        uint8_t * data = read_file(width, height);
         if (data) {
-            im_data.resize(height, width * chnls);
-            im_data.noalias() = Eigen::Map<ImageU>(data, height, width * chnls)
-                .cast<float>() / 255.f;
-            n_channels = chnls;
-            gl_load_mipmap(width, height, chnls, (void*) data, GL_UNSIGNED_BYTE);
+            gl_load_mipmap(width, height, n_channels, (void*) data, GL_UNSIGNED_BYTE);
             stbi_image_free(data);
             success = true;
-        } else {
-            std::cerr << "Failed to load texture " << path << ", using fallback color\n";
         }
     }
     if (!success) {
@@ -0,0 +1,239 @@
+#include "meshview/internal/thread_pool.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace meshview {
+namespace internal {
+
+namespace {
+// Pool and queue index of the current worker thread, if any
+thread_local const ThreadPool* tls_pool = nullptr;
+thread_local size_t tls_queue_id = 0;
+}  // namespace
+
+ThreadPool& ThreadPool::get() {
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool(size_t num_threads, bool pin) {
+    start(num_threads, pin);
+}
+
+ThreadPool::~ThreadPool() { stop(); }
+
+bool ThreadPool::resize(size_t num_threads, bool pin) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (_users > 0 || _resizing) {
+            std::cerr << "Cannot resize the thread pool while it is in use\n";
+            return false;
+        }
+        _resizing = true;
+    }
+    stop();
+    start(num_threads, pin);
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _resizing = false;
+    }
+    return true;
+}
+
+bool ThreadPool::acquire() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (_resizing) return false;
+    ++_users;
+    return true;
+}
+
+void ThreadPool::release() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    --_users;
+}
+
+void ThreadPool::start(size_t num_threads, bool pin) {
+    if (num_threads == 0) {
+        num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    _stop = false;
+    _queued = 0;
+    const size_t n_workers = num_threads - 1;
+    _queues.clear();
+    for (size_t i = 0; i < n_workers; ++i) {
+        _queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < n_workers; ++i) {
+        _workers.emplace_back(&ThreadPool::worker, this, i, pin);
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stop = true;
+    }
+    _cv.notify_all();
+    for (auto& thd : _workers) thd.join();
+    _workers.clear();
+}
+
+void ThreadPool::push(std::function<void()> task) {
+    // Workers push to their own queue (popped LIFO), others round-robin
+    size_t queue_id = tls_pool == this
+                          ? tls_queue_id
+                          : _next_queue.fetch_add(1) % _queues.size();
+    {
+        std::lock_guard<std::mutex> lock(_queues[queue_id]->mtx);
+        _queues[queue_id]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        ++_queued;
+    }
+    _cv.notify_one();
+}
+
+bool ThreadPool::pop(size_t queue_id, std::function<void()>& task) {
+    const size_t n_queues = _queues.size();
+    for (size_t i = 0; i < n_queues; ++i) {
+        Queue& queue = *_queues[(queue_id + i) % n_queues];
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        if (queue.tasks.empty()) continue;
+        if (i == 0) {
+            // Own queue: newest first, for locality
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            // Steal oldest
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        std::lock_guard<std::mutex> lock_pool(_mtx);
+        --_queued;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::worker(size_t id, bool pin) {
+    tls_pool = this;
+    tls_queue_id = id;
+#ifdef __linux__
+    if (pin) {
+        const size_t n_cores =
+            std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        // Leave core 0 to the main thread
+        CPU_SET((id + 1) % n_cores, &cpuset);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    }
+#endif
+    std::function<void()> task;
+    while (true) {
+        if (pop(id, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(_mtx);
+        _cv.wait(lock, [this] { return _stop || _queued > 0; });
+        if (_stop && _queued == 0) break;
+    }
+    tls_pool = nullptr;
+}
+
+void ThreadPool::parallel_for(size_t begin, size_t end,
+                              const std::function<void(size_t, size_t)>& fn,
+                              size_t grain) {
+    if (end <= begin) return;
+    const size_t n = end - begin;
+    if (grain == 0) {
+        // A few chunks per thread for load balancing
+        grain = std::max<size_t>((n + size() * 4 - 1) / (size() * 4), 1);
+    }
+    const size_t n_chunks = (n + grain - 1) / grain;
+    if (n_chunks <= 1 || !acquire()) {
+        // Serial fallback (also while the pool is being resized)
+        fn(begin, end);
+        return;
+    }
+    struct Release {
+        ThreadPool* pool;
+        ~Release() { pool->release(); }
+    } release{this};
+    if (_workers.empty()) {
+        fn(begin, end);
+        return;
+    }
+
+    // Chunks are claimed from a shared counter by the caller and by helper
+    // tasks; helpers that start after all chunks are claimed exit at once
+    // (and never touch fn). If fn throws, the first exception is kept and
+    // the unclaimed chunks are skipped; the caller rethrows it once all
+    // claimed chunks have finished.
+    struct State {
+        std::atomic<size_t> next_chunk{0}, chunks_done{0};
+        size_t begin, end, grain, n_chunks;
+        const std::function<void(size_t, size_t)>* fn;
+        std::exception_ptr error;
+        std::mutex mtx;
+        std::condition_variable cv;
+
+        void finish(size_t count) {
+            if (chunks_done.fetch_add(count) + count == n_chunks) {
+                std::lock_guard<std::mutex> lock(mtx);
+                cv.notify_all();
+            }
+        }
+
+        void run() {
+            size_t chunk;
+            while ((chunk = next_chunk.fetch_add(1)) < n_chunks) {
+                const size_t chunk_begin = begin + chunk * grain;
+                try {
+                    (*fn)(chunk_begin, std::min(chunk_begin + grain, end));
+                } catch (...) {
+                    {
+                        std::lock_guard<std::mutex> lock(mtx);
+                        if (!error) error = std::current_exception();
+                    }
+                    // Stop claiming; count the chunks nobody will run as
+                    // done along with this one
+                    const size_t claimed =
+                        std::min(next_chunk.exchange(n_chunks), n_chunks);
+                    finish(n_chunks - claimed + 1);
+                    return;
+                }
+                finish(1);
+            }
+        }
+    };
+    auto state = std::make_shared<State>();
+    state->begin = begin;
+    state->end = end;
+    state->grain = grain;
+    state->n_chunks = n_chunks;
+    state->fn = &fn;
+
+    const size_t n_helpers = std::min(_workers.size(), n_chunks - 1);
+    for (size_t i = 0; i < n_helpers; ++i) {
+        push([state]() { state->run(); });
+    }
+    state->run();
+
+    // Wait for chunks still being processed by helpers
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->cv.wait(lock, [&] { return state->chunks_done == n_chunks; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+}  // namespace internal
+}  // namespace meshview
@@ -0,0 +1,111 @@
+#include "meshview/internal/upload.hpp"
+
+#include <iostream>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "meshview/backend.hpp"
+
+namespace meshview {
+namespace internal {
+
+// *** PendingUpload ***
+bool PendingUpload::ready() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _ready;
+}
+
+void PendingUpload::abandon() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (_ready) {
+        free_bufs();
+        _ready = false;
+    }
+    _abandoned = true;
+}
+
+bool PendingUpload::abandoned() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    return _abandoned;
+}
+
+void PendingUpload::complete() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (_abandoned) {
+        free_bufs();
+    } else {
+        _ready = true;
+    }
+}
+
+void PendingUpload::free_bufs() {
+    if (~VBO) backend().delete_buffers(1, &VBO);
+    if (~EBO) backend().delete_buffers(1, &EBO);
+    for (auto& tex : textures) backend().delete_textures(1, &tex[2]);
+    VBO = EBO = -1;
+    textures.clear();
+}
+
+// *** UploadWorker ***
+UploadWorker::UploadWorker(void* share_window) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(1, 1, "meshview-upload", NULL,
+                                          (GLFWwindow*)share_window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!window) {
+        std::cerr << "Failed to create shared GL context for background "
+                     "uploads, uploads will be synchronous\n";
+        return;
+    }
+    _window = (void*)window;
+    _thread = std::thread(&UploadWorker::run, this);
+}
+
+UploadWorker::~UploadWorker() {
+    if (!_window) return;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stop = true;
+        _jobs.clear();
+    }
+    _cv.notify_one();
+    _thread.join();
+    glfwDestroyWindow((GLFWwindow*)_window);
+}
+
+void UploadWorker::submit(std::function<void()> job,
+                          std::function<void()> on_complete) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _jobs.push_back(Job{std::move(job), std::move(on_complete)});
+    }
+    _cv.notify_one();
+}
+
+void UploadWorker::run() {
+    glfwMakeContextCurrent((GLFWwindow*)_window);
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _cv.wait(lock, [this] { return _stop || !_jobs.empty(); });
+            if (_stop) break;
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        job.upload();
+        // Wait for the GPU to consume the upload before handing the objects
+        // over to the main context
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        GLenum status;
+        do {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                      /* 10 ms */ 10000000);
+        } while (status == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(fence);
+        job.on_complete();
+    }
+    glfwMakeContextCurrent(nullptr);
+}
+
+}  // namespace internal
+}  // namespace meshview
@@ -1,11 +1,19 @@
 #include "meshview/util.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <vector>
 #include <Eigen/Geometry>
 
 #include "meshview/common.hpp"
 #include "meshview/internal/assert.hpp"
+#include "meshview/internal/thread_pool.hpp"
+#ifdef MESHVIEW_ZLIB
+#include <zlib.h>
+#endif
 
 namespace meshview {
 namespace util {
@@ -41,58 +49,251 @@ void estimate_normals(const Eigen::Ref<const Points>& verts,
         estimate_normals(verts, out);
         return;
     }
-    Vector face_cnt(verts.rows());
-    face_cnt.setZero();
-
-    out.setZero();
-
-    Eigen::RowVector3f face_normal;
-    for (int i = 0; i < faces.rows(); ++i) {
-        face_normal =
-            (verts.row(faces(i, 1)) - verts.row(faces(i, 0)))
-                .cross(verts.row(faces(i, 2)) - verts.row(faces(i, 1)))
-                .normalized();
-        for (int j = 0; j < 3; ++j) {
-            out.row(faces(i, j)) += face_normal;
-            face_cnt[faces(i, j)] += 1.f;
+    auto& pool = internal::ThreadPool::get();
+    const size_t n_verts = verts.rows(), n_faces = faces.rows();
+
+    // Face normals
+    Points face_normals(n_faces, 3);
+    pool.parallel_for(0, n_faces, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            face_normals.row(i) =
+                (verts.row(faces(i, 1)) - verts.row(faces(i, 0)))
+                    .cross(verts.row(faces(i, 2)) - verts.row(faces(i, 1)))
+                    .normalized();
+        }
+    });
+
+    // Vertex -> incident faces map (CSR), so that vertices can be
+    // accumulated in parallel without write conflicts
+    std::vector<Index> adj_start(n_verts + 1, 0), adj(n_faces * 3);
+    for (size_t i = 0; i < n_faces * 3; ++i) {
+        ++adj_start[faces.data()[i] + 1];
+    }
+    for (size_t i = 0; i < n_verts; ++i) {
+        adj_start[i + 1] += adj_start[i];
+    }
+    {
+        std::vector<Index> adj_end(adj_start.begin(), adj_start.end() - 1);
+        for (size_t i = 0; i < n_faces * 3; ++i) {
+            adj[adj_end[faces.data()[i]]++] = (Index)(i / 3);
         }
     }
-    out.array().colwise() /= face_cnt.array();
+
+    // Average of incident face normals
+    pool.parallel_for(0, n_verts, [&](size_t begin, size_t end) {
+        Eigen::RowVector3f normal;
+        for (size_t i = begin; i < end; ++i) {
+            normal.setZero();
+            for (Index j = adj_start[i]; j < adj_start[i + 1]; ++j) {
+                normal += face_normals.row(adj[j]);
+            }
+            out.row(i) = normal / (float)(adj_start[i + 1] - adj_start[i]);
+        }
+    });
 }
 
 void estimate_normals(const Eigen::Ref<const Points>& verts,
                       Eigen::Ref<Points> out) {
-    Vector face_cnt(verts.rows());
-    face_cnt.setZero();
-    out.setZero();
-    Vector3f face_normal;
-    for (int i = 0; i < verts.rows(); i += 3) {
-        face_cnt.segment<3>(i).array() += 1.f;
-        out.middleRows<3>(i).rowwise() +=
-            (verts.row(i + 1) - verts.row(i))
-                .cross(verts.row(i + 2) - verts.row(i + 1))
-                .normalized();
-    }
-    out.array().colwise() /= face_cnt.array();
+    // Each triangle owns its 3 vertices, so just use the face normal
+    internal::ThreadPool::get().parallel_for(
+        0, verts.rows() / 3, [&](size_t begin, size_t end) {
+            for (size_t i = begin * 3; i < end * 3; i += 3) {
+                out.middleRows<3>(i).rowwise() =
+                    (verts.row(i + 1) - verts.row(i))
+                        .cross(verts.row(i + 2) - verts.row(i + 1))
+                        .normalized();
+            }
+        });
 }
 
 Eigen::Matrix<Index, Eigen::Dynamic, 1> make_uv_to_vert_map(
     size_t num_uv_verts, const Eigen::Ref<const Triangles>& tri_faces,
     const Eigen::Ref<const Triangles>& uv_tri_faces) {
     _MESHVIEW_ASSERT_EQ(tri_faces.rows(), uv_tri_faces.rows());
+    auto& pool = internal::ThreadPool::get();
     Eigen::Matrix<Index, Eigen::Dynamic, 1> result(num_uv_verts);
     result.setConstant(-1);
-    for (size_t i = 0; i < uv_tri_faces.rows(); ++i) {
-        for (size_t j = 0; j < 3; ++j) {
-            result[uv_tri_faces(i, j)] = tri_faces(i, j);
+    // NOTE: in valid input, every write to a uv vertex agrees
+    pool.parallel_for(0, uv_tri_faces.rows(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            for (size_t j = 0; j < 3; ++j) {
+                result[uv_tri_faces(i, j)] = tri_faces(i, j);
+            }
         }
-    }
+    });
     // Each uv vertex must be matched to some vertex
-    for (size_t i = 0; i < num_uv_verts; ++i) {
-        _MESHVIEW_ASSERT_NE(result[i], (Index)-1);
+    std::atomic<bool> all_matched(true);
+    pool.parallel_for(0, num_uv_verts, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (result[i] == (Index)-1) {
+                all_matched = false;
+                return;
+            }
+        }
+    });
+    if (!all_matched) {
+        for (size_t i = 0; i < num_uv_verts; ++i) {
+            _MESHVIEW_ASSERT_NE(result[i], (Index)-1);
+        }
     }
     return result;
 }
 
+namespace {
+// CRC-32 as used by PNG chunks
+uint32_t png_crc(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256];
+    static bool table_init = [] {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return true;
+    }();
+    (void)table_init;
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void put_u32_be(std::vector<uint8_t>& out, uint32_t val) {
+    out.push_back((uint8_t)(val >> 24));
+    out.push_back((uint8_t)(val >> 16));
+    out.push_back((uint8_t)(val >> 8));
+    out.push_back((uint8_t)val);
+}
+
+void put_png_chunk(std::vector<uint8_t>& out, const char* type,
+                   const uint8_t* data, size_t size) {
+    put_u32_be(out, (uint32_t)size);
+    const size_t type_pos = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    put_u32_be(out, png_crc(out.data() + type_pos, size + 4));
+}
+
+// zlib stream of raw using stored (uncompressed) deflate blocks
+std::vector<uint8_t> zlib_stored(const std::vector<uint8_t>& raw) {
+    std::vector<uint8_t> out;
+    const size_t BLOCK = 65535;
+    out.reserve(raw.size() + raw.size() / BLOCK * 5 + 16);
+    out.push_back(0x78);
+    out.push_back(0x01);
+    size_t pos = 0;
+    do {
+        const size_t len = std::min(BLOCK, raw.size() - pos);
+        out.push_back(pos + len == raw.size() ? 1 : 0);
+        out.push_back((uint8_t)(len & 0xff));
+        out.push_back((uint8_t)(len >> 8));
+        out.push_back((uint8_t)(~len & 0xff));
+        out.push_back((uint8_t)((~len >> 8) & 0xff));
+        out.insert(out.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+    } while (pos < raw.size());
+    // Adler-32
+    uint32_t a = 1, b = 0;
+    for (uint8_t c : raw) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_u32_be(out, (b << 16) | a);
+    return out;
+}
+}  // namespace
+
+size_t write_png(const std::string& path, const uint8_t* data, int width,
+                 int height, int channels, int compression_level) {
+    if (channels < 1 || channels > 4 || channels == 2 || width <= 0 ||
+        height <= 0) {
+        std::cerr << "write_png: unsupported image shape\n";
+        return 0;
+    }
+    // Scanlines with the Sub filter, which suits flat rendered backgrounds
+    const size_t row_bytes = (size_t)width * channels;
+    std::vector<uint8_t> raw((row_bytes + 1) * height);
+    for (int r = 0; r < height; ++r) {
+        const uint8_t* src = data + r * row_bytes;
+        uint8_t* dst = raw.data() + r * (row_bytes + 1);
+        dst[0] = 1;
+        for (int i = 0; i < channels; ++i) dst[1 + i] = src[i];
+        for (size_t i = channels; i < row_bytes; ++i) {
+            dst[1 + i] = (uint8_t)(src[i] - src[i - channels]);
+        }
+    }
+
+    std::vector<uint8_t> idat;
+#ifdef MESHVIEW_ZLIB
+    uLongf idat_size = compressBound((uLong)raw.size());
+    idat.resize(idat_size);
+    if (compress2(idat.data(), &idat_size, raw.data(), (uLong)raw.size(),
+                  compression_level) != Z_OK) {
+        std::cerr << "write_png: compression failed\n";
+        return 0;
+    }
+    idat.resize(idat_size);
+#else
+    (void)compression_level;
+    idat = zlib_stored(raw);
+#endif
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    png.reserve(idat.size() + 64);
+    std::vector<uint8_t> ihdr;
+    put_u32_be(ihdr, width);
+    put_u32_be(ihdr, height);
+    const uint8_t color_types[] = {0, 0, 0, 2, 6};
+    // Bit depth, color type, compression, filter, interlace
+    ihdr.insert(ihdr.end(), {8, color_types[channels], 0, 0, 0});
+    put_png_chunk(png, "IHDR", ihdr.data(), ihdr.size());
+    put_png_chunk(png, "IDAT", idat.data(), idat.size());
+    put_png_chunk(png, "IEND", nullptr, 0);
+
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs) {
+        std::cerr << "write_png: could not open " << path << "\n";
+        return 0;
+    }
+    ofs.write((const char*)png.data(), png.size());
+    return ofs ? png.size() : 0;
+}
+
+Vector3f unpack_normal(uint32_t packed) {
+    if (packed == 0) return Vector3f::Zero();
+    const float x = ((float)(packed & 0xffff) - 32768.f) / 32767.f;
+    const float y = ((float)(packed >> 16) - 32768.f) / 32767.f;
+    Vector3f n(x, y, 1.f - std::fabs(x) - std::fabs(y));
+    if (n.z() < 0.f) {
+        // Lower hemisphere was folded over the diagonals
+        n.x() = (1.f - std::fabs(y)) * (x >= 0.f ? 1.f : -1.f);
+        n.y() = (1.f - std::fabs(x)) * (y >= 0.f ? 1.f : -1.f);
+    }
+    return n.normalized();
+}
+
+Points unpack_normals(const Eigen::Ref<const ImageU32>& packed) {
+    Points result(packed.size(), 3);
+    internal::ThreadPool::get().parallel_for(
+        0, packed.rows(), [&](size_t begin, size_t end) {
+            for (size_t r = begin; r < end; ++r) {
+                for (Eigen::Index c = 0; c < packed.cols(); ++c) {
+                    result.row(r * packed.cols() + c) =
+                        unpack_normal(packed(r, c)).transpose();
+                }
+            }
+        });
+    return result;
+}
+
+bool set_num_threads(size_t num_threads, bool pin) {
+    return internal::ThreadPool::get().resize(num_threads, pin);
+}
+
+size_t get_num_threads() { return internal::ThreadPool::get().size(); }
+
 }  // namespace util
 }  // namespace meshview
@@ -1,13 +1,27 @@
 #include "meshview/meshview.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <limits>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <Eigen/Geometry>
 
 #include "meshview/util.hpp"
+#include "meshview/backend.hpp"
+#include "meshview/cache.hpp"
 #include "meshview/internal/shader.hpp"
+#include "meshview/internal/upload.hpp"
+#include "meshview/internal/headless.hpp"
+#include "meshview/internal/framebuffer.hpp"
+#include "meshview/internal/thread_pool.hpp"
+#include "meshview/internal/rasterizer.hpp"
+#include "meshview/internal/ray_tracer.hpp"
+#include "meshview/internal/benchmark.hpp"
 // Inlined shader code
 #include "meshview/internal/shader_inline.hpp"
 
@@ -30,10 +44,32 @@ void error_callback(int error, const char* description) {
     std::cerr << description << "\n";
 }
 
+// De-interleave object ID, primitive ID pairs into result
+void split_ids(const ImageU32& ids, Viewer::AuxBuffers& result) {
+    const size_t height = ids.rows(), width = ids.cols() / 2;
+    result.object_ids.resize(height, width);
+    result.primitive_ids.resize(height, width);
+    internal::ThreadPool::get().parallel_for(
+        0, height, [&](size_t begin, size_t end) {
+            for (size_t r = begin; r < end; ++r) {
+                for (size_t c = 0; c < width; ++c) {
+                    result.object_ids(r, c) = ids(r, 2 * c);
+                    result.primitive_ids(r, c) = ids(r, 2 * c + 1);
+                }
+            }
+        });
+}
+
+// Mark an input event for latency measurement
+void mark_input(meshview::Viewer& viewer) {
+    if (viewer._input_time < 0.0) viewer._input_time = glfwGetTime();
+}
+
 void win_key_callback(GLFWwindow* window, int key, int scancode, int action,
                       int mods) {
     meshview::Viewer& viewer =
         *reinterpret_cast<meshview::Viewer*>(glfwGetWindowUserPointer(window));
+    mark_input(viewer);
     if (viewer.on_key &&
         !viewer.on_key(key, (meshview::input::Action)action, mods))
         return;
@@ -50,12 +86,17 @@ void win_key_callback(GLFWwindow* window, int key, int scancode, int action,
                 glfwSetWindowShouldClose(window, GL_TRUE);
                 break;
             case 'Z':
-                viewer.camera.reset_view();
-                break;
-            case 'O':
-                viewer.camera.ortho = !viewer.camera.ortho;
-                viewer.camera.update_proj();
+                viewer
+                    .viewport_camera(
+                        viewer.viewport_at(viewer._mouse_x, viewer._mouse_y))
+                    .reset_view();
                 break;
+            case 'O': {
+                Camera& camera = viewer.viewport_camera(
+                    viewer.viewport_at(viewer._mouse_x, viewer._mouse_y));
+                camera.ortho = !camera.ortho;
+                camera.update_proj();
+            } break;
             case 'W':
                 viewer.wireframe = !viewer.wireframe;
                 break;
@@ -88,6 +129,15 @@ void win_key_callback(GLFWwindow* window, int key, int scancode, int action,
                     viewer._fullscreen = true;
                 }
             } break;
+            case GLFW_KEY_SPACE:
+                for (auto& animation : viewer.animations) {
+                    if (animation->playing()) {
+                        animation->pause();
+                    } else {
+                        animation->play();
+                    }
+                }
+                break;
             case 'H':
                 std::cout <<
                     R"HELP(Meshview (c) Alex Yu 2020
@@ -102,16 +152,31 @@ W:                         toggle wireframe
 C:                         toggle backface culling
 M:                         toggle maximize window (may not work on some systems)
 F:                         toggle fullscreen window
+space:                     play/pause animations
+, / .:                     previous/next animation frame
 )HELP";
                 break;
         }
     }
+    if ((action == GLFW_PRESS || action == GLFW_REPEAT) &&
+        (key == GLFW_KEY_COMMA || key == GLFW_KEY_PERIOD)) {
+        // Step (paused) animations by a frame, wrapping around
+        for (auto& animation : viewer.animations) {
+            const size_t n = animation->num_frames();
+            if (n == 0) continue;
+            const size_t frame = animation->current_frame();
+            animation->pause();
+            animation->seek(key == GLFW_KEY_PERIOD ? (frame + 1) % n
+                                                   : (frame + n - 1) % n);
+        }
+    }
 }
 
 void win_mouse_button_callback(GLFWwindow* window, int button, int action,
                                int mods) {
     meshview::Viewer& viewer =
         *reinterpret_cast<meshview::Viewer*>(glfwGetWindowUserPointer(window));
+    mark_input(viewer);
     glfwGetCursorPos(window, &viewer._mouse_x, &viewer._mouse_y);
 
     if (action == GLFW_RELEASE) viewer._mouse_button = -1;
@@ -127,6 +192,8 @@ void win_mouse_button_callback(GLFWwindow* window, int button, int action,
     if (action == GLFW_PRESS) {
         viewer._mouse_button = button;
         viewer._mouse_mods = mods;
+        viewer._active_viewport =
+            viewer.viewport_at(viewer._mouse_x, viewer._mouse_y);
     }
 }
 
@@ -135,24 +202,26 @@ void win_mouse_move_callback(GLFWwindow* window, double x, double y) {
 
     meshview::Viewer& viewer =
         *reinterpret_cast<meshview::Viewer*>(glfwGetWindowUserPointer(window));
+    mark_input(viewer);
     double prex = viewer._mouse_x, prey = viewer._mouse_y;
     viewer._mouse_x = x, viewer._mouse_y = y;
+    if (viewer.on_pick) viewer.pick(x, y);
     if (viewer.on_mouse_move && !viewer.on_mouse_move(x, y)) {
         return;
     }
     if (viewer._mouse_button != -1) {
+        Camera& camera = viewer.viewport_camera(viewer._active_viewport);
         if ((viewer._mouse_button == GLFW_MOUSE_BUTTON_LEFT &&
              (viewer._mouse_mods & GLFW_MOD_SHIFT)) ||
             viewer._mouse_button == GLFW_MOUSE_BUTTON_MIDDLE) {
             // Pan
-            viewer.camera.pan_with_mouse((float)(x - prex), (float)(y - prey));
+            camera.pan_with_mouse((float)(x - prex), (float)(y - prey));
         } else if (viewer._mouse_button == GLFW_MOUSE_BUTTON_LEFT &&
                    (viewer._mouse_mods & GLFW_MOD_CONTROL)) {
             // Roll
-            viewer.camera.roll_with_mouse((float)(x - prex), (float)(y - prey));
+            camera.roll_with_mouse((float)(x - prex), (float)(y - prey));
         } else if (viewer._mouse_button == GLFW_MOUSE_BUTTON_LEFT) {
-            viewer.camera.rotate_with_mouse((float)(x - prex),
-                                            (float)(y - prey));
+            camera.rotate_with_mouse((float)(x - prex), (float)(y - prey));
         }
     }
 }
@@ -160,6 +229,7 @@ void win_mouse_move_callback(GLFWwindow* window, double x, double y) {
 void win_scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     meshview::Viewer& viewer =
         *reinterpret_cast<meshview::Viewer*>(glfwGetWindowUserPointer(window));
+    mark_input(viewer);
     if (viewer.on_scroll && !viewer.on_scroll(xoffset, yoffset)) {
         return;
     }
@@ -167,7 +237,8 @@ void win_scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     ImGui_ImplGlfw_ScrollCallback(window, xoffset, yoffset);
     if (ImGui::GetIO().WantCaptureMouse) return;
 #endif
-    viewer.camera.zoom_with_mouse((float)yoffset);
+    viewer.viewport_camera(viewer.viewport_at(viewer._mouse_x, viewer._mouse_y))
+        .zoom_with_mouse((float)yoffset);
 }
 
 // Window resize
@@ -176,15 +247,23 @@ void win_framebuffer_size_callback(GLFWwindow* window, int width, int height) {
         *reinterpret_cast<meshview::Viewer*>(glfwGetWindowUserPointer(window));
     viewer.camera.aspect = (float)width / (float)height;
     viewer.camera.update_proj();
-    glViewport(0, 0, width, height);
+    backend().viewport(0, 0, width, height);
 }
 }  // namespace
 
 Viewer::Viewer() : _fullscreen(false) {
+    background.setZero();
+
+    light_color_ambient.setConstant(0.2f);
+    light_color_diffuse.setConstant(1.f);
+    light_color_specular.setConstant(0.25f);
+    light_pos << 12.f, 10.f, 20.f;
+
     glfwSetErrorCallback(error_callback);
 
     if (!glfwInit()) {
-        std::cerr << "GLFW failed to initialize\n";
+        std::cerr << "GLFW failed to initialize, only headless rendering "
+                     "(render_to_image) is available\n";
         return;
     }
 
@@ -194,32 +273,45 @@ Viewer::Viewer() : _fullscreen(false) {
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
-
-    background.setZero();
-
-    light_color_ambient.setConstant(0.2f);
-    light_color_diffuse.setConstant(1.f);
-    light_color_specular.setConstant(0.25f);
-    light_pos << 12.f, 10.f, 20.f;
 }
 
-Viewer::~Viewer() { glfwTerminate(); }
+Viewer::~Viewer() {
+    destroy_headless();
+    glfwTerminate();
+}
 
 void Viewer::show() {
+    begin_show();
+    // Objects in the headless context are not shared with the window
+    destroy_headless();
     GLFWwindow* window =
         glfwCreateWindow(_width, _height, "meshview", NULL, NULL);
     if (!window) {
+        {
+            std::lock_guard<std::mutex> lock(_post_mtx);
+            _starting = _close_requested = false;
+        }
         glfwTerminate();
         std::cerr << "GLFW window creation failed\n";
         return;
     }
-    _window = (void*)window;
+    {
+        std::lock_guard<std::mutex> lock(_post_mtx);
+        _window = (void*)window;
+        _starting = false;
+        if (_close_requested) {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+            _close_requested = false;
+        }
+    }
 
     camera.aspect = (float)_width / (float)_height;
     camera.update_proj();
     camera.update_view();
 
     glfwMakeContextCurrent(window);
+    int cur_swap_interval = swap_interval;
+    glfwSwapInterval(cur_swap_interval);
 
     glewExperimental = GL_TRUE;
     if (glewInit() != GLEW_OK) {
@@ -229,11 +321,6 @@ void Viewer::show() {
         return;
     }
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_PROGRAM_POINT_SIZE);
-    glDepthFunc(GL_LESS);
-    if (cull_face) glEnable(GL_CULL_FACE);
-
 #ifdef MESHVIEW_IMGUI
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -246,18 +333,8 @@ void Viewer::show() {
     glfwSetCharCallback(window, ImGui_ImplGlfw_CharCallback);
 #endif
 
-    // Compile shaders on-the-fly
-    internal::Shader shader_mesh(MESH_VERTEX_SHADER, MESH_FRAGMENT_SHADER);
-    internal::Shader shader_mesh_vert_color(MESH_VERTEX_SHADER_VERT_COLOR,
-                                            MESH_FRAGMENT_SHADER_VERT_COLOR);
-    internal::Shader shader_pc(POINTCLOUD_VERTEX_SHADER,
-                               POINTCLOUD_FRAGMENT_SHADER);
-
-    // Construct axes object
-    PointCloud axes(Eigen::template Map<const Points>{axes_verts, 6, 3},
-                    Eigen::template Map<const Points>{axes_rgb, 6, 3});
-    axes.draw_lines();
-    axes.update(true);
+    // Compile shaders, create axes
+    init_scene_objects();
 
     // Events
     glfwSetKeyCallback(window, win_key_callback);
@@ -267,64 +344,62 @@ void Viewer::show() {
     glfwSetFramebufferSizeCallback(window, win_framebuffer_size_callback);
     glfwSetWindowUserPointer(window, this);
 
-    glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
-
     glfwSetWindowTitle(window, title.c_str());
 
+    if (async_upload) {
+        _upload_worker = std::make_unique<internal::UploadWorker>(window);
+        if (!_upload_worker->valid()) _upload_worker.reset();
+    }
+
     if (on_open) on_open();
 
     // Ask to re-create the buffers + textures in meshes/pointclouds
     for (auto& mesh : meshes) mesh->update(true);
     for (auto& pc : point_clouds) pc->update(true);
 
-    auto set_light_and_camera = [&](const internal::Shader& shader) {
-        shader.set_vec3("light.ambient", light_color_ambient);
-        shader.set_vec3("light.diffuse", light_color_diffuse);
-        shader.set_vec3("light.specular", light_color_specular);
-        shader.set_vec3(
-            "light.position",
-            (camera.view.inverse() * light_pos.homogeneous()).head<3>());
-        shader.set_vec3("viewPos", camera.get_pos());
-    };
-
     _looping = true;
+    _input_time = -1.0;
+    bool first_frame = true;
     while (!glfwWindowShouldClose(window)) {
-        glClearColor(background[0], background[1], background[2], 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
-        if (cull_face)
-            glEnable(GL_CULL_FACE);
-        else
-            glDisable(GL_CULL_FACE);
-        axes.enable(draw_axes);
-
-        shader_pc.use();
-        axes.draw(shader_pc.id, camera);
-        for (auto& pc : point_clouds) {
-            pc->draw(shader_pc.id, camera);
-        }
-
-        shader_mesh.use();
-        set_light_and_camera(shader_mesh);
-        for (auto& mesh : meshes) {
-            if (mesh->shading_type == Mesh::ShadingType::texture) {
-                mesh->draw(shader_mesh.id, camera);
+        if (low_latency) {
+            // Handle input right before drawing, so that the frame is drawn
+            // with the newest camera state
+            if (loop_wait_events && !first_frame && !picking()) {
+                wait_events();
+            } else {
+                glfwPollEvents();
             }
+            if (glfwWindowShouldClose(window)) break;
+        }
+        first_frame = false;
+        run_posted();
+        update_animations();
+        update_point_streams();
+        if (swap_interval != cur_swap_interval) {
+            cur_swap_interval = swap_interval;
+            glfwSwapInterval(cur_swap_interval);
         }
 
-        shader_mesh_vert_color.use();
-        set_light_and_camera(shader_mesh_vert_color);
-        for (auto& mesh : meshes) {
-            if (mesh->shading_type == Mesh::ShadingType::vertex) {
-                mesh->draw(shader_mesh_vert_color.id, camera);
-            }
+        if (_benchmark) _benchmark->begin_frame(camera);
+        if (viewports.empty()) {
+            draw_scene(camera);
+        } else {
+            int fb_width, fb_height;
+            glfwGetFramebufferSize(window, &fb_width, &fb_height);
+            draw_viewports(fb_width, fb_height);
         }
+        if (_benchmark) _benchmark->end_submit();
+        if (on_pick) update_picking();
 
         if (on_loop && on_loop()) {
-            for (auto& mesh : meshes) mesh->update(true);
-            for (auto& pc : point_clouds) pc->update(true);
+            for (auto& mesh : meshes) update(*mesh, true);
+            for (auto& pc : point_clouds) update(*pc, true);
             camera.update_proj();
             camera.update_view();
+            for (auto& viewport : viewports) {
+                viewport.camera.update_proj();
+                viewport.camera.update_view();
+            }
         }
 
 #ifdef MESHVIEW_IMGUI
@@ -336,42 +411,844 @@ void Viewer::show() {
         ImGui::NewFrame();
 
         if (on_gui && on_gui()) {
-            for (auto& mesh : meshes) mesh->update(true);
-            for (auto& pc : point_clouds) pc->update(true);
+            for (auto& mesh : meshes) update(*mesh, true);
+            for (auto& pc : point_clouds) update(*pc, true);
             camera.update_proj();
             camera.update_view();
+            for (auto& viewport : viewports) {
+                viewport.camera.update_proj();
+                viewport.camera.update_view();
+            }
         }
 
         // Render dear imgui into screen
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 #endif
+        if (_recorder) capture_frame();
 
         glfwSwapBuffers(window);
-        if (loop_wait_events) {
-            glfwWaitEvents();
-        } else {
-            glfwPollEvents();
+        if (finish_after_swap) glFinish();
+        if (_input_time >= 0.0) {
+            const double latency = glfwGetTime() - _input_time;
+            _input_time = -1.0;
+            ++_latency.count;
+            _latency.last = latency;
+            _latency.mean += (latency - _latency.mean) / _latency.count;
+            _latency.max = std::max(_latency.max, latency);
+        }
+        if (_benchmark && _benchmark->end_frame()) {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+        if (!low_latency) {
+            // Keep looping until outstanding picks are delivered
+            if (loop_wait_events && !picking()) {
+                wait_events();
+            } else {
+                glfwPollEvents();
+            }
         }
     }
     _looping = false;
+    if (_benchmark) _benchmark->finish();
 
     if (on_close) on_close();
 
+    // Frames in flight need the context
+    stop_recording();
+    _pick_readback.reset();
+    _pick_fbo.reset();
+    _pick_queries.clear();
+    _pick_requested = _pick_fbo_valid = false;
+
+    // Finish/drop in-flight uploads before tearing down the context
+    _upload_worker.reset();
+
     for (auto& mesh : meshes) {
         mesh->free_bufs();  // Delete any existing buffers to prevent memory
                             // leak
     }
+    // Also drops their uploads which the worker never started
+    for (auto& pc : point_clouds) pc->free_bufs();
+    free_scene_objects();
 
 #ifdef MESHVIEW_IMGUI
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 #endif
-    _window = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_post_mtx);
+        _window = nullptr;
+    }
     glfwDestroyWindow(window);
 }
 
+void Viewer::init_scene_objects() {
+    if (_shader_mesh) return;
+    Backend& be = backend();
+    be.set_enabled(GL_DEPTH_TEST, true);
+    be.set_enabled(GL_PROGRAM_POINT_SIZE, true);
+    be.depth_func(GL_LESS);
+
+    // Compile shaders on-the-fly
+    _shader_mesh = std::make_unique<internal::Shader>(MESH_VERTEX_SHADER,
+                                                      MESH_FRAGMENT_SHADER);
+    _shader_mesh_vert_color = std::make_unique<internal::Shader>(
+        MESH_VERTEX_SHADER_VERT_COLOR, MESH_FRAGMENT_SHADER_VERT_COLOR);
+    _shader_pc = std::make_unique<internal::Shader>(POINTCLOUD_VERTEX_SHADER,
+                                                    POINTCLOUD_FRAGMENT_SHADER);
+
+    // Construct axes object
+    _axes = std::make_unique<PointCloud>(
+        Eigen::template Map<const Points>{axes_verts, 6, 3},
+        Eigen::template Map<const Points>{axes_rgb, 6, 3});
+    _axes->draw_lines();
+    _axes->update(true);
+}
+
+void Viewer::free_scene_objects() {
+    if (!_shader_mesh) return;
+    Backend& be = backend();
+    be.delete_program(_shader_mesh->id);
+    be.delete_program(_shader_mesh_vert_color->id);
+    be.delete_program(_shader_pc->id);
+    _shader_mesh.reset();
+    _shader_mesh_vert_color.reset();
+    _shader_pc.reset();
+    _axes.reset();
+}
+
+void Viewer::draw_scene(const Camera& camera) {
+    init_scene_objects();
+    backend().clear(background[0], background[1], background[2], 1.0f);
+    draw_objects(camera);
+}
+
+void Viewer::draw_objects(const Camera& camera, const Viewport* viewport) {
+    init_scene_objects();
+    Backend& be = backend();
+    be.polygon_mode(wireframe ? GL_LINE : GL_FILL);
+    be.set_enabled(GL_CULL_FACE, cull_face);
+    _axes->enable(draw_axes);
+
+    auto selected = [](const std::vector<size_t>& list, size_t i) {
+        return std::find(list.begin(), list.end(), i) != list.end();
+    };
+    const bool all = viewport == nullptr || viewport->all_objects;
+
+    auto set_light_and_camera = [&](const internal::Shader& shader) {
+        shader.set_vec3("light.ambient", light_color_ambient);
+        shader.set_vec3("light.diffuse", light_color_diffuse);
+        shader.set_vec3("light.specular", light_color_specular);
+        shader.set_vec3(
+            "light.position",
+            (camera.view.inverse() * light_pos.homogeneous()).head<3>());
+        shader.set_vec3("viewPos", camera.get_pos());
+    };
+
+    // Object IDs for the ID buffer (see AuxBuffers)
+    _shader_pc->use();
+    _shader_pc->set_int("ObjectID", 0);
+    _axes->draw(_shader_pc->id, camera);
+    for (size_t i = 0; i < point_clouds.size(); ++i) {
+        if (!all && !selected(viewport->point_clouds, i)) continue;
+        _shader_pc->set_int("ObjectID", (int)(meshes.size() + i + 1));
+        point_clouds[i]->draw(_shader_pc->id, camera);
+    }
+
+    _shader_mesh->use();
+    set_light_and_camera(*_shader_mesh);
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        if (!all && !selected(viewport->meshes, i)) continue;
+        if (meshes[i]->shading_type == Mesh::ShadingType::texture) {
+            _shader_mesh->set_int("ObjectID", (int)(i + 1));
+            meshes[i]->draw(_shader_mesh->id, camera);
+        }
+    }
+
+    _shader_mesh_vert_color->use();
+    set_light_and_camera(*_shader_mesh_vert_color);
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        if (!all && !selected(viewport->meshes, i)) continue;
+        if (meshes[i]->shading_type == Mesh::ShadingType::vertex) {
+            _shader_mesh_vert_color->set_int("ObjectID", (int)(i + 1));
+            meshes[i]->draw(_shader_mesh_vert_color->id, camera);
+        }
+    }
+}
+
+void Viewer::draw_viewports(int width, int height,
+                            internal::Framebuffer* fbo) {
+    Backend& be = backend();
+    if (fbo) {
+        fbo->clear(background[0], background[1], background[2]);
+    } else {
+        be.clear(background[0], background[1], background[2], 1.0f);
+    }
+    // Clear each viewport again, so that viewports on top of others do not
+    // show their depth or pixels
+    be.set_enabled(GL_SCISSOR_TEST, true);
+    for (size_t i = 0; i < viewports.size(); ++i) {
+        int x, y, w, h;
+        viewport_rect(i, width, height, x, y, w, h);
+        if (w <= 0 || h <= 0) continue;
+        be.viewport(x, y, w, h);
+        be.scissor(x, y, w, h);
+        if (fbo) {
+            fbo->clear(background[0], background[1], background[2]);
+        } else {
+            be.clear(background[0], background[1], background[2], 1.0f);
+        }
+        const Viewport& viewport = viewports[i];
+        Camera view = viewport.linked ? camera : viewport.camera;
+        view.aspect = (float)w / (float)h;
+        view.update_proj();
+        draw_objects(view, &viewport);
+    }
+    be.set_enabled(GL_SCISSOR_TEST, false);
+    be.viewport(0, 0, width, height);
+}
+
+void Viewer::viewport_rect(size_t index, int width, int height, int& x,
+                           int& y, int& w, int& h) const {
+    const Viewport& viewport = viewports[index];
+    x = (int)std::lround(viewport.x * width);
+    w = (int)std::lround((viewport.x + viewport.width) * width) - x;
+    // GL rows are bottom-up
+    y = height - (int)std::lround((viewport.y + viewport.height) * height);
+    h = height - (int)std::lround(viewport.y * height) - y;
+}
+
+void Viewer::split_viewports(int rows, int cols, bool linked) {
+    viewports.clear();
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            Viewport viewport;
+            viewport.x = (float)c / cols;
+            viewport.y = (float)r / rows;
+            viewport.width = 1.f / cols;
+            viewport.height = 1.f / rows;
+            viewport.linked = linked;
+            viewport.camera = camera;
+            viewports.push_back(viewport);
+        }
+    }
+}
+
+int Viewer::viewport_at(double x, double y) const {
+    if (_window == nullptr || viewports.empty()) return -1;
+    int win_width, win_height;
+    glfwGetWindowSize((GLFWwindow*)_window, &win_width, &win_height);
+    if (win_width <= 0 || win_height <= 0) return -1;
+    const double fx = x / win_width, fy = y / win_height;
+    for (size_t i = viewports.size(); i-- > 0;) {
+        const Viewport& viewport = viewports[i];
+        if (fx >= viewport.x && fx < viewport.x + viewport.width &&
+            fy >= viewport.y && fy < viewport.y + viewport.height) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+Camera& Viewer::viewport_camera(int index) {
+    if (index < 0 || index >= (int)viewports.size() ||
+        viewports[index].linked) {
+        return camera;
+    }
+    return viewports[index].camera;
+}
+
+bool Viewer::begin_headless(int& width, int& height) {
+    if (_looping) {
+        std::cerr << "Headless rendering is not available while show() is "
+                     "running\n";
+        return false;
+    }
+    if (width <= 0) width = _width;
+    if (height <= 0) height = _height;
+    if (_headless_failed) return false;
+    if (!_headless) {
+        _headless = std::make_unique<internal::HeadlessContext>();
+        if (!_headless->valid()) {
+            _headless.reset();
+            std::cerr << "No OpenGL context for headless rendering, using "
+                         "the software rasterizer\n";
+            _headless_failed = true;
+            return false;
+        }
+        // Fresh context: (re-)upload everything
+        for (auto& mesh : meshes) mesh->update(true);
+        for (auto& pc : point_clouds) pc->update(true);
+    } else {
+        _headless->make_current();
+        for (auto& mesh : meshes) {
+            if (!~mesh->VAO) mesh->update();
+        }
+        for (auto& pc : point_clouds) {
+            if (!~pc->VAO) pc->update();
+        }
+    }
+    if (!_headless_fbo) {
+        _headless_fbo = std::make_unique<internal::Framebuffer>(width, height);
+    } else {
+        _headless_fbo->resize(width, height);
+    }
+    _headless_fbo->bind();
+    return true;
+}
+
+void Viewer::destroy_headless() {
+    if (!_headless) return;
+    _headless->make_current();
+    _headless_fbo.reset();
+    free_scene_objects();
+    for (auto& mesh : meshes) mesh->free_bufs();
+    for (auto& pc : point_clouds) pc->free_bufs();
+    _headless.reset();
+}
+
+bool Viewer::render_to_buffer(const Camera& camera, uint8_t* out, int width,
+                              int height) {
+    if (!use_software() && begin_headless(width, height)) {
+        draw_scene(camera);
+        _headless_fbo->read_rgba(out);
+        return true;
+    }
+    if (!use_software()) return false;
+    render_software(camera, width, height, out);
+    return true;
+}
+
+void Viewer::render_software(const Camera& camera, int width, int height,
+                             uint8_t* color, float* depth, uint32_t* normals,
+                             uint32_t* ids, bool ray_trace,
+                             float* barycentrics) {
+    using internal::Rasterizer;
+    using internal::RayTracer;
+    if (width <= 0) width = _width;
+    if (height <= 0) height = _height;
+
+    // Same draws, in the same order and with the same object IDs, as
+    // draw_objects
+    std::vector<Rasterizer::Draw> draws;
+    PointsRGB axes(6, 6);
+    if (draw_axes) {
+        axes.leftCols<3>() = Eigen::Map<const Points>(axes_verts, 6, 3);
+        axes.rightCols<3>() = Eigen::Map<const Points>(axes_rgb, 6, 3);
+        Rasterizer::Draw draw;
+        draw.primitive = Rasterizer::Primitive::lines;
+        draw.verts = axes.data();
+        draw.n_verts = 6;
+        draws.push_back(draw);
+    }
+    for (size_t i = 0; i < point_clouds.size(); ++i) {
+        PointCloud& pc = *point_clouds[i];
+        if (!pc.enabled) continue;
+        Rasterizer::Draw draw;
+        draw.primitive = pc.lines ? Rasterizer::Primitive::lines
+                                  : Rasterizer::Primitive::points;
+        draw.verts = pc.data.data();
+        draw.n_verts = pc.data.rows();
+        draw.model = pc.transform;
+        draw.point_size = pc.point_size;
+        draw.object_id = (uint32_t)(meshes.size() + i + 1);
+        draws.push_back(draw);
+    }
+    for (auto shading : {Mesh::ShadingType::texture, Mesh::ShadingType::vertex}) {
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            Mesh& mesh = *meshes[i];
+            if (mesh.shading_type != shading || !mesh.enabled ||
+                mesh.data.rows() == 0) {
+                continue;
+            }
+            const PointsRGBNormal* vert_data;
+            const Triangles* face_data;
+            mesh.buffer_data(vert_data, face_data);
+            Rasterizer::Draw draw;
+            draw.verts = vert_data->data();
+            draw.n_verts = vert_data->rows();
+            draw.stride = vert_data->cols();
+            draw.indices = face_data->data();
+            draw.n_indices = face_data->size();
+            draw.model = mesh.transform;
+            draw.shininess = mesh.shininess;
+            draw.object_id = (uint32_t)(i + 1);
+            draw.key = &mesh;
+            draw.version = mesh._version;
+            if (shading == Mesh::ShadingType::texture) {
+                draw.shading = Rasterizer::Shading::texture;
+                // The shader samples the last texture of each type
+                Rasterizer::TextureImage* images[] = {&draw.diffuse,
+                                                      &draw.specular};
+                for (int type = 0; type < Texture::__TYPE_COUNT; ++type) {
+                    if (mesh.textures[type].empty()) continue;
+                    int channels;
+                    const Image& im =
+                        mesh.textures[type].back().image(channels);
+                    images[type]->data = im.data();
+                    images[type]->width = (int)im.cols() / channels;
+                    images[type]->height = (int)im.rows();
+                    images[type]->channels = channels;
+                }
+            } else {
+                draw.shading = Rasterizer::Shading::vertex_color;
+            }
+            draws.push_back(draw);
+        }
+    }
+
+    Rasterizer::Light light;
+    light.position =
+        (camera.view.inverse() * light_pos.homogeneous()).head<3>();
+    light.ambient = light_color_ambient;
+    light.diffuse = light_color_diffuse;
+    light.specular = light_color_specular;
+    Rasterizer::Options options;
+    options.background = background;
+    options.cull_face = cull_face;
+    options.wireframe = wireframe;
+    RayTracer::Target target;
+    target.color = color;
+    target.depth = depth;
+    target.normals = normals;
+    target.ids = ids;
+    target.barycentrics = barycentrics;
+    if (ray_trace) {
+        if (!_ray_tracer) _ray_tracer = std::make_unique<RayTracer>();
+        _ray_trace_rays_per_sec = _ray_tracer->render(
+            draws, camera, light, options, width, height, target);
+    } else {
+        if (!_rasterizer) _rasterizer = std::make_unique<Rasterizer>();
+        _rasterizer->render(draws, camera, light, options, width, height,
+                            target);
+    }
+}
+
+Viewer::AuxBuffers Viewer::render_aux(const Camera& camera, int width,
+                                      int height) {
+    AuxBuffers result;
+    if (width <= 0) width = _width;
+    if (height <= 0) height = _height;
+    result.color.resize(height, (size_t)width * 4);
+    result.depth.resize(height, width);
+    result.normals.resize(height, width);
+    result.object_ids.resize(height, width);
+    result.primitive_ids.resize(height, width);
+    AuxTargets out;
+    out.color = result.color.data();
+    out.depth = result.depth.data();
+    out.normals = result.normals.data();
+    out.object_ids = result.object_ids.data();
+    out.primitive_ids = result.primitive_ids.data();
+    if (!render_aux_to_buffer(camera, out, width, height)) return AuxBuffers();
+    return result;
+}
+
+bool Viewer::render_aux_to_buffer(const Camera& camera, const AuxTargets& out,
+                                  int width, int height) {
+    if (width <= 0) width = _width;
+    if (height <= 0) height = _height;
+    const bool rgb = out.color_channels == 3;
+    const bool use_gl = !use_software() && begin_headless(width, height);
+    if (!use_gl) {
+        if (!use_software()) return false;
+        // The rasterizer writes RGBA and interleaved IDs
+        const size_t n_pixels = (size_t)width * height;
+        std::vector<uint8_t> rgba(out.color && rgb ? n_pixels * 4 : 0);
+        std::vector<uint32_t> ids(
+            out.object_ids || out.primitive_ids ? n_pixels * 2 : 0);
+        render_software(camera, width, height, rgb ? rgba.data() : out.color,
+                        out.depth, out.normals,
+                        ids.empty() ? nullptr : ids.data());
+        internal::ThreadPool::get().parallel_for(
+            0, n_pixels, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    if (!rgba.empty()) {
+                        std::memcpy(out.color + i * 3, &rgba[i * 4], 3);
+                    }
+                    if (out.object_ids) out.object_ids[i] = ids[i * 2];
+                    if (out.primitive_ids) {
+                        out.primitive_ids[i] = ids[i * 2 + 1];
+                    }
+                }
+            });
+        return true;
+    }
+
+    internal::Framebuffer& fbo = *_headless_fbo;
+    const bool aux =
+        out.depth || out.normals || out.object_ids || out.primitive_ids;
+    if (aux) {
+        fbo.set_aux(true);
+        fbo.clear(background[0], background[1], background[2]);
+        draw_objects(camera);
+    } else {
+        draw_scene(camera);
+    }
+    if (out.color) {
+        fbo.read(0, rgb ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, rgb ? 3 : 4,
+                 out.color);
+    }
+    if (out.depth) fbo.read(1, GL_RED, GL_FLOAT, sizeof(float), out.depth);
+    if (out.normals) {
+        fbo.read(2, GL_RED_INTEGER, GL_UNSIGNED_INT, sizeof(uint32_t),
+                 out.normals);
+    }
+    if (out.object_ids) {
+        fbo.read(3, GL_RED_INTEGER, GL_UNSIGNED_INT, sizeof(uint32_t),
+                 out.object_ids);
+    }
+    if (out.primitive_ids) {
+        fbo.read(3, GL_GREEN_INTEGER, GL_UNSIGNED_INT, sizeof(uint32_t),
+                 out.primitive_ids);
+    }
+    if (aux) fbo.set_aux(false);
+    return true;
+}
+
+Viewer::RayTraceBuffers Viewer::ray_trace(const Camera& camera, int width,
+                                          int height) {
+    RayTraceBuffers result;
+    if (width <= 0) width = _width;
+    if (height <= 0) height = _height;
+    result.color.resize(height, (size_t)width * 4);
+    result.depth.resize(height, width);
+    result.normals.resize(height, width);
+    result.barycentrics.resize(height, (size_t)width * 2);
+    ImageU32 ids(height, (size_t)width * 2);
+    render_software(camera, width, height, result.color.data(),
+                    result.depth.data(), result.normals.data(), ids.data(),
+                    true, result.barycentrics.data());
+    split_ids(ids, result);
+    return result;
+}
+
+double Viewer::render_batch_to_buffer(const std::vector<Camera>& cameras,
+                                     uint8_t* out, int width, int height,
+                                     size_t in_flight) {
+    if (cameras.empty()) return 0.0;
+    if (width <= 0) width = _width;
+    if (height <= 0) height = _height;
+    const size_t row_bytes = (size_t)width * 4;
+    const size_t frame_bytes = row_bytes * height;
+    const auto start = std::chrono::high_resolution_clock::now();
+    auto views_per_sec = [&]() {
+        const double elapsed =
+            std::chrono::duration<double>(
+                std::chrono::high_resolution_clock::now() - start)
+                .count();
+        _batch_views_per_sec = cameras.size() / std::max(elapsed, 1e-9);
+        return _batch_views_per_sec;
+    };
+    if (use_software() || !begin_headless(width, height)) {
+        if (!use_software()) return 0.0;
+        // Each view is already rendered in parallel
+        for (size_t i = 0; i < cameras.size(); ++i) {
+            render_software(cameras[i], width, height,
+                            out + i * frame_bytes);
+        }
+        return views_per_sec();
+    }
+
+    internal::AsyncReadback readback(std::max<size_t>(in_flight, 1));
+    auto copy_out = [&](size_t view, const uint8_t* data) {
+        // Flip GL's bottom-up rows
+        uint8_t* dst = out + view * frame_bytes;
+        internal::ThreadPool::get().parallel_for(
+            0, height, [&](size_t begin, size_t end) {
+                for (size_t r = begin; r < end; ++r) {
+                    std::memcpy(dst + r * row_bytes,
+                                data + (height - 1 - r) * row_bytes,
+                                row_bytes);
+                }
+            });
+    };
+    for (size_t i = 0; i < cameras.size(); ++i) {
+        if (readback.full()) readback.pop(copy_out);
+        draw_scene(cameras[i]);
+        readback.push(width, height, GL_RGBA, GL_UNSIGNED_BYTE, 4, i);
+    }
+    while (!readback.empty()) readback.pop(copy_out);
+    return views_per_sec();
+}
+
+bool Viewer::start_recording(const Recorder::Options& options) {
+    stop_recording();
+    _recorder = std::make_unique<Recorder>(options);
+    if (!_recorder->ok()) {
+        _record_stats = _recorder->stats();
+        _recorder.reset();
+        return false;
+    }
+    return true;
+}
+
+void Viewer::stop_recording() {
+    if (!_recorder) return;
+    if (_record_readback) {
+        while (!_record_readback->empty()) pop_recorded_frame();
+        _record_readback.reset();
+    }
+    _recorder->flush();
+    _record_stats = _recorder->stats();
+    _recorder.reset();
+}
+
+Recorder::Stats Viewer::recording_stats() {
+    return _recorder ? _recorder->stats() : _record_stats;
+}
+
+void Viewer::capture_frame() {
+    int width, height;
+    glfwGetFramebufferSize((GLFWwindow*)_window, &width, &height);
+    if (width <= 0 || height <= 0) return;
+    if (!_record_readback) {
+        _record_readback = std::make_unique<internal::AsyncReadback>(2);
+    }
+    // Hand over frames the GPU has finished; only wait if both PBOs are
+    // still in flight
+    while (_record_readback->front_ready()) pop_recorded_frame();
+    if (_record_readback->full()) pop_recorded_frame();
+    glReadBuffer(GL_BACK);
+    _record_readback->push(width, height, GL_RGBA, GL_UNSIGNED_BYTE, 4, 0);
+    _record_sizes.emplace_back(width, height);
+}
+
+void Viewer::pop_recorded_frame() {
+    const int width = _record_sizes.front().first,
+              height = _record_sizes.front().second;
+    _record_sizes.pop_front();
+    const size_t row_bytes = (size_t)width * 4;
+    std::vector<uint8_t> frame = _recorder->buffer(row_bytes * height);
+    _record_readback->pop([&](size_t, const uint8_t* data) {
+        // Flip GL's bottom-up rows
+        internal::ThreadPool::get().parallel_for(
+            0, height, [&](size_t begin, size_t end) {
+                for (size_t r = begin; r < end; ++r) {
+                    std::memcpy(frame.data() + r * row_bytes,
+                                data + (height - 1 - r) * row_bytes,
+                                row_bytes);
+                }
+            });
+    });
+    _recorder->push(std::move(frame), width, height);
+}
+
+void Viewer::pick(double x, double y) {
+    _pick_requested = true;
+    _pick_x = x;
+    _pick_y = y;
+}
+
+size_t Viewer::pick_signature(int width, int height) const {
+    // FNV-1a over the raw bytes
+    size_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void* data, size_t bytes) {
+        const uint8_t* p = (const uint8_t*)data;
+        for (size_t i = 0; i < bytes; ++i) {
+            hash = (hash ^ p[i]) * 1099511628211ULL;
+        }
+    };
+    mix(camera.view.data(), sizeof(float) * 16);
+    mix(camera.proj.data(), sizeof(float) * 16);
+    const int state[] = {width, height, draw_axes, cull_face, wireframe};
+    mix(state, sizeof(state));
+    for (auto& viewport : viewports) {
+        const float rect[] = {viewport.x, viewport.y, viewport.width,
+                              viewport.height};
+        mix(rect, sizeof(rect));
+        mix(&viewport.linked, sizeof(bool));
+        mix(&viewport.all_objects, sizeof(bool));
+        mix(viewport.camera.view.data(), sizeof(float) * 16);
+        mix(viewport.camera.proj.data(), sizeof(float) * 16);
+        const size_t counts[] = {viewport.meshes.size(),
+                                 viewport.point_clouds.size()};
+        mix(counts, sizeof(counts));
+        mix(viewport.meshes.data(), sizeof(size_t) * counts[0]);
+        mix(viewport.point_clouds.data(), sizeof(size_t) * counts[1]);
+    }
+    for (auto& mesh : meshes) {
+        const void* ptr = mesh.get();
+        mix(&ptr, sizeof(ptr));
+        mix(&mesh->_version, sizeof(size_t));
+        mix(&mesh->enabled, sizeof(bool));
+        mix(mesh->transform.data(), sizeof(float) * 16);
+    }
+    for (auto& pc : point_clouds) {
+        const void* ptr = pc.get();
+        mix(&ptr, sizeof(ptr));
+        mix(&pc->_version, sizeof(size_t));
+        mix(&pc->enabled, sizeof(bool));
+        mix(&pc->lines, sizeof(bool));
+        mix(&pc->point_size, sizeof(float));
+        mix(pc->transform.data(), sizeof(float) * 16);
+    }
+    return hash;
+}
+
+void Viewer::update_picking() {
+    // Deliver finished picks, without waiting
+    while (_pick_readback && _pick_readback->front_ready()) {
+        const PickQuery query = _pick_queries.front();
+        _pick_queries.pop_front();
+        PickResult result;
+        result.x = query.x;
+        result.y = query.y;
+        _pick_readback->pop([&](size_t, const uint8_t* data) {
+            // Hit nearest to the query point
+            const uint32_t* ids = (const uint32_t*)data;
+            int best = -1, best_dist = 0;
+            for (int r = 0; r < query.height; ++r) {
+                for (int c = 0; c < query.width; ++c) {
+                    const int i = r * query.width + c;
+                    if (ids[i * 2] == 0) continue;
+                    const int dx = c - query.center_x, dy = r - query.center_y;
+                    const int dist = dx * dx + dy * dy;
+                    if (best < 0 || dist < best_dist) {
+                        best = i;
+                        best_dist = dist;
+                    }
+                }
+            }
+            if (best >= 0) {
+                result.object_id = ids[best * 2];
+                result.primitive = ids[best * 2 + 1];
+            }
+        });
+        result.viewport = viewport_at(query.x, query.y);
+        if (result.object_id > 0 && result.object_id <= meshes.size()) {
+            result.mesh = (int)result.object_id - 1;
+        } else if (result.object_id > meshes.size()) {
+            result.point_cloud = (int)(result.object_id - meshes.size() - 1);
+        }
+        on_pick(result);
+    }
+    if (!_pick_requested) return;
+    if (!_pick_readback) {
+        _pick_readback = std::make_unique<internal::AsyncReadback>(4);
+    }
+    // Keep the request (updated by later mouse moves) until a slot is free
+    if (_pick_readback->full()) return;
+    _pick_requested = false;
+
+    // Window to framebuffer pixels (they differ on high-DPI displays), with
+    // GL's rows bottom-up
+    int win_width, win_height, width, height;
+    glfwGetWindowSize((GLFWwindow*)_window, &win_width, &win_height);
+    glfwGetFramebufferSize((GLFWwindow*)_window, &width, &height);
+    if (width <= 0 || height <= 0 || win_width <= 0 || win_height <= 0) {
+        return;
+    }
+    const int px = (int)std::floor(_pick_x * width / win_width);
+    const int py = height - 1 - (int)std::floor(_pick_y * height / win_height);
+    const int radius = std::max(pick_radius, 0);
+    PickQuery query;
+    query.x = _pick_x;
+    query.y = _pick_y;
+    query.x0 = std::max(px - radius, 0);
+    query.y0 = std::max(py - radius, 0);
+    query.width = std::min(px + radius + 1, width) - query.x0;
+    query.height = std::min(py + radius + 1, height) - query.y0;
+    query.center_x = px - query.x0;
+    query.center_y = py - query.y0;
+    if (query.width <= 0 || query.height <= 0) {
+        // Outside the window
+        PickResult result;
+        result.x = _pick_x;
+        result.y = _pick_y;
+        result.viewport = viewport_at(_pick_x, _pick_y);
+        on_pick(result);
+        return;
+    }
+
+    // Re-render the ID buffer only if anything it depends on changed
+    const size_t signature = pick_signature(width, height);
+    if (!_pick_fbo) {
+        _pick_fbo = std::make_unique<internal::Framebuffer>(width, height);
+        _pick_fbo_valid = false;
+    }
+    _pick_fbo->resize(width, height);
+    _pick_fbo->bind();
+    if (!_pick_fbo_valid || signature != _pick_signature) {
+        _pick_fbo->set_aux(true);
+        if (viewports.empty()) {
+            _pick_fbo->clear(0.f, 0.f, 0.f);
+            draw_objects(camera);
+        } else {
+            draw_viewports(width, height, _pick_fbo.get());
+        }
+        _pick_fbo_valid = true;
+        _pick_signature = signature;
+    }
+    glReadBuffer(GL_COLOR_ATTACHMENT3);
+    _pick_readback->push(query.width, query.height, GL_RG_INTEGER,
+                         GL_UNSIGNED_INT, 2 * sizeof(uint32_t), 0, query.x0,
+                         query.y0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    _pick_queries.push_back(query);
+    internal::Framebuffer::unbind();
+    backend().viewport(0, 0, width, height);
+}
+
+ImageU Viewer::render_batch(const std::vector<Camera>& cameras, int width,
+                            int height) {
+    if (width <= 0) width = _width;
+    if (height <= 0) height = _height;
+    ImageU result(cameras.size() * height, (size_t)width * 4);
+    if (render_batch_to_buffer(cameras, result.data(), width, height) == 0.0) {
+        return ImageU();
+    }
+    return result;
+}
+
+Image Viewer::render_to_image(const Camera& camera, int width, int height) {
+    if (width <= 0) width = _width;
+    if (height <= 0) height = _height;
+    ImageU im_u8(height, width * 4);
+    if (!render_to_buffer(camera, im_u8.data(), width, height)) return Image();
+    Image im(height, width * 4);
+    internal::ThreadPool::get().parallel_for(
+        0, height, [&](size_t begin, size_t end) {
+            im.middleRows(begin, end - begin).noalias() =
+                im_u8.middleRows(begin, end - begin).cast<float>() / 255.f;
+        });
+    return im;
+}
+
+void Viewer::begin_show() {
+    std::lock_guard<std::mutex> lock(_post_mtx);
+    _starting = true;
+}
+
+void Viewer::close() {
+    std::lock_guard<std::mutex> lock(_post_mtx);
+    if (_window == nullptr) {
+        // If show() is starting (perhaps on another thread), close once the
+        // window opens; else there is nothing to close
+        if (_starting) _close_requested = true;
+        return;
+    }
+    glfwSetWindowShouldClose((GLFWwindow*)_window, GLFW_TRUE);
+    glfwPostEmptyEvent();
+}
+
+void Viewer::post(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(_post_mtx);
+    _posted.push_back(std::move(task));
+    if (_window != nullptr) glfwPostEmptyEvent();
+}
+
+void Viewer::run_posted() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(_post_mtx);
+        tasks.swap(_posted);
+    }
+    for (auto& task : tasks) task();
+}
+
 Mesh& Viewer::add_cube(const Eigen::Ref<const Vector3f>& cen, float side_len,
                        const Eigen::Ref<const Vector3f>& color) {
     Mesh cube = Mesh::Cube();
@@ -383,6 +1260,113 @@ Mesh& Viewer::add_cube(const Eigen::Ref<const Vector3f>& cen, float side_len,
                                                       color[2]);
 }
 
+std::vector<Mesh*> Viewer::add_obj(const std::string& path) {
+    std::vector<Mesh*> added;
+    for (auto& mesh : Mesh::load_obj(path)) {
+        meshes.push_back(std::move(mesh));
+        if (_looping) update(*meshes.back());
+        added.push_back(meshes.back().get());
+    }
+    return added;
+}
+
+MeshAnimation* Viewer::add_animation(const std::string& path, Mesh& mesh,
+                                     bool play) {
+    auto animation = std::make_unique<MeshAnimation>();
+    if (!animation->open(path)) return nullptr;
+    if (!animation->apply(0, mesh)) return nullptr;
+    if (_looping) update(mesh);
+    animation->mesh = &mesh;
+    // Frame 0 is already in mesh
+    animation->advance(0.0);
+    if (play) animation->play();
+    animations.push_back(std::move(animation));
+    return animations.back().get();
+}
+
+void Viewer::update_animations() {
+    const double time = glfwGetTime();
+    for (auto& animation : animations) {
+        if (animation->mesh && animation->advance(time) &&
+            animation->apply(animation->current_frame(), *animation->mesh)) {
+            update(*animation->mesh);
+        }
+    }
+}
+
+PointCloudStream* Viewer::add_point_stream(
+    const std::string& path, const PointCloudStream::Options& options) {
+    auto stream = std::make_unique<PointCloudStream>();
+    if (!stream->open(path, options)) return nullptr;
+    stream->point_cloud = &add_point_cloud();
+    point_streams.push_back(std::move(stream));
+    return point_streams.back().get();
+}
+
+void Viewer::update_point_streams() {
+    for (auto& stream : point_streams) {
+        if (stream->point_cloud) {
+            stream->upload(*stream->point_cloud,
+                           stream->options().chunks_per_frame);
+        }
+    }
+}
+
+void Viewer::wait_events() {
+    double timeout = std::numeric_limits<double>::infinity();
+    const double time = glfwGetTime();
+    for (auto& animation : animations) {
+        if (animation->mesh) {
+            timeout = std::min(timeout, animation->time_to_next_frame(time));
+        }
+    }
+    for (auto& stream : point_streams) {
+        // Pick up new chunks at up to 60 frames per second
+        if (stream->point_cloud && stream->loading()) {
+            timeout = std::min(timeout, 1.0 / 60.0);
+        }
+    }
+    if (std::isinf(timeout)) {
+        glfwWaitEvents();
+    } else if (timeout > 0.0) {
+        glfwWaitEventsTimeout(timeout);
+    } else {
+        glfwPollEvents();
+    }
+}
+
+std::vector<Mesh*> Viewer::add_gltf(const std::string& path) {
+    std::vector<Mesh*> added;
+    for (auto& mesh : Mesh::load_gltf(path)) {
+        meshes.push_back(std::move(mesh));
+        if (_looping) update(*meshes.back());
+        added.push_back(meshes.back().get());
+    }
+    return added;
+}
+
+bool Viewer::add_cache(const std::string& path) {
+    SceneCache cache;
+    if (!cache.open(path)) return false;
+    for (size_t i = 0; i < cache.num_meshes(); ++i) {
+        meshes.push_back(cache.load_mesh(i));
+        if (_looping) update(*meshes.back());
+    }
+    for (size_t i = 0; i < cache.num_point_clouds(); ++i) {
+        point_clouds.push_back(cache.load_point_cloud(i));
+        if (_looping) update(*point_clouds.back());
+    }
+    return true;
+}
+
+bool Viewer::save_cache(const std::string& path, bool raw_textures) const {
+    std::vector<const Mesh*> mesh_ptrs;
+    std::vector<const PointCloud*> point_cloud_ptrs;
+    for (auto& mesh : meshes) mesh_ptrs.push_back(mesh.get());
+    for (auto& pc : point_clouds) point_cloud_ptrs.push_back(pc.get());
+    return SceneCache::write(path, mesh_ptrs, point_cloud_ptrs, raw_textures);
+}
+
 Mesh& Viewer::add_square(const Eigen::Ref<const Vector3f>& cen, float side_len,
                          const Eigen::Ref<const Vector3f>& color) {
     Mesh sqr = Mesh::Square();
@@ -407,6 +1391,24 @@ Mesh& Viewer::add_sphere(const Eigen::Ref<const Vector3f>& cen, float radius,
                                                       color[2]);
 }
 
+void Viewer::reset_latency_stats() { _latency = LatencyStats(); }
+
+void Viewer::update(Mesh& mesh, bool force_init) {
+    if (_upload_worker) {
+        mesh.update_async(*_upload_worker);
+    } else {
+        mesh.update(force_init);
+    }
+}
+
+void Viewer::update(PointCloud& point_cloud, bool force_init) {
+    if (_upload_worker) {
+        point_cloud.update_async(*_upload_worker);
+    } else {
+        point_cloud.update(force_init);
+    }
+}
+
 PointCloud& Viewer::add_line(const Eigen::Ref<const Vector3f>& a,
                              const Eigen::Ref<const Vector3f>& b,
                              const Eigen::Ref<const Vector3f>& color) {